@@ -5,35 +5,72 @@
 #define RAPIDJSON_HAS_STDSTRING 1
 #include "rapidjson.h"
 #include "document.h"
+#include "ostreamwrapper.h"
+#include "writer.h"
 
+#include <algorithm>
+#include <atomic>
 #include <iostream>
 #include <fstream>
 #include <sstream>
 #include <string>
+#include <thread>
+#include <sys/stat.h>
 
-AgentsConfig::AgentsConfig(LadderConfig *InLadderConfig)
-    : Config(InLadderConfig),
+namespace {
+
+// In nanoseconds, so an edit within the same second that keeps the size is still seen.
+int64_t GetModifiedTime(const struct stat &FileInfo)
+{
+#if defined(__linux__)
+    return static_cast<int64_t>(FileInfo.st_mtim.tv_sec) * 1000000000 + FileInfo.st_mtim.tv_nsec;
+#elif defined(__APPLE__)
+    return static_cast<int64_t>(FileInfo.st_mtimespec.tv_sec) * 1000000000 + FileInfo.st_mtimespec.tv_nsec;
+#else
+    return static_cast<int64_t>(FileInfo.st_mtime) * 1000000000;
+#endif
+}
+
+bool SameBots(const std::vector<BotConfig> &First, const std::vector<BotConfig> &Second)
+{
+    return std::equal(First.begin(), First.end(), Second.begin(), Second.end(), [](const BotConfig &A, const BotConfig &B)
+    {
+        return A.BotName == B.BotName && A.Race == B.Race && A.Type == B.Type && A.RootPath == B.RootPath && A.FileName == B.FileName
+            && A.Args == B.Args && A.Debug == B.Debug && A.SurrenderPhrase == B.SurrenderPhrase && A.Difficulty == B.Difficulty;
+    });
+}
+
+} // namespace
+
+AgentsConfig::AgentsConfig(std::shared_ptr<const LadderSettings> InSettings, HttpClient *InHttp)
+    : Settings(std::move(InSettings)),
+      Http(InHttp),
       PlayerIds(nullptr),
-      EnablePlayerIds(false)
+      EnablePlayerIds(false),
+      ParsedFilesChanged(false)
 {
-	if (Config == nullptr)
+	if (Settings == nullptr)
 	{
 		return;
 	}
-	std::string PlayerIdFile = Config->GetStringValue("PlayerIdFile");
-	if (PlayerIdFile.length() > 0)
+	if (Settings->PlayerIdFile.length() > 0)
 	{
-		PlayerIds = new LadderConfig(PlayerIdFile);
+		PlayerIds = new LadderConfig(Settings->PlayerIdFile);
         PlayerIds->ParseConfig();
 		EnablePlayerIds = true;
 	}
-	if (Config->GetStringValue("BotConfigFile") != "")
+	BotFileCache = Settings->BotConfigCacheFile;
+	if (!BotFileCache.empty())
 	{
-		LoadAgents("", Config->GetStringValue("BotConfigFile"));
+		LoadBotFileCache();
 	}
-	else if (Config->GetStringValue("BaseBotDirectory") != "")
+	if (!Settings->BotConfigFile.empty())
 	{
-		ReadBotDirectories(Config->GetStringValue("BaseBotDirectory"));
+		LoadAgents("", Settings->BotConfigFile);
+	}
+	else if (!Settings->BaseBotDirectory.empty())
+	{
+		ReadBotDirectories(Settings->BaseBotDirectory);
 	}
 
 }
@@ -42,12 +79,41 @@ void AgentsConfig::ReadBotDirectories(const std::string &BaseDirectory)
 {
 	std::vector<std::string> directories;
 	sc2::scan_directory(BaseDirectory.c_str(), directories, true, true);
-	for (const std::string  &Directory : directories)
+	// Parsing only reads shared state, so the directories are spread over a few threads
+	// and the bots are added afterwards in directory order.
+	std::vector<std::vector<BotConfig>> ParsedBots(directories.size());
+	std::atomic<size_t> NextDirectory(0);
+	const auto ParseDirectories = [&]()
 	{
-		std::string CurrentConfigFile = Directory + "/ladderbots.json";
-		LoadAgents(Directory, CurrentConfigFile);
+		for (size_t Index = NextDirectory++; Index < directories.size(); Index = NextDirectory++)
+		{
+			if (ParseBotFile(directories[Index], directories[Index] + "/ladderbots.json", ParsedBots[Index]))
+			{
+				PrepareBots(ParsedBots[Index]);
+			}
+		}
+	};
+	const size_t Workers = std::min<size_t>(std::max(1u, std::thread::hardware_concurrency()), directories.size());
+	std::vector<std::thread> Threads;
+	for (size_t Worker = 1; Worker < Workers; ++Worker)
+	{
+		Threads.emplace_back(ParseDirectories);
 	}
-
+	ParseDirectories();
+	for (std::thread &Thread : Threads)
+	{
+		Thread.join();
+	}
+	bool NewPlayerIds = false;
+	for (std::vector<BotConfig> &Bots : ParsedBots)
+	{
+		NewPlayerIds |= AddParsedBots(Bots);
+	}
+	if (NewPlayerIds)
+	{
+		PlayerIds->WriteConfig();
+	}
+	SaveBotFileCache();
 }
 
 void AgentsConfig::LoadAgents(const std::string &BaseDirectory, const std::string &BotConfigFile)
@@ -56,6 +122,78 @@ void AgentsConfig::LoadAgents(const std::string &BaseDirectory, const std::strin
 	{
 		return;
 	}
+	std::vector<BotConfig> ParsedBots;
+	if (!ParseBotFile(BaseDirectory, BotConfigFile, ParsedBots))
+	{
+		return;
+	}
+	PrepareBots(ParsedBots);
+	if (AddParsedBots(ParsedBots))
+	{
+		PlayerIds->WriteConfig();
+	}
+	SaveBotFileCache();
+}
+
+size_t AgentsConfig::RemoveAgents(const std::string &BotConfigFile)
+{
+	std::vector<BotConfig> RemovedFileBots;
+	{
+		std::lock_guard<std::mutex> Lock(ParsedFilesMutex);
+		const auto Parsed = ParsedFiles.find(BotConfigFile);
+		if (Parsed == ParsedFiles.end())
+		{
+			return 0;
+		}
+		RemovedFileBots = std::move(Parsed->second.Bots);
+		ParsedFiles.erase(Parsed);
+		ParsedFilesChanged = true;
+	}
+	size_t Removed = 0;
+	for (const BotConfig &Bot : RemovedFileBots)
+	{
+		const BotHandle Handle = GetBotHandle(Bot.BotName);
+		// Handles stay valid, so the bot is kept but never drawn again.
+		if (Handle != InvalidBotHandle && Agents[Handle].Enabled)
+		{
+			Agents[Handle].Enabled = false;
+			RemovedBots.insert(Bot.BotName);
+			++Removed;
+		}
+	}
+	SaveBotFileCache();
+	return Removed;
+}
+
+std::vector<std::string> AgentsConfig::GetBotFiles()
+{
+	std::lock_guard<std::mutex> Lock(ParsedFilesMutex);
+	std::vector<std::string> Files;
+	for (const auto &File : ParsedFiles)
+	{
+		Files.push_back(File.first);
+	}
+	return Files;
+}
+
+bool AgentsConfig::ParseBotFile(const std::string &BaseDirectory, const std::string &BotConfigFile, std::vector<BotConfig> &ParsedBots)
+{
+	struct stat FileInfo;
+	if (stat(BotConfigFile.c_str(), &FileInfo) != 0)
+	{
+		std::cerr << "Unable to parse bot config file: " << BotConfigFile << std::endl;
+		return false;
+	}
+	{
+		std::lock_guard<std::mutex> Lock(ParsedFilesMutex);
+		const auto Cached = ParsedFiles.find(BotConfigFile);
+		if (Cached != ParsedFiles.end() && Cached->second.BaseDirectory == BaseDirectory
+			&& Cached->second.ModifiedTime == GetModifiedTime(FileInfo) && Cached->second.Size == static_cast<int64_t>(FileInfo.st_size))
+		{
+			ParsedBots = Cached->second.Bots;
+			return true;
+		}
+	}
 	std::ifstream t(BotConfigFile);
 	std::stringstream buffer;
 	buffer << t.rdbuf();
@@ -65,7 +203,7 @@ void AgentsConfig::LoadAgents(const std::string &BaseDirectory, const std::strin
 	if (parsingFailed)
 	{
 		std::cerr << "Unable to parse bot config file: " << BotConfigFile << std::endl;
-		return;
+		return false;
 	}
 	if (doc.HasMember("Bots") && doc["Bots"].IsObject())
 	{
@@ -94,6 +232,16 @@ void AgentsConfig::LoadAgents(const std::string &BaseDirectory, const std::strin
                 std::cerr << "Unable to parse type for bot " << NewBot.BotName << std::endl;
                 continue;
             }
+            if (NewBot.Type == Computer)
+            {
+                // Played by the StarCraft II client, there is nothing to start.
+                if (val.HasMember("Difficulty") && val["Difficulty"].IsString())
+                {
+                    NewBot.Difficulty = GetDifficultyFromString(val["Difficulty"].GetString());
+                }
+                ParsedBots.push_back(NewBot);
+                continue;
+            }
             if (val.HasMember("RootPath") && val["RootPath"].IsString())
             {
                 if (!BaseDirectory.empty()) {
@@ -123,14 +271,6 @@ void AgentsConfig::LoadAgents(const std::string &BaseDirectory, const std::strin
                 std::cerr << "Unable to parse file name for bot " << NewBot.BotName << std::endl;
                 continue;
             }
-            if (!sc2::DoesFileExist(NewBot.RootPath + NewBot.FileName))
-            {
-                std::cerr << "Unable to parse bot " << NewBot.BotName << std::endl;
-                std::cerr << "Is the path " << NewBot.RootPath << " correct?" << std::endl;
-                continue;
-            }
-            const std::string dataLocation = NewBot.RootPath + "/data";
-            MakeDirectory(dataLocation); // If a directory exists this just fails and does nothing.
             if (val.HasMember("Args") && val["Args"].IsString())
             {
                 NewBot.Args = val["Args"].GetString();
@@ -142,119 +282,311 @@ void AgentsConfig::LoadAgents(const std::string &BaseDirectory, const std::strin
             if (val.HasMember("SurrenderPhrase") && val["SurrenderPhrase"].IsString()) {
                 NewBot.SurrenderPhrase = val["SurrenderPhrase"].GetString();
             }
+            ParsedBots.push_back(NewBot);
+        }
+	}
+	std::lock_guard<std::mutex> Lock(ParsedFilesMutex);
+	ParsedBotFile &Cached = ParsedFiles[BotConfigFile];
+	// A file that was only rewritten with the same bots, as on every bot download, does not make
+	// the cache file dirty. It is parsed once more on the next start instead.
+	if (Cached.BaseDirectory != BaseDirectory || !SameBots(Cached.Bots, ParsedBots))
+	{
+		ParsedFilesChanged = true;
+	}
+	Cached.BaseDirectory = BaseDirectory;
+	Cached.ModifiedTime = GetModifiedTime(FileInfo);
+	Cached.Size = static_cast<int64_t>(FileInfo.st_size);
+	Cached.Bots = ParsedBots;
+	return true;
+}
 
-            if (EnablePlayerIds)
-            {
-                NewBot.PlayerId = PlayerIds->GetStringValue(NewBot.BotName);
-                if (NewBot.PlayerId.empty())
-                {
-                    NewBot.PlayerId = GerneratePlayerId(PLAYER_ID_LENGTH);
-                    PlayerIds->AddValue(NewBot.BotName, NewBot.PlayerId);
-                    PlayerIds->WriteConfig();
-                }
-            }
+// Checks the parts of a bot that live outside its config file, so these are never taken from the cache.
+void AgentsConfig::PrepareBots(std::vector<BotConfig> &ParsedBots) const
+{
+    auto NewBotIt = ParsedBots.begin();
+    while (NewBotIt != ParsedBots.end())
+    {
+        BotConfig &NewBot = *NewBotIt;
+        if (NewBot.Type == Computer)
+        {
+            ++NewBotIt;
+            continue;
+        }
+        if (!sc2::DoesFileExist(NewBot.RootPath + NewBot.FileName))
+        {
+            std::cerr << "Unable to parse bot " << NewBot.BotName << std::endl;
+            std::cerr << "Is the path " << NewBot.RootPath << " correct?" << std::endl;
+            NewBotIt = ParsedBots.erase(NewBotIt);
+            continue;
+        }
+        const std::string dataLocation = NewBot.RootPath + "/data";
+        MakeDirectory(dataLocation); // If a directory exists this just fails and does nothing.
 
-            std::string OutCmdLine = "";
-            switch (NewBot.Type)
-            {
-            case Python:
-            {
-                OutCmdLine = Config->GetStringValue("PythonBinary") + " " + NewBot.FileName;
-                break;
-            }
-            case Wine:
-            {
-                OutCmdLine = "wine " + NewBot.FileName;
-                break;
-            }
-            case Mono:
-            {
-                OutCmdLine = "mono " + NewBot.FileName;
-                break;
-            }
-            case DotNetCore:
-            {
-                OutCmdLine = "dotnet " + NewBot.FileName;
-                break;
-            }
-            case CommandCenter:
-            {
-                OutCmdLine = Config->GetStringValue("CommandCenterPath") + " --ConfigFile " + NewBot.FileName;
-                break;
-            }
-            case BinaryCpp:
+        std::string OutCmdLine = "";
+        switch (NewBot.Type)
+        {
+        case Python:
+        {
+            OutCmdLine = Settings->PythonBinary + " " + NewBot.FileName;
+            break;
+        }
+        case Wine:
+        {
+            OutCmdLine = "wine " + NewBot.FileName;
+            break;
+        }
+        case Mono:
+        {
+            OutCmdLine = "mono " + NewBot.FileName;
+            break;
+        }
+        case DotNetCore:
+        {
+            OutCmdLine = "dotnet " + NewBot.FileName;
+            break;
+        }
+        case CommandCenter:
+        {
+            OutCmdLine = Settings->CommandCenterPath + " --ConfigFile " + NewBot.FileName;
+            break;
+        }
+        case BinaryCpp:
+        {
+            OutCmdLine = NewBot.RootPath + NewBot.FileName;
+            break;
+        }
+        case Java:
+        {
+            OutCmdLine = "java -jar " + NewBot.FileName;
+            break;
+        }
+        case NodeJS:
+        {
+            OutCmdLine = Settings->NodeJSBinary + " " + NewBot.FileName;
+            break;
+        }
+        case Computer:
+        {
+            break;
+        }
+        }
+
+        if (NewBot.Args != "")
+        {
+            OutCmdLine += " " + NewBot.Args;
+        }
+
+        NewBot.executeCommand = OutCmdLine;
+        ++NewBotIt;
+    }
+}
+
+// Returns true if player ids were generated, the caller writes them to disk once for all files.
+bool AgentsConfig::AddParsedBots(std::vector<BotConfig> &ParsedBots)
+{
+    bool NewPlayerIds = false;
+    for (BotConfig &NewBot : ParsedBots)
+    {
+        if (EnablePlayerIds)
+        {
+            NewBot.PlayerId = PlayerIds->GetStringValue(NewBot.BotName);
+            if (NewBot.PlayerId.empty())
             {
-                OutCmdLine = NewBot.RootPath + NewBot.FileName;
-                break;
+                NewBot.PlayerId = GerneratePlayerId(PLAYER_ID_LENGTH);
+                PlayerIds->AddValue(NewBot.BotName, NewBot.PlayerId);
+                NewPlayerIds = true;
             }
-            case Java:
+        }
+
+        const BotHandle Known = GetBotHandle(NewBot.BotName);
+        if (Known != InvalidBotHandle)
+        {
+            // Reloading a bot's config file keeps what was learned about the bot while running.
+            BotConfig &SavedBot = Agents[Known];
+            NewBot.CheckSum = SavedBot.CheckSum;
+            NewBot.ELO = SavedBot.ELO;
+            // A bot whose config file comes back after it was removed is enabled again.
+            if (RemovedBots.erase(NewBot.BotName) == 0)
             {
-                OutCmdLine = "java -jar " + NewBot.FileName;
-                break;
+                NewBot.Enabled = SavedBot.Enabled;
             }
-            case NodeJS:
+            SavedBot = std::move(NewBot);
+        }
+        else
+        {
+            AddBot(NewBot);
+        }
+    }
+    return NewPlayerIds;
+}
+
+void AgentsConfig::LoadBotFileCache()
+{
+    std::ifstream ifs(BotFileCache);
+    if (!ifs)
+    {
+        return;
+    }
+    std::stringstream buffer;
+    buffer << ifs.rdbuf();
+    rapidjson::Document doc;
+    if (doc.Parse(buffer.str()).HasParseError() || !doc.IsObject() || !doc.HasMember("Files") || !doc["Files"].IsArray())
+    {
+        std::cerr << "Ignoring invalid bot config cache: " << BotFileCache << std::endl;
+        return;
+    }
+    for (const auto &File : doc["Files"].GetArray())
+    {
+        if (!File.IsObject() || !File.HasMember("Path") || !File["Path"].IsString() || !File.HasMember("BaseDirectory") || !File["BaseDirectory"].IsString()
+            || !File.HasMember("ModifiedTimeNs") || !File["ModifiedTimeNs"].IsInt64() || !File.HasMember("Size") || !File["Size"].IsInt64()
+            || !File.HasMember("Bots") || !File["Bots"].IsArray())
+        {
+            continue;
+        }
+        ParsedBotFile Cached;
+        Cached.BaseDirectory = File["BaseDirectory"].GetString();
+        Cached.ModifiedTime = File["ModifiedTimeNs"].GetInt64();
+        Cached.Size = File["Size"].GetInt64();
+        bool Valid = true;
+        for (const auto &Bot : File["Bots"].GetArray())
+        {
+            if (!Bot.IsObject() || !Bot.HasMember("BotName") || !Bot["BotName"].IsString() || !Bot.HasMember("Race") || !Bot["Race"].IsInt()
+                || !Bot.HasMember("Type") || !Bot["Type"].IsInt() || !Bot.HasMember("RootPath") || !Bot["RootPath"].IsString()
+                || !Bot.HasMember("FileName") || !Bot["FileName"].IsString() || !Bot.HasMember("Args") || !Bot["Args"].IsString()
+                || !Bot.HasMember("Debug") || !Bot["Debug"].IsBool() || !Bot.HasMember("SurrenderPhrase") || !Bot["SurrenderPhrase"].IsString())
             {
-                OutCmdLine = Config->GetStringValue("NodeJSBinary") + " " + NewBot.FileName;
+                Valid = false;
                 break;
             }
-            }
-
-            if (NewBot.Args != "")
+            BotConfig NewBot;
+            NewBot.BotName = Bot["BotName"].GetString();
+            NewBot.Race = static_cast<sc2::Race>(Bot["Race"].GetInt());
+            NewBot.Type = static_cast<BotType>(Bot["Type"].GetInt());
+            NewBot.RootPath = Bot["RootPath"].GetString();
+            NewBot.FileName = Bot["FileName"].GetString();
+            NewBot.Args = Bot["Args"].GetString();
+            NewBot.Debug = Bot["Debug"].GetBool();
+            NewBot.SurrenderPhrase = Bot["SurrenderPhrase"].GetString();
+            if (Bot.HasMember("Difficulty") && Bot["Difficulty"].IsInt())
             {
-                OutCmdLine += " " + NewBot.Args;
+                NewBot.Difficulty = static_cast<sc2::Difficulty>(Bot["Difficulty"].GetInt());
             }
+            Cached.Bots.push_back(NewBot);
+        }
+        if (Valid)
+        {
+            ParsedFiles[File["Path"].GetString()] = std::move(Cached);
+        }
+    }
+}
 
-            NewBot.executeCommand = OutCmdLine;
-            BotConfig SavedBot;
-            if (FindBot(NewBot.BotName, SavedBot))
-            {
-                NewBot.CheckSum = SavedBot.CheckSum;
-                BotConfigs[NewBot.BotName] = NewBot;
-            }
-            else
+void AgentsConfig::SaveBotFileCache()
+{
+    if (BotFileCache.empty() || !ParsedFilesChanged)
+    {
+        return;
+    }
+    const std::string TempFile = BotFileCache + ".tmp";
+    {
+        std::ofstream ofs(TempFile.c_str(), std::ofstream::trunc);
+        if (!ofs)
+        {
+            return;
+        }
+        rapidjson::OStreamWrapper osw(ofs);
+        rapidjson::Writer<rapidjson::OStreamWrapper> writer(osw);
+        writer.StartObject();
+        writer.Key("Files");
+        writer.StartArray();
+        for (const auto &File : ParsedFiles)
+        {
+            writer.StartObject();
+            writer.Key("Path");
+            writer.String(File.first);
+            writer.Key("BaseDirectory");
+            writer.String(File.second.BaseDirectory);
+            writer.Key("ModifiedTimeNs");
+            writer.Int64(File.second.ModifiedTime);
+            writer.Key("Size");
+            writer.Int64(File.second.Size);
+            writer.Key("Bots");
+            writer.StartArray();
+            for (const BotConfig &Bot : File.second.Bots)
             {
-                BotConfigs.insert(std::make_pair(std::string(NewBot.BotName), NewBot));
+                writer.StartObject();
+                writer.Key("BotName");
+                writer.String(Bot.BotName);
+                writer.Key("Race");
+                writer.Int(static_cast<int>(Bot.Race));
+                writer.Key("Type");
+                writer.Int(static_cast<int>(Bot.Type));
+                writer.Key("RootPath");
+                writer.String(Bot.RootPath);
+                writer.Key("FileName");
+                writer.String(Bot.FileName);
+                writer.Key("Args");
+                writer.String(Bot.Args);
+                writer.Key("Debug");
+                writer.Bool(Bot.Debug);
+                writer.Key("SurrenderPhrase");
+                writer.String(Bot.SurrenderPhrase);
+                writer.Key("Difficulty");
+                writer.Int(static_cast<int>(Bot.Difficulty));
+                writer.EndObject();
             }
-
+            writer.EndArray();
+            writer.EndObject();
         }
-	}
-
+        writer.EndArray();
+        writer.EndObject();
+    }
+    if (ReplaceFileAtomically(TempFile, BotFileCache))
+    {
+        ParsedFilesChanged = false;
+    }
 }
 
 void AgentsConfig::SaveBotConfig(const BotConfig& Agent)
 {
-    BotConfig SavedBot;
-    if (FindBot(Agent.BotName, SavedBot))
+    const BotHandle Known = GetBotHandle(Agent.BotName);
+    if (Known != InvalidBotHandle)
     {
-        BotConfigs[Agent.BotName] = Agent;
+        Agents[Known] = Agent;
     }
     else
     {
-        BotConfigs.insert(std::make_pair(std::string(Agent.BotName), Agent));
+        AddBot(Agent);
     }
 }
 
+BotHandle AgentsConfig::AddBot(const BotConfig &Agent)
+{
+    const BotHandle Handle = static_cast<BotHandle>(Agents.size());
+    Agents.push_back(Agent);
+    BotHandles.emplace(Agent.BotName, Handle);
+    return Handle;
+}
 
-bool AgentsConfig::FindBot(const std::string &BotName, BotConfig &ReturnBot)
+BotHandle AgentsConfig::GetBotHandle(const std::string &BotName) const
 {
-	auto ThisBot = BotConfigs.find(BotName);
-	if (ThisBot != BotConfigs.end())
-	{
-		ReturnBot = ThisBot->second;
-		return true;
-	}
-	return false;
+    const auto Known = BotHandles.find(BotName);
+    return Known != BotHandles.end() ? Known->second : InvalidBotHandle;
+}
+
+const BotConfig *AgentsConfig::FindBot(const std::string &BotName) const
+{
+    const BotHandle Handle = GetBotHandle(BotName);
+    return Handle != InvalidBotHandle ? &Agents[Handle] : nullptr;
 }
 
 bool AgentsConfig::CheckDiactivatedBots()
 {
-	std::string BotCheckLocation = Config->GetStringValue("BotInfoLocation");
+	std::string BotCheckLocation = Settings->BotInfoLocation;
 	if (BotCheckLocation.empty())
 	{
 		return false;
 	}
-	std::vector<std::string> arguments;
-	std::string result = PerformRestRequest(BotCheckLocation, arguments);
+	std::string result = Http->Get(BotCheckLocation);
 	if (result.empty())
 	{
 		return false;
@@ -273,28 +605,29 @@ bool AgentsConfig::CheckDiactivatedBots()
 		{
 			if (val.HasMember("name") && val["name"].IsString())
 			{
-				auto ThisBot = BotConfigs.find(val["name"].GetString());
-				if (ThisBot != BotConfigs.end())
+				const BotHandle Handle = GetBotHandle(val["name"].GetString());
+				if (Handle != InvalidBotHandle)
 				{
+					BotConfig &ThisBot = Agents[Handle];
 					if (val.HasMember("deactivated") && val.HasMember("deleted") && val["deactivated"].IsBool() && val["deleted"].IsBool())
 					{
-						if ((val["deactivated"].GetBool() || val["deleted"].GetBool()) && ThisBot->second.Enabled)
+						if ((val["deactivated"].GetBool() || val["deleted"].GetBool()) && ThisBot.Enabled)
 						{
 							// Set bot to disabled
-							PrintThread{} << "Deactivating bot " << ThisBot->second.BotName << std::endl;
-							ThisBot->second.Enabled = false;
+							PrintThread{} << "Deactivating bot " << ThisBot.BotName << std::endl;
+							ThisBot.Enabled = false;
 
 						}
-						else if (val["deactivated"].GetBool() == false && val["deleted"].GetBool() == false && ThisBot->second.Enabled == false)
+						else if (val["deactivated"].GetBool() == false && val["deleted"].GetBool() == false && ThisBot.Enabled == false)
 						{
 							// reenable a bot
-							PrintThread{} << "Activating bot " << ThisBot->second.BotName;
-							ThisBot->second.Enabled = true;
+							PrintThread{} << "Activating bot " << ThisBot.BotName;
+							ThisBot.Enabled = true;
 						}
 					}
 					if (val.HasMember("elo") && val["elo"].IsString())
 					{
-						ThisBot->second.ELO = std::stoi(val["elo"].GetString());
+						ThisBot.ELO = std::stoi(val["elo"].GetString());
 					}
 				}
 
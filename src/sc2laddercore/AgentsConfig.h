@@ -1,30 +1,78 @@
 #pragma once
 
-#include <string>
+#include <cstdint>
 #include <map>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <string>
+#include <unordered_map>
+#include <vector>
 
 #include "Types.h"
 #include "LadderConfig.h"
+#include "LadderSettings.h"
+#include "HttpClient.h"
 #define PLAYER_ID_LENGTH 16
 
+// Dense index of a bot in AgentsConfig. Bots are never removed, so a handle stays valid while the ladder runs.
+typedef uint32_t BotHandle;
+constexpr BotHandle InvalidBotHandle = UINT32_MAX;
+
 class AgentsConfig
 {
 public:
-    AgentsConfig(LadderConfig *InLadderConfig);
+    AgentsConfig(std::shared_ptr<const LadderSettings> InSettings, HttpClient *InHttp);
     void LoadAgents(const std::string &BaseDirectory, const std::string &BotConfigFile);
 	void SaveBotConfig(const BotConfig & Agent);
     void ReadBotDirectories(const std::string &BaseDirectory);
+    // Disables the bots that were loaded from a bot config file that is gone, they are enabled again when it is loaded.
+    // Returns the number of bots that were disabled.
+    size_t RemoveAgents(const std::string &BotConfigFile);
+    // The bot config files that were parsed, including the ones only known from the cache.
+    std::vector<std::string> GetBotFiles();
 
-    bool FindBot(const std::string &BotName, BotConfig &ReturnBot);
+    // References and pointers to bots are invalidated when a bot is added.
+    const BotConfig *FindBot(const std::string &BotName) const;
+    BotHandle GetBotHandle(const std::string &BotName) const;
+    const BotConfig &GetBot(BotHandle Handle) const { return Agents[Handle]; }
+    // Indexed by handle.
+    const std::vector<BotConfig> &GetBots() const { return Agents; }
+    void SetELO(BotHandle Handle, int ELO) { Agents[Handle].ELO = ELO; }
 
 	bool CheckDiactivatedBots();
 
-    std::map<std::string, BotConfig> BotConfigs;
-
 private:
-    LadderConfig *Config;
+    // Bots as read from a bot config file, reused while the file keeps its modification time and size.
+    struct ParsedBotFile
+    {
+        std::string BaseDirectory;
+        // Nanoseconds since the epoch.
+        int64_t ModifiedTime{0};
+        int64_t Size{0};
+        std::vector<BotConfig> Bots;
+    };
+
+    BotHandle AddBot(const BotConfig &Agent);
+    // Safe to call from several threads at once.
+    bool ParseBotFile(const std::string &BaseDirectory, const std::string &BotConfigFile, std::vector<BotConfig> &ParsedBots);
+    void PrepareBots(std::vector<BotConfig> &ParsedBots) const;
+    bool AddParsedBots(std::vector<BotConfig> &ParsedBots);
+    void LoadBotFileCache();
+    void SaveBotFileCache();
+
+    std::vector<BotConfig> Agents;
+    std::unordered_map<std::string, BotHandle> BotHandles;
+    // Bots disabled by RemoveAgents.
+    std::set<std::string> RemovedBots;
+    std::shared_ptr<const LadderSettings> Settings;
+    HttpClient *Http;
     LadderConfig *PlayerIds;
     bool EnablePlayerIds;
+    std::map<std::string, ParsedBotFile> ParsedFiles;
+    std::mutex ParsedFilesMutex;
+    bool ParsedFilesChanged;
+    std::string BotFileCache;
     std::string GerneratePlayerId(size_t Length);
 
 
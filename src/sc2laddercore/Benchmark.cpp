@@ -0,0 +1,299 @@
+#include "Benchmark.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+
+#define RAPIDJSON_HAS_STDSTRING 1
+#include "rapidjson.h"
+#include "document.h"
+#include "ostreamwrapper.h"
+#include "prettywriter.h"
+
+#include "AgentsConfig.h"
+#include "Tools.h"
+
+namespace {
+
+template <typename Writer, typename Distribution>
+void WriteDistribution(Writer &writer, const char *Name, const Distribution &Values)
+{
+    writer.Key(Name);
+    writer.StartObject();
+    writer.Key("Samples");
+    writer.Uint(Values.Samples);
+    writer.Key("Mean");
+    writer.Double(Values.Mean);
+    writer.Key("P50");
+    writer.Double(Values.P50);
+    writer.Key("P90");
+    writer.Double(Values.P90);
+    writer.Key("P99");
+    writer.Double(Values.P99);
+    writer.Key("Max");
+    writer.Double(Values.Max);
+    writer.EndObject();
+}
+
+double GetDoubleMember(const rapidjson::Value &Value, const char *Name)
+{
+    return Value.HasMember(Name) && Value[Name].IsNumber() ? Value[Name].GetDouble() : 0.0;
+}
+
+// Percent change from Baseline to Current, 0 if there is nothing to compare.
+double GetChange(double Baseline, double Current)
+{
+    return Baseline > 0.0 ? (Current - Baseline) * 100.0 / Baseline : 0.0;
+}
+
+} // namespace
+
+Benchmark::Benchmark(const std::string &InReportFile, const std::string &InBaselineFile, int InTolerancePercent)
+    : ReportFile(InReportFile)
+    , BaselineFile(InBaselineFile)
+    , TolerancePercent(InTolerancePercent)
+{
+}
+
+std::vector<Matchup> Benchmark::PlanMatches(const AgentsConfig &Agents, const std::vector<std::string> &Pairings, const std::vector<std::string> &Maps, int Runs)
+{
+    std::vector<std::pair<const BotConfig *, const BotConfig *>> Pairs;
+    if (Pairings.empty())
+    {
+        const std::vector<BotConfig> &Bots = Agents.GetBots();
+        for (size_t First = 0; First < Bots.size(); ++First)
+        {
+            for (size_t Second = First + 1; Second < Bots.size(); ++Second)
+            {
+                if (Bots[First].Type != Computer || Bots[Second].Type != Computer)
+                {
+                    Pairs.emplace_back(&Bots[First], &Bots[Second]);
+                }
+            }
+        }
+    }
+    for (const std::string &Pairing : Pairings)
+    {
+        const size_t Separator = Pairing.find(" vs ");
+        const BotConfig *Bot1 = Separator != std::string::npos ? Agents.FindBot(Pairing.substr(0, Separator)) : nullptr;
+        const BotConfig *Bot2 = Separator != std::string::npos ? Agents.FindBot(Pairing.substr(Separator + 4)) : nullptr;
+        if (Bot1 == nullptr || Bot2 == nullptr)
+        {
+            PrintThread{} << "Unknown benchmark pairing \"" << Pairing << "\", expected \"Bot1 vs Bot2\"." << std::endl;
+            continue;
+        }
+        Pairs.emplace_back(Bot1, Bot2);
+    }
+    std::vector<Matchup> Matches;
+    for (const auto &Pair : Pairs)
+    {
+        for (const std::string &Map : Maps)
+        {
+            for (int Run = 0; Run < Runs; ++Run)
+            {
+                Matches.emplace_back(*Pair.first, *Pair.second, Map);
+            }
+        }
+    }
+    return Matches;
+}
+
+void Benchmark::AddResult(const Matchup &Match, const GameResult &Result, double WallSeconds)
+{
+    const std::string Name = Match.Agent1.BotName + " vs " + Match.Agent2.BotName + " on " + RemoveMapExtension(Match.Map);
+    const auto Found = SeriesIndex.find(Name);
+    if (Found == SeriesIndex.end())
+    {
+        SeriesIndex[Name] = AllSeries.size();
+        AllSeries.emplace_back();
+        AllSeries.back().Name = Name;
+    }
+    Series &Added = AllSeries[Found == SeriesIndex.end() ? AllSeries.size() - 1 : Found->second];
+    if (Result.GameLoop == 0)
+    {
+        // The game never ran, its times say nothing about the ladder.
+        ++Added.Errors;
+        return;
+    }
+    Added.Bot1Steps.insert(Added.Bot1Steps.end(), Result.Bot1StepTimes.begin(), Result.Bot1StepTimes.end());
+    Added.Bot2Steps.insert(Added.Bot2Steps.end(), Result.Bot2StepTimes.begin(), Result.Bot2StepTimes.end());
+    Added.WallSeconds.push_back(WallSeconds);
+}
+
+template <typename T>
+Benchmark::Distribution Benchmark::Summarize(std::vector<T> Values)
+{
+    Distribution Summary;
+    if (Values.empty())
+    {
+        return Summary;
+    }
+    std::sort(Values.begin(), Values.end());
+    double Sum = 0.0;
+    for (const T Value : Values)
+    {
+        Sum += static_cast<double>(Value);
+    }
+    const auto Percentile = [&Values](double Fraction)
+    {
+        return static_cast<double>(Values[static_cast<size_t>(Fraction * (Values.size() - 1))]);
+    };
+    Summary.Samples = static_cast<uint32_t>(Values.size());
+    Summary.Mean = Sum / Values.size();
+    Summary.P50 = Percentile(0.5);
+    Summary.P90 = Percentile(0.9);
+    Summary.P99 = Percentile(0.99);
+    Summary.Max = static_cast<double>(Values.back());
+    return Summary;
+}
+
+bool Benchmark::Finish(uint32_t Seed)
+{
+    std::vector<std::pair<std::string, SeriesSummary>> Summaries;
+    for (const Series &Played : AllSeries)
+    {
+        SeriesSummary Summary;
+        Summary.Runs = static_cast<uint32_t>(Played.WallSeconds.size());
+        Summary.Errors = Played.Errors;
+        Summary.Wall = Summarize(Played.WallSeconds);
+        Summary.Bot1Step = Summarize(Played.Bot1Steps);
+        Summary.Bot2Step = Summarize(Played.Bot2Steps);
+        Summaries.emplace_back(Played.Name, Summary);
+        PrintThread{} << "Benchmark " << Played.Name << ": " << Summary.Runs << " runs, " << Summary.Errors << " errors, wall time " << Summary.Wall.Mean << " s (" << Summary.Wall.P50 << " - " << Summary.Wall.Max << ")"
+            << ", step latency p50/p90/p99/max " << Summary.Bot1Step.P50 << "/" << Summary.Bot1Step.P90 << "/" << Summary.Bot1Step.P99 << "/" << Summary.Bot1Step.Max
+            << " and " << Summary.Bot2Step.P50 << "/" << Summary.Bot2Step.P90 << "/" << Summary.Bot2Step.P99 << "/" << Summary.Bot2Step.Max << " microseconds" << std::endl;
+    }
+    if (!ReportFile.empty() && !WriteReport(ReportFile, Seed, Summaries))
+    {
+        PrintThread{} << "Unable to write the benchmark report " << ReportFile << std::endl;
+    }
+    if (BaselineFile.empty())
+    {
+        return true;
+    }
+    std::map<std::string, SeriesSummary> Baseline;
+    if (!ReadReport(BaselineFile, Baseline))
+    {
+        PrintThread{} << "No benchmark baseline in " << BaselineFile << ", saving this run as the baseline." << std::endl;
+        WriteReport(BaselineFile, Seed, Summaries);
+        return true;
+    }
+    bool WithinTolerance = true;
+    for (const auto &Current : Summaries)
+    {
+        const auto Found = Baseline.find(Current.first);
+        if (Found == Baseline.end())
+        {
+            PrintThread{} << "Benchmark " << Current.first << " is not in the baseline." << std::endl;
+            continue;
+        }
+        const SeriesSummary &Before = Found->second;
+        const SeriesSummary &After = Current.second;
+        if (After.Runs == 0 || After.Errors > Before.Errors)
+        {
+            // Nothing to time, or fewer games got through: either way the ladder got worse.
+            WithinTolerance = false;
+            PrintThread{} << "REGRESSION Benchmark " << Current.first << " against baseline: " << After.Runs << " runs and " << After.Errors
+                << " errors, the baseline had " << Before.Runs << " runs and " << Before.Errors << " errors" << std::endl;
+            continue;
+        }
+        // A distribution without samples, e.g. the steps of a built-in AI, has nothing to compare.
+        const auto Compare = [](const Distribution &Baseline, const Distribution &Measured, double Distribution::*Value)
+        {
+            return Measured.Samples > 0 ? GetChange(Baseline.*Value, Measured.*Value) : 0.0;
+        };
+        const double Changes[] = {
+            Compare(Before.Wall, After.Wall, &Distribution::Mean),
+            Compare(Before.Bot1Step, After.Bot1Step, &Distribution::P50),
+            Compare(Before.Bot1Step, After.Bot1Step, &Distribution::P99),
+            Compare(Before.Bot2Step, After.Bot2Step, &Distribution::P50),
+            Compare(Before.Bot2Step, After.Bot2Step, &Distribution::P99),
+        };
+        const bool Regressed = std::any_of(std::begin(Changes), std::end(Changes), [this](double Change) { return Change > TolerancePercent; });
+        WithinTolerance &= !Regressed;
+        PrintThread{} << (Regressed ? "REGRESSION " : "") << "Benchmark " << Current.first << " against baseline: wall time " << Changes[0]
+            << "%, step latency p50/p99 " << Changes[1] << "%/" << Changes[2] << "% and " << Changes[3] << "%/" << Changes[4] << "%" << std::endl;
+    }
+    return WithinTolerance;
+}
+
+bool Benchmark::WriteReport(const std::string &File, uint32_t Seed, const std::vector<std::pair<std::string, SeriesSummary>> &Summaries)
+{
+    const std::string TempFile = File + ".tmp";
+    {
+        std::ofstream ofs(TempFile.c_str(), std::ofstream::trunc);
+        if (!ofs)
+        {
+            return false;
+        }
+        rapidjson::OStreamWrapper osw(ofs);
+        rapidjson::PrettyWriter<rapidjson::OStreamWrapper> writer(osw);
+        writer.StartObject();
+        writer.Key("Seed");
+        writer.Uint(Seed);
+        writer.Key("Series");
+        writer.StartArray();
+        for (const auto &Summary : Summaries)
+        {
+            const SeriesSummary &Values = Summary.second;
+            writer.StartObject();
+            writer.Key("Name");
+            writer.String(Summary.first);
+            writer.Key("Runs");
+            writer.Uint(Values.Runs);
+            writer.Key("Errors");
+            writer.Uint(Values.Errors);
+            WriteDistribution(writer, "WallSeconds", Values.Wall);
+            WriteDistribution(writer, "Bot1StepMicroseconds", Values.Bot1Step);
+            WriteDistribution(writer, "Bot2StepMicroseconds", Values.Bot2Step);
+            writer.EndObject();
+        }
+        writer.EndArray();
+        writer.EndObject();
+    }
+    return ReplaceFileAtomically(TempFile, File);
+}
+
+bool Benchmark::ReadReport(const std::string &File, std::map<std::string, SeriesSummary> &Summaries)
+{
+    std::ifstream ifs(File.c_str());
+    if (!ifs)
+    {
+        return false;
+    }
+    std::stringstream buffer;
+    buffer << ifs.rdbuf();
+    rapidjson::Document doc;
+    if (doc.Parse(buffer.str()).HasParseError() || !doc.IsObject() || !doc.HasMember("Series") || !doc["Series"].IsArray())
+    {
+        return false;
+    }
+    const auto ReadDistribution = [](const rapidjson::Value &Value, const char *Name, Distribution &Read)
+    {
+        if (Value.HasMember(Name) && Value[Name].IsObject())
+        {
+            const rapidjson::Value &Values = Value[Name];
+            Read.Samples = static_cast<uint32_t>(GetDoubleMember(Values, "Samples"));
+            Read.Mean = GetDoubleMember(Values, "Mean");
+            Read.P50 = GetDoubleMember(Values, "P50");
+            Read.P90 = GetDoubleMember(Values, "P90");
+            Read.P99 = GetDoubleMember(Values, "P99");
+            Read.Max = GetDoubleMember(Values, "Max");
+        }
+    };
+    for (const auto &Value : doc["Series"].GetArray())
+    {
+        if (!Value.IsObject() || !Value.HasMember("Name") || !Value["Name"].IsString())
+        {
+            continue;
+        }
+        SeriesSummary &Summary = Summaries[Value["Name"].GetString()];
+        Summary.Runs = static_cast<uint32_t>(GetDoubleMember(Value, "Runs"));
+        Summary.Errors = static_cast<uint32_t>(GetDoubleMember(Value, "Errors"));
+        ReadDistribution(Value, "WallSeconds", Summary.Wall);
+        ReadDistribution(Value, "Bot1StepMicroseconds", Summary.Bot1Step);
+        ReadDistribution(Value, "Bot2StepMicroseconds", Summary.Bot2Step);
+    }
+    return true;
+}
@@ -0,0 +1,69 @@
+#pragma once
+
+#include <cstdint>
+#include <map>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "Types.h"
+
+class AgentsConfig;
+
+// Collects the step latencies and wall times of benchmark matches and compares them to a baseline.
+// A benchmark plays every pairing on every map a fixed number of times, always in the same order
+// and with the same game seed, so two runs of it differ only in the ladder and the machine.
+class Benchmark
+{
+public:
+    Benchmark(const std::string &InReportFile, const std::string &InBaselineFile, int InTolerancePercent);
+
+    // Pairings are "Bot1 vs Bot2", all pairs of bots if empty. Maps are played in the given order.
+    static std::vector<Matchup> PlanMatches(const AgentsConfig &Agents, const std::vector<std::string> &Pairings, const std::vector<std::string> &Maps, int Runs);
+
+    void AddResult(const Matchup &Match, const GameResult &Result, double WallSeconds);
+    // Writes the report and compares it to the baseline, the report becomes the baseline if there is none yet.
+    // Returns false if a series got slower than the tolerance allows, had more errors or did not finish a game.
+    bool Finish(uint32_t Seed);
+
+private:
+    struct Series
+    {
+        std::string Name;
+        std::vector<uint32_t> Bot1Steps;
+        std::vector<uint32_t> Bot2Steps;
+        std::vector<double> WallSeconds;
+        uint32_t Errors{0};
+    };
+
+    // Percentiles and mean of a series in the report and the baseline.
+    struct Distribution
+    {
+        uint32_t Samples{0};
+        double Mean{0.0};
+        double P50{0.0};
+        double P90{0.0};
+        double P99{0.0};
+        double Max{0.0};
+    };
+    struct SeriesSummary
+    {
+        uint32_t Runs{0};
+        uint32_t Errors{0};
+        Distribution Wall;
+        Distribution Bot1Step;
+        Distribution Bot2Step;
+    };
+
+    template <typename T>
+    static Distribution Summarize(std::vector<T> Values);
+    static bool WriteReport(const std::string &File, uint32_t Seed, const std::vector<std::pair<std::string, SeriesSummary>> &Summaries);
+    static bool ReadReport(const std::string &File, std::map<std::string, SeriesSummary> &Summaries);
+
+    const std::string ReportFile;
+    const std::string BaselineFile;
+    const int TolerancePercent;
+    // In the order they were first played.
+    std::vector<Series> AllSeries;
+    std::map<std::string, size_t> SeriesIndex;
+};
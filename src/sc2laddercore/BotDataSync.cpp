@@ -0,0 +1,496 @@
+#include "BotDataSync.h"
+
+#include <chrono>
+#include <cstdint>
+#include <fstream>
+#include <sstream>
+#include <vector>
+
+#include <sys/stat.h>
+
+#include "sc2utils/sc2_scan_directory.h"
+
+#define RAPIDJSON_HAS_STDSTRING 1
+#include "rapidjson.h"
+#include "document.h"
+#include "ostreamwrapper.h"
+#include "stringbuffer.h"
+#include "writer.h"
+
+#include "HttpClient.h"
+#include "Tools.h"
+#include "Types.h"
+
+namespace {
+
+void ListFilesRecursive(const std::string &Directory, const std::string &Prefix, std::vector<std::string> &Files)
+{
+    std::vector<std::string> Entries;
+    sc2::scan_directory(Directory.c_str(), Entries, false, false);
+    for (const std::string &File : Entries)
+    {
+        Files.push_back(Prefix + File);
+    }
+    std::vector<std::string> SubDirectories;
+    sc2::scan_directory(Directory.c_str(), SubDirectories, false, true);
+    for (const std::string &SubDirectory : SubDirectories)
+    {
+        if (SubDirectory == "." || SubDirectory == "..")
+        {
+            continue;
+        }
+        ListFilesRecursive(Directory + "/" + SubDirectory, Prefix + SubDirectory + "/", Files);
+    }
+}
+
+// Seconds alone miss a file rewritten with the same size within the same second.
+int64_t GetModifiedTime(const struct stat &Info)
+{
+#if defined(__linux__)
+    return static_cast<int64_t>(Info.st_mtim.tv_sec) * 1000000000 + Info.st_mtim.tv_nsec;
+#elif defined(__APPLE__)
+    return static_cast<int64_t>(Info.st_mtimespec.tv_sec) * 1000000000 + Info.st_mtimespec.tv_nsec;
+#else
+    return static_cast<int64_t>(Info.st_mtime) * 1000000000;
+#endif
+}
+
+bool StatFile(const std::string &Path, uint64_t &Size, int64_t &ModifiedTime)
+{
+    struct stat Info;
+    if (stat(Path.c_str(), &Info) != 0)
+    {
+        return false;
+    }
+    Size = static_cast<uint64_t>(Info.st_size);
+    ModifiedTime = GetModifiedTime(Info);
+    return true;
+}
+
+void MakeParentDirectories(const std::string &Root, const std::string &RelativePath)
+{
+    size_t Slash = RelativePath.find('/');
+    while (Slash != std::string::npos)
+    {
+        MakeDirectory(Root + "/" + RelativePath.substr(0, Slash));
+        Slash = RelativePath.find('/', Slash + 1);
+    }
+}
+
+bool LoadManifest(const std::string &ManifestFile, DataManifest &Manifest)
+{
+    std::ifstream ifs(ManifestFile);
+    if (!ifs)
+    {
+        return false;
+    }
+    std::stringstream buffer;
+    buffer << ifs.rdbuf();
+    return BotDataSync::ParseManifest(buffer.str(), Manifest);
+}
+
+template <typename Writer>
+void WriteManifest(Writer &writer, const DataManifest &Manifest)
+{
+    writer.StartObject();
+    writer.Key("Files");
+    writer.StartArray();
+    for (const auto &File : Manifest)
+    {
+        writer.StartObject();
+        writer.Key("Path");
+        writer.String(File.first);
+        writer.Key("Size");
+        writer.Uint64(File.second.Size);
+        writer.Key("ModifiedTime");
+        writer.Int64(File.second.ModifiedTime);
+        writer.Key("Hash");
+        writer.String(File.second.Hash);
+        writer.EndObject();
+    }
+    writer.EndArray();
+    writer.EndObject();
+}
+
+bool SaveManifest(const std::string &ManifestFile, const DataManifest &Manifest)
+{
+    std::ofstream ofs(ManifestFile, std::ofstream::trunc);
+    if (!ofs)
+    {
+        return false;
+    }
+    rapidjson::OStreamWrapper osw(ofs);
+    rapidjson::Writer<rapidjson::OStreamWrapper> writer(osw);
+    WriteManifest(writer, Manifest);
+    return true;
+}
+
+bool EndsWith(const std::string &Value, const std::string &Suffix)
+{
+    return Value.size() >= Suffix.size() && Value.compare(Value.size() - Suffix.size(), Suffix.size(), Suffix) == 0;
+}
+
+bool IsSuccessResponse(const std::string &Body)
+{
+    rapidjson::Document doc;
+    return !doc.Parse(Body.c_str()).HasParseError() && doc.IsObject() && doc.HasMember("result") && doc["result"].IsBool() && doc["result"].GetBool();
+}
+
+} // namespace
+
+bool BotDataSync::IsSafePath(const std::string &Path)
+{
+    return !Path.empty() && Path[0] != '/' && Path.find('\\') == std::string::npos && Path.find(':') == std::string::npos && Path.find("..") == std::string::npos;
+}
+
+bool BotDataSync::ParseManifest(const std::string &Json, DataManifest &Manifest)
+{
+    rapidjson::Document doc;
+    if (doc.Parse(Json.c_str()).HasParseError() || !doc.IsObject() || !doc.HasMember("Files") || !doc["Files"].IsArray())
+    {
+        return false;
+    }
+    for (const auto &File : doc["Files"].GetArray())
+    {
+        if (!File.HasMember("Path") || !File["Path"].IsString() || !File.HasMember("Hash") || !File["Hash"].IsString())
+        {
+            continue;
+        }
+        // Paths are joined to the data directory, one escaping it spoils the whole manifest.
+        if (!IsSafePath(File["Path"].GetString()))
+        {
+            Manifest.clear();
+            return false;
+        }
+        DataManifestEntry Entry;
+        Entry.Hash = File["Hash"].GetString();
+        if (File.HasMember("Size") && File["Size"].IsUint64())
+        {
+            Entry.Size = File["Size"].GetUint64();
+        }
+        if (File.HasMember("ModifiedTime") && File["ModifiedTime"].IsInt64())
+        {
+            Entry.ModifiedTime = File["ModifiedTime"].GetInt64();
+        }
+        Manifest[File["Path"].GetString()] = Entry;
+    }
+    return true;
+}
+
+void BotDataSync::DiffManifests(const DataManifest &Source, const DataManifest &Target, std::vector<std::string> &Changed, std::vector<std::string> &Removed)
+{
+    for (const auto &File : Source)
+    {
+        const auto TargetFile = Target.find(File.first);
+        if (TargetFile == Target.end() || TargetFile->second.Hash != File.second.Hash)
+        {
+            Changed.push_back(File.first);
+        }
+    }
+    for (const auto &File : Target)
+    {
+        if (Source.find(File.first) == Source.end())
+        {
+            Removed.push_back(File.first);
+        }
+    }
+}
+
+void DataSyncStats::Add(const DataSyncStats &Other)
+{
+    TotalBytes += Other.TotalBytes;
+    BytesTransferred += Other.BytesTransferred;
+    FilesTransferred += Other.FilesTransferred;
+    FilesDeleted += Other.FilesDeleted;
+    Seconds += Other.Seconds;
+    EstimatedSecondsSaved += Other.EstimatedSecondsSaved;
+}
+
+BotDataSync::BotDataSync(HttpClient *InHttp, const std::string &InSyncLocation, const std::string &InUsername, const std::string &InPassword, const std::string &InDirectory)
+    : Http(InHttp)
+    , SyncLocation(InSyncLocation)
+    , Username(InUsername)
+    , Password(InPassword)
+    , Directory(InDirectory)
+{
+}
+
+void BotDataSync::AddScope(std::vector<HttpFormField> &Fields) const
+{
+    if (Directory.empty())
+    {
+        Fields.emplace_back("Scope", "bot");
+    }
+}
+
+std::string BotDataSync::GetSyncDirectory(const std::string &BotDirectory) const
+{
+    return Directory.empty() ? BotDirectory : BotDirectory + "/" + Directory;
+}
+
+std::string BotDataSync::GetManifestFile(const std::string &BotDirectory) const
+{
+    return BotDirectory + "/" + (Directory.empty() ? "bot" : Directory) + ".manifest";
+}
+
+bool BotDataSync::Download(const std::string &BotName, const std::string &BotDirectory, DataSyncStats &Stats)
+{
+    const auto Start = std::chrono::steady_clock::now();
+    const std::string DataDirectory = GetSyncDirectory(BotDirectory);
+    const std::string ManifestFile = GetManifestFile(BotDirectory);
+    MakeDirectory(BotDirectory);
+    MakeDirectory(DataDirectory);
+
+    DataManifest Remote;
+    if (!FetchRemoteManifest(BotName, Remote))
+    {
+        return false;
+    }
+    DataManifest Cached;
+    LoadManifest(ManifestFile, Cached);
+    const DataManifest Local = ScanDirectory(DataDirectory, Cached, Directory.empty());
+
+    std::vector<std::string> Changed;
+    std::vector<std::string> Removed;
+    DiffManifests(Remote, Local, Changed, Removed);
+
+    DataManifest Synced;
+    for (const auto &File : Remote)
+    {
+        Stats.TotalBytes += File.second.Size;
+        const auto LocalFile = Local.find(File.first);
+        if (LocalFile != Local.end() && LocalFile->second.Hash == File.second.Hash)
+        {
+            Synced[File.first] = LocalFile->second;
+        }
+    }
+    for (const std::string &Path : Changed)
+    {
+        const DataManifestEntry &RemoteEntry = Remote.at(Path);
+        if (!DownloadFile(BotName, DataDirectory, Path, RemoteEntry))
+        {
+            // Remember what is already in place, the next sync only fetches the rest.
+            SaveManifest(ManifestFile, Synced);
+            return false;
+        }
+        DataManifestEntry Entry = RemoteEntry;
+        StatFile(DataDirectory + "/" + Path, Entry.Size, Entry.ModifiedTime);
+        Synced[Path] = Entry;
+        Stats.BytesTransferred += RemoteEntry.Size;
+        ++Stats.FilesTransferred;
+    }
+    for (const std::string &Path : Removed)
+    {
+        remove((DataDirectory + "/" + Path).c_str());
+        ++Stats.FilesDeleted;
+    }
+    SaveManifest(ManifestFile, Synced);
+    FinishStats(Stats, std::chrono::duration<double>(std::chrono::steady_clock::now() - Start).count());
+    return true;
+}
+
+bool BotDataSync::Upload(const std::string &BotName, const std::string &BotDirectory, DataSyncStats &Stats)
+{
+    const auto Start = std::chrono::steady_clock::now();
+    const std::string DataDirectory = GetSyncDirectory(BotDirectory);
+    const std::string ManifestFile = GetManifestFile(BotDirectory);
+
+    // The cached manifest describes what the server has since our last sync.
+    DataManifest Baseline;
+    if (!LoadManifest(ManifestFile, Baseline) && !FetchRemoteManifest(BotName, Baseline))
+    {
+        return false;
+    }
+    const DataManifest Local = ScanDirectory(DataDirectory, Baseline, Directory.empty());
+
+    std::vector<std::string> Changed;
+    std::vector<std::string> Removed;
+    DiffManifests(Local, Baseline, Changed, Removed);
+
+    DataManifest Synced = Baseline;
+    bool Success = true;
+    for (const auto &File : Local)
+    {
+        Stats.TotalBytes += File.second.Size;
+        // Unchanged content may still carry a new modification time.
+        const auto RemoteFile = Baseline.find(File.first);
+        if (RemoteFile != Baseline.end() && RemoteFile->second.Hash == File.second.Hash)
+        {
+            Synced[File.first] = File.second;
+        }
+    }
+    for (const std::string &Path : Changed)
+    {
+        const DataManifestEntry &Entry = Local.at(Path);
+        if (!UploadFile(BotName, DataDirectory, Path, Entry))
+        {
+            Success = false;
+            continue;
+        }
+        Synced[Path] = Entry;
+        Stats.BytesTransferred += Entry.Size;
+        ++Stats.FilesTransferred;
+    }
+    for (const std::string &Path : Removed)
+    {
+        if (!DeleteRemoteFile(BotName, Path))
+        {
+            Success = false;
+            continue;
+        }
+        Synced.erase(Path);
+        ++Stats.FilesDeleted;
+    }
+    SaveManifest(ManifestFile, Synced);
+    FinishStats(Stats, std::chrono::duration<double>(std::chrono::steady_clock::now() - Start).count());
+    return Success;
+}
+
+bool BotDataSync::FetchRemoteManifest(const std::string &BotName, DataManifest &Manifest)
+{
+    std::vector<HttpFormField> Fields;
+    Fields.emplace_back("Username", Username);
+    Fields.emplace_back("Password", Password);
+    Fields.emplace_back("BotName", BotName);
+    AddScope(Fields);
+    Fields.emplace_back("Action", "manifest");
+    const std::string Result = Http->PostForm(SyncLocation, Fields);
+    if (!ParseManifest(Result, Manifest))
+    {
+        PrintThread{} << "Unable to parse data manifest for " << BotName << ": " << Result << std::endl;
+        return false;
+    }
+    return true;
+}
+
+bool BotDataSync::DownloadFile(const std::string &BotName, const std::string &DataDirectory, const std::string &Path, const DataManifestEntry &Entry)
+{
+    std::vector<HttpFormField> Fields;
+    Fields.emplace_back("Username", Username);
+    Fields.emplace_back("Password", Password);
+    Fields.emplace_back("BotName", BotName);
+    AddScope(Fields);
+    Fields.emplace_back("Action", "download");
+    Fields.emplace_back("Path", Path);
+    MakeParentDirectories(DataDirectory, Path);
+    std::string LocalPath = DataDirectory + "/" + Path;
+    std::string TempPath = LocalPath + ".sync";
+    HttpResponse Response;
+    if (!Http->DownloadForm(SyncLocation, Fields, TempPath, Response))
+    {
+        PrintThread{} << "Failed to download data file " << Path << " of " << BotName << std::endl;
+        remove(TempPath.c_str());
+        return false;
+    }
+    if (GenerateMD5(TempPath) != Entry.Hash)
+    {
+        PrintThread{} << "Checksum mismatch for data file " << Path << " of " << BotName << std::endl;
+        remove(TempPath.c_str());
+        return false;
+    }
+#ifndef _WIN32
+    // File modes are not part of the manifest, bot binaries have to stay executable.
+    if (Directory.empty())
+    {
+        chmod(TempPath.c_str(), 0755);
+    }
+#endif
+    remove(LocalPath.c_str());
+    return MoveReplayFile(TempPath.c_str(), LocalPath.c_str());
+}
+
+bool BotDataSync::UploadFile(const std::string &BotName, const std::string &DataDirectory, const std::string &Path, const DataManifestEntry &Entry)
+{
+    std::vector<HttpFormField> Fields;
+    Fields.emplace_back("Username", Username);
+    Fields.emplace_back("Password", Password);
+    Fields.emplace_back("BotName", BotName);
+    AddScope(Fields);
+    Fields.emplace_back("Action", "upload");
+    Fields.emplace_back("Path", Path);
+    Fields.emplace_back("Hash", Entry.Hash);
+    Fields.emplace_back("File", DataDirectory + "/" + Path, true);
+    if (!IsSuccessResponse(Http->PostForm(SyncLocation, Fields)))
+    {
+        PrintThread{} << "Failed to upload data file " << Path << " of " << BotName << std::endl;
+        return false;
+    }
+    return true;
+}
+
+bool BotDataSync::DeleteRemoteFile(const std::string &BotName, const std::string &Path)
+{
+    std::vector<HttpFormField> Fields;
+    Fields.emplace_back("Username", Username);
+    Fields.emplace_back("Password", Password);
+    Fields.emplace_back("BotName", BotName);
+    AddScope(Fields);
+    Fields.emplace_back("Action", "delete");
+    Fields.emplace_back("Path", Path);
+    if (!IsSuccessResponse(Http->PostForm(SyncLocation, Fields)))
+    {
+        PrintThread{} << "Failed to delete remote data file " << Path << " of " << BotName << std::endl;
+        return false;
+    }
+    return true;
+}
+
+DataManifest BotDataSync::ScanDirectory(const std::string &DataDirectory, const DataManifest &Cached, bool BotFiles)
+{
+    DataManifest Manifest;
+    std::vector<std::string> Files;
+    ListFilesRecursive(DataDirectory, "", Files);
+    for (const std::string &File : Files)
+    {
+        // Log files are rewritten every game and are of no use to the server copy.
+        if (File == "stderr.log" || File == "stdout.log")
+        {
+            continue;
+        }
+        if (BotFiles && (File.compare(0, 5, "data/") == 0 || EndsWith(File, ".manifest") || EndsWith(File, ".sync")))
+        {
+            continue;
+        }
+        std::string FullPath = DataDirectory + "/" + File;
+        DataManifestEntry Entry;
+        if (!StatFile(FullPath, Entry.Size, Entry.ModifiedTime))
+        {
+            continue;
+        }
+        const auto CachedEntry = Cached.find(File);
+        if (CachedEntry != Cached.end() && CachedEntry->second.Size == Entry.Size && CachedEntry->second.ModifiedTime == Entry.ModifiedTime)
+        {
+            Entry.Hash = CachedEntry->second.Hash;
+        }
+        else
+        {
+            Entry.Hash = GenerateMD5(FullPath);
+        }
+        Manifest[File] = Entry;
+    }
+    return Manifest;
+}
+
+std::string BotDataSync::GetManifestJson(const DataManifest &Manifest)
+{
+    rapidjson::StringBuffer buffer;
+    rapidjson::Writer<rapidjson::StringBuffer> writer(buffer);
+    WriteManifest(writer, Manifest);
+    return buffer.GetString();
+}
+
+void BotDataSync::FinishStats(DataSyncStats &Stats, double Seconds)
+{
+    Stats.Seconds = Seconds;
+    if (Stats.BytesTransferred > 0 && Seconds > 0.0)
+    {
+        const double Measured = Stats.BytesTransferred / Seconds;
+        const double Previous = BytesPerSecond.load();
+        BytesPerSecond.store(Previous > 0.0 ? (Previous * 0.8 + Measured * 0.2) : Measured);
+    }
+    const double Rate = BytesPerSecond.load();
+    if (Rate > 0.0)
+    {
+        Stats.EstimatedSecondsSaved = (Stats.TotalBytes - Stats.BytesTransferred) / Rate;
+    }
+}
@@ -0,0 +1,85 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <map>
+#include <string>
+#include <vector>
+
+class HttpClient;
+struct HttpFormField;
+
+struct DataManifestEntry
+{
+    uint64_t Size{0};
+    int64_t ModifiedTime{0};
+    std::string Hash;
+};
+
+// Relative file path inside the data directory -> entry
+typedef std::map<std::string, DataManifestEntry> DataManifest;
+
+struct DataSyncStats
+{
+    uint64_t TotalBytes{0};
+    uint64_t BytesTransferred{0};
+    size_t FilesTransferred{0};
+    size_t FilesDeleted{0};
+    double Seconds{0.0};
+    double EstimatedSecondsSaved{0.0};
+
+    void Add(const DataSyncStats &Other);
+};
+
+// Keeps a bot's data directory in sync with the copy on the ladder website,
+// moving only the files whose content changed.
+//
+// All requests are posted to BotDataSyncPath with Username, Password, BotName and Action:
+//   Action=manifest                    -> {"Files":[{"Path":"a/b.txt","Size":12,"Hash":"<md5>"}]}
+//   Action=download, Path              -> raw file content
+//   Action=upload, Path, Hash, File=@  -> {"result":true}
+//   Action=delete, Path                -> {"result":true}
+//
+// The manifest of the last synchronised state is cached next to the data directory,
+// so unchanged files are recognised by size and modification time without hashing them again.
+// A manifest naming an absolute path or one with ".." is refused as a whole.
+//
+// With an empty Directory the bot's own files are synchronised instead of its data, all requests
+// then carry Scope=bot. The data directory and the cached manifests are left out of that scope.
+class BotDataSync
+{
+public:
+    BotDataSync(HttpClient *InHttp, const std::string &InSyncLocation, const std::string &InUsername, const std::string &InPassword, const std::string &InDirectory = "data");
+
+    bool Download(const std::string &BotName, const std::string &BotDirectory, DataSyncStats &Stats);
+    bool Upload(const std::string &BotName, const std::string &BotDirectory, DataSyncStats &Stats);
+
+    // Used by the coordinator to serve the same protocol.
+    static DataManifest ScanDirectory(const std::string &Directory, const DataManifest &Cached, bool BotFiles);
+    static std::string GetManifestJson(const DataManifest &Manifest);
+    // Relative paths only, without any way to step out of the data directory.
+    static bool IsSafePath(const std::string &Path);
+    // Fails on malformed json and on any entry with an unsafe path.
+    static bool ParseManifest(const std::string &Json, DataManifest &Manifest);
+    // Changed lists the files of Source that Target lacks or holds with other content,
+    // Removed the files only Target has.
+    static void DiffManifests(const DataManifest &Source, const DataManifest &Target, std::vector<std::string> &Changed, std::vector<std::string> &Removed);
+
+private:
+    bool FetchRemoteManifest(const std::string &BotName, DataManifest &Manifest);
+    bool DownloadFile(const std::string &BotName, const std::string &DataDirectory, const std::string &Path, const DataManifestEntry &Entry);
+    bool UploadFile(const std::string &BotName, const std::string &DataDirectory, const std::string &Path, const DataManifestEntry &Entry);
+    bool DeleteRemoteFile(const std::string &BotName, const std::string &Path);
+    void AddScope(std::vector<HttpFormField> &Fields) const;
+    std::string GetSyncDirectory(const std::string &BotDirectory) const;
+    std::string GetManifestFile(const std::string &BotDirectory) const;
+    void FinishStats(DataSyncStats &Stats, double Seconds);
+
+    HttpClient *Http;
+    const std::string SyncLocation;
+    const std::string Username;
+    const std::string Password;
+    const std::string Directory;
+    // Updated by every match slot that synchronises a bot.
+    std::atomic<double> BytesPerSecond{0.0};
+};
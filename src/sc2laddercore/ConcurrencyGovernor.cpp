@@ -0,0 +1,233 @@
+#include "ConcurrencyGovernor.h"
+
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+#include <string>
+
+#include "Log.h"
+
+namespace {
+
+// Intervals a number of slots that overloaded the host is not tried again.
+const int CeilingIntervals = 10;
+
+#ifdef __linux__
+// Sums the cpu line of /proc/stat: user nice system idle iowait irq softirq steal.
+bool ReadCpuTicks(uint64_t &BusyTicks, uint64_t &TotalTicks)
+{
+    std::ifstream StatFile("/proc/stat");
+    std::string Cpu;
+    uint64_t Ticks[8] = {};
+    if (!(StatFile >> Cpu) || Cpu != "cpu")
+    {
+        return false;
+    }
+    for (uint64_t &Field : Ticks)
+    {
+        if (!(StatFile >> Field))
+        {
+            return false;
+        }
+    }
+    TotalTicks = 0;
+    for (const uint64_t Field : Ticks)
+    {
+        TotalTicks += Field;
+    }
+    // Idle and iowait are the time no task ran.
+    BusyTicks = TotalTicks - Ticks[3] - Ticks[4];
+    return true;
+}
+
+// Reads avg10 of the line "some avg10=1.23 avg60=0.50 avg300=0.10 total=12345".
+double ReadMemoryPressure()
+{
+    std::ifstream PressureFile("/proc/pressure/memory");
+    std::string Line;
+    while (std::getline(PressureFile, Line))
+    {
+        std::istringstream Fields(Line);
+        std::string Kind;
+        std::string Average;
+        if (Fields >> Kind >> Average && Kind == "some" && Average.compare(0, 6, "avg10=") == 0)
+        {
+            return std::stod(Average.substr(6));
+        }
+    }
+    return 0.0;
+}
+#endif
+
+} // namespace
+
+HostSampler::HostSampler()
+    : LastBusyTicks(0)
+    , LastTotalTicks(0)
+{
+    Sample();
+}
+
+HostLoad HostSampler::Sample()
+{
+    HostLoad Load;
+#ifdef __linux__
+    uint64_t BusyTicks = 0;
+    uint64_t TotalTicks = 0;
+    if (ReadCpuTicks(BusyTicks, TotalTicks))
+    {
+        if (TotalTicks > LastTotalTicks && BusyTicks >= LastBusyTicks)
+        {
+            Load.CpuPercent = 100.0 * (BusyTicks - LastBusyTicks) / (TotalTicks - LastTotalTicks);
+        }
+        LastBusyTicks = BusyTicks;
+        LastTotalTicks = TotalTicks;
+    }
+    Load.MemoryPressure = ReadMemoryPressure();
+#endif
+    return Load;
+}
+
+ConcurrencyGovernor::ConcurrencyGovernor(const LadderSettings &Settings, Clock::time_point Now)
+    : MinSlots(std::max(1, std::min(Settings.MinMatchSlots, Settings.MaxMatchSlots)))
+    , MaxSlots(std::max(1, Settings.MaxMatchSlots))
+    , Interval(std::chrono::seconds(Settings.GovernorInterval))
+    , MaxCpu(Settings.GovernorMaxCpu)
+    , MaxMemoryPressure(Settings.GovernorMaxMemoryPressure)
+    , MaxStepTimeouts(Settings.GovernorMaxStepTimeouts)
+    , MaxSlowdown(Settings.GovernorMaxSlowdown)
+    , Slots(MinSlots)
+    , Ceiling(MaxSlots)
+    , CeilingUntil(Now)
+    , IntervalStart(Now)
+    , IntervalLoops(0.0)
+    , IntervalMatchSeconds(0.0)
+    , IntervalMatches(0)
+    , IntervalTimeouts(0)
+{
+}
+
+int ConcurrencyGovernor::GetSlots() const
+{
+    std::lock_guard<std::mutex> Lock(GovernorMutex);
+    return Slots;
+}
+
+void ConcurrencyGovernor::ReportProgress(int Slot, uint32_t GameLoop, Clock::time_point Now)
+{
+    std::lock_guard<std::mutex> Lock(GovernorMutex);
+    const auto Last = Progress.find(Slot);
+    if (Last != Progress.end() && GameLoop >= Last->second.GameLoop && Now > Last->second.Time)
+    {
+        IntervalLoops += GameLoop - Last->second.GameLoop;
+        IntervalMatchSeconds += std::chrono::duration<double>(Now - Last->second.Time).count();
+    }
+    Progress[Slot] = SlotProgress{GameLoop, Now};
+    BusySlots.insert(Slot);
+}
+
+void ConcurrencyGovernor::ReportResult(int Slot, const GameResult &Result)
+{
+    std::lock_guard<std::mutex> Lock(GovernorMutex);
+    Progress.erase(Slot);
+    ++IntervalMatches;
+    if (Result.StepTimeouts > 0)
+    {
+        ++IntervalTimeouts;
+    }
+}
+
+bool ConcurrencyGovernor::IsDue(Clock::time_point Now) const
+{
+    std::lock_guard<std::mutex> Lock(GovernorMutex);
+    return Now - IntervalStart >= Interval;
+}
+
+bool ConcurrencyGovernor::Update(const HostLoad &Load, Clock::time_point Now)
+{
+    std::lock_guard<std::mutex> Lock(GovernorMutex);
+    const double Seconds = std::chrono::duration<double>(Now - IntervalStart).count();
+    const bool Measured = IntervalMatchSeconds > 0.0 && Seconds > 0.0;
+    const bool Full = static_cast<int>(BusySlots.size()) >= Slots;
+    const double MatchSpeed = Measured ? IntervalLoops / IntervalMatchSeconds : 0.0;
+    const double Throughput = Measured ? IntervalLoops / Seconds : 0.0;
+    // Only intervals in which every slot played say what this number of slots can do.
+    if (Measured && Full)
+    {
+        SlotLevel &Level = Levels[Slots];
+        Level.Throughput = Level.Intervals == 0 ? Throughput : (Level.Throughput + Throughput) / 2.0;
+        Level.MatchSpeed = Level.Intervals == 0 ? MatchSpeed : (Level.MatchSpeed + MatchSpeed) / 2.0;
+        ++Level.Intervals;
+    }
+    // The matches are compared with the fewest slots that were measured.
+    double ReferenceSpeed = 0.0;
+    for (const auto &Level : Levels)
+    {
+        if (Level.first < Slots)
+        {
+            ReferenceSpeed = Level.second.MatchSpeed;
+            break;
+        }
+    }
+    const auto Lower = Levels.find(Slots - 1);
+
+    std::ostringstream Reason;
+    if (Load.CpuPercent > MaxCpu)
+    {
+        Reason << "cpu use is at " << Load.CpuPercent << "%";
+    }
+    else if (Load.MemoryPressure > MaxMemoryPressure)
+    {
+        Reason << "memory pressure is at " << Load.MemoryPressure << "%";
+    }
+    else if (IntervalMatches > 0 && IntervalTimeouts * 100.0 > MaxStepTimeouts * IntervalMatches)
+    {
+        Reason << IntervalTimeouts << " of " << IntervalMatches << " matches had step timeouts";
+    }
+    else if (Measured && ReferenceSpeed > 0.0 && MatchSpeed < ReferenceSpeed * (100.0 - MaxSlowdown) / 100.0)
+    {
+        Reason << "matches play " << MatchSpeed << " game loops per second instead of " << ReferenceSpeed;
+    }
+    else if (Measured && Full && Lower != Levels.end() && Levels[Slots].Throughput <= Lower->second.Throughput)
+    {
+        Reason << Slots << " matches play no more game loops per second than " << Slots - 1;
+    }
+
+    const int PreviousSlots = Slots;
+    if (!Reason.str().empty())
+    {
+        if (Slots > MinSlots)
+        {
+            --Slots;
+            Ceiling = Slots;
+            CeilingUntil = Now + Interval * CeilingIntervals;
+        }
+    }
+    else if (Measured && Full && Slots < MaxSlots)
+    {
+        if (Now >= CeilingUntil)
+        {
+            Ceiling = MaxSlots;
+        }
+        if (Slots < Ceiling)
+        {
+            ++Slots;
+        }
+    }
+    if (Slots < PreviousSlots)
+    {
+        PrintThread{} << "Using " << Slots << " match slots instead of " << PreviousSlots << ", " << Reason.str() << "." << std::endl;
+    }
+    else if (Slots > PreviousSlots)
+    {
+        PrintThread{} << "Using " << Slots << " match slots, " << PreviousSlots << " played " << Levels[PreviousSlots].Throughput << " game loops per second." << std::endl;
+    }
+
+    IntervalStart = Now;
+    BusySlots.clear();
+    IntervalLoops = 0.0;
+    IntervalMatchSeconds = 0.0;
+    IntervalMatches = 0;
+    IntervalTimeouts = 0;
+    return Slots != PreviousSlots;
+}
@@ -0,0 +1,98 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <set>
+
+#include "LadderSettings.h"
+#include "Types.h"
+
+// Load of the host since the previous sample.
+struct HostLoad
+{
+    // Busy time of all cores in percent.
+    double CpuPercent{0.0};
+    // Share of the last 10 seconds in which some task waited for memory (PSI "some avg10"), in percent.
+    double MemoryPressure{0.0};
+};
+
+// Reads the cpu time from /proc/stat and the memory pressure from /proc/pressure/memory.
+// Elsewhere, and on kernels without PSI, the missing values stay 0.
+class HostSampler
+{
+public:
+    HostSampler();
+
+    HostLoad Sample();
+
+private:
+    uint64_t LastBusyTicks;
+    uint64_t LastTotalTicks;
+};
+
+// Decides how many matches are played at the same time, between MinMatchSlots and MaxMatchSlots.
+// Once per GovernorInterval it looks at the host and at the matches of the interval:
+// - a slot is taken away if the cpu or the memory pressure is above its limit, if too many matches
+//   had a bot stopped for a step timeout, or if a match runs more than GovernorMaxSlowdown percent
+//   fewer game loops per second than with fewer slots, which is when the bots' steps get slower.
+// - a slot is taken away as well if all slots together play no more game loops per second than
+//   one slot less did, the host is then saturated.
+// - otherwise a slot is added while every slot is busy.
+// After a slot was taken away the governor stays below that number for ten intervals before it tries again.
+// Slots report from their own threads, all members are thread safe.
+class ConcurrencyGovernor
+{
+public:
+    using Clock = std::chrono::steady_clock;
+
+    ConcurrencyGovernor(const LadderSettings &Settings, Clock::time_point Now = Clock::now());
+
+    // Slots 0 to GetSlots() - 1 may start a match.
+    int GetSlots() const;
+    // The match of Slot has reached GameLoop.
+    void ReportProgress(int Slot, uint32_t GameLoop, Clock::time_point Now = Clock::now());
+    // The match of Slot has ended.
+    void ReportResult(int Slot, const GameResult &Result);
+    bool IsDue(Clock::time_point Now = Clock::now()) const;
+    // Decides on the slots of the next interval. Returns true if their number changed.
+    bool Update(const HostLoad &Load, Clock::time_point Now = Clock::now());
+
+private:
+    struct SlotProgress
+    {
+        uint32_t GameLoop;
+        Clock::time_point Time;
+    };
+    // Game loops per second seen with a number of slots, averaged over the intervals.
+    struct SlotLevel
+    {
+        double Throughput{0.0};
+        double MatchSpeed{0.0};
+        int Intervals{0};
+    };
+
+    const int MinSlots;
+    const int MaxSlots;
+    const Clock::duration Interval;
+    const double MaxCpu;
+    const double MaxMemoryPressure;
+    const double MaxStepTimeouts;
+    const double MaxSlowdown;
+
+    mutable std::mutex GovernorMutex;
+    int Slots;
+    int Ceiling;
+    Clock::time_point CeilingUntil;
+    Clock::time_point IntervalStart;
+    // Last report of every slot that is playing a match.
+    std::map<int, SlotProgress> Progress;
+    // Slots that played during the interval.
+    std::set<int> BusySlots;
+    double IntervalLoops;
+    double IntervalMatchSeconds;
+    int IntervalMatches;
+    int IntervalTimeouts;
+    std::map<int, SlotLevel> Levels;
+};
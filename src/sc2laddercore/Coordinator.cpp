@@ -0,0 +1,515 @@
+#include "Coordinator.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+
+#define RAPIDJSON_HAS_STDSTRING 1
+#include "rapidjson.h"
+#include "document.h"
+#include "ostreamwrapper.h"
+#include "prettywriter.h"
+#include "stringbuffer.h"
+#include "writer.h"
+
+#include "civetweb.h"
+
+#include "AgentsConfig.h"
+#include "LadderSettings.h"
+#include "MatchupList.h"
+#include "Tools.h"
+
+namespace {
+
+// Workers that ask while leased matches may still come back wait this long before asking again.
+constexpr int RetryAfterSeconds = 10;
+// Matches drawn from the schedule and held back because one of their bots is playing.
+// Past this a worker waits instead of the schedule being read further ahead.
+constexpr size_t MaxDeferredMatches = 100;
+
+std::atomic<uint64_t> UploadCounter{0};
+
+// Fields of a posted form. Uploaded files are stored in temporary files, which are removed
+// with the form unless the handler has moved them somewhere else.
+struct FormData
+{
+    std::map<std::string, std::string> Values;
+    std::map<std::string, std::string> Files;
+    std::string UploadDirectory;
+    const std::string *Username{nullptr};
+    const std::string *Password{nullptr};
+
+    ~FormData()
+    {
+        for (const auto &File : Files)
+        {
+            remove(File.second.c_str());
+        }
+    }
+
+    std::string Get(const std::string &Name) const
+    {
+        const auto Found = Values.find(Name);
+        return Found != Values.end() ? Found->second : std::string();
+    }
+
+    // Workers send their credentials first, so files of anyone else are never stored.
+    bool IsAuthorized() const
+    {
+        return Get("Username") == *Username && Get("Password") == *Password;
+    }
+};
+
+int FieldFound(const char *Key, const char *FileName, char *Path, size_t PathLength, void *UserData)
+{
+    FormData *Form = static_cast<FormData *>(UserData);
+    if (FileName == nullptr || FileName[0] == '\0')
+    {
+        return FORM_FIELD_STORAGE_GET;
+    }
+    if (!Form->IsAuthorized())
+    {
+        return FORM_FIELD_STORAGE_SKIP;
+    }
+    const std::string Stored = Form->UploadDirectory + "upload-" + std::to_string(++UploadCounter) + ".tmp";
+    if (Stored.size() >= PathLength)
+    {
+        return FORM_FIELD_STORAGE_SKIP;
+    }
+    std::snprintf(Path, PathLength, "%s", Stored.c_str());
+    Form->Files[Key] = Stored;
+    return FORM_FIELD_STORAGE_STORE;
+}
+
+int FieldGet(const char *Key, const char *Value, size_t ValueLength, void *UserData)
+{
+    // Long values arrive in several parts.
+    static_cast<FormData *>(UserData)->Values[Key].append(Value, ValueLength);
+    return 0;
+}
+
+int FieldStored(const char *, long long, void *)
+{
+    return 0;
+}
+
+void ReadForm(mg_connection *Connection, FormData &Form)
+{
+    mg_form_data_handler Handler;
+    Handler.field_found = FieldFound;
+    Handler.field_get = FieldGet;
+    Handler.field_store = FieldStored;
+    Handler.user_data = &Form;
+    mg_handle_form_request(Connection, &Handler);
+}
+
+const char *GetStatusText(int Status)
+{
+    switch (Status)
+    {
+    case 200:
+        return "OK";
+    case 204:
+        return "No Content";
+    case 400:
+        return "Bad Request";
+    case 401:
+        return "Unauthorized";
+    case 404:
+        return "Not Found";
+    case 410:
+        return "Gone";
+    default:
+        return "Internal Server Error";
+    }
+}
+
+int SendResponse(mg_connection *Connection, int Status, const std::string &Body)
+{
+    mg_printf(Connection, "HTTP/1.1 %d %s\r\nContent-Type: application/json\r\nContent-Length: %u\r\nConnection: close\r\n\r\n", Status, GetStatusText(Status), static_cast<unsigned>(Body.size()));
+    mg_write(Connection, Body.data(), Body.size());
+    return Status;
+}
+
+int SendResult(mg_connection *Connection, bool Success)
+{
+    return SendResponse(Connection, Success ? 200 : 400, Success ? "{\"result\":true}" : "{\"result\":false}");
+}
+
+// All workers share the credentials, they are told apart by their address.
+std::string GetWorkerName(mg_connection *Connection)
+{
+    const mg_request_info *Request = mg_get_request_info(Connection);
+    return Request != nullptr && Request->remote_addr != nullptr ? Request->remote_addr : "unknown worker";
+}
+
+// Reads the posted form, false if it does not carry CoordinatorUsername and CoordinatorPassword.
+bool ReadAuthorizedForm(mg_connection *Connection, FormData &Form, const std::string &UploadDirectory, const LadderSettings &Settings)
+{
+    Form.UploadDirectory = UploadDirectory;
+    Form.Username = &Settings.CoordinatorUsername;
+    Form.Password = &Settings.CoordinatorPassword;
+    ReadForm(Connection, Form);
+    if (!Form.IsAuthorized())
+    {
+        PrintThread{} << "Rejected a request of " << GetWorkerName(Connection) << " without valid credentials." << std::endl;
+        return false;
+    }
+    return true;
+}
+
+template <typename Writer>
+void WriteBot(Writer &writer, const char *Key, const BotConfig &Bot)
+{
+    writer.Key(Key);
+    writer.StartObject();
+    writer.Key("name");
+    writer.String(Bot.BotName);
+    if (!Bot.PlayerId.empty())
+    {
+        writer.Key("playerid");
+        writer.String(Bot.PlayerId);
+    }
+    writer.EndObject();
+}
+
+std::string GetMatchJson(const Matchup &Match, const std::string &LeaseId)
+{
+    rapidjson::StringBuffer buffer;
+    rapidjson::Writer<rapidjson::StringBuffer> writer(buffer);
+    writer.StartObject();
+    WriteBot(writer, "Bot1", Match.Agent1);
+    WriteBot(writer, "Bot2", Match.Agent2);
+    writer.Key("Map");
+    writer.String(Match.Map);
+    writer.Key("LeaseId");
+    writer.String(LeaseId);
+    writer.EndObject();
+    return buffer.GetString();
+}
+
+// Relative paths from a worker must stay inside the synchronised directory.
+void MakeParentDirectories(const std::string &Root, const std::string &RelativePath)
+{
+    size_t Slash = RelativePath.find('/');
+    while (Slash != std::string::npos)
+    {
+        MakeDirectory(Root + RelativePath.substr(0, Slash));
+        Slash = RelativePath.find('/', Slash + 1);
+    }
+}
+
+std::string GetReplayName(const Matchup &Match)
+{
+    std::string ReplayName = Match.Agent1.BotName + "v" + Match.Agent2.BotName + "-" + RemoveMapExtension(Match.Map) + ".SC2Replay";
+    ReplayName.erase(std::remove_if(ReplayName.begin(), ReplayName.end(), isspace), ReplayName.end());
+    return ReplayName;
+}
+
+} // namespace
+
+Coordinator::Coordinator(std::shared_ptr<const LadderSettings> InSettings, const AgentsConfig *InAgents, MatchupList *InMatchups, ResultHandler InOnResult)
+    : Settings(InSettings)
+    , Agents(InAgents)
+    , Matchups(InMatchups)
+    , OnResult(InOnResult)
+    , UploadDirectory(InSettings->LocalReplayDirectory + "coordinator/")
+    , Leases(InSettings->LeaseTimeout, InSettings->LeaseAttempts)
+{
+    MakeDirectory(UploadDirectory);
+    WriteBotConfigs();
+}
+
+Coordinator::~Coordinator()
+{
+    if (Server != nullptr)
+    {
+        mg_stop(Server);
+    }
+}
+
+bool Coordinator::Run()
+{
+    const std::string Port = Settings->CoordinatorAddress + ":" + std::to_string(Settings->CoordinatorPort);
+    const char *Options[] = { "listening_ports", Port.c_str(), "num_threads", "16", nullptr };
+    mg_callbacks Callbacks;
+    std::memset(&Callbacks, 0, sizeof(Callbacks));
+    Server = mg_start(&Callbacks, this, Options);
+    if (Server == nullptr)
+    {
+        PrintThread{} << "Unable to listen for workers on " << Port << std::endl;
+        return false;
+    }
+    mg_set_request_handler(Server, "/matchup", HandleMatchup, this);
+    mg_set_request_handler(Server, "/result", HandleResult, this);
+    mg_set_request_handler(Server, "/sync", HandleSync, this);
+    PrintThread{} << "Coordinating workers on " << Port << ", leases run out after " << Settings->LeaseTimeout << " seconds without a heartbeat." << std::endl;
+    while (!IsFinished())
+    {
+        SleepFor(1);
+        Leases.Expire();
+        RecordAbandoned();
+    }
+    PrintThread{} << "Every match of the schedule has been played." << std::endl;
+    mg_stop(Server);
+    Server = nullptr;
+    return true;
+}
+
+bool Coordinator::IsFinished() const
+{
+    std::lock_guard<std::mutex> Lock(ScheduleMutex);
+    return ScheduleDone && Deferred.empty() && Leases.GetActiveCount() == 0 && Leases.GetReturnedCount() == 0 && Leases.GetAbandonedCount() == 0;
+}
+
+bool Coordinator::IsBotBusy(const Matchup &Match) const
+{
+    return (Match.Agent1.Type != Computer && Leases.IsPlaying(Match.Agent1.BotName))
+        || (Match.Agent2.Type != Computer && Leases.IsPlaying(Match.Agent2.BotName));
+}
+
+bool Coordinator::TakeNextMatch(Matchup &NextMatch)
+{
+    // Held back matches go first, so they are not overtaken for long.
+    for (auto Waiting = Deferred.begin(); Waiting != Deferred.end(); ++Waiting)
+    {
+        if (!IsBotBusy(*Waiting))
+        {
+            NextMatch = *Waiting;
+            Deferred.erase(Waiting);
+            return true;
+        }
+    }
+    while (Deferred.size() < MaxDeferredMatches)
+    {
+        if (!Leases.TakeReturned(NextMatch))
+        {
+            if (ScheduleDone || !Matchups->GetNextMatchup(NextMatch))
+            {
+                ScheduleDone = true;
+                return false;
+            }
+        }
+        if (!IsBotBusy(NextMatch))
+        {
+            return true;
+        }
+        Deferred.push_back(NextMatch);
+    }
+    return false;
+}
+
+void Coordinator::RecordAbandoned()
+{
+    Matchup Match;
+    while (Leases.TakeAbandoned(Match))
+    {
+        PrintThread{} << Match.Agent1.BotName << " vs " << Match.Agent2.BotName << " on " << Match.Map << " was not played after " << Settings->LeaseAttempts << " leases, giving up." << std::endl;
+        LogWrite(LogTarget::ErrorList, "\"" + Match.Agent1.BotName + "\"vs\"" + Match.Agent2.BotName + "\" " + Match.Map + "\n");
+        std::lock_guard<std::mutex> Lock(ScheduleMutex);
+        Matchups->CompleteMatch(Match);
+    }
+}
+
+int Coordinator::HandleMatchup(mg_connection *Connection, void *Data)
+{
+    Coordinator *Self = static_cast<Coordinator *>(Data);
+    FormData Form;
+    if (!ReadAuthorizedForm(Connection, Form, Self->UploadDirectory, *Self->Settings))
+    {
+        return SendResponse(Connection, 401, "{\"result\":false}");
+    }
+    const std::string Worker = GetWorkerName(Connection);
+    const std::string Action = Form.Get("Action");
+    const std::string LeaseId = Form.Get("LeaseId");
+    if (Action == "heartbeat")
+    {
+        const bool Renewed = Self->Leases.Renew(LeaseId);
+        return SendResponse(Connection, Renewed ? 200 : 410, Renewed ? "{\"result\":true}" : "{\"result\":false}");
+    }
+    if (Action == "release")
+    {
+        if (Self->Leases.Release(LeaseId))
+        {
+            PrintThread{} << Worker << " released lease " << LeaseId << std::endl;
+        }
+        return SendResult(Connection, true);
+    }
+
+    Matchup NextMatch;
+    std::lock_guard<std::mutex> Lock(Self->ScheduleMutex);
+    if (!Self->TakeNextMatch(NextMatch))
+    {
+        if (Self->ScheduleDone && Self->Deferred.empty() && Self->Leases.GetActiveCount() == 0)
+        {
+            return SendResponse(Connection, 204, "");
+        }
+        return SendResponse(Connection, 200, "{\"RetryAfter\":" + std::to_string(RetryAfterSeconds) + "}");
+    }
+    const std::string NewLease = Self->Leases.Add(NextMatch, Worker);
+    PrintThread{} << "Lease " << NewLease << ": " << NextMatch.Agent1.BotName << " vs " << NextMatch.Agent2.BotName << " on " << NextMatch.Map << " to " << Worker << std::endl;
+    return SendResponse(Connection, 200, GetMatchJson(NextMatch, NewLease));
+}
+
+int Coordinator::HandleResult(mg_connection *Connection, void *Data)
+{
+    Coordinator *Self = static_cast<Coordinator *>(Data);
+    FormData Form;
+    if (!ReadAuthorizedForm(Connection, Form, Self->UploadDirectory, *Self->Settings))
+    {
+        return SendResponse(Connection, 401, "{\"result\":false}");
+    }
+    const std::string LeaseId = Form.Get("LeaseId");
+    Matchup Match;
+    if (!Self->Leases.Complete(LeaseId, Match))
+    {
+        // The match has been handed to another worker, whose result counts.
+        PrintThread{} << "Result of " << GetWorkerName(Connection) << " for unknown or expired lease " << LeaseId << " ignored." << std::endl;
+        return SendResponse(Connection, 410, "{\"result\":false}");
+    }
+    GameResult Result;
+    Result.Result = GetResultTypeFromString(Form.Get("Result"));
+    Result.Bot1AvgFrame = static_cast<float>(std::strtod(Form.Get("Bot1AvgFrame").c_str(), nullptr));
+    Result.Bot2AvgFrame = static_cast<float>(std::strtod(Form.Get("Bot2AvgFrame").c_str(), nullptr));
+    Result.GameLoop = static_cast<uint32_t>(std::strtoul(Form.Get("Frames").c_str(), nullptr, 10));
+    Result.TimeStamp = Form.Get("TimeStamp");
+    const auto Replay = Form.Files.find("replayfile");
+    if (Replay != Form.Files.end())
+    {
+        const std::string ReplayFile = Self->Settings->LocalReplayDirectory + GetReplayName(Match);
+        if (!ReplaceFileAtomically(Replay->second, ReplayFile))
+        {
+            PrintThread{} << "Unable to store the replay " << ReplayFile << std::endl;
+        }
+    }
+    PrintThread{} << GetWorkerName(Connection) << " finished " << Match.Agent1.BotName << " vs " << Match.Agent2.BotName << " on " << Match.Map << ": " << GetResultType(Result.Result) << std::endl;
+    {
+        std::lock_guard<std::mutex> Lock(Self->ScheduleMutex);
+        Self->Matchups->CompleteMatch(Match);
+        Self->OnResult(Match, Result);
+    }
+    return SendResult(Connection, true);
+}
+
+int Coordinator::HandleSync(mg_connection *Connection, void *Data)
+{
+    Coordinator *Self = static_cast<Coordinator *>(Data);
+    FormData Form;
+    if (!ReadAuthorizedForm(Connection, Form, Self->UploadDirectory, *Self->Settings))
+    {
+        return SendResponse(Connection, 401, "{\"result\":false}");
+    }
+    const BotConfig *Bot = Self->Agents->FindBot(Form.Get("BotName"));
+    if (Bot == nullptr || Bot->Type == Computer)
+    {
+        return SendResponse(Connection, 404, "{\"result\":false}");
+    }
+    const bool BotFiles = Form.Get("Scope") == "bot";
+    const std::string Directory = BotFiles ? Bot->RootPath : Bot->RootPath + "data/";
+    const std::string Action = Form.Get("Action");
+    const std::string Path = Form.Get("Path");
+    if (Action == "manifest")
+    {
+        DataManifest Manifest;
+        {
+            std::lock_guard<std::mutex> Lock(Self->SyncMutex);
+            DataManifest &Cached = Self->Manifests[Directory];
+            Cached = BotDataSync::ScanDirectory(Directory, Cached, BotFiles);
+            Manifest = Cached;
+        }
+        if (BotFiles)
+        {
+            // Workers load the bot from its own directory, the coordinator's config may have it elsewhere.
+            std::string ConfigFile = Self->GetBotConfigFile(Bot->BotName);
+            DataManifestEntry &Entry = Manifest["ladderbots.json"];
+            Entry.Hash = GenerateMD5(ConfigFile);
+            std::ifstream Config(ConfigFile, std::ifstream::ate | std::ifstream::binary);
+            Entry.Size = static_cast<uint64_t>(Config.tellg());
+            Entry.ModifiedTime = 0;
+        }
+        return SendResponse(Connection, 200, BotDataSync::GetManifestJson(Manifest));
+    }
+    if (!BotDataSync::IsSafePath(Path))
+    {
+        return SendResult(Connection, false);
+    }
+    if (Action == "download")
+    {
+        const std::string File = BotFiles && Path == "ladderbots.json" ? Self->GetBotConfigFile(Bot->BotName) : Directory + Path;
+        mg_send_file(Connection, File.c_str());
+        return 200;
+    }
+    // The bots themselves are only changed on the coordinator.
+    if (BotFiles)
+    {
+        return SendResult(Connection, false);
+    }
+    if (Action == "upload")
+    {
+        const auto Uploaded = Form.Files.find("File");
+        if (Uploaded == Form.Files.end() || GenerateMD5(Uploaded->second) != Form.Get("Hash"))
+        {
+            return SendResult(Connection, false);
+        }
+        MakeDirectory(Directory);
+        MakeParentDirectories(Directory, Path);
+        const std::string File = Directory + Path;
+        return SendResult(Connection, ReplaceFileAtomically(Uploaded->second, File));
+    }
+    if (Action == "delete")
+    {
+        remove((Directory + Path).c_str());
+        return SendResult(Connection, true);
+    }
+    return SendResult(Connection, false);
+}
+
+std::string Coordinator::GetBotConfigFile(const std::string &BotName) const
+{
+    return UploadDirectory + BotName + ".ladderbots.json";
+}
+
+void Coordinator::WriteBotConfigs()
+{
+    for (const BotConfig &Bot : Agents->GetBots())
+    {
+        if (Bot.Type == Computer)
+        {
+            continue;
+        }
+        std::ofstream ofs(GetBotConfigFile(Bot.BotName), std::ofstream::trunc);
+        rapidjson::OStreamWrapper osw(ofs);
+        rapidjson::PrettyWriter<rapidjson::OStreamWrapper> writer(osw);
+        writer.StartObject();
+        writer.Key("Bots");
+        writer.StartObject();
+        writer.Key(Bot.BotName);
+        writer.StartObject();
+        writer.Key("Race");
+        writer.String(GetRaceString(Bot.Race));
+        writer.Key("Type");
+        writer.String(GetTypeString(Bot.Type));
+        writer.Key("RootPath");
+        writer.String("./");
+        writer.Key("FileName");
+        writer.String(Bot.FileName);
+        if (!Bot.Args.empty())
+        {
+            writer.Key("Args");
+            writer.String(Bot.Args);
+        }
+        writer.Key("Debug");
+        writer.Bool(Bot.Debug);
+        if (!Bot.SurrenderPhrase.empty())
+        {
+            writer.Key("SurrenderPhrase");
+            writer.String(Bot.SurrenderPhrase);
+        }
+        writer.EndObject();
+        writer.EndObject();
+        writer.EndObject();
+    }
+}
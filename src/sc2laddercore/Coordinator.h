@@ -0,0 +1,75 @@
+#pragma once
+
+#include <deque>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+
+#include "BotDataSync.h"
+#include "MatchLeases.h"
+#include "Types.h"
+
+class AgentsConfig;
+class MatchupList;
+struct LadderSettings;
+struct mg_connection;
+struct mg_context;
+
+// Runs the ladder on worker processes, on this host or on others in the local network.
+// Every request has to carry CoordinatorUsername and CoordinatorPassword as Username and Password.
+// The coordinator owns the schedule, the results and the bots. A worker is a ladder manager
+// with the url generator pointed at the coordinator, which speaks the ladder website protocol:
+//   POST /matchup                    -> next match with a LeaseId, {"RetryAfter":<seconds>} while
+//                                       leased matches may still come back or every remaining match
+//                                       has a bot that plays on another worker, 204 when all are played
+//   POST /matchup Action=heartbeat   -> renews LeaseId, 410 if it ran out
+//   POST /matchup Action=release     -> the match of LeaseId is handed out again, up to LeaseAttempts leases
+//   POST /result                     -> the fields of a result upload, with LeaseId and the replay
+//   POST /sync                       -> the BotDataSync protocol for bot data, with Scope=bot for the
+//                                       bot's own files and a generated ladderbots.json
+class Coordinator
+{
+public:
+    typedef std::function<void(const Matchup &Match, const GameResult &Result)> ResultHandler;
+
+    Coordinator(std::shared_ptr<const LadderSettings> InSettings, const AgentsConfig *InAgents, MatchupList *InMatchups, ResultHandler InOnResult);
+    ~Coordinator();
+
+    // Serves the workers until every match of the schedule has a result.
+    bool Run();
+
+private:
+    static int HandleMatchup(mg_connection *Connection, void *Data);
+    static int HandleResult(mg_connection *Connection, void *Data);
+    static int HandleSync(mg_connection *Connection, void *Data);
+
+    bool IsFinished() const;
+    // Called with ScheduleMutex held. The two workers would overwrite each other's bot data through /sync.
+    bool IsBotBusy(const Matchup &Match) const;
+    // Called with ScheduleMutex held. Takes the next match whose bots are not in a leased match,
+    // false if there is none right now or the schedule is done.
+    bool TakeNextMatch(Matchup &NextMatch);
+    // Matches that ran out of leases go to the error list and count as done.
+    void RecordAbandoned();
+    void WriteBotConfigs();
+    std::string GetBotConfigFile(const std::string &BotName) const;
+
+    const std::shared_ptr<const LadderSettings> Settings;
+    const AgentsConfig *Agents;
+    MatchupList *Matchups;
+    const ResultHandler OnResult;
+    const std::string UploadDirectory;
+    MatchLeases Leases;
+    mg_context *Server{nullptr};
+
+    // Guards the schedule and the results, workers are served from several threads.
+    mutable std::mutex ScheduleMutex;
+    bool ScheduleDone{false};
+    // Matches that wait for one of their bots to finish a match on another worker.
+    std::deque<Matchup> Deferred;
+    // Last manifest of every synchronised directory, so unchanged files are not hashed again.
+    std::mutex SyncMutex;
+    std::map<std::string, DataManifest> Manifests;
+};
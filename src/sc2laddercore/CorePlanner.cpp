@@ -0,0 +1,173 @@
+#include "CorePlanner.h"
+
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <thread>
+
+#ifdef __linux__
+#include <sched.h>
+#endif
+
+namespace {
+
+// Parses a kernel cpu list like "0-3,8,10-11".
+std::vector<int> ParseCpuList(const std::string &List)
+{
+    std::vector<int> Cpus;
+    std::istringstream Ranges(List);
+    std::string Range;
+    while (std::getline(Ranges, Range, ','))
+    {
+        const size_t Dash = Range.find('-');
+        try
+        {
+            const int First = std::stoi(Range.substr(0, Dash));
+            const int Last = Dash == std::string::npos ? First : std::stoi(Range.substr(Dash + 1));
+            for (int Cpu = First; Cpu <= Last; ++Cpu)
+            {
+                Cpus.push_back(Cpu);
+            }
+        }
+        catch (const std::exception &)
+        {
+        }
+    }
+    return Cpus;
+}
+
+std::vector<std::vector<int>> ReadNodes()
+{
+    std::vector<std::vector<int>> Nodes;
+#ifdef __linux__
+    cpu_set_t Allowed;
+    CPU_ZERO(&Allowed);
+    const bool KnowAllowed = sched_getaffinity(0, sizeof(Allowed), &Allowed) == 0;
+    for (int Node = 0;; ++Node)
+    {
+        std::ifstream NodeCpus("/sys/devices/system/node/node" + std::to_string(Node) + "/cpulist");
+        if (!NodeCpus)
+        {
+            break;
+        }
+        std::string List;
+        std::getline(NodeCpus, List);
+        std::vector<int> Cores;
+        for (int Cpu : ParseCpuList(List))
+        {
+            if (!KnowAllowed || (Cpu < CPU_SETSIZE && CPU_ISSET(Cpu, &Allowed)))
+            {
+                Cores.push_back(Cpu);
+            }
+        }
+        if (!Cores.empty())
+        {
+            Nodes.push_back(Cores);
+        }
+    }
+    if (Nodes.empty() && KnowAllowed)
+    {
+        std::vector<int> Cores;
+        for (int Cpu = 0; Cpu < CPU_SETSIZE; ++Cpu)
+        {
+            if (CPU_ISSET(Cpu, &Allowed))
+            {
+                Cores.push_back(Cpu);
+            }
+        }
+        Nodes.push_back(Cores);
+    }
+#endif
+    if (Nodes.empty())
+    {
+        std::vector<int> Cores;
+        for (unsigned Cpu = 0; Cpu < std::thread::hardware_concurrency(); ++Cpu)
+        {
+            Cores.push_back(static_cast<int>(Cpu));
+        }
+        Nodes.push_back(Cores);
+    }
+    return Nodes;
+}
+
+} // namespace
+
+CorePlanner::CorePlanner(int InCoresPerMatch)
+    : CoresPerMatch(InCoresPerMatch > 0 ? static_cast<size_t>(InCoresPerMatch) : 1)
+    , Nodes(ReadNodes())
+{
+}
+
+CorePlanner::CorePlanner(int InCoresPerMatch, const std::vector<std::vector<int>> &InNodes)
+    : CoresPerMatch(InCoresPerMatch > 0 ? static_cast<size_t>(InCoresPerMatch) : 1)
+    , Nodes(InNodes)
+{
+}
+
+std::vector<int> CorePlanner::Acquire()
+{
+    std::lock_guard<std::mutex> Lock(PlannerMutex);
+    std::vector<int> Spread;
+    for (const std::vector<int> &Node : Nodes)
+    {
+        std::vector<int> Free;
+        for (int Core : Node)
+        {
+            if (Busy.count(Core) == 0)
+            {
+                Free.push_back(Core);
+            }
+        }
+        if (Free.size() >= CoresPerMatch)
+        {
+            Free.resize(CoresPerMatch);
+            Busy.insert(Free.begin(), Free.end());
+            return Free;
+        }
+        Spread.insert(Spread.end(), Free.begin(), Free.end());
+    }
+    // No node has enough free cores on its own.
+    if (Spread.size() < CoresPerMatch)
+    {
+        return std::vector<int>();
+    }
+    Spread.resize(CoresPerMatch);
+    Busy.insert(Spread.begin(), Spread.end());
+    return Spread;
+}
+
+void CorePlanner::Release(const std::vector<int> &Cores)
+{
+    std::lock_guard<std::mutex> Lock(PlannerMutex);
+    for (int Core : Cores)
+    {
+        Busy.erase(Core);
+    }
+}
+
+size_t CorePlanner::GetCoreCount() const
+{
+    size_t Count = 0;
+    for (const std::vector<int> &Node : Nodes)
+    {
+        Count += Node.size();
+    }
+    return Count;
+}
+
+CoreLease::CoreLease(CorePlanner *InPlanner)
+    : Planner(InPlanner)
+{
+    if (Planner != nullptr)
+    {
+        Cores = Planner->Acquire();
+    }
+}
+
+CoreLease::~CoreLease()
+{
+    if (Planner != nullptr)
+    {
+        Planner->Release(Cores);
+    }
+}
@@ -0,0 +1,46 @@
+#pragma once
+
+#include <mutex>
+#include <set>
+#include <vector>
+
+// Hands out sets of cores to matches, so the processes and threads of a match stay on the
+// same cores (and caches) for the whole game instead of being moved around by the scheduler.
+// A set is taken from a single NUMA node whenever one has enough free cores.
+class CorePlanner
+{
+public:
+    explicit CorePlanner(int InCoresPerMatch);
+    // Plans on the given cores of every NUMA node instead of the ones of this machine.
+    CorePlanner(int InCoresPerMatch, const std::vector<std::vector<int>> &InNodes);
+
+    // Returns an empty set if not enough cores are free, the match then runs unpinned.
+    std::vector<int> Acquire();
+    void Release(const std::vector<int> &Cores);
+
+    size_t GetCoreCount() const;
+    size_t GetNodeCount() const { return Nodes.size(); }
+
+private:
+    const size_t CoresPerMatch;
+    // Usable cores of every NUMA node.
+    std::vector<std::vector<int>> Nodes;
+    std::set<int> Busy;
+    std::mutex PlannerMutex;
+};
+
+// Cores of one match, given back to the planner when it goes out of scope.
+class CoreLease
+{
+public:
+    explicit CoreLease(CorePlanner *InPlanner);
+    ~CoreLease();
+    CoreLease(const CoreLease &) = delete;
+    CoreLease &operator=(const CoreLease &) = delete;
+
+    const std::vector<int> &GetCores() const { return Cores; }
+
+private:
+    CorePlanner *Planner;
+    std::vector<int> Cores;
+};
@@ -0,0 +1,266 @@
+#include "FileWatcher.h"
+
+#include <sys/stat.h>
+#include <vector>
+
+#ifdef __linux__
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+
+#include "sc2utils/sc2_scan_directory.h"
+
+namespace {
+
+void SplitPath(const std::string &Path, std::string &Directory, std::string &Name)
+{
+    const size_t Slash = Path.find_last_of("/\\");
+    if (Slash == std::string::npos)
+    {
+        Directory = ".";
+        Name = Path;
+        return;
+    }
+    Directory = Slash == 0 ? "/" : Path.substr(0, Slash);
+    Name = Path.substr(Slash + 1);
+}
+
+std::string TrimTrailingSlash(std::string Path)
+{
+    while (Path.size() > 1 && (Path.back() == '/' || Path.back() == '\\'))
+    {
+        Path.pop_back();
+    }
+    return Path;
+}
+
+time_t GetModifiedTime(const std::string &Path)
+{
+    struct stat Info;
+    return stat(Path.c_str(), &Info) == 0 ? Info.st_mtime : 0;
+}
+
+} // namespace
+
+FileWatcher::FileWatcher()
+    : NotifyHandle(-1)
+{
+#ifdef __linux__
+    NotifyHandle = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+#endif
+}
+
+FileWatcher::~FileWatcher()
+{
+#ifdef __linux__
+    if (NotifyHandle >= 0)
+    {
+        close(NotifyHandle);
+    }
+#endif
+}
+
+void FileWatcher::WatchFile(const std::string &Path)
+{
+    std::string Directory, Name;
+    SplitPath(Path, Directory, Name);
+    WatchedFiles[Directory][Name] = Path;
+    ModifiedTimes[Path] = GetModifiedTime(Path);
+    AddDirectory(Directory);
+}
+
+void FileWatcher::WatchSubdirectories(const std::string &BaseDirectory, const std::string &FileName)
+{
+    const std::string Base = TrimTrailingSlash(BaseDirectory);
+    WatchedBases[Base] = FileName;
+    AddDirectory(Base);
+    std::set<std::string> AlreadyLoaded;
+    ScanSubdirectories(Base, AlreadyLoaded);
+}
+
+void FileWatcher::AddDirectory(const std::string &Directory)
+{
+#ifdef __linux__
+    if (NotifyHandle < 0)
+    {
+        return;
+    }
+    // Files are watched through their directory, so replacing a file by renaming over it is seen too.
+    const int Descriptor = inotify_add_watch(NotifyHandle, Directory.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO | IN_CREATE | IN_DELETE | IN_MOVED_FROM | IN_DELETE_SELF);
+    if (Descriptor >= 0)
+    {
+        WatchDescriptors[Descriptor] = Directory;
+    }
+#else
+    (void)Directory;
+#endif
+}
+
+void FileWatcher::ForgetDirectory(const std::string &Directory, std::set<std::string> &Changed)
+{
+#ifdef __linux__
+    for (auto Watch = WatchDescriptors.begin(); Watch != WatchDescriptors.end();)
+    {
+        if (Watch->second == Directory)
+        {
+            // Fails harmlessly when the directory is already gone and the watch with it.
+            inotify_rm_watch(NotifyHandle, Watch->first);
+            Watch = WatchDescriptors.erase(Watch);
+        }
+        else
+        {
+            ++Watch;
+        }
+    }
+#endif
+    const auto Files = WatchedFiles.find(Directory);
+    if (Files == WatchedFiles.end())
+    {
+        return;
+    }
+    for (const auto &File : Files->second)
+    {
+        Changed.insert(File.second);
+        ModifiedTimes.erase(File.second);
+    }
+    WatchedFiles.erase(Files);
+}
+
+bool FileWatcher::IsInWatchedBase(const std::string &Directory) const
+{
+    std::string Base, Name;
+    SplitPath(Directory, Base, Name);
+    return WatchedBases.count(Base) > 0;
+}
+
+void FileWatcher::ScanSubdirectories(const std::string &BaseDirectory, std::set<std::string> &Changed)
+{
+    const std::string &FileName = WatchedBases[BaseDirectory];
+    std::vector<std::string> Directories;
+    sc2::scan_directory(BaseDirectory.c_str(), Directories, true, true);
+    for (const std::string &Directory : Directories)
+    {
+        const std::string Path = Directory + "/" + FileName;
+        std::string WatchedDirectory, Name;
+        SplitPath(Path, WatchedDirectory, Name);
+        const auto Known = WatchedFiles.find(WatchedDirectory);
+        if (Known != WatchedFiles.end() && Known->second.count(Name) > 0)
+        {
+            continue;
+        }
+        WatchFile(Path);
+        if (ModifiedTimes[Path] != 0)
+        {
+            Changed.insert(Path);
+        }
+    }
+}
+
+std::set<std::string> FileWatcher::PollChanges()
+{
+    std::set<std::string> Changed;
+#ifdef __linux__
+    if (NotifyHandle >= 0)
+    {
+        std::set<std::string> GrownBases;
+        alignas(struct inotify_event) char Buffer[4096];
+        ssize_t Length;
+        while ((Length = read(NotifyHandle, Buffer, sizeof(Buffer))) > 0)
+        {
+            for (const char *Next = Buffer; Next < Buffer + Length;)
+            {
+                const struct inotify_event *Event = reinterpret_cast<const struct inotify_event *>(Next);
+                Next += sizeof(struct inotify_event) + Event->len;
+                const auto Directory = WatchDescriptors.find(Event->wd);
+                if (Directory == WatchDescriptors.end())
+                {
+                    continue;
+                }
+                if (Event->mask & IN_IGNORED)
+                {
+                    // The directory is gone. A subdirectory of a base is picked up again by the
+                    // next scan once it is re-created, so it must not be remembered as watched.
+                    const std::string Removed = Directory->second;
+                    WatchDescriptors.erase(Directory);
+                    if (IsInWatchedBase(Removed))
+                    {
+                        ForgetDirectory(Removed, Changed);
+                    }
+                    continue;
+                }
+                if (Event->mask & IN_DELETE_SELF)
+                {
+                    const auto Files = WatchedFiles.find(Directory->second);
+                    if (Files != WatchedFiles.end())
+                    {
+                        for (const auto &File : Files->second)
+                        {
+                            Changed.insert(File.second);
+                        }
+                    }
+                    continue;
+                }
+                if (Event->len == 0)
+                {
+                    continue;
+                }
+                if (Event->mask & IN_ISDIR)
+                {
+                    if (WatchedBases.count(Directory->second) > 0)
+                    {
+                        if (Event->mask & (IN_DELETE | IN_MOVED_FROM))
+                        {
+                            // A renamed directory keeps its watch, which would report under the old name.
+                            ForgetDirectory(Directory->second + "/" + Event->name, Changed);
+                        }
+                        else
+                        {
+                            GrownBases.insert(Directory->second);
+                        }
+                    }
+                    continue;
+                }
+                // A removed file is reported too, the caller finds it missing.
+                if ((Event->mask & (IN_CLOSE_WRITE | IN_MOVED_TO | IN_DELETE | IN_MOVED_FROM)) == 0)
+                {
+                    continue;
+                }
+                const auto Files = WatchedFiles.find(Directory->second);
+                if (Files == WatchedFiles.end())
+                {
+                    continue;
+                }
+                const auto File = Files->second.find(Event->name);
+                if (File != Files->second.end())
+                {
+                    Changed.insert(File->second);
+                }
+            }
+        }
+        for (const std::string &Base : GrownBases)
+        {
+            ScanSubdirectories(Base, Changed);
+        }
+        return Changed;
+    }
+#endif
+    for (auto &Watched : ModifiedTimes)
+    {
+        const time_t ModifiedTime = GetModifiedTime(Watched.first);
+        if (ModifiedTime != Watched.second)
+        {
+            Watched.second = ModifiedTime;
+            Changed.insert(Watched.first);
+        }
+    }
+    std::vector<std::string> Bases;
+    for (const auto &Base : WatchedBases)
+    {
+        Bases.push_back(Base.first);
+    }
+    for (const std::string &Base : Bases)
+    {
+        ScanSubdirectories(Base, Changed);
+    }
+    return Changed;
+}
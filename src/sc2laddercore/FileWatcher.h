@@ -0,0 +1,38 @@
+#pragma once
+
+#include <ctime>
+#include <map>
+#include <set>
+#include <string>
+
+// Reports which of a set of files changed since the last call to PollChanges().
+// Uses inotify on Linux, so checking for changes costs nothing while nothing changes.
+// Elsewhere the modification times of the watched files are compared on every poll.
+class FileWatcher
+{
+public:
+    FileWatcher();
+    ~FileWatcher();
+
+    void WatchFile(const std::string &Path);
+    // Watches FileName inside every subdirectory of BaseDirectory, including ones created later.
+    void WatchSubdirectories(const std::string &BaseDirectory, const std::string &FileName);
+
+    // Never blocks. Returns the changed files as they were passed to WatchFile, removed ones included.
+    std::set<std::string> PollChanges();
+
+private:
+    void AddDirectory(const std::string &Directory);
+    void ScanSubdirectories(const std::string &BaseDirectory, std::set<std::string> &Changed);
+    // Stops watching a directory that was removed or renamed and reports its files as changed.
+    void ForgetDirectory(const std::string &Directory, std::set<std::string> &Changed);
+    bool IsInWatchedBase(const std::string &Directory) const;
+
+    // Directory -> file name inside it -> path as registered
+    std::map<std::string, std::map<std::string, std::string>> WatchedFiles;
+    // Base directory -> file name to watch in its subdirectories
+    std::map<std::string, std::string> WatchedBases;
+    std::map<std::string, time_t> ModifiedTimes;
+    int NotifyHandle;
+    std::map<int, std::string> WatchDescriptors;
+};
@@ -0,0 +1,795 @@
+#include "HttpClient.h"
+
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <thread>
+
+#include <sys/stat.h>
+
+#ifdef _WIN32
+#include <winsock2.h>
+#include <ws2tcpip.h>
+typedef SOCKET SocketHandle;
+#define INVALID_SOCKET_HANDLE INVALID_SOCKET
+#define CloseSocket closesocket
+#define PollSocket WSAPoll
+#define SEND_FLAGS 0
+#else
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+typedef int SocketHandle;
+#define INVALID_SOCKET_HANDLE (-1)
+#define CloseSocket close
+#define PollSocket poll
+#ifdef MSG_NOSIGNAL
+#define SEND_FLAGS MSG_NOSIGNAL
+#else
+#define SEND_FLAGS 0
+#endif
+#endif
+
+#include "Tools.h"
+#include "Types.h"
+
+struct HttpConnection
+{
+    SocketHandle Socket{INVALID_SOCKET_HANDLE};
+    std::string Buffer;
+    size_t BufferPos{0};
+    uint64_t BytesReceived{0};
+    // Set once the peer has closed the connection, as opposed to a read that timed out or failed.
+    bool Closed{false};
+};
+
+namespace {
+
+constexpr size_t IOChunkSize = 64 * 1024;
+
+struct ParsedUrl
+{
+    std::string Scheme;
+    std::string Host;
+    std::string Port;
+    std::string Path;
+};
+
+bool ParseUrl(const std::string &Url, ParsedUrl &Out)
+{
+    std::string Rest = Url;
+    const size_t SchemeEnd = Rest.find("://");
+    Out.Scheme = "http";
+    if (SchemeEnd != std::string::npos)
+    {
+        Out.Scheme = Rest.substr(0, SchemeEnd);
+        std::transform(Out.Scheme.begin(), Out.Scheme.end(), Out.Scheme.begin(), ::tolower);
+        Rest.erase(0, SchemeEnd + 3);
+    }
+    const size_t PathStart = Rest.find('/');
+    std::string HostPort = Rest.substr(0, PathStart);
+    Out.Path = PathStart == std::string::npos ? "/" : Rest.substr(PathStart);
+    const size_t PortStart = HostPort.find(':');
+    if (PortStart != std::string::npos)
+    {
+        Out.Host = HostPort.substr(0, PortStart);
+        Out.Port = HostPort.substr(PortStart + 1);
+    }
+    else
+    {
+        Out.Host = HostPort;
+        Out.Port = Out.Scheme == "https" ? "443" : "80";
+    }
+    return !Out.Host.empty();
+}
+
+std::string ToLower(std::string Value)
+{
+    std::transform(Value.begin(), Value.end(), Value.begin(), ::tolower);
+    return Value;
+}
+
+std::string Trim(const std::string &Value)
+{
+    const size_t First = Value.find_first_not_of(" \t\r\n");
+    if (First == std::string::npos)
+    {
+        return "";
+    }
+    const size_t Last = Value.find_last_not_of(" \t\r\n");
+    return Value.substr(First, Last - First + 1);
+}
+
+std::string BaseName(const std::string &Path)
+{
+    const size_t Slash = Path.find_last_of("/\\");
+    return Slash == std::string::npos ? Path : Path.substr(Slash + 1);
+}
+
+bool GetFileSize(const std::string &Path, uint64_t &Size)
+{
+    struct stat Info;
+    if (stat(Path.c_str(), &Info) != 0)
+    {
+        return false;
+    }
+    Size = static_cast<uint64_t>(Info.st_size);
+    return true;
+}
+
+bool WaitForSocket(SocketHandle Socket, bool ForWrite, int TimeoutMS)
+{
+    pollfd Fd;
+    Fd.fd = Socket;
+    Fd.events = ForWrite ? POLLOUT : POLLIN;
+    Fd.revents = 0;
+    return PollSocket(&Fd, 1, TimeoutMS) > 0;
+}
+
+bool SendAll(HttpConnection &Connection, const char *Data, size_t Length, int TimeoutMS, uint64_t &BytesSent)
+{
+    while (Length > 0)
+    {
+        if (!WaitForSocket(Connection.Socket, true, TimeoutMS))
+        {
+            return false;
+        }
+        const int Sent = send(Connection.Socket, Data, static_cast<int>(std::min(Length, IOChunkSize)), SEND_FLAGS);
+        if (Sent <= 0)
+        {
+            return false;
+        }
+        Data += Sent;
+        Length -= static_cast<size_t>(Sent);
+        BytesSent += static_cast<uint64_t>(Sent);
+    }
+    return true;
+}
+
+bool SendAll(HttpConnection &Connection, const std::string &Data, int TimeoutMS, uint64_t &BytesSent)
+{
+    return SendAll(Connection, Data.data(), Data.size(), TimeoutMS, BytesSent);
+}
+
+// Returns false on timeout, error or if the peer closed the connection.
+bool FillBuffer(HttpConnection &Connection, int TimeoutMS)
+{
+    if (Connection.BufferPos > 0)
+    {
+        Connection.Buffer.erase(0, Connection.BufferPos);
+        Connection.BufferPos = 0;
+    }
+    if (!WaitForSocket(Connection.Socket, false, TimeoutMS))
+    {
+        return false;
+    }
+    char Chunk[IOChunkSize];
+    const int Received = recv(Connection.Socket, Chunk, sizeof(Chunk), 0);
+    if (Received <= 0)
+    {
+        Connection.Closed = Received == 0;
+        return false;
+    }
+    Connection.Buffer.append(Chunk, static_cast<size_t>(Received));
+    Connection.BytesReceived += static_cast<uint64_t>(Received);
+    return true;
+}
+
+bool ReadLine(HttpConnection &Connection, std::string &Line, int TimeoutMS)
+{
+    for (;;)
+    {
+        const size_t End = Connection.Buffer.find("\r\n", Connection.BufferPos);
+        if (End != std::string::npos)
+        {
+            Line = Connection.Buffer.substr(Connection.BufferPos, End - Connection.BufferPos);
+            Connection.BufferPos = End + 2;
+            return true;
+        }
+        if (!FillBuffer(Connection, TimeoutMS))
+        {
+            return false;
+        }
+    }
+}
+
+typedef std::function<bool(const char *, size_t)> BodySink;
+
+bool ReadExact(HttpConnection &Connection, uint64_t Length, const BodySink &Sink, int TimeoutMS)
+{
+    while (Length > 0)
+    {
+        if (Connection.BufferPos == Connection.Buffer.size() && !FillBuffer(Connection, TimeoutMS))
+        {
+            return false;
+        }
+        const size_t Available = Connection.Buffer.size() - Connection.BufferPos;
+        const size_t Take = static_cast<size_t>(std::min<uint64_t>(Available, Length));
+        if (!Sink(Connection.Buffer.data() + Connection.BufferPos, Take))
+        {
+            return false;
+        }
+        Connection.BufferPos += Take;
+        Length -= Take;
+    }
+    return true;
+}
+
+bool ReadUntilClosed(HttpConnection &Connection, const BodySink &Sink, int TimeoutMS)
+{
+    for (;;)
+    {
+        if (Connection.BufferPos < Connection.Buffer.size())
+        {
+            if (!Sink(Connection.Buffer.data() + Connection.BufferPos, Connection.Buffer.size() - Connection.BufferPos))
+            {
+                return false;
+            }
+            Connection.BufferPos = Connection.Buffer.size();
+        }
+        if (!FillBuffer(Connection, TimeoutMS))
+        {
+            // Without a length the end of the body is signalled by closing the connection,
+            // a timeout or an error leaves the body truncated.
+            return Connection.Closed;
+        }
+    }
+}
+
+bool ReadChunked(HttpConnection &Connection, const BodySink &Sink, int TimeoutMS)
+{
+    std::string Line;
+    for (;;)
+    {
+        if (!ReadLine(Connection, Line, TimeoutMS))
+        {
+            return false;
+        }
+        const uint64_t ChunkSize = std::strtoull(Line.c_str(), nullptr, 16);
+        if (ChunkSize == 0)
+        {
+            // Skip the trailer.
+            do
+            {
+                if (!ReadLine(Connection, Line, TimeoutMS))
+                {
+                    return false;
+                }
+            } while (!Line.empty());
+            return true;
+        }
+        if (!ReadExact(Connection, ChunkSize, Sink, TimeoutMS) || !ReadLine(Connection, Line, TimeoutMS))
+        {
+            return false;
+        }
+    }
+}
+
+void SetNonBlocking(SocketHandle Socket, bool NonBlocking)
+{
+#ifdef _WIN32
+    u_long Mode = NonBlocking ? 1 : 0;
+    ioctlsocket(Socket, FIONBIO, &Mode);
+#else
+    const int Flags = fcntl(Socket, F_GETFL, 0);
+    fcntl(Socket, F_SETFL, NonBlocking ? (Flags | O_NONBLOCK) : (Flags & ~O_NONBLOCK));
+#endif
+}
+
+// Connects in non blocking mode so a dead host can not stall the ladder.
+bool ConnectWithTimeout(SocketHandle Socket, const sockaddr *Address, int AddressLength, int TimeoutMS)
+{
+    SetNonBlocking(Socket, true);
+    if (connect(Socket, Address, AddressLength) != 0)
+    {
+        if (!WaitForSocket(Socket, true, TimeoutMS))
+        {
+            return false;
+        }
+        int Error = 0;
+        socklen_t ErrorLength = sizeof(Error);
+        if (getsockopt(Socket, SOL_SOCKET, SO_ERROR, reinterpret_cast<char *>(&Error), &ErrorLength) != 0 || Error != 0)
+        {
+            return false;
+        }
+    }
+    SetNonBlocking(Socket, false);
+    return true;
+}
+
+SocketHandle ConnectSocket(const std::string &Host, const std::string &Port, int TimeoutMS)
+{
+    addrinfo Hints;
+    std::memset(&Hints, 0, sizeof(Hints));
+    Hints.ai_family = AF_UNSPEC;
+    Hints.ai_socktype = SOCK_STREAM;
+    addrinfo *Addresses = nullptr;
+    if (getaddrinfo(Host.c_str(), Port.c_str(), &Hints, &Addresses) != 0)
+    {
+        return INVALID_SOCKET_HANDLE;
+    }
+    SocketHandle Socket = INVALID_SOCKET_HANDLE;
+    for (addrinfo *Address = Addresses; Address != nullptr; Address = Address->ai_next)
+    {
+        Socket = socket(Address->ai_family, Address->ai_socktype, Address->ai_protocol);
+        if (Socket == INVALID_SOCKET_HANDLE)
+        {
+            continue;
+        }
+        if (ConnectWithTimeout(Socket, Address->ai_addr, static_cast<int>(Address->ai_addrlen), TimeoutMS))
+        {
+            break;
+        }
+        CloseSocket(Socket);
+        Socket = INVALID_SOCKET_HANDLE;
+    }
+    freeaddrinfo(Addresses);
+    if (Socket != INVALID_SOCKET_HANDLE)
+    {
+        int NoDelay = 1;
+        setsockopt(Socket, IPPROTO_TCP, TCP_NODELAY, reinterpret_cast<const char *>(&NoDelay), sizeof(NoDelay));
+#ifdef __APPLE__
+        int NoSigPipe = 1;
+        setsockopt(Socket, SOL_SOCKET, SO_NOSIGPIPE, &NoSigPipe, sizeof(NoSigPipe));
+#endif
+    }
+    return Socket;
+}
+
+void CloseConnection(HttpConnection *Connection)
+{
+    if (Connection == nullptr)
+    {
+        return;
+    }
+    if (Connection->Socket != INVALID_SOCKET_HANDLE)
+    {
+        CloseSocket(Connection->Socket);
+    }
+    delete Connection;
+}
+
+std::string GenerateBoundary()
+{
+    static const char hexdigit[16] = { '0', '1','2','3','4','5','6','7','8','9','a','b','c','d','e','f' };
+    std::string Boundary = "----Sc2LadderBoundary";
+    for (int i = 0; i < 16; ++i)
+    {
+        Boundary.append(1, hexdigit[rand() % sizeof hexdigit]);
+    }
+    return Boundary;
+}
+
+// One piece of a multipart body, either inline text or a file streamed from disk.
+struct BodyPart
+{
+    std::string Text;
+    std::string FilePath;
+    uint64_t Length{0};
+};
+
+} // namespace
+
+HttpClient::HttpClient(int InTimeoutMS, int InMaxRetries)
+    : TimeoutMS(InTimeoutMS > 0 ? InTimeoutMS : 30000)
+    , MaxRetries(InMaxRetries > 0 ? InMaxRetries : 3)
+{
+#ifdef _WIN32
+    WSADATA WsaData;
+    WSAStartup(MAKEWORD(2, 2), &WsaData);
+#endif
+}
+
+HttpClient::~HttpClient()
+{
+    for (auto &HostConnections : IdleConnections)
+    {
+        for (HttpConnection *Connection : HostConnections.second)
+        {
+            CloseConnection(Connection);
+        }
+    }
+#ifdef _WIN32
+    WSACleanup();
+#endif
+}
+
+bool HttpClient::Get(const std::string &Url, HttpResponse &Response)
+{
+    return Perform("GET", Url, std::vector<HttpFormField>(), "", true, Response);
+}
+
+bool HttpClient::PostForm(const std::string &Url, const std::vector<HttpFormField> &Fields, HttpResponse &Response)
+{
+    return Perform("POST", Url, Fields, "", false, Response);
+}
+
+bool HttpClient::DownloadForm(const std::string &Url, const std::vector<HttpFormField> &Fields, const std::string &OutFile, HttpResponse &Response)
+{
+    // A download only reads from the server, so it is repeated like a GET.
+    return Perform("POST", Url, Fields, OutFile, true, Response);
+}
+
+std::string HttpClient::Get(const std::string &Url)
+{
+    HttpResponse Response;
+    Get(Url, Response);
+    return Response.Body;
+}
+
+std::string HttpClient::PostForm(const std::string &Url, const std::vector<HttpFormField> &Fields)
+{
+    HttpResponse Response;
+    PostForm(Url, Fields, Response);
+    return Response.Body;
+}
+
+bool HttpClient::Perform(const std::string &Method, const std::string &Url, const std::vector<HttpFormField> &Fields, const std::string &OutFile, bool Idempotent, HttpResponse &Response)
+{
+    ParsedUrl Parsed;
+    if (!ParseUrl(Url, Parsed))
+    {
+        PrintThread{} << "Invalid url: " << Url << std::endl;
+        return false;
+    }
+    if (Parsed.Scheme == "https")
+    {
+        return PerformWithCurl(Url, Fields, OutFile, Response);
+    }
+    int BackoffMS = 500;
+    for (int Attempt = 0; Attempt < MaxRetries; ++Attempt)
+    {
+        if (Attempt > 0)
+        {
+            PrintThread{} << "Request to " << Url << " failed, retrying in " << BackoffMS << " ms." << std::endl;
+            std::this_thread::sleep_for(std::chrono::milliseconds(BackoffMS));
+            BackoffMS *= 2;
+        }
+        Response = HttpResponse();
+        switch (PerformOnce(Method, Url, Fields, OutFile, Response))
+        {
+        case Outcome::Success:
+            return true;
+        case Outcome::Failed:
+            return false;
+        case Outcome::RetryIfIdempotent:
+            if (!Idempotent)
+            {
+                // The server may have acted on the request already, repeating it could record it twice.
+                PrintThread{} << "Request to " << Url << " failed after it was sent, not repeating it." << std::endl;
+                return false;
+            }
+            break;
+        case Outcome::Retry:
+            break;
+        }
+    }
+    return false;
+}
+
+HttpClient::Outcome HttpClient::PerformOnce(const std::string &Method, const std::string &Url, const std::vector<HttpFormField> &Fields, const std::string &OutFile, HttpResponse &Response)
+{
+    ParsedUrl Parsed;
+    ParseUrl(Url, Parsed);
+
+    // Build the multipart body description up front so we can send a Content-Length.
+    std::vector<BodyPart> Parts;
+    const std::string Boundary = GenerateBoundary();
+    uint64_t ContentLength = 0;
+    if (!Fields.empty())
+    {
+        for (const HttpFormField &Field : Fields)
+        {
+            BodyPart Header;
+            Header.Text = "--" + Boundary + "\r\nContent-Disposition: form-data; name=\"" + Field.Name + "\"";
+            if (Field.IsFile)
+            {
+                Header.Text += "; filename=\"" + BaseName(Field.Value) + "\"\r\nContent-Type: application/octet-stream\r\n\r\n";
+                Parts.push_back(Header);
+                BodyPart File;
+                File.FilePath = Field.Value;
+                if (!GetFileSize(File.FilePath, File.Length))
+                {
+                    PrintThread{} << "Unable to open upload file: " << File.FilePath << std::endl;
+                    return Outcome::Failed;
+                }
+                Parts.push_back(File);
+                BodyPart End;
+                End.Text = "\r\n";
+                Parts.push_back(End);
+            }
+            else
+            {
+                Header.Text += "\r\n\r\n" + Field.Value + "\r\n";
+                Parts.push_back(Header);
+            }
+        }
+        BodyPart Closing;
+        Closing.Text = "--" + Boundary + "--\r\n";
+        Parts.push_back(Closing);
+        for (BodyPart &Part : Parts)
+        {
+            if (Part.FilePath.empty())
+            {
+                Part.Length = Part.Text.size();
+            }
+            ContentLength += Part.Length;
+        }
+    }
+
+    std::string RequestHead = Method + " " + Parsed.Path + " HTTP/1.1\r\n";
+    RequestHead += "Host: " + Parsed.Host + (Parsed.Port != "80" ? ":" + Parsed.Port : "") + "\r\n";
+    RequestHead += "User-Agent: Sc2LadderServer\r\n";
+    RequestHead += "Accept: */*\r\n";
+    RequestHead += "Connection: keep-alive\r\n";
+    const std::string Cookie = GetCookieHeader(Parsed.Host);
+    if (!Cookie.empty())
+    {
+        RequestHead += "Cookie: " + Cookie + "\r\n";
+    }
+    if (!Parts.empty())
+    {
+        RequestHead += "Content-Type: multipart/form-data; boundary=" + Boundary + "\r\n";
+    }
+    if (!Parts.empty() || Method == "POST")
+    {
+        RequestHead += "Content-Length: " + std::to_string(ContentLength) + "\r\n";
+    }
+    RequestHead += "\r\n";
+
+    // A pooled connection may have been closed by the server in the meantime.
+    // In that case we silently reconnect once without counting it as a retry.
+    for (int ConnectAttempt = 0; ConnectAttempt < 2; ++ConnectAttempt)
+    {
+        bool Reused = false;
+        HttpConnection *Connection = AcquireConnection(Parsed.Host, Parsed.Port, Reused);
+        if (Connection == nullptr)
+        {
+            PrintThread{} << "Unable to connect to " << Parsed.Host << ":" << Parsed.Port << std::endl;
+            // Nothing was sent, so any request can be tried again.
+            return Outcome::Retry;
+        }
+
+        bool Sent = SendAll(*Connection, RequestHead, TimeoutMS, Response.BytesSent);
+        for (size_t i = 0; Sent && i < Parts.size(); ++i)
+        {
+            const BodyPart &Part = Parts[i];
+            if (Part.FilePath.empty())
+            {
+                Sent = SendAll(*Connection, Part.Text, TimeoutMS, Response.BytesSent);
+                continue;
+            }
+            std::ifstream File(Part.FilePath, std::ios::binary);
+            char Chunk[IOChunkSize];
+            uint64_t Remaining = Part.Length;
+            while (Sent && Remaining > 0 && File.read(Chunk, static_cast<std::streamsize>(std::min<uint64_t>(sizeof(Chunk), Remaining))))
+            {
+                Sent = SendAll(*Connection, Chunk, static_cast<size_t>(File.gcount()), TimeoutMS, Response.BytesSent);
+                Remaining -= static_cast<uint64_t>(File.gcount());
+            }
+            Sent = Sent && Remaining == 0;
+        }
+
+        std::string StatusLine;
+        if (!Sent || !ReadLine(*Connection, StatusLine, TimeoutMS))
+        {
+            const bool NothingReceived = Connection->BytesReceived == 0;
+            CloseConnection(Connection);
+            if (Reused && NothingReceived)
+            {
+                continue;
+            }
+            return Outcome::RetryIfIdempotent;
+        }
+
+        // Status line: HTTP/1.1 200 OK
+        const size_t FirstSpace = StatusLine.find(' ');
+        Response.StatusCode = FirstSpace == std::string::npos ? 0 : std::atoi(StatusLine.c_str() + FirstSpace + 1);
+        bool KeepAlive = StatusLine.compare(0, 8, "HTTP/1.1") == 0;
+        bool Chunked = false;
+        bool HasLength = false;
+        uint64_t BodyLength = 0;
+        std::string Line;
+        for (;;)
+        {
+            if (!ReadLine(*Connection, Line, TimeoutMS))
+            {
+                CloseConnection(Connection);
+                return Outcome::RetryIfIdempotent;
+            }
+            if (Line.empty())
+            {
+                break;
+            }
+            const size_t Colon = Line.find(':');
+            if (Colon == std::string::npos)
+            {
+                continue;
+            }
+            const std::string Name = ToLower(Trim(Line.substr(0, Colon)));
+            const std::string Value = Trim(Line.substr(Colon + 1));
+            if (Name == "content-length")
+            {
+                HasLength = true;
+                BodyLength = std::strtoull(Value.c_str(), nullptr, 10);
+            }
+            else if (Name == "transfer-encoding")
+            {
+                Chunked = ToLower(Value).find("chunked") != std::string::npos;
+            }
+            else if (Name == "connection")
+            {
+                const std::string Lower = ToLower(Value);
+                if (Lower.find("close") != std::string::npos)
+                {
+                    KeepAlive = false;
+                }
+                else if (Lower.find("keep-alive") != std::string::npos)
+                {
+                    KeepAlive = true;
+                }
+            }
+            else if (Name == "set-cookie")
+            {
+                StoreCookie(Parsed.Host, Value);
+            }
+        }
+
+        const bool Success = Response.StatusCode >= 200 && Response.StatusCode < 300;
+        std::ofstream OutStream;
+        if (Success && !OutFile.empty())
+        {
+            OutStream.open(OutFile, std::ios::binary | std::ios::trunc);
+            if (!OutStream)
+            {
+                PrintThread{} << "Unable to open download file: " << OutFile << std::endl;
+                CloseConnection(Connection);
+                return Outcome::Failed;
+            }
+        }
+        BodySink Sink = [&](const char *Data, size_t Length) -> bool
+        {
+            if (OutStream.is_open())
+            {
+                OutStream.write(Data, static_cast<std::streamsize>(Length));
+                return static_cast<bool>(OutStream);
+            }
+            Response.Body.append(Data, Length);
+            return true;
+        };
+
+        bool BodyRead = true;
+        if (Method == "HEAD" || Response.StatusCode == 204 || Response.StatusCode == 304)
+        {
+            BodyRead = true;
+        }
+        else if (Chunked)
+        {
+            BodyRead = ReadChunked(*Connection, Sink, TimeoutMS);
+        }
+        else if (HasLength)
+        {
+            BodyRead = ReadExact(*Connection, BodyLength, Sink, TimeoutMS);
+        }
+        else
+        {
+            BodyRead = ReadUntilClosed(*Connection, Sink, TimeoutMS);
+            KeepAlive = false;
+        }
+        Response.BytesReceived = Connection->BytesReceived;
+        Connection->BytesReceived = 0;
+        ReleaseConnection(Parsed.Host, Parsed.Port, Connection, KeepAlive && BodyRead);
+
+        if (!BodyRead || Response.StatusCode >= 500)
+        {
+            return Outcome::RetryIfIdempotent;
+        }
+        return Success ? Outcome::Success : Outcome::Failed;
+    }
+    return Outcome::Retry;
+}
+
+bool HttpClient::PerformWithCurl(const std::string &Url, const std::vector<HttpFormField> &Fields, const std::string &OutFile, HttpResponse &Response)
+{
+    // Keep the login session working the way it did before the in-process client.
+    std::vector<std::string> Arguments{ " -b cookies.txt", " -c cookies.txt" };
+    for (const HttpFormField &Field : Fields)
+    {
+        // Values go through the shell, and -F would read a file for a text value starting with @ or <.
+        Arguments.push_back((Field.IsFile ? " -F " : " --form-string ") + QuoteShellArgument(Field.Name + "=" + (Field.IsFile ? "@" : "") + Field.Value));
+    }
+    if (!OutFile.empty())
+    {
+        Arguments.push_back(" -o " + QuoteShellArgument(OutFile));
+    }
+    // curl appends the status code as the last line of its output, 000 if there was no response.
+    Arguments.push_back(" -w \"\\n%{http_code}\"");
+    const std::string Output = PerformRestRequest(QuoteShellArgument(Url), Arguments);
+    const size_t LastLine = Output.rfind('\n');
+    if (LastLine == std::string::npos)
+    {
+        Response.StatusCode = 0;
+        return false;
+    }
+    Response.StatusCode = std::atoi(Output.c_str() + LastLine + 1);
+    Response.Body = Output.substr(0, LastLine);
+    return Response.StatusCode >= 200 && Response.StatusCode < 300;
+}
+
+HttpConnection *HttpClient::AcquireConnection(const std::string &Host, const std::string &Port, bool &Reused)
+{
+    const std::string Key = Host + ":" + Port;
+    {
+        std::lock_guard<std::mutex> Lock(PoolMutex);
+        auto Idle = IdleConnections.find(Key);
+        if (Idle != IdleConnections.end() && !Idle->second.empty())
+        {
+            HttpConnection *Connection = Idle->second.back();
+            Idle->second.pop_back();
+            Reused = true;
+            return Connection;
+        }
+    }
+    Reused = false;
+    const SocketHandle Socket = ConnectSocket(Host, Port, TimeoutMS);
+    if (Socket == INVALID_SOCKET_HANDLE)
+    {
+        return nullptr;
+    }
+    HttpConnection *Connection = new HttpConnection();
+    Connection->Socket = Socket;
+    return Connection;
+}
+
+void HttpClient::ReleaseConnection(const std::string &Host, const std::string &Port, HttpConnection *Connection, bool KeepAlive)
+{
+    if (!KeepAlive)
+    {
+        CloseConnection(Connection);
+        return;
+    }
+    Connection->Buffer.clear();
+    Connection->BufferPos = 0;
+    std::lock_guard<std::mutex> Lock(PoolMutex);
+    IdleConnections[Host + ":" + Port].push_back(Connection);
+}
+
+std::string HttpClient::GetCookieHeader(const std::string &Host)
+{
+    std::lock_guard<std::mutex> Lock(CookieMutex);
+    std::string Header;
+    auto HostCookies = Cookies.find(Host);
+    if (HostCookies == Cookies.end())
+    {
+        return Header;
+    }
+    for (const auto &Cookie : HostCookies->second)
+    {
+        if (!Header.empty())
+        {
+            Header += "; ";
+        }
+        Header += Cookie.first + "=" + Cookie.second;
+    }
+    return Header;
+}
+
+void HttpClient::StoreCookie(const std::string &Host, const std::string &SetCookie)
+{
+    const std::string NameValue = SetCookie.substr(0, SetCookie.find(';'));
+    const size_t Equals = NameValue.find('=');
+    if (Equals == std::string::npos)
+    {
+        return;
+    }
+    std::lock_guard<std::mutex> Lock(CookieMutex);
+    Cookies[Host][Trim(NameValue.substr(0, Equals))] = Trim(NameValue.substr(Equals + 1));
+}
@@ -0,0 +1,82 @@
+#pragma once
+
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+
+struct HttpConnection;
+
+struct HttpFormField
+{
+    std::string Name;
+    std::string Value; // For file fields this is the path of the file to upload.
+    bool IsFile;
+
+    HttpFormField(const std::string &InName, const std::string &InValue, bool InIsFile = false)
+        : Name(InName)
+        , Value(InValue)
+        , IsFile(InIsFile)
+    {}
+};
+
+struct HttpResponse
+{
+    int StatusCode{0};
+    std::string Body;
+    uint64_t BytesSent{0};
+    uint64_t BytesReceived{0};
+};
+
+// Small HTTP/1.1 client used to talk to the ladder website.
+// Connections are kept alive and reused per host, cookies set by the server
+// are remembered for the lifetime of the client, downloads are streamed to
+// disk and file uploads are streamed from disk.
+// https urls are handed to curl since we do not link a TLS library, without retries.
+// Failed requests are retried with a backoff, posted forms only if they never reached the server.
+class HttpClient
+{
+public:
+    HttpClient(int InTimeoutMS = 30000, int InMaxRetries = 3);
+    ~HttpClient();
+
+    bool Get(const std::string &Url, HttpResponse &Response);
+    bool PostForm(const std::string &Url, const std::vector<HttpFormField> &Fields, HttpResponse &Response);
+    // Same as PostForm, but a successful response body is written to OutFile.
+    bool DownloadForm(const std::string &Url, const std::vector<HttpFormField> &Fields, const std::string &OutFile, HttpResponse &Response);
+
+    // Convenience wrappers that only return the body, empty on failure.
+    std::string Get(const std::string &Url);
+    std::string PostForm(const std::string &Url, const std::vector<HttpFormField> &Fields);
+
+private:
+    enum class Outcome
+    {
+        Success,
+        // Nothing reached the server.
+        Retry,
+        // The request was sent, the server may have acted on it.
+        RetryIfIdempotent,
+        Failed
+    };
+
+    // Only an Idempotent request is repeated once it was sent: after a timeout, a broken response or a 5xx.
+    bool Perform(const std::string &Method, const std::string &Url, const std::vector<HttpFormField> &Fields, const std::string &OutFile, bool Idempotent, HttpResponse &Response);
+    Outcome PerformOnce(const std::string &Method, const std::string &Url, const std::vector<HttpFormField> &Fields, const std::string &OutFile, HttpResponse &Response);
+    bool PerformWithCurl(const std::string &Url, const std::vector<HttpFormField> &Fields, const std::string &OutFile, HttpResponse &Response);
+
+    HttpConnection *AcquireConnection(const std::string &Host, const std::string &Port, bool &Reused);
+    void ReleaseConnection(const std::string &Host, const std::string &Port, HttpConnection *Connection, bool KeepAlive);
+
+    std::string GetCookieHeader(const std::string &Host);
+    void StoreCookie(const std::string &Host, const std::string &SetCookie);
+
+    const int TimeoutMS;
+    const int MaxRetries;
+
+    std::mutex PoolMutex;
+    std::map<std::string, std::vector<HttpConnection*>> IdleConnections;
+    std::mutex CookieMutex;
+    std::map<std::string, std::map<std::string, std::string>> Cookies;
+};
@@ -44,7 +44,7 @@ bool LadderConfig::WriteConfig()
 	return this->doc.Accept(writer);
 }
 
-std::string LadderConfig::GetStringValue(std::string RequestedValue)
+std::string LadderConfig::GetStringValue(const std::string &RequestedValue) const
 {
     if (doc.HasMember(RequestedValue))
     {
@@ -57,7 +57,12 @@ std::string LadderConfig::GetStringValue(std::string RequestedValue)
     return ""; // this allows config entries to not have to exist
 }
 
-bool LadderConfig::GetBoolValue(std::string RequestedValue)
+bool LadderConfig::HasValue(const std::string &RequestedValue) const
+{
+    return doc.HasMember(RequestedValue);
+}
+
+bool LadderConfig::GetBoolValue(const std::string &RequestedValue) const
 {
     if (doc.HasMember(RequestedValue))
     {
@@ -70,7 +75,7 @@ bool LadderConfig::GetBoolValue(std::string RequestedValue)
     return false; // this allows config entries to not have to exist
 }
 
-int LadderConfig::GetIntValue(std::string RequestedValue)
+int LadderConfig::GetIntValue(const std::string &RequestedValue) const
 {
     if (doc.HasMember(RequestedValue))
     {
@@ -83,7 +88,7 @@ int LadderConfig::GetIntValue(std::string RequestedValue)
     return 0; // this allows config entries to not have to exist
 }
 
-std::vector<std::string> LadderConfig::GetArrayValue(std::string RequestedValue)
+std::vector<std::string> LadderConfig::GetArrayValue(const std::string &RequestedValue) const
 {
 	std::vector<std::string> ReturnedArray;
 	if (doc.HasMember(RequestedValue) && doc[RequestedValue].IsArray())
@@ -91,6 +96,10 @@ std::vector<std::string> LadderConfig::GetArrayValue(std::string RequestedValue)
 		const rapidjson::Value & Values = doc[RequestedValue];
 		for (auto itr = Values.Begin(); itr != Values.End(); ++itr)
 		{
+			if (!itr->IsString())
+			{
+				throw std::invalid_argument("The value \"" + RequestedValue + "\" has to be an array of Strings! Aborting.");
+			}
 			ReturnedArray.push_back(itr->GetString());
 		}
 	}
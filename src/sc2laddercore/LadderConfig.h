@@ -14,10 +14,11 @@ public:
     explicit LadderConfig(const std::string &InConfigFile);
     bool ParseConfig();
     bool WriteConfig();
-    bool GetBoolValue(std::string RequestedValue);
-    int GetIntValue(std::string RequestedValue);
-    std::string GetStringValue(std::string RequestedValue);
-    std::vector<std::string> GetArrayValue(std::string RequestedValue);
+    bool HasValue(const std::string &RequestedValue) const;
+    bool GetBoolValue(const std::string &RequestedValue) const;
+    int GetIntValue(const std::string &RequestedValue) const;
+    std::string GetStringValue(const std::string &RequestedValue) const;
+    std::vector<std::string> GetArrayValue(const std::string &RequestedValue) const;
 	void AddValue(const std::string &Index, const std::string &Value);
 private:
     const std::string ConfigFileLocation;
@@ -3,6 +3,7 @@
 #include <sys/stat.h>
 #include <fcntl.h>
 
+#include <atomic>
 #include <exception>
 #include <fstream>
 #include <string>
@@ -33,18 +34,136 @@
 #include "Types.h"
 #include "Tools.h"
 #include "Proxy.h"
+#include "CorePlanner.h"
+#include "MapCatalog.h"
+#include "ProcessSampler.h"
+#include "ReplayRename.h"
 
 
-LadderGame::LadderGame(int InCoordinatorArgc, char** InCoordinatorArgv, LadderConfig *InConfig)
+namespace {
+
+ResourceLimits GetBotLimits(const LadderSettings &Settings)
+{
+    ResourceLimits Limits;
+    Limits.CpuPercent = static_cast<uint32_t>(Settings.BotCpuLimit);
+    Limits.MemoryBytes = static_cast<uint64_t>(Settings.BotMemoryLimit) * 1024 * 1024;
+    Limits.MaxProcesses = static_cast<uint32_t>(Settings.BotProcessLimit);
+    Limits.LimitAddressSpace = Settings.MemoryLimitAsAddressSpace;
+    return Limits;
+}
+
+ResourceLimits GetClientLimits(const LadderSettings &Settings)
+{
+    ResourceLimits Limits;
+    Limits.CpuPercent = static_cast<uint32_t>(Settings.ClientCpuLimit);
+    Limits.MemoryBytes = static_cast<uint64_t>(Settings.ClientMemoryLimit) * 1024 * 1024;
+    Limits.LimitAddressSpace = Settings.MemoryLimitAsAddressSpace;
+    return Limits;
+}
+
+void ReportRlimitFallback(const LadderSettings &Settings, const ResourceGroup &MatchGroup, const ResourceLimits &BotLimits, const ResourceLimits &ClientLimits)
+{
+    if (MatchGroup.IsActive())
+    {
+        return;
+    }
+    if (!Settings.CgroupRoot.empty())
+    {
+        PrintThread{} << "cgroups are not available in " << Settings.CgroupRoot << ", bot limits are applied as rlimits." << std::endl;
+    }
+    static std::atomic<bool> ProcessLimitReported{false};
+    if (BotLimits.MaxProcesses > 0 && !ProcessLimitReported.exchange(true))
+    {
+        PrintThread{} << "BotProcessLimit is not enforced without cgroups." << std::endl;
+    }
+    static std::atomic<bool> MemoryLimitReported{false};
+    if ((BotLimits.MemoryBytes > 0 || ClientLimits.MemoryBytes > 0) && !MemoryLimitReported.exchange(true))
+    {
+        if (Settings.MemoryLimitAsAddressSpace)
+        {
+            PrintThread{} << "Memory limits are applied as address space limits, bots running on the JVM, .NET, mono or wine may fail to start." << std::endl;
+        }
+        else
+        {
+            PrintThread{} << "Memory limits are not enforced without cgroups, set MemoryLimitAsAddressSpace to apply them as address space limits." << std::endl;
+        }
+    }
+}
+
+std::string GetMatchGroupName()
+{
+    static std::atomic<uint32_t> MatchGroups{0};
+    return "match-" + std::to_string(std::time(nullptr)) + "-" + std::to_string(++MatchGroups);
+}
+
+ResourceUsage CollectUsage(const Proxy &BotProxy, const ProcessSampler &Sampler, const ResourceGroup &Group)
+{
+    ResourceUsage Usage = BotProxy.botUsage();
+    if (Usage.ProcessMeasured)
+    {
+        Usage.CpuMicroseconds = Usage.UserCpuMicroseconds + Usage.SystemCpuMicroseconds;
+        Usage.PeakMemoryBytes = Usage.PeakRssBytes;
+        Usage.Measured = true;
+    }
+    // The group also counts the processes the bot started.
+    Group.ReadUsage(Usage);
+    Sampler.AddTo(Usage);
+    return Usage;
+}
+
+void LogUsage(const BotConfig &Agent, const ResourceUsage &Usage)
+{
+    if (Usage.Measured)
+    {
+        PrintThread{} << Agent.BotName << " : used " << Usage.CpuMicroseconds / 1000000.0 << " seconds of cpu time, peak memory " << Usage.PeakMemoryBytes / (1024 * 1024) << " MB." << std::endl;
+    }
+    if (Usage.ProcessMeasured)
+    {
+        PrintThread{} << Agent.BotName << " : process used " << Usage.UserCpuMicroseconds / 1000000.0 << " s user and " << Usage.SystemCpuMicroseconds / 1000000.0 << " s system time, peak rss " << Usage.PeakRssBytes / (1024 * 1024) << " MB, " << Usage.VoluntarySwitches << " voluntary and " << Usage.InvoluntarySwitches << " involuntary context switches." << std::endl;
+    }
+    if (Usage.Samples > 0)
+    {
+        PrintThread{} << Agent.BotName << " : peak cpu " << Usage.PeakCpuPercent << "%, average rss " << Usage.AverageRssBytes / (1024 * 1024) << " MB over " << Usage.Samples << " samples." << std::endl;
+    }
+}
+
+std::string GetResultTimeStamp()
+{
+    std::time_t t = std::time(nullptr);
+    std::tm tm = *std::gmtime(&t);
+    std::ostringstream oss;
+    oss << std::put_time(&tm, "%d-%m-%Y %H-%M-%S") <<"UTC";
+    return oss.str();
+}
+
+// The StarCraft II clients name their players after their ports, the replay has these names until it is renamed.
+std::string GetClientPlayerName(int ClientPort)
+{
+    return "foo" + std::to_string(ClientPort);
+}
+
+std::string GetReplayFile(const std::string &ReplayDirectory, const BotConfig &Agent1, const BotConfig &Agent2, const std::string &Map)
+{
+    std::string replayFile = ReplayDirectory + Agent1.BotName + "v" + Agent2.BotName + "-" + RemoveMapExtension(Map) + ".SC2Replay";
+    replayFile.erase(remove_if(replayFile.begin(), replayFile.end(), isspace), replayFile.end());
+    return replayFile;
+}
+
+} // namespace
+
+LadderGame::LadderGame(int InCoordinatorArgc, char** InCoordinatorArgv, std::shared_ptr<const LadderSettings> InSettings, MapCatalog *InMaps, CorePlanner *InPlanner, int InSlot)
     : CoordinatorArgc(InCoordinatorArgc)
     , CoordinatorArgv(InCoordinatorArgv)
-    , Config(InConfig)
+    , Settings(std::move(InSettings))
+    , Maps(InMaps)
+    , Planner(InPlanner)
+    , PortBase(Settings->PortBase + InSlot * MATCH_SLOT_PORTS)
 {
-    const int maxGameTimeInt = Config->GetIntValue("MaxGameTime");
-    MaxGameTime = maxGameTimeInt > 0 ? static_cast<uint32_t>(maxGameTimeInt) : 0;
-    const int MaxRealGameTimeInt = Config->GetIntValue("MaxRealGameTime");
-    MaxRealGameTime = MaxRealGameTimeInt > 0 ? static_cast<uint32_t>(MaxRealGameTimeInt) : 0;
-    RealTime = Config->GetBoolValue("RealTimeMode");
+}
+
+void LadderGame::SetProgressReport(std::function<void(uint32_t GameLoop)> InProgressReport)
+{
+    ProgressReport = std::move(InProgressReport);
 }
 
 void LadderGame::LogStartGame(const BotConfig &Bot1, const BotConfig &Bot2)
@@ -55,29 +174,90 @@ void LadderGame::LogStartGame(const BotConfig &Bot1, const BotConfig &Bot2)
     std::string Bot1Filename = Bot1.RootPath + "/data/stderr.log";
     std::string Bot2Filename = Bot2.RootPath + "/data/stderr.log";
     std::ofstream outfile;
-    outfile.open(Bot1Filename, std::ios_base::app);
-    outfile << std::endl << std::put_time(&tm, "%d-%m-%Y %H-%M-%S") << ": " << "Starting game vs " << Bot2.BotName << std::endl;
-    outfile.close();
-    outfile.open(Bot2Filename, std::ios_base::app);
-    outfile << std::endl << std::put_time(&tm, "%d-%m-%Y %H-%M-%S") << ": " << "Starting game vs " << Bot1.BotName << std::endl;
-    outfile.close();
+    if (Bot1.Type != Computer)
+    {
+        outfile.open(Bot1Filename, std::ios_base::app);
+        outfile << std::endl << std::put_time(&tm, "%d-%m-%Y %H-%M-%S") << ": " << "Starting game vs " << Bot2.BotName << std::endl;
+        outfile.close();
+    }
+    if (Bot2.Type != Computer)
+    {
+        outfile.open(Bot2Filename, std::ios_base::app);
+        outfile << std::endl << std::put_time(&tm, "%d-%m-%Y %H-%M-%S") << ": " << "Starting game vs " << Bot1.BotName << std::endl;
+        outfile.close();
+    }
 }
 
 GameResult LadderGame::StartGame(const BotConfig &Agent1, const BotConfig &Agent2, const std::string &Map)
 {
+    if (Agent1.Type == Computer && Agent2.Type == Computer)
+    {
+        PrintThread{} << "Two built-in AIs can not play each other." << std::endl;
+        return GameResult();
+    }
+    MapInfo MapFile;
+    if (!Maps->Find(Map, MapFile))
+    {
+        PrintThread{} << "Unable to find map: " << Map << std::endl;
+        return GameResult();
+    }
+    const std::string MapPath = MapFile.Path.empty() ? Map : MapFile.Path;
     LogStartGame(Agent1, Agent2);
+    if (Agent2.Type == Computer)
+    {
+        return StartGameVsDefault(Agent1, Agent2, true, Map, MapPath);
+    }
+    if (Agent1.Type == Computer)
+    {
+        return StartGameVsDefault(Agent2, Agent1, false, Map, MapPath);
+    }
+    // Every match gets its own cgroup subtree. Declared before the proxies, so the groups are
+    // removed after the proxies have stopped the processes in them.
+    const ResourceLimits BotLimits = GetBotLimits(*Settings);
+    const ResourceLimits ClientLimits = GetClientLimits(*Settings);
+    // Each player gets half of the cores of the match for its bot, client and proxy thread,
+    // so the two sides do not take cache and cpu time from each other.
+    const CoreLease MatchCores(Planner);
+    if (Planner != nullptr && MatchCores.GetCores().empty())
+    {
+        PrintThread{} << "No free cores to pin the match to, running it unpinned." << std::endl;
+    }
+    const std::vector<int> &Cores = MatchCores.GetCores();
+    const size_t Half = Cores.size() >= 2 ? Cores.size() / 2 : Cores.size();
+    const std::vector<int> Side1Cores(Cores.begin(), Cores.begin() + Half);
+    const std::vector<int> Side2Cores(Cores.size() >= 2 ? Cores.begin() + Half : Cores.begin(), Cores.end());
+    ResourceLimits Bot1Limits = BotLimits;
+    ResourceLimits Bot2Limits = BotLimits;
+    ResourceLimits Client1Limits = ClientLimits;
+    ResourceLimits Client2Limits = ClientLimits;
+    Bot1Limits.Cores = Client1Limits.Cores = Side1Cores;
+    Bot2Limits.Cores = Client2Limits.Cores = Side2Cores;
+    const ResourceGroup MatchGroup(Settings->CgroupRoot, GetMatchGroupName(), ResourceLimits());
+    ReportRlimitFallback(*Settings, MatchGroup, BotLimits, ClientLimits);
+    const ResourceGroup Bot1Group(MatchGroup.GetPath(), "bot1", Bot1Limits);
+    const ResourceGroup Bot2Group(MatchGroup.GetPath(), "bot2", Bot2Limits);
+    const ResourceGroup Client1Group(MatchGroup.GetPath(), "client1", Client1Limits);
+    const ResourceGroup Client2Group(MatchGroup.GetPath(), "client2", Client2Limits);
+
     // Proxy init
-    Proxy proxyBot1(MaxGameTime, MaxRealGameTime, Agent1);
-    Proxy proxyBot2(MaxGameTime, MaxRealGameTime, Agent2);
+    Proxy proxyBot1(Settings->MaxGameTime, Settings->MaxRealGameTime, Agent1);
+    Proxy proxyBot2(Settings->MaxGameTime, Settings->MaxRealGameTime, Agent2);
+    proxyBot1.setResourceGroups(&Bot1Group, &Client1Group);
+    proxyBot2.setResourceGroups(&Bot2Group, &Client2Group);
+    proxyBot1.setRandomSeed(Settings->BenchmarkSeed);
+    proxyBot2.setRandomSeed(Settings->BenchmarkSeed);
+    proxyBot1.setKeepStepTimes(Settings->BenchmarkRuns > 0);
+    proxyBot2.setKeepStepTimes(Settings->BenchmarkRuns > 0);
+    proxyBot2.setJoinsGame();
 
     // Start the SC2 instances
     sc2::ProcessSettings process_settings;
     sc2::GameSettings game_settings;
     sc2::ParseSettings(CoordinatorArgc, CoordinatorArgv, process_settings, game_settings);
-    constexpr int portServerBot1 = 5677;
-    constexpr int portServerBot2 = 5678;
-    constexpr int portClientBot1 = 5679;
-    constexpr int portClientBot2 = 5680;
+    const int portServerBot1 = PortBase;
+    const int portServerBot2 = PortBase + 1;
+    const int portClientBot1 = PortBase + 2;
+    const int portClientBot2 = PortBase + 3;
     PrintThread {} << "Starting the StarCraft II clients." << std::endl;
     proxyBot1.startSC2Instance(process_settings, portServerBot1, portClientBot1);
     proxyBot2.startSC2Instance(process_settings, portServerBot2, portClientBot2);
@@ -90,8 +270,8 @@ GameResult LadderGame::StartGame(const BotConfig &Agent1, const BotConfig &Agent
     }
     // Setup map
     PrintThread {} << "Creating the game on " << Map << "." << std::endl;
-    const bool setupGameSuccessful1 = proxyBot1.setupGame(process_settings, Map, RealTime, Agent1.Race, Agent2.Race);
-    const bool setupGameSuccessful2 = proxyBot2.setupGame(process_settings, Map, RealTime, Agent1.Race, Agent2.Race);
+    const bool setupGameSuccessful1 = SetupGame(proxyBot1, Map, MapPath, Agent1.Race, Agent2.Race);
+    const bool setupGameSuccessful2 = proxyBot2.setupGame(MapPath, Settings->RealTimeMode, Agent1.Race, Agent2.Race);
     if (!setupGameSuccessful1 || !setupGameSuccessful2)
     {
         PrintThread {} << "Failed to create the game." << std::endl;
@@ -100,8 +280,8 @@ GameResult LadderGame::StartGame(const BotConfig &Agent1, const BotConfig &Agent
 
     // Start the bots
     PrintThread {} << "Starting the bots " << Agent1.BotName << " and " << Agent2.BotName << "." << std::endl;
-    const bool startBotSuccessful1 = proxyBot1.startBot(portServerBot1, PORT_START, Agent2.PlayerId);
-    const bool startBotSuccessful2 = proxyBot2.startBot(portServerBot2, PORT_START, Agent1.PlayerId);
+    const bool startBotSuccessful1 = proxyBot1.startBot(portServerBot1, PortBase + BOT_PORT_OFFSET, Agent2.PlayerId);
+    const bool startBotSuccessful2 = proxyBot2.startBot(portServerBot2, PortBase + BOT_PORT_OFFSET, Agent1.PlayerId);
     if (!startBotSuccessful1)
     {
         PrintThread {} << "Failed to start " << Agent1.BotName << "." << std::endl;
@@ -121,23 +301,28 @@ GameResult LadderGame::StartGame(const BotConfig &Agent1, const BotConfig &Agent
     proxyBot2.startGame();
 
     // Check from time to time if the match finished
+    ProcessSampler Bot1Sampler;
+    ProcessSampler Bot2Sampler;
     while (!proxyBot1.gameFinished() || !proxyBot2.gameFinished())
     {
+        Bot1Sampler.Sample(proxyBot1.botProcessId());
+        Bot2Sampler.Sample(proxyBot2.botProcessId());
+        if (ProgressReport)
+        {
+            ProgressReport(proxyBot1.currentGameLoop());
+        }
         sc2::SleepFor(1000);
     }
 
-    std::string replayDir = Config->GetStringValue("LocalReplayDirectory");
-    if (replayDir.back() != '/')
-    {
-        replayDir += "/";
-    }
-    std::string replayFile = replayDir + Agent1.BotName + "v" + Agent2.BotName + "-" + RemoveMapExtension(Map) + ".SC2Replay";
-    replayFile.erase(remove_if(replayFile.begin(), replayFile.end(), isspace), replayFile.end());
+    const std::string replayFile = GetReplayFile(Settings->LocalReplayDirectory, Agent1, Agent2, Map);
     if (!(proxyBot1.saveReplay(replayFile) || proxyBot2.saveReplay(replayFile)))
     {
         PrintThread{} << "Saving replay failed." << std::endl;
     }
     ChangeBotNames(replayFile, Agent1.BotName, Agent2.BotName);
+    // The usage of the bot processes is known once they have exited.
+    proxyBot1.stopBot();
+    proxyBot2.stopBot();
 
     GameResult Result;
     const auto resultBot1 = proxyBot1.getResult();
@@ -145,25 +330,154 @@ GameResult LadderGame::StartGame(const BotConfig &Agent1, const BotConfig &Agent
 
 
     Result.Result = getEndResultFromProxyResults(resultBot1, resultBot2);
+    Result.StepTimeouts = (resultBot1 == ExitCase::BotStepTimeout ? 1 : 0) + (resultBot2 == ExitCase::BotStepTimeout ? 1 : 0);
     Result.Bot1AvgFrame = proxyBot1.stats().avgLoopDuration;
     Result.Bot2AvgFrame = proxyBot2.stats().avgLoopDuration;
     Result.GameLoop = proxyBot1.stats().gameLoops;
+    Result.Bot1StepDeviation = static_cast<float>(proxyBot1.stats().stepTimeDeviation());
+    Result.Bot2StepDeviation = static_cast<float>(proxyBot2.stats().stepTimeDeviation());
+    Result.Cores = Cores;
+    if (Settings->BenchmarkRuns > 0)
+    {
+        Result.Bot1StepTimes = proxyBot1.stats().stepTimes;
+        Result.Bot2StepTimes = proxyBot2.stats().stepTimes;
+    }
+    Result.Bot1Usage = CollectUsage(proxyBot1, Bot1Sampler, Bot1Group);
+    Result.Bot2Usage = CollectUsage(proxyBot2, Bot2Sampler, Bot2Group);
+    LogUsage(Agent1, Result.Bot1Usage);
+    LogUsage(Agent2, Result.Bot2Usage);
+    Result.TimeStamp = GetResultTimeStamp();
+    return Result;
+}
 
-    std::time_t t = std::time(nullptr);
-    std::tm tm = *std::gmtime(&t);
-    std::ostringstream oss;
-    oss << std::put_time(&tm, "%d-%m-%Y %H-%M-%S") <<"UTC";
-    Result.TimeStamp = oss.str();
+GameResult LadderGame::StartGameVsDefault(const BotConfig &Agent, const BotConfig &Computer, const bool BotIsPlayer1, const std::string &Map, const std::string &MapPath)
+{
+    // The client of the bot plays the built-in AI itself, so a single client and proxy are enough.
+    // The bot's side gets all cores of the match.
+    const CoreLease MatchCores(Planner);
+    if (Planner != nullptr && MatchCores.GetCores().empty())
+    {
+        PrintThread{} << "No free cores to pin the match to, running it unpinned." << std::endl;
+    }
+    ResourceLimits BotLimits = GetBotLimits(*Settings);
+    ResourceLimits ClientLimits = GetClientLimits(*Settings);
+    BotLimits.Cores = ClientLimits.Cores = MatchCores.GetCores();
+    const ResourceGroup MatchGroup(Settings->CgroupRoot, GetMatchGroupName(), ResourceLimits());
+    ReportRlimitFallback(*Settings, MatchGroup, BotLimits, ClientLimits);
+    const ResourceGroup BotGroup(MatchGroup.GetPath(), "bot1", BotLimits);
+    const ResourceGroup ClientGroup(MatchGroup.GetPath(), "client1", ClientLimits);
+
+    Proxy proxyBot(Settings->MaxGameTime, Settings->MaxRealGameTime, Agent);
+    proxyBot.setResourceGroups(&BotGroup, &ClientGroup);
+    proxyBot.setComputerOpponent(Computer.Difficulty);
+    proxyBot.setRandomSeed(Settings->BenchmarkSeed);
+    proxyBot.setKeepStepTimes(Settings->BenchmarkRuns > 0);
+
+    sc2::ProcessSettings process_settings;
+    sc2::GameSettings game_settings;
+    sc2::ParseSettings(CoordinatorArgc, CoordinatorArgv, process_settings, game_settings);
+    const int portServerBot = PortBase;
+    const int portClientBot = PortBase + 2;
+    PrintThread {} << "Starting the StarCraft II client." << std::endl;
+    proxyBot.startSC2Instance(process_settings, portServerBot, portClientBot);
+    if (!proxyBot.ConnectToSC2Instance(process_settings, portServerBot, portClientBot))
+    {
+        PrintThread {} << "Failed to start the StarCraft II client." << std::endl;
+        return GameResult();
+    }
+    PrintThread {} << "Creating the game on " << Map << " against the built-in AI (" << GetDifficultyString(Computer.Difficulty) << ")." << std::endl;
+    if (!SetupGame(proxyBot, Map, MapPath, Agent.Race, Computer.Race))
+    {
+        PrintThread {} << "Failed to create the game." << std::endl;
+        return GameResult();
+    }
+    PrintThread {} << "Starting the bot " << Agent.BotName << "." << std::endl;
+    if (!proxyBot.startBot(portServerBot, PortBase + BOT_PORT_OFFSET, Computer.PlayerId))
+    {
+        PrintThread {} << "Failed to start " << Agent.BotName << "." << std::endl;
+        return GameResult();
+    }
+
+    PrintThread {} << "Starting the match." << std::endl;
+    proxyBot.startGame();
+    ProcessSampler BotSampler;
+    while (!proxyBot.gameFinished())
+    {
+        BotSampler.Sample(proxyBot.botProcessId());
+        if (ProgressReport)
+        {
+            ProgressReport(proxyBot.currentGameLoop());
+        }
+        sc2::SleepFor(1000);
+    }
+
+    const std::string replayFile = BotIsPlayer1 ? GetReplayFile(Settings->LocalReplayDirectory, Agent, Computer, Map) : GetReplayFile(Settings->LocalReplayDirectory, Computer, Agent, Map);
+    if (!proxyBot.saveReplay(replayFile))
+    {
+        PrintThread{} << "Saving replay failed." << std::endl;
+    }
+    ChangeBotNames(replayFile, Agent.BotName, Computer.BotName);
+    proxyBot.stopBot();
+
+    GameResult Result;
+    Result.Result = getEndResultVsComputer(proxyBot.getResult(), BotIsPlayer1);
+    Result.StepTimeouts = proxyBot.getResult() == ExitCase::BotStepTimeout ? 1 : 0;
+    Result.GameLoop = proxyBot.stats().gameLoops;
+    Result.Cores = MatchCores.GetCores();
+    const ResourceUsage Usage = CollectUsage(proxyBot, BotSampler, BotGroup);
+    LogUsage(Agent, Usage);
+    if (BotIsPlayer1)
+    {
+        Result.Bot1AvgFrame = proxyBot.stats().avgLoopDuration;
+        Result.Bot1StepDeviation = static_cast<float>(proxyBot.stats().stepTimeDeviation());
+        Result.Bot1Usage = Usage;
+        if (Settings->BenchmarkRuns > 0)
+        {
+            Result.Bot1StepTimes = proxyBot.stats().stepTimes;
+        }
+    }
+    else
+    {
+        Result.Bot2AvgFrame = proxyBot.stats().avgLoopDuration;
+        Result.Bot2StepDeviation = static_cast<float>(proxyBot.stats().stepTimeDeviation());
+        Result.Bot2Usage = Usage;
+        if (Settings->BenchmarkRuns > 0)
+        {
+            Result.Bot2StepTimes = proxyBot.stats().stepTimes;
+        }
+    }
+    Result.TimeStamp = GetResultTimeStamp();
     return Result;
 }
 
+bool LadderGame::SetupGame(Proxy &Host, const std::string &Map, const std::string &MapPath, const sc2::Race Bot1Race, const sc2::Race Bot2Race)
+{
+    const auto Start = std::chrono::steady_clock::now();
+    if (!Host.setupGame(MapPath, Settings->RealTimeMode, Bot1Race, Bot2Race))
+    {
+        return false;
+    }
+    Maps->ReportLoadTime(Map, std::chrono::duration<double>(std::chrono::steady_clock::now() - Start).count());
+    return true;
+}
 
 void LadderGame::ChangeBotNames(const std::string &ReplayFile, const std::string &Bot1Name, const std::string &Bot2Name)
 {
-    std::string CmdLine = Config->GetStringValue("ReplayBotRenameProgram");
+    const std::string FirstPlayerName = GetClientPlayerName(PortBase + 2);
+    const std::string SecondPlayerName = GetClientPlayerName(PortBase + 3);
+    if (RenameReplayPlayers(ReplayFile, { { FirstPlayerName, Bot1Name }, { SecondPlayerName, Bot2Name } }))
+    {
+        return;
+    }
+    // The external program handles replays this build can not read.
+    std::string CmdLine = Settings->ReplayBotRenameProgram;
     if (CmdLine.size() > 0)
     {
-        CmdLine = CmdLine + " " + ReplayFile + " " + FIRST_PLAYER_NAME + " " + Bot1Name + " " + SECOND_PLAYER_NAME + " " + Bot2Name;
+        CmdLine = CmdLine + " " + ReplayFile + " " + FirstPlayerName + " " + Bot1Name + " " + SecondPlayerName + " " + Bot2Name;
         StartExternalProcess(CmdLine);
     }
+    else
+    {
+        PrintThread{} << "Unable to rename the players of " << ReplayFile << std::endl;
+    }
 }
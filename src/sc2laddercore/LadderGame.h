@@ -1,28 +1,42 @@
 #pragma once
+#include <functional>
 #include "Types.h"
-#include "LadderConfig.h"
+#include "LadderSettings.h"
 
-#define PORT_START 5690
+class CorePlanner;
+class Proxy;
+class MapCatalog;
 
-#define FIRST_PLAYER_NAME "foo5679"
-#define SECOND_PLAYER_NAME "foo5680"
+// The bots' StartPort, counted from PortBase. The ports before it are used by the clients.
+#define BOT_PORT_OFFSET 13
+// Distance between the PortBase of two match slots that play at the same time.
+#define MATCH_SLOT_PORTS 20
 
 class LadderGame
 {
 public:
-    LadderGame(int InCoordinatorArgc, char** InCoordinatorArgv, LadderConfig *InConfig);
+    // Maps finds the map files. Planner may be nullptr, the match then runs wherever the scheduler puts it.
+    // Matches of different slots use different ports and can be played at the same time.
+    LadderGame(int InCoordinatorArgc, char** InCoordinatorArgv, std::shared_ptr<const LadderSettings> InSettings, MapCatalog *InMaps, CorePlanner *InPlanner = nullptr, int InSlot = 0);
     GameResult StartGame(const BotConfig & Agent1, const BotConfig & Agent2, const std::string & Map);
+    // Called about once a second with the game loop while the match is played.
+    void SetProgressReport(std::function<void(uint32_t GameLoop)> InProgressReport);
 
 
 
 private:
     void LogStartGame(const BotConfig & Bot1, const BotConfig & Bot2);
+    // Agent plays Computer, a bot of type Computer, on a single client.
+    GameResult StartGameVsDefault(const BotConfig &Agent, const BotConfig &Computer, const bool BotIsPlayer1, const std::string &Map, const std::string &MapPath);
+    // Sends the create game request of Map and logs how long loading it took.
+    bool SetupGame(Proxy &Host, const std::string &Map, const std::string &MapPath, const sc2::Race Bot1Race, const sc2::Race Bot2Race);
     void ChangeBotNames(const std::string &ReplayFile, const std::string &Bot1Name, const std::string &Bot2Name);
 
     int CoordinatorArgc;
     char** CoordinatorArgv;
-    LadderConfig *Config;
-    uint32_t MaxGameTime{0U};
-    uint32_t MaxRealGameTime{0U};
-    bool RealTime{false};
+    std::shared_ptr<const LadderSettings> Settings;
+    MapCatalog *Maps;
+    CorePlanner *Planner;
+    const int PortBase;
+    std::function<void(uint32_t GameLoop)> ProgressReport;
 };
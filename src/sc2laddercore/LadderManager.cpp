@@ -30,6 +30,7 @@
 #include <memory>
 #include <iostream>
 #include <future>
+#include <thread>
 #include <chrono>
 #include <sys/stat.h>
 #include <fcntl.h>
@@ -41,6 +42,11 @@
 #include "MatchupList.h"
 #include "Tools.h"
 #include "LadderGame.h"
+#include "CorePlanner.h"
+#include "Benchmark.h"
+#include "Coordinator.h"
+#include "ConcurrencyGovernor.h"
+#include "MapCatalog.h"
 
 #ifdef _WIN32
 #include "dirent.h"
@@ -48,32 +54,67 @@
 #include <dirent.h>
 #endif
 
-std::mutex PrintThread::_mutexPrint{};
 
 
 
 LadderManager::LadderManager(int InCoordinatorArgc, char** inCoordinatorArgv)
 
-	: CoordinatorArgc(InCoordinatorArgc)
+	: Results(nullptr)
+	, ResultIndex(nullptr)
+	, Ratings(nullptr)
+	, ResultsExportInterval(10)
+	, ResultsSinceExport(0)
+	, MatchesStarted(0)
+	, Archive(nullptr)
+	, Catalog(nullptr)
+	, CoordinatorArgc(InCoordinatorArgc)
 	, CoordinatorArgv(inCoordinatorArgv)
 	, MaxEloDiff(0)
 	, ConfigFile("LadderManager.json")
 	, EnableReplayUploads(false)
 	, EnableServerLogin(false)
 	, Config(nullptr)
+	, AgentConfig(nullptr)
+	, Http(nullptr)
+	, DataSync(nullptr)
+	, BotSync(nullptr)
+	, Watcher(nullptr)
+	, Planner(nullptr)
+	, PlannerCores(0)
+	, SlotsStopping(false)
+	, SlotsTransferring(0)
+	, ReloadPending(false)
 {
 }
 
 // Used for tests
 LadderManager::LadderManager(int InCoordinatorArgc, char** inCoordinatorArgv, const char *InConfigFile)
 
-	: CoordinatorArgc(InCoordinatorArgc)
+	: Results(nullptr)
+	, ResultIndex(nullptr)
+	, Ratings(nullptr)
+	, ResultsExportInterval(10)
+	, ResultsSinceExport(0)
+	, MatchesStarted(0)
+	, Archive(nullptr)
+	, Catalog(nullptr)
+	, CoordinatorArgc(InCoordinatorArgc)
 	, CoordinatorArgv(inCoordinatorArgv)
 	, MaxEloDiff(0)
 	, ConfigFile(InConfigFile)
 	, EnableReplayUploads(false)
 	, EnableServerLogin(false)
 	, Config(nullptr)
+	, AgentConfig(nullptr)
+	, Http(nullptr)
+	, DataSync(nullptr)
+	, BotSync(nullptr)
+	, Watcher(nullptr)
+	, Planner(nullptr)
+	, PlannerCores(0)
+	, SlotsStopping(false)
+	, SlotsTransferring(0)
+	, ReloadPending(false)
 {
 }
 
@@ -88,220 +129,451 @@ bool LadderManager::LoadSetup()
 		PrintThread{} << "Unable to parse config (not found or not valid): " << ConfigFile << std::endl;
 		return false;
 	}
-
-	std::string EnableReplayUploadString = Config->GetStringValue("EnableReplayUpload");
-	if (EnableReplayUploadString == "True")
+	std::vector<std::string> Errors;
+	Settings = LadderSettings::Load(*Config, Errors);
+	if (!Settings)
 	{
-		EnableReplayUploads = true;
+		PrintThread{} << "Invalid config " << ConfigFile << ":" << std::endl;
+		for (const std::string &Error : Errors)
+		{
+			PrintThread{} << "* " << Error << std::endl;
+		}
+		return false;
 	}
 
-	ResultsLogFile = Config->GetStringValue("ResultsLogFile");
-	ServerUsername = Config->GetStringValue("ServerUsername");
-	ServerPassword = Config->GetStringValue("ServerPassword");
-	std::string EnableServerLoginString = Config->GetStringValue("EnableServerLogin");
-	if (EnableServerLoginString == "True")
+	ResultsLogFile = Settings->ResultsLogFile;
+	delete Ratings;
+	Ratings = nullptr;
+	delete ResultIndex;
+	ResultIndex = nullptr;
+	delete Results;
+	Results = nullptr;
+	if (ResultsLogFile.size() > 0)
+	{
+		Results = new ResultsJournal(Settings->ResultsJournalFile, ResultsLogFile, Settings->ResultsSyncInterval);
+		ResultIndex = new ResultStore(Results);
+		Ratings = new RatingEngine(Settings->RatingsFile, Settings->EloKFactor, Settings->EloInitialRating);
+		Ratings->Initialize(*ResultIndex);
+		ResultsExportInterval = Settings->ResultsExportInterval;
+	}
+	delete Archive;
+	Archive = nullptr;
+	if (!Settings->ReplayArchiveDirectory.empty())
 	{
-		EnableServerLogin = true;
-		ServerLoginAddress = Config->GetStringValue("ServerLoginAddress");
+		Archive = new ReplayArchive(Settings->ReplayArchiveDirectory, Settings->ReplayArchiveCompression);
 	}
-	BotCheckLocation = Config->GetStringValue("BotInfoLocation");
+	ApplySettings();
 
-	std::string MaxEloDiffStr = Config->GetStringValue("MaxEloDiff");
-	if (MaxEloDiffStr.length() > 0)
+	delete Http;
+	Http = new HttpClient(Settings->HttpTimeout, Settings->HttpRetries);
+	delete DataSync;
+	DataSync = nullptr;
+	if (Settings->BotDataSyncPath.length() > 0)
+	{
+		DataSync = new BotDataSync(Http, Settings->BotDataSyncPath, ServerUsername, ServerPassword);
+	}
+	delete BotSync;
+	BotSync = nullptr;
+	if (Settings->BotSyncPath.length() > 0)
 	{
-		MaxEloDiff = std::stoi(MaxEloDiffStr);
+		BotSync = new BotDataSync(Http, Settings->BotSyncPath, ServerUsername, ServerPassword, "");
 	}
 
 	return true;
 }
 
-void LadderManager::SaveJsonResult(const BotConfig &Bot1, const BotConfig &Bot2, const std::string  &Map, GameResult Result)
+// Copies the settings that may change while the ladder runs.
+// The results journal, http client and data sync are only created in LoadSetup and keep their settings until a restart.
+void LadderManager::ApplySettings()
 {
-	rapidjson::Document ResultsDoc;
-	rapidjson::Document OriginalResults;
-	rapidjson::Document::AllocatorType& alloc = ResultsDoc.GetAllocator();
-	ResultsDoc.SetObject();
-	rapidjson::Value ResultsArray(rapidjson::kArrayType);
-	std::ifstream ifs(ResultsLogFile.c_str());
-	if (ifs)
-	{
-		std::stringstream buffer;
-		buffer << ifs.rdbuf();
-		bool parsingFailed = OriginalResults.Parse(buffer.str()).HasParseError();
-		if (!parsingFailed && OriginalResults.HasMember("Results"))
+	EnableReplayUploads = Settings->EnableReplayUpload;
+	ResultsExportInterval = Settings->ResultsExportInterval;
+	ServerUsername = Settings->ServerUsername;
+	ServerPassword = Settings->ServerPassword;
+	EnableServerLogin = Settings->EnableServerLogin;
+	ServerLoginAddress = Settings->ServerLoginAddress;
+	BotCheckLocation = Settings->BotInfoLocation;
+	MaxEloDiff = Settings->MaxEloDiff;
+	ConfigureLog(Settings->ErrorListFile, Settings->MatchLogDirectory);
+	// Running matches keep their cores from the previous planner until they end.
+	if (Settings->MatchCores != PlannerCores)
+	{
+		Planner.reset();
+		PlannerCores = Settings->MatchCores;
+		if (PlannerCores > 0)
 		{
-			const rapidjson::Value & Results = OriginalResults["Results"];
-			for (const auto& val : Results.GetArray())
-			{
-				rapidjson::Value NewVal;
-				NewVal.CopyFrom(val, alloc);
-				ResultsArray.PushBack(NewVal, alloc);
-			}
+			Planner = std::make_shared<CorePlanner>(PlannerCores);
+			PrintThread{} << "Pinning matches to " << PlannerCores << " of " << Planner->GetCoreCount() << " cores on " << Planner->GetNodeCount() << " NUMA nodes." << std::endl;
 		}
 	}
+}
 
-	rapidjson::Value NewResult(rapidjson::kObjectType);
-	NewResult.AddMember("Bot1", Bot1.BotName, ResultsDoc.GetAllocator());
-	NewResult.AddMember("Bot2", Bot2.BotName, alloc);
-	switch (Result.Result)
-	{
-    case ResultType::Player1Win:
-    case ResultType::Player2Crash:
-    case ResultType::Player2TimeOut:
-		NewResult.AddMember("Winner", Bot1.BotName, alloc);
-		break;
-    case ResultType::Player2Win:
-    case ResultType::Player1Crash:
-    case ResultType::Player1TimeOut:
-		NewResult.AddMember("Winner", Bot2.BotName, alloc);
-		break;
-    case ResultType::Tie:
-    case ResultType::Timeout:
-		NewResult.AddMember("Winner", "Tie", alloc);
-		break;
-    case ResultType::InitializationError:
-    case ResultType::Error:
-    case ResultType::ProcessingReplay:
-		NewResult.AddMember("Winner", "Error", alloc);
-		break;
-	}
-
-	NewResult.AddMember("Map", Map, alloc);
-	NewResult.AddMember("Result", GetResultType(Result.Result), alloc);
-	NewResult.AddMember("GameTime", Result.GameLoop, alloc);
-	NewResult.AddMember("TimeStamp", Result.TimeStamp, alloc);
-	ResultsArray.PushBack(NewResult, alloc);
-	ResultsDoc.AddMember("Results", ResultsArray, alloc);
-	std::ofstream ofs(ResultsLogFile.c_str());
-	rapidjson::OStreamWrapper osw(ofs);
-	rapidjson::PrettyWriter<rapidjson::OStreamWrapper> writer(osw);
-	ResultsDoc.Accept(writer);
+void LadderManager::ReportStepDeviation(const GameResult &Result)
+{
+	if (Result.GameLoop == 0)
+	{
+		return;
+	}
+	StepDeviationSummary &Summary = Result.Cores.empty() ? UnpinnedSteps : PinnedSteps;
+	// Against the built-in AI only one side has step times.
+	const int Sides = (Result.Bot1StepDeviation > 0 ? 1 : 0) + (Result.Bot2StepDeviation > 0 ? 1 : 0);
+	if (Sides == 0)
+	{
+		return;
+	}
+	Summary.Sum += (Result.Bot1StepDeviation + Result.Bot2StepDeviation) / Sides;
+	++Summary.Games;
+	std::ostringstream Report;
+	Report << "Step time deviation " << Result.Bot1StepDeviation << " / " << Result.Bot2StepDeviation << " microseconds";
+	if (!Result.Cores.empty())
+	{
+		Report << " on cores";
+		for (int Core : Result.Cores)
+		{
+			Report << " " << Core;
+		}
+	}
+	Report << ". Average pinned: ";
+	if (PinnedSteps.Games > 0)
+	{
+		Report << PinnedSteps.Sum / PinnedSteps.Games << " (" << PinnedSteps.Games << " games)";
+	}
+	else
+	{
+		Report << "-";
+	}
+	Report << ", unpinned: ";
+	if (UnpinnedSteps.Games > 0)
+	{
+		Report << UnpinnedSteps.Sum / UnpinnedSteps.Games << " (" << UnpinnedSteps.Games << " games)";
+	}
+	else
+	{
+		Report << "-";
+	}
+	PrintThread{} << Report.str() << std::endl;
 }
 
-bool LadderManager::UploadCmdLine(GameResult result, const Matchup &ThisMatch, const std::string UploadResultLocation)
+void LadderManager::WatchConfigFiles()
 {
-	std::string ReplayDir = Config->GetStringValue("LocalReplayDirectory");
-	std::string RawMapName = RemoveMapExtension(ThisMatch.Map);
-	std::string ReplayFile;
-		ReplayFile = ThisMatch.Agent1.BotName + "v" + ThisMatch.Agent2.BotName + "-" + RawMapName + ".Sc2Replay";
-	ReplayFile.erase(remove_if(ReplayFile.begin(), ReplayFile.end(), isspace), ReplayFile.end());
-	std::string ReplayLoc = ReplayDir + ReplayFile;
-
-    std::vector<std::string> arguments;
-    std::string  argument = " -b cookies.txt";
-    arguments.push_back(argument);
-    argument = " -F Username=" + ServerUsername;   
-    arguments.push_back(argument);
-    argument = " -F Password=" + ServerPassword;
-    arguments.push_back(argument);
-    argument = " -F Bot1Name=" + ThisMatch.Agent1.BotName;
-    arguments.push_back(argument);
-    argument = " -F Bot1Race=" + std::to_string((int)ThisMatch.Agent1.Race);
-    arguments.push_back(argument);
-    argument = " -F Bot2Name=" + ThisMatch.Agent2.BotName;
-    arguments.push_back(argument);
-    argument = " -F Bot1AvgFrame=" + std::to_string(result.Bot1AvgFrame);
-    arguments.push_back(argument);
-    argument = " -F Bot2AvgFrame=" + std::to_string(result.Bot2AvgFrame);
-    arguments.push_back(argument);
-    argument = " -F Frames=" + std::to_string(result.GameLoop);
-    arguments.push_back(argument);
-    argument = " -F Map=" + RawMapName;
-    arguments.push_back(argument);
-    argument = " -F Result=" + GetResultType(result.Result);
-    arguments.push_back(argument);
-    argument = " -F replayfile=@" + ReplayLoc;
-    arguments.push_back(argument);
-    PerformRestRequest(UploadResultLocation, arguments);
-	return true;
+	delete Watcher;
+	Watcher = new FileWatcher();
+	Watcher->WatchFile(ConfigFile);
+	if (Settings->BotConfigFile != "")
+	{
+		Watcher->WatchFile(Settings->BotConfigFile);
+	}
+	else if (Settings->BaseBotDirectory != "")
+	{
+		Watcher->WatchSubdirectories(Settings->BaseBotDirectory, "ladderbots.json");
+	}
 }
 
+LadderManager::TransferScope::TransferScope(LadderManager &InManager, std::unique_lock<std::mutex> &InLock)
+	: Manager(InManager)
+	, Lock(InLock)
+{
+	Manager.SlotCondition.wait(Lock, [this] { return !Manager.ReloadPending; });
+	++Manager.SlotsTransferring;
+	Lock.unlock();
+}
 
-bool LadderManager::LoginToServer()
+LadderManager::TransferScope::~TransferScope()
 {
-    std::vector<std::string> arguments;
-    std::string  argument = " -c cookies.txt";
-    arguments.push_back(argument);
-    argument = " -F Username=" + ServerUsername;
-    arguments.push_back(argument);
-    argument = " -F Password=" + ServerPassword;
-    arguments.push_back(argument);
-    PerformRestRequest(ServerLoginAddress, arguments);
-	return true;
+	Lock.lock();
+	--Manager.SlotsTransferring;
+	Manager.SlotCondition.notify_all();
 }
 
-bool LadderManager::IsBotEnabled(std::string BotName)
+// The config and the roster are replaced with SlotMutex held. Transfers read the settings without it,
+// so the reload first waits until the running ones have ended.
+void LadderManager::ReloadChangedFiles(MatchupList *Matchups, std::unique_lock<std::mutex> &Lock)
 {
-	BotConfig ThisBot;
-	if (AgentConfig->FindBot(BotName, ThisBot))
+	if (Watcher == nullptr)
+	{
+		return;
+	}
+	const std::set<std::string> ChangedFiles = Watcher->PollChanges();
+	if (ChangedFiles.empty())
+	{
+		return;
+	}
+	ReloadPending = true;
+	SlotCondition.wait(Lock, [this] { return SlotsTransferring == 0; });
+	ReloadPending = false;
+	SlotCondition.notify_all();
+	bool RosterChanged = false;
+	for (const std::string &Path : ChangedFiles)
+	{
+		if (Path == ConfigFile)
+		{
+			ReloadConfig(Matchups);
+			continue;
+		}
+		if (!sc2::DoesFileExist(Path))
+		{
+			PrintThread{} << Path << " was removed, disabled " << AgentConfig->RemoveAgents(Path) << " bot(s)." << std::endl;
+			RosterChanged = true;
+			continue;
+		}
+		// Only the changed file is parsed again, the rest of the roster is kept as it is.
+		PrintThread{} << "Reloading bots from " << Path << std::endl;
+		std::string BotDirectory;
+		if (Settings->BotConfigFile == "")
+		{
+			BotDirectory = Path.substr(0, Path.find_last_of("/\\"));
+		}
+		AgentConfig->LoadAgents(BotDirectory, Path);
+		RosterChanged = true;
+	}
+	if (RosterChanged)
 	{
-		return ThisBot.Enabled;
+		if (Ratings != nullptr && BotCheckLocation.empty())
+		{
+			Ratings->Apply(*AgentConfig);
+		}
+		UpdatePairing();
+		PrintThread{} << AgentConfig->GetBots().size() << " bots loaded." << std::endl;
+	}
+}
 
+bool LadderManager::ReloadConfig(MatchupList *Matchups)
+{
+	LadderConfig NewConfig(ConfigFile);
+	if (!NewConfig.ParseConfig())
+	{
+		PrintThread{} << "Ignoring change to " << ConfigFile << ": unable to parse config." << std::endl;
+		return false;
 	}
-	return false;
+	std::vector<std::string> Errors;
+	std::shared_ptr<const LadderSettings> NewSettings = LadderSettings::Load(NewConfig, Errors);
+	if (!NewSettings)
+	{
+		PrintThread{} << "Ignoring change to " << ConfigFile << ":" << std::endl;
+		for (const std::string &Error : Errors)
+		{
+			PrintThread{} << "* " << Error << std::endl;
+		}
+		return false;
+	}
+	const bool BotSourceChanged = NewSettings->BotConfigFile != Settings->BotConfigFile || NewSettings->BaseBotDirectory != Settings->BaseBotDirectory;
+	// A game that is still shutting down keeps its own reference to the previous settings.
+	Settings = NewSettings;
+	// AgentsConfig reads the interpreter paths through Config when bots are loaded.
+	Config->ParseConfig();
+	ApplySettings();
+	if (BotSourceChanged)
+	{
+		ReloadBotSource();
+	}
+	UpdatePairing();
+	Matchups->SetRatingWindow(&Pairing, MaxEloDiff);
+	PrintThread{} << "Reloaded " << ConfigFile << std::endl;
+	return true;
 }
-bool LadderManager::IsInsideEloRange(std::string Bot1Name, std::string Bot2Name)
+
+// Replaces the bots of the previous BotConfigFile or BaseBotDirectory with the ones of the current settings.
+void LadderManager::ReloadBotSource()
 {
-	if (MaxEloDiff == 0)
+	const std::string BaseDirectory = Settings->BaseBotDirectory.empty() ? "" : Settings->BaseBotDirectory + "/";
+	for (const std::string &Path : AgentConfig->GetBotFiles())
 	{
-		return true;
+		// Downloaded bots are kept in BaseBotDirectory also when the bots are listed in BotConfigFile.
+		const bool InSource = Path == Settings->BotConfigFile || (!BaseDirectory.empty() && Path.compare(0, BaseDirectory.size(), BaseDirectory) == 0);
+		if (!InSource)
+		{
+			AgentConfig->RemoveAgents(Path);
+		}
 	}
-	BotConfig Bot1, Bot2;
-	if (AgentConfig->FindBot(Bot1Name, Bot1) && AgentConfig->FindBot(Bot2Name, Bot2))
+	if (Settings->BotConfigFile != "")
 	{
-		int32_t EloDiff = abs(Bot1.ELO - Bot2.ELO);
-		PrintThread{} << Bot1Name << " ELO: " << Bot1.ELO << " | " << Bot2Name << " ELO: " << Bot2.ELO << " | Diff: " << EloDiff << std::endl;
+		AgentConfig->LoadAgents("", Settings->BotConfigFile);
+	}
+	else if (Settings->BaseBotDirectory != "")
+	{
+		AgentConfig->ReadBotDirectories(Settings->BaseBotDirectory);
+	}
+	if (Ratings != nullptr && BotCheckLocation.empty())
+	{
+		Ratings->Apply(*AgentConfig);
+	}
+	WatchConfigFiles();
+	PrintThread{} << "Bots reloaded, " << AgentConfig->GetBots().size() << " bots known." << std::endl;
+}
 
-		if (Bot1.ELO > 0 && Bot2.ELO > 0 && abs(EloDiff) > MaxEloDiff)
+void LadderManager::UpdatePairing()
+{
+	for (const BotConfig &Agent : AgentConfig->GetBots())
+	{
+		// A disabled bot stays in the roster, but must not be picked as an opponent.
+		if (Agent.Enabled)
+		{
+			Pairing.Update(Agent.BotName, Agent.ELO);
+		}
+		else
 		{
-			return false;
+			Pairing.Remove(Agent.BotName);
 		}
-		return true;
+	}
+	if (MaxEloDiff > 0)
+	{
+		PrintThread{} << Pairing.CountEligiblePairs(MaxEloDiff) << " pairs of bots are within " << MaxEloDiff << " ELO of each other." << std::endl;
+	}
+}
 
+void LadderManager::SaveJsonResult(const BotConfig &Bot1, const BotConfig &Bot2, const std::string  &Map, GameResult Result)
+{
+	if (ResultIndex == nullptr)
+	{
+		return;
 	}
+	const ResultRecord Record(Bot1.BotName, Bot2.BotName, Map, Result);
+	ResultIndex->Add(Record);
+	Ratings->Update(Record.Bot1, Record.Bot2, ResultStore::GetOutcome(Record));
+	Ratings->Save();
+	if (AgentConfig != nullptr && BotCheckLocation.empty())
+	{
+		Ratings->Apply(*AgentConfig);
+		for (const BotConfig *Agent : { &Bot1, &Bot2 })
+		{
+			// The bot may have been disabled while it played.
+			if (IsBotEnabled(Agent->BotName))
+			{
+				Pairing.Update(Agent->BotName, Ratings->GetRating(Agent->BotName));
+			}
+		}
+	}
+	const ResultSummary HeadToHead = ResultIndex->GetHeadToHead(Bot1.BotName, Bot2.BotName);
+	PrintThread{} << "Head to head " << Bot1.BotName << " vs " << Bot2.BotName << ": " << HeadToHead.Wins << "-" << HeadToHead.Losses << "-" << HeadToHead.Ties << " (" << HeadToHead.Errors << " errors)" << std::endl;
+	// Results.json is only rewritten every few games, the journal is the source of truth.
+	if (++ResultsSinceExport >= ResultsExportInterval)
+	{
+		Results->Export();
+		ResultsSinceExport = 0;
+	}
+}
+
+std::string LadderManager::GetLocalReplayFile(const Matchup &ThisMatch) const
+{
+	std::string ReplayFile = ThisMatch.Agent1.BotName + "v" + ThisMatch.Agent2.BotName + "-" + RemoveMapExtension(ThisMatch.Map) + ".SC2Replay";
+	ReplayFile.erase(remove_if(ReplayFile.begin(), ReplayFile.end(), isspace), ReplayFile.end());
+	return Settings->LocalReplayDirectory + ReplayFile;
+}
+
+void LadderManager::ArchiveReplay(const Matchup &ThisMatch, const GameResult &Result)
+{
+	const std::string ReplayFile = GetLocalReplayFile(ThisMatch);
+	if (Archive == nullptr || !sc2::DoesFileExist(ReplayFile))
+	{
+		return;
+	}
+	ArchivedReplay Entry;
+	// Matches of a coordinator are known by their lease, others get an id from the archive.
+	Entry.MatchId = ThisMatch.LeaseId;
+	Entry.Bot1 = ThisMatch.Agent1.BotName;
+	Entry.Bot2 = ThisMatch.Agent2.BotName;
+	Entry.Map = RemoveMapExtension(ThisMatch.Map);
+	Entry.TimeStamp = Result.TimeStamp;
+	const std::string MatchId = Archive->Add(ReplayFile, Entry);
+	if (!MatchId.empty())
+	{
+		PrintThread{} << "Replay archived as match " << MatchId << std::endl;
+	}
+}
+
+bool LadderManager::UploadCmdLine(GameResult result, const Matchup &ThisMatch, const std::string UploadResultLocation)
+{
+	std::string RawMapName = RemoveMapExtension(ThisMatch.Map);
+	std::string ReplayLoc = GetLocalReplayFile(ThisMatch);
+
+    // The session cookie from LoginToServer is kept by the http client.
+    std::vector<HttpFormField> Fields;
+    Fields.emplace_back("Username", ServerUsername);
+    Fields.emplace_back("Password", ServerPassword);
+    Fields.emplace_back("Bot1Name", ThisMatch.Agent1.BotName);
+    Fields.emplace_back("Bot1Race", std::to_string((int)ThisMatch.Agent1.Race));
+    Fields.emplace_back("Bot2Name", ThisMatch.Agent2.BotName);
+    Fields.emplace_back("Bot1AvgFrame", std::to_string(result.Bot1AvgFrame));
+    Fields.emplace_back("Bot2AvgFrame", std::to_string(result.Bot2AvgFrame));
+    Fields.emplace_back("Frames", std::to_string(result.GameLoop));
+    Fields.emplace_back("Map", RawMapName);
+    Fields.emplace_back("Result", GetResultType(result.Result));
+    if (!ThisMatch.LeaseId.empty())
+    {
+        Fields.emplace_back("LeaseId", ThisMatch.LeaseId);
+        Fields.emplace_back("TimeStamp", result.TimeStamp);
+    }
+    Fields.emplace_back("replayfile", ReplayLoc, true);
+    HttpResponse Response;
+    if (!Http->PostForm(UploadResultLocation, Fields, Response))
+    {
+        PrintThread{} << "Result upload failed with status " << Response.StatusCode << std::endl;
+        return false;
+    }
+	return true;
+}
+
+
+bool LadderManager::LoginToServer()
+{
+    std::vector<HttpFormField> Fields;
+    Fields.emplace_back("Username", ServerUsername);
+    Fields.emplace_back("Password", ServerPassword);
+    HttpResponse Response;
+    if (!Http->PostForm(ServerLoginAddress, Fields, Response))
+    {
+        PrintThread{} << "Login to " << ServerLoginAddress << " failed with status " << Response.StatusCode << std::endl;
+        return false;
+    }
 	return true;
 }
 
+bool LadderManager::IsBotEnabled(std::string BotName)
+{
+	const BotConfig *ThisBot = AgentConfig->FindBot(BotName);
+	return ThisBot != nullptr && ThisBot->Enabled;
+}
+bool LadderManager::IsInsideEloRange(std::string Bot1Name, std::string Bot2Name)
+{
+	return Pairing.IsEligible(Bot1Name, Bot2Name, MaxEloDiff);
+}
+
 bool LadderManager::DownloadBot(const std::string& BotName, const std::string& Checksum, bool Data)
 {
-    constexpr int DownloadRetrys = 3;
-    std::string RootPath = Config->GetStringValue("BaseBotDirectory") + "/" + BotName;
+    std::string RootPath = Settings->BaseBotDirectory + "/" + BotName;
     if (Data)
     {
         RootPath += "/data";
     }
     RemoveDirectoryRecursive(RootPath);
-    for (int RetryCount = 0; RetryCount < DownloadRetrys; RetryCount++)
+    std::vector<HttpFormField> Fields;
+    Fields.emplace_back("Username", ServerUsername);
+    Fields.emplace_back("Password", ServerPassword);
+    Fields.emplace_back("BotName", BotName);
+    if (Data)
     {
-        std::vector<std::string> arguments;
-        std::string argument = " -F Username=" + ServerUsername;
-        arguments.push_back(argument);
-        argument = " -F Password=" + ServerPassword;
-        arguments.push_back(argument);
-        argument = " -F BotName=" + BotName;
-        arguments.push_back(argument);
-        if (Data)
-        {
-            argument = " -F Data=1";
-            arguments.push_back(argument);
-        }
-        std::string BotZipLocation = Config->GetStringValue("BaseBotDirectory") + "/" + BotName + ".zip";
-        remove(BotZipLocation.c_str());
-        argument = " -o " + BotZipLocation;
-        arguments.push_back(argument);
-        PerformRestRequest(Config->GetStringValue("BotDownloadPath"), arguments);
-        std::string BotMd5 = GenerateMD5(BotZipLocation);
-        PrintThread{} << "Download checksum: " << Checksum << " Bot checksum: " << BotMd5 << std::endl;
-
-        if (BotMd5.compare(Checksum) == 0)
-        {
-            UnzipArchive(BotZipLocation, RootPath);
-            remove(BotZipLocation.c_str());
-            return true;
-        }
+        Fields.emplace_back("Data", "1");
+    }
+    // Not the name UploadBot uses, a zip under that name is data waiting for its upload.
+    std::string BotZipLocation = Settings->BaseBotDirectory + "/" + BotName + ".download.zip";
+    remove(BotZipLocation.c_str());
+    // The client retries failed downloads itself.
+    HttpResponse Response;
+    if (!Http->DownloadForm(Settings->BotDownloadPath, Fields, BotZipLocation, Response))
+    {
+        PrintThread{} << "Download of " << BotName << " failed with status " << Response.StatusCode << std::endl;
         remove(BotZipLocation.c_str());
+        return false;
     }
-    return false;
+    std::string BotMd5 = GenerateMD5(BotZipLocation);
+    PrintThread{} << "Download checksum: " << Checksum << " Bot checksum: " << BotMd5 << std::endl;
+    const bool Verified = BotMd5.compare(Checksum) == 0;
+    if (Verified)
+    {
+        UnzipArchive(BotZipLocation, RootPath);
+    }
+    remove(BotZipLocation.c_str());
+    return Verified;
 }
 
 bool LadderManager::VerifyUploadRequest(const std::string &UploadResult)
@@ -327,49 +599,75 @@ bool LadderManager::VerifyUploadRequest(const std::string &UploadResult)
 
 bool LadderManager::UploadBot(const BotConfig &bot, bool Data)
 {
-    std::string BotZipLocation = Config->GetStringValue("BaseBotDirectory") + "/" + bot.BotName + ".zip";
+    if (bot.Type == Computer)
+    {
+        return true;
+    }
+    std::string BotZipLocation = Settings->BaseBotDirectory + "/" + bot.BotName + ".zip";
     std::string InputLocation = bot.RootPath;
+    if (Data && DataSync != nullptr)
+    {
+        // Only the changed files are sent, and the local copy is kept as the baseline for the next game.
+        DataSyncStats Stats;
+        const bool Synced = DataSync->Upload(bot.BotName, Settings->BaseBotDirectory + "/" + bot.BotName, Stats);
+        ReportDataSync(bot.BotName, "upload", Stats);
+        return Synced;
+    }
     if (Data)
     {
         InputLocation += "/data";
     }
     ZipArchive(InputLocation, BotZipLocation);
     std::string BotMd5 = GenerateMD5(BotZipLocation);
-    std::vector<std::string> arguments;
-	std::string argument = " -F Username=" + ServerUsername;
-	arguments.push_back(argument);
-	argument = " -F Password=" + ServerPassword;
-	arguments.push_back(argument);
-	argument = " -F BotName=" + bot.BotName;
-	arguments.push_back(argument);
-    argument = " -F Checksum=" + BotMd5;
-    arguments.push_back(argument);
+    std::vector<HttpFormField> Fields;
+    Fields.emplace_back("Username", ServerUsername);
+    Fields.emplace_back("Password", ServerPassword);
+    Fields.emplace_back("BotName", bot.BotName);
+    Fields.emplace_back("Checksum", BotMd5);
     if (Data)
     {
-        argument = " -F Data=1";
-        arguments.push_back(argument);
+        Fields.emplace_back("Data", "1");
     }
-    argument = " -F BotFile=@" + BotZipLocation;
-	arguments.push_back(argument);
-    constexpr int UploadRetrys = 3;
-    for (int RetryCount = 0; RetryCount < UploadRetrys; RetryCount++)
+    Fields.emplace_back("BotFile", BotZipLocation, true);
+    // Not repeated: the server may have stored an upload whose response got lost.
+    const bool Uploaded = VerifyUploadRequest(Http->PostForm(Settings->BotUploadPath, Fields));
+    if (!Uploaded)
     {
-       	std::string UploadResult = PerformRestRequest(Config->GetStringValue("BotUploadPath"), arguments);
-        if (VerifyUploadRequest(UploadResult))
-        {
-            SleepFor(1);
-            RemoveDirectoryRecursive(InputLocation);
-            remove(BotZipLocation.c_str());
-            return true;
-        }
+        // The local copy is the only one that has the bot's latest data now.
+        PrintThread{} << "Keeping " << InputLocation << " and " << BotZipLocation << " after the failed upload of " << bot.BotName << std::endl;
+        return false;
     }
+    SleepFor(1);
     RemoveDirectoryRecursive(InputLocation);
     remove(BotZipLocation.c_str());
-    return false;
+    return true;
+}
+
+// Called during a transfer, without SlotMutex.
+void LadderManager::ReportDataSync(const std::string &BotName, const std::string &Direction, const DataSyncStats &Stats)
+{
+    {
+        std::lock_guard<std::mutex> Lock(SlotMutex);
+        MatchDataSync[BotName].Add(Stats);
+    }
+    PrintThread{} << BotName << " : data " << Direction << " moved " << Stats.FilesTransferred << " file(s), " << Stats.BytesTransferred << " of " << Stats.TotalBytes << " bytes, deleted " << Stats.FilesDeleted << " file(s)." << std::endl;
 }
 
 bool LadderManager::GetBot(BotConfig& Agent, const std::string& BotChecksum, const std::string& DataChecksum)
 {
+    const std::string BotLocation = Settings->BaseBotDirectory + "/" + Agent.BotName;
+    if (DataSync == nullptr && sc2::DoesFileExist(BotLocation + ".zip"))
+    {
+        // The data of the last match never reached the server, downloading now would replace it with older data.
+        BotConfig Pending = Agent;
+        Pending.RootPath = BotLocation;
+        if (!UploadBot(Pending, true))
+        {
+            PrintThread{} << "Upload of the last data of " << Agent.BotName << " failed again, skipping game" << std::endl;
+            LogNetworkFailiure(Agent.BotName, "Upload");
+            return false;
+        }
+    }
     if (BotChecksum != "" && BotChecksum != Agent.CheckSum)
     {
         if (!DownloadBot(Agent.BotName, BotChecksum, false))
@@ -380,7 +678,18 @@ bool LadderManager::GetBot(BotConfig& Agent, const std::string& BotChecksum, con
             return false;
         }
     }
-    if (DataChecksum != "")
+    if (DataSync != nullptr)
+    {
+        DataSyncStats Stats;
+        if (!DataSync->Download(Agent.BotName, Settings->BaseBotDirectory + "/" + Agent.BotName, Stats))
+        {
+            PrintThread{} << "Bot data sync failed, skipping game" << std::endl;
+            LogNetworkFailiure(Agent.BotName, "Sync Data");
+            return false;
+        }
+        ReportDataSync(Agent.BotName, "download", Stats);
+    }
+    else if (DataChecksum != "")
     {
         if (!DownloadBot(Agent.BotName, DataChecksum, true))
         {
@@ -391,29 +700,63 @@ bool LadderManager::GetBot(BotConfig& Agent, const std::string& BotChecksum, con
     }
     else
     {
-        const std::string DataLocation = Config->GetStringValue("BaseBotDirectory") + "/" + Agent.BotName + "/data";
+        const std::string DataLocation = Settings->BaseBotDirectory + "/" + Agent.BotName + "/data";
         MakeDirectory(DataLocation);
     }
     return true;
 }
 
-bool LadderManager::ConfgureBot(BotConfig& Agent, const std::string& BotId, const std::string& Checksum, const std::string& DataChecksum)
+bool LadderManager::ConfgureBot(BotConfig& Agent, const std::string& BotId, const std::string& Checksum, const std::string& DataChecksum, std::unique_lock<std::mutex> &Lock)
 {
-    if (Config->GetStringValue("BotDownloadPath") != "")
+    const BotConfig *KnownBot = AgentConfig->FindBot(Agent.BotName);
+    if (KnownBot != nullptr && KnownBot->Type == BotType::Computer)
+    {
+        // The built-in AI has nothing to download.
+        Agent = *KnownBot;
+        return true;
+    }
+    if (BotSync != nullptr)
+    {
+        // Only the files that changed on the coordinator since the last match are transferred.
+        const std::string BotLocation = Settings->BaseBotDirectory + "/" + Agent.BotName;
+        {
+            TransferScope Transfer(*this, Lock);
+            DataSyncStats Stats;
+            if (!BotSync->Download(Agent.BotName, BotLocation, Stats))
+            {
+                PrintThread{} << "Bot sync failed, skipping game" << std::endl;
+                LogNetworkFailiure(Agent.BotName, "Sync Bot");
+                return false;
+            }
+            ReportDataSync(Agent.BotName, "bot download", Stats);
+            if (!GetBot(Agent, "", DataChecksum))
+            {
+                return false;
+            }
+        }
+        AgentConfig->LoadAgents(BotLocation, BotLocation + "/ladderbots.json");
+    }
+    else if (Settings->BotDownloadPath != "")
     {
         if (Checksum == "" )
         {
             PrintThread{} << "No bot checksum found.  skipping game" << std::endl;
             return false;
         }
-        if (!GetBot(Agent, Checksum, DataChecksum))
         {
-            return false;
+            TransferScope Transfer(*this, Lock);
+            if (!GetBot(Agent, Checksum, DataChecksum))
+            {
+                return false;
+            }
         }
-        const std::string BotLocation = Config->GetStringValue("BaseBotDirectory") + "/" + Agent.BotName;
+        const std::string BotLocation = Settings->BaseBotDirectory + "/" + Agent.BotName;
         AgentConfig->LoadAgents(BotLocation, BotLocation + "/ladderbots.json");
     }
-    AgentConfig->FindBot(Agent.BotName, Agent);
+    if (const BotConfig *SavedAgent = AgentConfig->FindBot(Agent.BotName))
+    {
+        Agent = *SavedAgent;
+    }
     if (Agent.Skeleton )
     {
         PrintThread{} << "Unable to download bot " << Agent.BotName << std::endl;
@@ -430,100 +773,326 @@ bool LadderManager::ConfgureBot(BotConfig& Agent, const std::string& BotId, cons
 
 }
 
-void LadderManager::RunLadderManager()
+int LadderManager::RunLadderManager()
 {
-	AgentConfig = new AgentsConfig(Config);
-	MatchupList *Matchups = new MatchupList(Config->GetStringValue("MatchupListFile"), AgentConfig, Config->GetArrayValue("Maps"), getSC2Path(), Config->GetStringValue("MatchupGenerator"), Config->GetStringValue("ServerUsername"), Config->GetStringValue("ServerPassword"));
+	AgentConfig = new AgentsConfig(Settings, Http);
+	SC2Path = getSC2Path();
+	// The matchups and games look their maps up here instead of on disk.
+	Catalog = std::make_unique<MapCatalog>(Settings->Maps, sc2::GetGameMapsDirectory(SC2Path), sc2::GetLibraryMapsDirectory(), Settings->PrewarmMaps);
+	if (Settings->BenchmarkRuns > 0)
+	{
+		return RunBenchmark() ? 0 : 1;
+	}
+	// Without a ladder website the ratings computed from local results are used for ELO checks.
+	if (Ratings != nullptr && BotCheckLocation.empty())
+	{
+		Ratings->Apply(*AgentConfig);
+	}
+	if (Settings->CoordinatorPort > 0)
+	{
+		RunCoordinator();
+		return 0;
+	}
+	MatchupList *Matchups = new MatchupList(Settings->MatchupListFile, AgentConfig, Http, std::vector<std::string>(Settings->Maps), SC2Path, Catalog.get(), Settings->MatchupGenerator, Settings->ServerUsername, Settings->ServerPassword);
+	UpdatePairing();
+	Matchups->SetRatingWindow(&Pairing, MaxEloDiff);
+	// Changes to the config and the bot files are picked up between matches.
+	WatchConfigFiles();
     PrintThread{} << "Initialization finished." << std::endl << std::endl;
-	Matchup NextMatch;
 	try
 	{
 		if (EnableServerLogin)
 		{
 			LoginToServer();
 		}
-		while (Matchups->GetNextMatchup(NextMatch))
+		if (Settings->MatchupPrefetch > 0)
 		{
-    		GameResult result;
-			PrintThread{} << "Starting " << NextMatch.Agent1.BotName << " vs " << NextMatch.Agent2.BotName << " on " << NextMatch.Map << std::endl;
-            LadderGame CurrentLadderGame(CoordinatorArgc, CoordinatorArgv, Config);
-
-            if (!ConfgureBot(NextMatch.Agent1, NextMatch.Bot1Id, NextMatch.Bot1Checksum, NextMatch.Bot1DataChecksum))
-            {
-                PrintThread{} << "Error configuring bot " << NextMatch.Agent1.BotName << " Skipping game" << std::endl;
-                continue;
-            }
-            if (!ConfgureBot(NextMatch.Agent2, NextMatch.Bot2Id, NextMatch.Bot2Checksum, NextMatch.Bot2DataChecksum))
-            {
-                PrintThread{} << "Error configuring bot " << NextMatch.Agent1.BotName << " Skipping game" << std::endl;
-                continue;
-            }
-
-			result = CurrentLadderGame.StartGame(NextMatch.Agent1, NextMatch.Agent2, NextMatch.Map);
-			if (Config->GetStringValue("BotUploadPath") != "")
-       		{
-                if(!UploadBot(NextMatch.Agent1, true))
-                {
-                    LogNetworkFailiure(NextMatch.Agent1.BotName, "Upload");
-                }
-                if(!UploadBot(NextMatch.Agent2, true))
-                {
-                    LogNetworkFailiure(NextMatch.Agent2.BotName, "Upload");
-                }
-       		}
-
-            PrintThread{} << "Game finished with result: " << GetResultType(result.Result) << std::endl << std::endl;
-		    if (EnableReplayUploads)
-		    {
-    			UploadCmdLine(result, NextMatch, Config->GetStringValue("UploadResultLocation"));
-	    	}
-    		if (ResultsLogFile.size() > 0)
-	    	{
-			    SaveJsonResult(NextMatch.Agent1, NextMatch.Agent2, NextMatch.Map, result);
-    		}
-            Matchups->SaveMatchList();
+			Matchups->StartPrefetch(Settings->MatchupPrefetch);
 		}
+		Matchups->StartHeartbeat(Settings->LeaseHeartbeat);
+		RunMatchSlots(Matchups);
 	}
 	catch (const std::exception& e)
 	{
-		PrintThread{} << "Exception in game " << NextMatch.Agent1.BotName << " vs " << NextMatch.Agent2.BotName << " : " << e.what() << std::endl;
-		SaveError(NextMatch.Agent1.BotName, NextMatch.Agent2.BotName, NextMatch.Map);
+		PrintThread{} << "Exception in ladder manager: " << e.what() << std::endl;
 	}
+	if (Results != nullptr && ResultsSinceExport > 0)
+	{
+		Results->Export();
+		ResultsSinceExport = 0;
+	}
+	if (Archive != nullptr)
+	{
+		Archive->Flush();
+	}
+	// Returns any prefetched matchups to the server.
+	delete Matchups;
+	delete Watcher;
+	Watcher = nullptr;
+	FlushLog();
+	return 0;
 }
 
-void LadderManager::LogNetworkFailiure(const std::string &AgentName, const std::string &Action)
+void LadderManager::RunMatchSlots(MatchupList *Matchups)
 {
-    std::string ErrorListFile = Config->GetStringValue("ErrorListFile");
-    if (ErrorListFile == "")
-    {
-        return;
-    }
-    std::ofstream ofs(ErrorListFile, std::ofstream::app);
-    if (!ofs)
-    {
-        return;
-    }
-    std::time_t t = std::time(nullptr);
-    std::tm tm = *std::localtime(&t);
+	SlotsStopping = false;
+	// A single slot plays the matches one after the other on this thread.
+	if (Settings->MaxMatchSlots <= 1)
+	{
+		RunMatchSlot(0, Matchups, nullptr);
+		return;
+	}
+	ConcurrencyGovernor Governor(*Settings);
+	PrintThread{} << "Playing " << Governor.GetSlots() << " to " << Settings->MaxMatchSlots << " matches at once." << std::endl;
+	std::vector<std::thread> Slots;
+	for (int Slot = 0; Slot < Settings->MaxMatchSlots; ++Slot)
+	{
+		Slots.emplace_back(&LadderManager::RunMatchSlot, this, Slot, Matchups, &Governor);
+	}
+	HostSampler Host;
+	{
+		std::unique_lock<std::mutex> Lock(SlotMutex);
+		while (!SlotsStopping)
+		{
+			SlotCondition.wait_for(Lock, std::chrono::seconds(1));
+			if (Governor.IsDue() && Governor.Update(Host.Sample()))
+			{
+				SlotCondition.notify_all();
+			}
+		}
+	}
+	// The slots finish the matches they have already drawn.
+	for (std::thread &Slot : Slots)
+	{
+		Slot.join();
+	}
+}
 
-    ofs << std::put_time(&tm, "%d-%m-%Y %H-%M-%S") << ": " << AgentName + " Failed to " << Action  << std::endl;
-    ofs.close();
+void LadderManager::RunMatchSlot(int Slot, MatchupList *Matchups, ConcurrencyGovernor *Governor)
+{
+	auto IsFree = [this](const BotConfig &Agent)
+	{
+		return Agent.Type == Computer || PlayingBots.count(Agent.BotName) == 0;
+	};
+	std::unique_lock<std::mutex> Lock(SlotMutex);
+	while (!SlotsStopping)
+	{
+		if (Governor != nullptr && Slot >= Governor->GetSlots())
+		{
+			SlotCondition.wait(Lock);
+			continue;
+		}
+		Matchup NextMatch;
+		bool Playing = false;
+		try
+		{
+			// Changed files are reloaded before each match is drawn, also after a skipped game.
+			ReloadChangedFiles(Matchups, Lock);
+			if (!Matchups->GetNextMatchup(NextMatch))
+			{
+				SlotsStopping = true;
+				break;
+			}
+			// The directory and data of a bot are shared by all its matches, so it plays one at a time.
+			SlotCondition.wait(Lock, [&] { return IsFree(NextMatch.Agent1) && IsFree(NextMatch.Agent2); });
+			for (const BotConfig *Agent : { &NextMatch.Agent1, &NextMatch.Agent2 })
+			{
+				if (Agent->Type != Computer)
+				{
+					PlayingBots.insert(Agent->BotName);
+				}
+			}
+			Playing = true;
+			PlayMatch(NextMatch, Matchups, Slot, Governor, Lock);
+		}
+		catch (const std::exception& e)
+		{
+			if (!Lock.owns_lock())
+			{
+				Lock.lock();
+			}
+			PrintThread{} << "Exception in game " << NextMatch.Agent1.BotName << " vs " << NextMatch.Agent2.BotName << " : " << e.what() << std::endl;
+			SaveError(NextMatch.Agent1.BotName, NextMatch.Agent2.BotName, NextMatch.Map);
+			SlotsStopping = true;
+		}
+		if (Playing)
+		{
+			PlayingBots.erase(NextMatch.Agent1.BotName);
+			PlayingBots.erase(NextMatch.Agent2.BotName);
+			SlotCondition.notify_all();
+		}
+	}
+	SlotCondition.notify_all();
 }
 
-void LadderManager::SaveError(const std::string &Agent1, const std::string &Agent2, const std::string &Map)
+void LadderManager::PlayMatch(Matchup &NextMatch, MatchupList *Matchups, int Slot, ConcurrencyGovernor *Governor, std::unique_lock<std::mutex> &Lock)
 {
-	std::string ErrorListFile = Config->GetStringValue("ErrorListFile");
-	if (ErrorListFile == "")
+	MatchDataSync.erase(NextMatch.Agent1.BotName);
+	MatchDataSync.erase(NextMatch.Agent2.BotName);
+	LogContext MatchContext;
+	MatchContext.MatchId = ++MatchesStarted;
+	MatchContext.Phase = "configure";
+	LogScope MatchScope(MatchContext);
+	std::string MatchLogName = std::to_string(MatchContext.MatchId) + "-" + NextMatch.Agent1.BotName + "v" + NextMatch.Agent2.BotName + "-" + RemoveMapExtension(NextMatch.Map) + ".log";
+	MatchLogName.erase(remove_if(MatchLogName.begin(), MatchLogName.end(), isspace), MatchLogName.end());
+	MatchLogFile MatchLog(MatchContext.MatchId, MatchLogName);
+	PrintThread{} << "Starting " << NextMatch.Agent1.BotName << " vs " << NextMatch.Agent2.BotName << " on " << NextMatch.Map << std::endl;
+	// The map is read into the page cache while the bots are configured and the clients start.
+	Catalog->Prewarm(NextMatch.Map);
+	const std::shared_ptr<CorePlanner> MatchPlanner = Planner;
+	LadderGame CurrentLadderGame(CoordinatorArgc, CoordinatorArgv, Settings, Catalog.get(), MatchPlanner.get(), Slot);
+
+	if (!ConfgureBot(NextMatch.Agent1, NextMatch.Bot1Id, NextMatch.Bot1Checksum, NextMatch.Bot1DataChecksum, Lock))
 	{
+		PrintThread{} << "Error configuring bot " << NextMatch.Agent1.BotName << " Skipping game" << std::endl;
+		Matchups->SkipMatch(NextMatch);
 		return;
 	}
-	std::ofstream ofs(ErrorListFile, std::ofstream::app);
-	if (!ofs)
+	if (!ConfgureBot(NextMatch.Agent2, NextMatch.Bot2Id, NextMatch.Bot2Checksum, NextMatch.Bot2DataChecksum, Lock))
 	{
+		PrintThread{} << "Error configuring bot " << NextMatch.Agent1.BotName << " Skipping game" << std::endl;
+		Matchups->SkipMatch(NextMatch);
 		return;
 	}
-	ofs << "\"" + Agent1 + "\"vs\"" + Agent2 + "\" " + Map << std::endl;
-	ofs.close();
+
+	SetLogPhase("game");
+	if (Governor != nullptr)
+	{
+		CurrentLadderGame.SetProgressReport([Governor, Slot](uint32_t GameLoop)
+		{
+			Governor->ReportProgress(Slot, GameLoop);
+		});
+	}
+	// The other slots draw, configure and finish their matches while this one is played.
+	Lock.unlock();
+	const GameResult result = CurrentLadderGame.StartGame(NextMatch.Agent1, NextMatch.Agent2, NextMatch.Map);
+	Lock.lock();
+	if (Governor != nullptr)
+	{
+		Governor->ReportResult(Slot, result);
+	}
+	ReportStepDeviation(result);
+	SetLogPhase("upload");
+	// Checked once the game is over, the heartbeat may have lost the lease at any time before.
+	const bool LeaseLost = Matchups->IsLeaseLost(NextMatch.LeaseId);
+	if (LeaseLost)
+	{
+		PrintThread{} << "The lease of this match ran out, its data and result are not uploaded." << std::endl;
+	}
+	{
+		// Only the files of this match's bots are sent, no other slot uses them until they are out of PlayingBots.
+		TransferScope Transfer(*this, Lock);
+		if (!LeaseLost && (Settings->BotUploadPath != "" || DataSync != nullptr))
+		{
+			if (!UploadBot(NextMatch.Agent1, true))
+			{
+				LogNetworkFailiure(NextMatch.Agent1.BotName, "Upload");
+			}
+			if (!UploadBot(NextMatch.Agent2, true))
+			{
+				LogNetworkFailiure(NextMatch.Agent2.BotName, "Upload");
+			}
+		}
+		if (EnableReplayUploads && !LeaseLost)
+		{
+			UploadCmdLine(result, NextMatch, Settings->UploadResultLocation);
+		}
+		// After the upload, which sends the replay from LocalReplayDirectory.
+		ArchiveReplay(NextMatch, result);
+	}
+
+	if (DataSync != nullptr)
+	{
+		DataSyncStats Synced = MatchDataSync[NextMatch.Agent1.BotName];
+		Synced.Add(MatchDataSync[NextMatch.Agent2.BotName]);
+		PrintThread{} << "Data sync for this match: " << Synced.BytesTransferred << " of " << Synced.TotalBytes << " bytes transferred in " << Synced.Seconds << " seconds, about " << Synced.EstimatedSecondsSaved << " seconds saved." << std::endl;
+	}
+	PrintThread{} << "Game finished with result: " << GetResultType(result.Result) << std::endl << std::endl;
+	SetLogPhase("results");
+	if (ResultsLogFile.size() > 0)
+	{
+		SaveJsonResult(NextMatch.Agent1, NextMatch.Agent2, NextMatch.Map, result);
+	}
+	Matchups->CompleteMatch(NextMatch);
+}
+
+void LadderManager::RunCoordinator()
+{
+	MatchupList *Matchups = new MatchupList(Settings->MatchupListFile, AgentConfig, Http, std::vector<std::string>(Settings->Maps), SC2Path, Catalog.get(), Settings->MatchupGenerator, Settings->ServerUsername, Settings->ServerPassword);
+	UpdatePairing();
+	Matchups->SetRatingWindow(&Pairing, MaxEloDiff);
+	{
+		// Results arrive one at a time, the coordinator serialises them.
+		Coordinator Workers(Settings, AgentConfig, Matchups, [this](const Matchup &Match, const GameResult &Result)
+		{
+			if (ResultsLogFile.size() > 0)
+			{
+				SaveJsonResult(Match.Agent1, Match.Agent2, Match.Map, Result);
+			}
+			ArchiveReplay(Match, Result);
+		});
+		Workers.Run();
+	}
+	if (Results != nullptr && ResultsSinceExport > 0)
+	{
+		Results->Export();
+		ResultsSinceExport = 0;
+	}
+	if (Archive != nullptr)
+	{
+		Archive->Flush();
+	}
+	delete Matchups;
+	FlushLog();
+}
+
+bool LadderManager::RunBenchmark()
+{
+	// The ladder schedule is random and depends on the server, a benchmark plays its own fixed list
+	// of local bots with a fixed game seed and keeps no results, ratings or uploads.
+	const std::vector<Matchup> Matches = Benchmark::PlanMatches(*AgentConfig, Settings->BenchmarkPairings, Settings->Maps, Settings->BenchmarkRuns);
+	PrintThread{} << "Benchmark of " << Matches.size() << " matches with seed " << Settings->BenchmarkSeed << "." << std::endl << std::endl;
+	Benchmark Bench(Settings->BenchmarkReportFile, Settings->BenchmarkBaselineFile, Settings->BenchmarkTolerance);
+	for (const Matchup &NextMatch : Matches)
+	{
+		LogContext MatchContext;
+		MatchContext.MatchId = ++MatchesStarted;
+		MatchContext.Phase = "benchmark";
+		LogScope MatchScope(MatchContext);
+		PrintThread{} << "Starting " << NextMatch.Agent1.BotName << " vs " << NextMatch.Agent2.BotName << " on " << NextMatch.Map << std::endl;
+		Catalog->Prewarm(NextMatch.Map);
+		GameResult Result;
+		const auto Started = std::chrono::steady_clock::now();
+		try
+		{
+			LadderGame CurrentLadderGame(CoordinatorArgc, CoordinatorArgv, Settings, Catalog.get(), Planner.get());
+			Result = CurrentLadderGame.StartGame(NextMatch.Agent1, NextMatch.Agent2, NextMatch.Map);
+		}
+		catch (const std::exception &e)
+		{
+			PrintThread{} << "Exception in benchmark game: " << e.what() << std::endl;
+		}
+		const double WallSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - Started).count();
+		PrintThread{} << "Game finished with result: " << GetResultType(Result.Result) << " after " << WallSeconds << " seconds" << std::endl << std::endl;
+		Bench.AddResult(NextMatch, Result, WallSeconds);
+	}
+	const bool WithinTolerance = Bench.Finish(Settings->BenchmarkSeed);
+	if (!WithinTolerance)
+	{
+		PrintThread{} << "The benchmark regressed against the baseline, more errors, no finished game or slower by more than " << Settings->BenchmarkTolerance << "%." << std::endl;
+	}
+	FlushLog();
+	return WithinTolerance;
+}
+
+void LadderManager::LogNetworkFailiure(const std::string &AgentName, const std::string &Action)
+{
+    LogWrite(LogTarget::ErrorListTimestamped, AgentName + " Failed to " + Action + "\n");
+}
+
+void LadderManager::SaveError(const std::string &Agent1, const std::string &Agent2, const std::string &Map)
+{
+	LogWrite(LogTarget::ErrorList, "\"" + Agent1 + "\"vs\"" + Agent2 + "\" " + Map + "\n");
 }
 
 std::string LadderManager::getSC2Path() const
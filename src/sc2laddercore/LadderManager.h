@@ -1,13 +1,38 @@
 #pragma once
 #include <memory.h>
+#include <memory>
 #include <sstream>
 #include <mutex>
+#include <condition_variable>
+#include <map>
+#include <set>
 #include <iostream>
 #include <iomanip>
 #include <ctime>
 #include <sc2api/sc2_api.h>
 #include "LadderConfig.h"
+#include "LadderSettings.h"
 #include "AgentsConfig.h"
+#include "HttpClient.h"
+#include "BotDataSync.h"
+#include "ResultsJournal.h"
+#include "ResultStore.h"
+#include "RatingEngine.h"
+#include "PairingIndex.h"
+#include "FileWatcher.h"
+#include "ReplayArchive.h"
+#include "MapCatalog.h"
+
+class MatchupList;
+class CorePlanner;
+class ConcurrencyGovernor;
+
+// Step time deviation of the games played on pinned and on unpinned cores, to see what pinning gains.
+struct StepDeviationSummary
+{
+    double Sum{0.0};
+    uint64_t Games{0};
+};
 
 
 class LadderManager
@@ -17,7 +42,8 @@ public:
 	LadderManager(int InCoordinatorArgc, char** inCoordinatorArgv, const char *InConfigFile);
     bool LoadSetup();
 	void SaveJsonResult(const BotConfig & Bot1, const BotConfig & Bot2, const std::string & Map, GameResult Result);
-	void RunLadderManager();
+	// Returns the exit code of the process, nonzero if a benchmark is slower than its baseline.
+	int RunLadderManager();
 
     void LogNetworkFailiure(const std::string &Agent1, const std::string &Action);
 
@@ -28,11 +54,39 @@ private:
     bool VerifyUploadRequest(const std::string & uploadResult);
     bool UploadBot(const BotConfig &bot, bool Data);
 	bool GetBot(BotConfig& Agent, const std::string & BotChecksum, const std::string & DataChecksum);
-    bool ConfgureBot(BotConfig & Agent, const std::string & BotId, const std::string & Checksum, const std::string & DataChecksum);
+    // Called with Lock held, it is released while the bot is downloaded.
+    bool ConfgureBot(BotConfig & Agent, const std::string & BotId, const std::string & Checksum, const std::string & DataChecksum, std::unique_lock<std::mutex> &Lock);
     bool UploadCmdLine(GameResult result, const Matchup &ThisMatch, std::string UploadLocation);
+    void ReportDataSync(const std::string &BotName, const std::string &Direction, const DataSyncStats &Stats);
 
 	bool LoginToServer();
+	void ApplySettings();
+	void WatchConfigFiles();
+	// Called with Lock held, it waits until no slot is transferring files before anything is reloaded.
+	void ReloadChangedFiles(MatchupList *Matchups, std::unique_lock<std::mutex> &Lock);
+	bool ReloadConfig(MatchupList *Matchups);
+	void ReloadBotSource();
+	void UpdatePairing();
+	void ReportStepDeviation(const GameResult &Result);
+	bool RunBenchmark();
+	void RunCoordinator();
+	void RunMatchSlots(MatchupList *Matchups);
+	void RunMatchSlot(int Slot, MatchupList *Matchups, ConcurrencyGovernor *Governor);
+	// Called with Lock held, it is released while the bots are transferred and the game is played.
+	void PlayMatch(Matchup &NextMatch, MatchupList *Matchups, int Slot, ConcurrencyGovernor *Governor, std::unique_lock<std::mutex> &Lock);
+	std::string GetLocalReplayFile(const Matchup &ThisMatch) const;
+	void ArchiveReplay(const Matchup &ThisMatch, const GameResult &Result);
 	std::string ResultsLogFile;
+	ResultsJournal *Results;
+	ResultStore *ResultIndex;
+	RatingEngine *Ratings;
+	int ResultsExportInterval;
+	int ResultsSinceExport;
+	uint64_t MatchesStarted;
+	// Keeps the replays of all matches, nullptr if they stay in LocalReplayDirectory.
+	ReplayArchive *Archive;
+	std::unique_ptr<MapCatalog> Catalog;
+	std::string SC2Path;
 
 	void SaveError(const std::string &Agent1, const std::string &Agent2, const std::string &Map);
 
@@ -51,5 +105,42 @@ private:
 	std::string ServerPassword;
 	std::string ServerLoginAddress;
     LadderConfig *Config;
+    std::shared_ptr<const LadderSettings> Settings;
     AgentsConfig *AgentConfig;
+    HttpClient *Http;
+    BotDataSync *DataSync;
+    // Synchronises the bots' own files with a coordinator.
+    BotDataSync *BotSync;
+    // Data synchronised for the current match of each bot.
+    std::map<std::string, DataSyncStats> MatchDataSync;
+    PairingIndex Pairing;
+    FileWatcher *Watcher;
+    // Matches that are still running keep their own reference when it is replaced.
+    std::shared_ptr<CorePlanner> Planner;
+    int PlannerCores;
+    StepDeviationSummary PinnedSteps;
+    StepDeviationSummary UnpinnedSteps;
+    // Guards the settings, the bot roster, the pairing, the results and the match list.
+    // The match slots release it only to play a game or to transfer the files of their own bots.
+    std::mutex SlotMutex;
+    std::condition_variable SlotCondition;
+    // Bots in a match of one of the slots, a bot plays one match at a time.
+    std::set<std::string> PlayingBots;
+    bool SlotsStopping;
+    // Slots that released SlotMutex for a transfer, they still read the settings and the server login.
+    int SlotsTransferring;
+    // A reload waits for the running transfers to end, new ones wait for the reload.
+    bool ReloadPending;
+
+    // Releases SlotMutex for the lifetime of the scope and takes it back at the end, also on an exception.
+    class TransferScope
+    {
+    public:
+        TransferScope(LadderManager &InManager, std::unique_lock<std::mutex> &InLock);
+        ~TransferScope();
+
+    private:
+        LadderManager &Manager;
+        std::unique_lock<std::mutex> &Lock;
+    };
 };
@@ -0,0 +1,297 @@
+#include "LadderSettings.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+#include "LadderConfig.h"
+
+namespace {
+
+class SettingsReader
+{
+public:
+    SettingsReader(const LadderConfig &InConfig, std::vector<std::string> &InErrors)
+        : Config(InConfig)
+        , Errors(InErrors)
+    {
+    }
+
+    std::string String(const std::string &Name)
+    {
+        try
+        {
+            return Config.GetStringValue(Name);
+        }
+        catch (const std::invalid_argument &)
+        {
+            Errors.push_back("\"" + Name + "\" has to be a string.");
+        }
+        return "";
+    }
+
+    // Numbers written as strings are accepted, older configs do that.
+    int Int(const std::string &Name, int Minimum = 0)
+    {
+        int Value = 0;
+        try
+        {
+            Value = Config.GetIntValue(Name);
+        }
+        catch (const std::invalid_argument &)
+        {
+            const std::string Text = String(Name);
+            size_t Parsed = 0;
+            try
+            {
+                Value = std::stoi(Text, &Parsed);
+            }
+            catch (const std::exception &)
+            {
+                Parsed = 0;
+            }
+            if (Text.empty() || Parsed != Text.size())
+            {
+                Errors.push_back("\"" + Name + "\" has to be a number.");
+                return 0;
+            }
+        }
+        if (Value < Minimum)
+        {
+            Errors.push_back("\"" + Name + "\" can not be less than " + std::to_string(Minimum) + ".");
+            return 0;
+        }
+        return Value;
+    }
+
+    // Accepts true/false as well as the "True"/"False" strings used by older configs.
+    bool Bool(const std::string &Name, bool Default = false)
+    {
+        if (!Config.HasValue(Name))
+        {
+            return Default;
+        }
+        try
+        {
+            return Config.GetBoolValue(Name);
+        }
+        catch (const std::invalid_argument &)
+        {
+        }
+        std::string Text = String(Name);
+        std::transform(Text.begin(), Text.end(), Text.begin(), ::tolower);
+        if (Text == "true")
+        {
+            return true;
+        }
+        if (Text != "false" && !Text.empty())
+        {
+            Errors.push_back("\"" + Name + "\" has to be true or false.");
+        }
+        return false;
+    }
+
+    std::vector<std::string> Array(const std::string &Name)
+    {
+        try
+        {
+            return Config.GetArrayValue(Name);
+        }
+        catch (const std::invalid_argument &)
+        {
+            Errors.push_back("\"" + Name + "\" has to be an array of strings.");
+        }
+        return std::vector<std::string>();
+    }
+
+    void Require(bool Condition, const std::string &Error)
+    {
+        if (!Condition)
+        {
+            Errors.push_back(Error);
+        }
+    }
+
+private:
+    const LadderConfig &Config;
+    std::vector<std::string> &Errors;
+};
+
+} // namespace
+
+std::shared_ptr<const LadderSettings> LadderSettings::Load(const LadderConfig &Config, std::vector<std::string> &Errors)
+{
+    const size_t PreviousErrors = Errors.size();
+    SettingsReader Read(Config, Errors);
+    std::shared_ptr<LadderSettings> Settings = std::make_shared<LadderSettings>();
+
+    Settings->ErrorListFile = Read.String("ErrorListFile");
+    Settings->MatchLogDirectory = Read.String("MatchLogDirectory");
+    Settings->BotConfigFile = Read.String("BotConfigFile");
+    Settings->BaseBotDirectory = Read.String("BaseBotDirectory");
+    Settings->CommandCenterPath = Read.String("CommandCenterPath");
+    Settings->PythonBinary = Read.String("PythonBinary");
+    Settings->NodeJSBinary = Read.String("NodeJSBinary");
+    Settings->PlayerIdFile = Read.String("PlayerIdFile");
+    Settings->BotConfigCacheFile = Read.String("BotConfigCacheFile");
+
+    Settings->MaxGameTime = static_cast<uint32_t>(Read.Int("MaxGameTime"));
+    Settings->MaxRealGameTime = static_cast<uint32_t>(Read.Int("MaxRealGameTime"));
+    Settings->RealTimeMode = Read.Bool("RealTimeMode");
+    Settings->LocalReplayDirectory = Read.String("LocalReplayDirectory");
+    if (!Settings->LocalReplayDirectory.empty() && Settings->LocalReplayDirectory.back() != '/')
+    {
+        Settings->LocalReplayDirectory += "/";
+    }
+    Settings->ReplayBotRenameProgram = Read.String("ReplayBotRenameProgram");
+    Settings->ReplayArchiveDirectory = Read.String("ReplayArchiveDirectory");
+    Settings->ReplayArchiveCompression = Read.Bool("ReplayArchiveCompression", true);
+    Settings->Maps = Read.Array("Maps");
+    Settings->PrewarmMaps = Read.Bool("PrewarmMaps", true);
+
+    Settings->CgroupRoot = Read.String("CgroupRoot");
+    Settings->BotCpuLimit = Read.Int("BotCpuLimit");
+    Settings->BotMemoryLimit = Read.Int("BotMemoryLimit");
+    Settings->BotProcessLimit = Read.Int("BotProcessLimit");
+    Settings->ClientCpuLimit = Read.Int("ClientCpuLimit");
+    Settings->ClientMemoryLimit = Read.Int("ClientMemoryLimit");
+    Settings->MemoryLimitAsAddressSpace = Read.Bool("MemoryLimitAsAddressSpace", false);
+    Settings->MatchCores = Read.Int("MatchCores");
+    const int MaxMatchSlots = Read.Int("MaxMatchSlots");
+    if (MaxMatchSlots > 0)
+    {
+        Settings->MaxMatchSlots = MaxMatchSlots;
+    }
+    const int MinMatchSlots = Read.Int("MinMatchSlots");
+    if (MinMatchSlots > 0)
+    {
+        Settings->MinMatchSlots = MinMatchSlots;
+    }
+    const int GovernorInterval = Read.Int("GovernorInterval");
+    if (GovernorInterval > 0)
+    {
+        Settings->GovernorInterval = GovernorInterval;
+    }
+    const int GovernorMaxCpu = Read.Int("GovernorMaxCpu");
+    if (GovernorMaxCpu > 0)
+    {
+        Settings->GovernorMaxCpu = GovernorMaxCpu;
+    }
+    const int GovernorMaxMemoryPressure = Read.Int("GovernorMaxMemoryPressure");
+    if (GovernorMaxMemoryPressure > 0)
+    {
+        Settings->GovernorMaxMemoryPressure = GovernorMaxMemoryPressure;
+    }
+    const int GovernorMaxStepTimeouts = Read.Int("GovernorMaxStepTimeouts");
+    if (GovernorMaxStepTimeouts > 0)
+    {
+        Settings->GovernorMaxStepTimeouts = GovernorMaxStepTimeouts;
+    }
+    const int GovernorMaxSlowdown = Read.Int("GovernorMaxSlowdown");
+    if (GovernorMaxSlowdown > 0)
+    {
+        Settings->GovernorMaxSlowdown = GovernorMaxSlowdown;
+    }
+
+    Settings->MatchupGenerator = Read.String("MatchupGenerator");
+    Settings->MatchupListFile = Read.String("MatchupListFile");
+    Settings->MatchupPrefetch = Read.Int("MatchupPrefetch");
+    Settings->MaxEloDiff = Read.Int("MaxEloDiff");
+
+    Settings->ResultsLogFile = Read.String("ResultsLogFile");
+    Settings->ResultsJournalFile = Read.String("ResultsJournalFile");
+    if (Settings->ResultsJournalFile.empty() && !Settings->ResultsLogFile.empty())
+    {
+        Settings->ResultsJournalFile = Settings->ResultsLogFile + ".journal";
+    }
+    const int ResultsExportInterval = Read.Int("ResultsExportInterval");
+    if (ResultsExportInterval > 0)
+    {
+        Settings->ResultsExportInterval = ResultsExportInterval;
+    }
+    Settings->ResultsSyncInterval = Read.Int("ResultsSyncInterval");
+    Settings->RatingsFile = Read.String("RatingsFile");
+    if (Settings->RatingsFile.empty() && !Settings->ResultsLogFile.empty())
+    {
+        Settings->RatingsFile = Settings->ResultsLogFile + ".ratings";
+    }
+    Settings->EloKFactor = Read.Int("EloKFactor");
+    Settings->EloInitialRating = Read.Int("EloInitialRating");
+
+    Settings->EnableReplayUpload = Read.Bool("EnableReplayUpload");
+    Settings->UploadResultLocation = Read.String("UploadResultLocation");
+    Settings->EnableServerLogin = Read.Bool("EnableServerLogin");
+    Settings->ServerLoginAddress = Read.String("ServerLoginAddress");
+    Settings->ServerUsername = Read.String("ServerUsername");
+    Settings->ServerPassword = Read.String("ServerPassword");
+    Settings->BotInfoLocation = Read.String("BotInfoLocation");
+    Settings->BotDownloadPath = Read.String("BotDownloadPath");
+    Settings->BotUploadPath = Read.String("BotUploadPath");
+    Settings->BotDataSyncPath = Read.String("BotDataSyncPath");
+    Settings->HttpTimeout = Read.Int("HttpTimeout");
+    Settings->HttpRetries = Read.Int("HttpRetries");
+
+    Settings->CoordinatorPort = Read.Int("CoordinatorPort");
+    const std::string CoordinatorAddress = Read.String("CoordinatorAddress");
+    if (!CoordinatorAddress.empty())
+    {
+        Settings->CoordinatorAddress = CoordinatorAddress;
+    }
+    Settings->CoordinatorUsername = Read.String("CoordinatorUsername");
+    Settings->CoordinatorPassword = Read.String("CoordinatorPassword");
+    if (Config.HasValue("LeaseAttempts"))
+    {
+        Settings->LeaseAttempts = Read.Int("LeaseAttempts");
+    }
+    const int LeaseTimeout = Read.Int("LeaseTimeout");
+    if (LeaseTimeout > 0)
+    {
+        Settings->LeaseTimeout = LeaseTimeout;
+    }
+    Settings->LeaseHeartbeat = Read.Int("LeaseHeartbeat");
+    Settings->BotSyncPath = Read.String("BotSyncPath");
+    const int PortBase = Read.Int("PortBase");
+    if (PortBase > 0)
+    {
+        Settings->PortBase = PortBase;
+    }
+
+    Settings->BenchmarkRuns = Read.Int("BenchmarkRuns");
+    if (Settings->BenchmarkRuns > 0)
+    {
+        const int BenchmarkSeed = Read.Int("BenchmarkSeed");
+        Settings->BenchmarkSeed = BenchmarkSeed > 0 ? static_cast<uint32_t>(BenchmarkSeed) : 1U;
+    }
+    Settings->BenchmarkPairings = Read.Array("BenchmarkPairings");
+    Settings->BenchmarkReportFile = Read.String("BenchmarkReportFile");
+    if (Settings->BenchmarkReportFile.empty())
+    {
+        Settings->BenchmarkReportFile = "Benchmark.json";
+    }
+    Settings->BenchmarkBaselineFile = Read.String("BenchmarkBaselineFile");
+    const int BenchmarkTolerance = Read.Int("BenchmarkTolerance");
+    if (BenchmarkTolerance > 0)
+    {
+        Settings->BenchmarkTolerance = BenchmarkTolerance;
+    }
+
+    std::string Generator = Settings->MatchupGenerator;
+    std::transform(Generator.begin(), Generator.end(), Generator.begin(), ::tolower);
+    // A benchmark plays its own schedule and needs no matchups.
+    const bool Benchmark = Settings->BenchmarkRuns > 0;
+    Read.Require(Benchmark || Generator == "file" || Generator == "url", "\"MatchupGenerator\" has to be either \"File\" or \"URL\".");
+    Read.Require(Benchmark || !Settings->MatchupListFile.empty(), "\"MatchupListFile\" is required.");
+    Read.Require(!Settings->LocalReplayDirectory.empty(), "\"LocalReplayDirectory\" is required.");
+    Read.Require(Settings->MinMatchSlots <= Settings->MaxMatchSlots, "\"MinMatchSlots\" can not be larger than \"MaxMatchSlots\".");
+    Read.Require(Settings->GovernorMaxSlowdown < 100, "\"GovernorMaxSlowdown\" has to be below 100.");
+    Read.Require(!Settings->EnableReplayUpload || !Settings->UploadResultLocation.empty(), "\"EnableReplayUpload\" requires \"UploadResultLocation\".");
+    Read.Require(!Settings->EnableServerLogin || !Settings->ServerLoginAddress.empty(), "\"EnableServerLogin\" requires \"ServerLoginAddress\".");
+    Read.Require(Settings->CoordinatorPort == 0 || Generator == "file", "\"CoordinatorPort\" requires the \"File\" \"MatchupGenerator\".");
+    Read.Require(Settings->CoordinatorPort == 0 || (!Settings->CoordinatorUsername.empty() && !Settings->CoordinatorPassword.empty()), "\"CoordinatorPort\" requires \"CoordinatorUsername\" and \"CoordinatorPassword\".");
+    Read.Require(Settings->CoordinatorPort < 65536 && Settings->PortBase < 65536 - 20 * Settings->MaxMatchSlots, "\"CoordinatorPort\" and \"PortBase\" have to be valid ports.");
+
+    if (Errors.size() > PreviousErrors)
+    {
+        return nullptr;
+    }
+    return Settings;
+}
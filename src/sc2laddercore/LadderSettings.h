@@ -0,0 +1,110 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+class LadderConfig;
+
+// Typed, validated copy of LadderManager.json.
+// Built once when the config is loaded and never changed afterwards, so it can be
+// shared between everything that runs a match without locking or string lookups.
+// Defaults that depend on other entries are resolved here as well.
+struct LadderSettings
+{
+    std::string ErrorListFile;
+    std::string MatchLogDirectory;
+    std::string BotConfigFile;
+    std::string BaseBotDirectory;
+    std::string CommandCenterPath;
+    std::string PythonBinary;
+    std::string NodeJSBinary;
+    std::string PlayerIdFile;
+    std::string BotConfigCacheFile;
+
+    uint32_t MaxGameTime{0};
+    uint32_t MaxRealGameTime{0};
+    bool RealTimeMode{false};
+    std::string LocalReplayDirectory;
+    std::string ReplayBotRenameProgram;
+    // Replays are moved into this archive after each match, empty to keep them in LocalReplayDirectory.
+    std::string ReplayArchiveDirectory;
+    bool ReplayArchiveCompression{true};
+    std::vector<std::string> Maps;
+    // Reads the map of a match into the page cache while the match is set up.
+    bool PrewarmMaps{true};
+
+    std::string CgroupRoot;
+    int BotCpuLimit{0};
+    int BotMemoryLimit{0};
+    int BotProcessLimit{0};
+    int ClientCpuLimit{0};
+    int ClientMemoryLimit{0};
+    // Applies the memory limits as RLIMIT_AS when no cgroup is available.
+    bool MemoryLimitAsAddressSpace{false};
+    int MatchCores{0};
+    // Matches played at the same time, adjusted between the two by the concurrency governor.
+    // Read once at startup.
+    int MaxMatchSlots{1};
+    int MinMatchSlots{1};
+    int GovernorInterval{60};
+    int GovernorMaxCpu{90};
+    int GovernorMaxMemoryPressure{10};
+    int GovernorMaxStepTimeouts{5};
+    int GovernorMaxSlowdown{20};
+
+    std::string MatchupGenerator;
+    std::string MatchupListFile;
+    int MatchupPrefetch{0};
+    int MaxEloDiff{0};
+
+    std::string ResultsLogFile;
+    std::string ResultsJournalFile;
+    int ResultsExportInterval{10};
+    int ResultsSyncInterval{0};
+    std::string RatingsFile;
+    int EloKFactor{0};
+    int EloInitialRating{0};
+
+    bool EnableReplayUpload{false};
+    std::string UploadResultLocation;
+    bool EnableServerLogin{false};
+    std::string ServerLoginAddress;
+    std::string ServerUsername;
+    std::string ServerPassword;
+    std::string BotInfoLocation;
+    std::string BotDownloadPath;
+    std::string BotUploadPath;
+    std::string BotDataSyncPath;
+    int HttpTimeout{0};
+    int HttpRetries{0};
+
+    // Serves the schedule to workers on this port instead of playing it, 0 to play it here.
+    int CoordinatorPort{0};
+    // Interface the coordinator listens on, the local host unless workers run elsewhere.
+    std::string CoordinatorAddress{"127.0.0.1"};
+    // Workers have to send these as their ServerUsername and ServerPassword.
+    std::string CoordinatorUsername;
+    std::string CoordinatorPassword;
+    int LeaseTimeout{120};
+    // Leases of a match that may run out or be released before it is given up, 0 for no limit.
+    int LeaseAttempts{3};
+    // Workers renew the leases of their matches this often, 0 for ladder servers without heartbeats.
+    int LeaseHeartbeat{0};
+    std::string BotSyncPath;
+    // First of the ports the StarCraft II clients and bots of a match use.
+    int PortBase{5677};
+
+    // Benchmark mode plays a fixed schedule instead of the ladder when BenchmarkRuns is set.
+    int BenchmarkRuns{0};
+    // Game seed of every match, 0 outside benchmark mode for random games.
+    uint32_t BenchmarkSeed{0};
+    std::vector<std::string> BenchmarkPairings;
+    std::string BenchmarkReportFile;
+    std::string BenchmarkBaselineFile;
+    int BenchmarkTolerance{10};
+
+    // Returns nullptr and fills Errors if the config has invalid entries.
+    static std::shared_ptr<const LadderSettings> Load(const LadderConfig &Config, std::vector<std::string> &Errors);
+};
@@ -0,0 +1,379 @@
+#include "Log.h"
+
+#include <atomic>
+#include <chrono>
+#include <ctime>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <thread>
+
+#include "Tools.h"
+
+namespace {
+
+constexpr size_t QueueSize = 8192; // Must be a power of two.
+constexpr size_t MaxMessageSize = 16384;
+
+enum class EntryKind : uint8_t
+{
+    Message,
+    ConfigureErrorList,
+    ConfigureMatchLogs,
+    BeginMatch,
+    EndMatch,
+};
+
+struct LogEntry
+{
+    EntryKind Kind{EntryKind::Message};
+    LogTarget Target{LogTarget::Console};
+    std::chrono::system_clock::time_point Time;
+    LogContext Context;
+    std::string Text;
+};
+
+// Bounded multi producer queue, each slot carries a sequence number that tells
+// producers and the consumer whose turn it is.
+class LogQueue
+{
+public:
+    LogQueue()
+        : Slots(new Slot[QueueSize])
+    {
+        for (size_t Index = 0; Index < QueueSize; ++Index)
+        {
+            Slots[Index].Sequence.store(Index, std::memory_order_relaxed);
+        }
+    }
+
+    bool TryPush(LogEntry &Entry)
+    {
+        size_t Position = PushPosition.load(std::memory_order_relaxed);
+        for (;;)
+        {
+            Slot &Target = Slots[Position & (QueueSize - 1)];
+            const size_t Sequence = Target.Sequence.load(std::memory_order_acquire);
+            const intptr_t Difference = static_cast<intptr_t>(Sequence) - static_cast<intptr_t>(Position);
+            if (Difference == 0)
+            {
+                if (PushPosition.compare_exchange_weak(Position, Position + 1, std::memory_order_relaxed))
+                {
+                    Target.Entry = std::move(Entry);
+                    Target.Sequence.store(Position + 1, std::memory_order_release);
+                    return true;
+                }
+            }
+            else if (Difference < 0)
+            {
+                return false;
+            }
+            else
+            {
+                Position = PushPosition.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    // Only called by the writer thread.
+    bool TryPop(LogEntry &Entry)
+    {
+        Slot &Source = Slots[PopPosition & (QueueSize - 1)];
+        if (Source.Sequence.load(std::memory_order_acquire) != PopPosition + 1)
+        {
+            return false;
+        }
+        Entry = std::move(Source.Entry);
+        Source.Entry.Text.clear();
+        Source.Sequence.store(PopPosition + QueueSize, std::memory_order_release);
+        ++PopPosition;
+        return true;
+    }
+
+    size_t Pushed() const
+    {
+        return PushPosition.load(std::memory_order_acquire);
+    }
+
+private:
+    struct Slot
+    {
+        std::atomic<size_t> Sequence;
+        LogEntry Entry;
+    };
+    std::unique_ptr<Slot[]> Slots;
+    alignas(64) std::atomic<size_t> PushPosition{0};
+    alignas(64) size_t PopPosition{0};
+};
+
+class LogWriter
+{
+public:
+    LogWriter()
+        : Writer(&LogWriter::Run, this)
+    {
+    }
+
+    ~LogWriter()
+    {
+        Stopping.store(true, std::memory_order_release);
+        Writer.join();
+    }
+
+    void Push(LogEntry &&Entry)
+    {
+        // Console messages may be logged from a proxy thread, those must never wait.
+        if (Entry.Kind == EntryKind::Message && Entry.Target == LogTarget::Console)
+        {
+            if (!Queue.TryPush(Entry))
+            {
+                Dropped.fetch_add(1, std::memory_order_relaxed);
+            }
+            return;
+        }
+        while (!Queue.TryPush(Entry))
+        {
+            std::this_thread::yield();
+        }
+    }
+
+    void Flush()
+    {
+        const size_t Target = Queue.Pushed();
+        while (Written.load(std::memory_order_acquire) < Target)
+        {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+    }
+
+private:
+    void Run()
+    {
+        LogEntry Entry;
+        for (;;)
+        {
+            const bool Stop = Stopping.load(std::memory_order_acquire);
+            size_t Count = 0;
+            while (Queue.TryPop(Entry))
+            {
+                Handle(Entry);
+                ++Count;
+            }
+            const uint64_t DroppedMessages = Dropped.exchange(0, std::memory_order_relaxed);
+            if (DroppedMessages > 0)
+            {
+                std::cout << FormatTime(std::chrono::system_clock::now()) << ": " << DroppedMessages << " log messages dropped, the log queue was full." << std::endl;
+            }
+            if (Count > 0)
+            {
+                std::cout.flush();
+                ErrorList.flush();
+                for (auto &MatchFile : MatchFiles)
+                {
+                    MatchFile.second->flush();
+                }
+                Written.fetch_add(Count, std::memory_order_release);
+            }
+            else if (Stop)
+            {
+                return;
+            }
+            else
+            {
+                std::this_thread::sleep_for(std::chrono::milliseconds(5));
+            }
+        }
+    }
+
+    void Handle(const LogEntry &Entry)
+    {
+        switch (Entry.Kind)
+        {
+        case EntryKind::Message:
+            Write(Entry);
+            break;
+        case EntryKind::ConfigureErrorList:
+            if (Entry.Text != ErrorListFile)
+            {
+                ErrorList.close();
+                ErrorList.clear();
+                ErrorListFile = Entry.Text;
+                if (!ErrorListFile.empty())
+                {
+                    ErrorList.open(ErrorListFile, std::ofstream::app);
+                }
+            }
+            break;
+        case EntryKind::ConfigureMatchLogs:
+            MatchLogDirectory = Entry.Text;
+            if (!MatchLogDirectory.empty())
+            {
+                MakeDirectory(MatchLogDirectory);
+            }
+            break;
+        case EntryKind::BeginMatch:
+            if (!MatchLogDirectory.empty())
+            {
+                std::unique_ptr<std::ofstream> MatchFile(new std::ofstream(MatchLogDirectory + "/" + Entry.Text, std::ofstream::app));
+                if (*MatchFile)
+                {
+                    MatchFiles[Entry.Context.MatchId] = std::move(MatchFile);
+                }
+            }
+            break;
+        case EntryKind::EndMatch:
+            MatchFiles.erase(Entry.Context.MatchId);
+            break;
+        }
+    }
+
+    void Write(const LogEntry &Entry)
+    {
+        if (Entry.Target != LogTarget::Console)
+        {
+            if (ErrorList.is_open())
+            {
+                if (Entry.Target == LogTarget::ErrorListTimestamped)
+                {
+                    ErrorList << FormatTime(Entry.Time) << ": ";
+                }
+                ErrorList << Entry.Text;
+            }
+            return;
+        }
+        std::string Fields;
+        if (Entry.Context.MatchId != 0)
+        {
+            Fields = "match " + std::to_string(Entry.Context.MatchId);
+        }
+        if (!Entry.Context.Phase.empty())
+        {
+            Fields += (Fields.empty() ? "" : " | ") + Entry.Context.Phase;
+        }
+        if (!Entry.Context.Bot.empty())
+        {
+            Fields += (Fields.empty() ? "" : " | ") + Entry.Context.Bot;
+        }
+        const std::string &Time = FormatTime(Entry.Time);
+        std::cout << Time << ": ";
+        if (!Fields.empty())
+        {
+            std::cout << "[" << Fields << "] ";
+        }
+        std::cout << Entry.Text;
+        const auto MatchFile = MatchFiles.find(Entry.Context.MatchId);
+        if (MatchFile != MatchFiles.end())
+        {
+            *MatchFile->second << Time << ": " << Entry.Text;
+        }
+    }
+
+    // localtime is only called once per second of log messages.
+    const std::string &FormatTime(std::chrono::system_clock::time_point Time)
+    {
+        const std::time_t Seconds = std::chrono::system_clock::to_time_t(Time);
+        if (Seconds != FormattedSeconds)
+        {
+            const std::tm tm = *std::localtime(&Seconds);
+            std::ostringstream Formatted;
+            Formatted << std::put_time(&tm, "%d-%m-%Y %H-%M-%S");
+            FormattedTime = Formatted.str();
+            FormattedSeconds = Seconds;
+        }
+        return FormattedTime;
+    }
+
+    LogQueue Queue;
+    std::atomic<uint64_t> Dropped{0};
+    std::atomic<size_t> Written{0};
+    std::atomic<bool> Stopping{false};
+
+    // Only used by the writer thread.
+    std::string ErrorListFile;
+    std::ofstream ErrorList;
+    std::string MatchLogDirectory;
+    std::map<uint64_t, std::unique_ptr<std::ofstream>> MatchFiles;
+    std::time_t FormattedSeconds{0};
+    std::string FormattedTime;
+
+    std::thread Writer;
+};
+
+LogWriter &GetLogWriter()
+{
+    static LogWriter Writer;
+    return Writer;
+}
+
+thread_local LogContext ThreadContext;
+
+void PushControl(EntryKind Kind, uint64_t MatchId, const std::string &Text)
+{
+    LogEntry Entry;
+    Entry.Kind = Kind;
+    Entry.Context.MatchId = MatchId;
+    Entry.Text = Text;
+    GetLogWriter().Push(std::move(Entry));
+}
+
+} // namespace
+
+void LogWrite(LogTarget Target, std::string &&Text)
+{
+    LogEntry Entry;
+    Entry.Target = Target;
+    Entry.Time = std::chrono::system_clock::now();
+    Entry.Context = ThreadContext;
+    Entry.Text = std::move(Text);
+    if (Entry.Text.size() > MaxMessageSize)
+    {
+        Entry.Text.resize(MaxMessageSize);
+        Entry.Text += "...\n";
+    }
+    GetLogWriter().Push(std::move(Entry));
+}
+
+void ConfigureLog(const std::string &ErrorListFile, const std::string &MatchLogDirectory)
+{
+    PushControl(EntryKind::ConfigureErrorList, 0, ErrorListFile);
+    PushControl(EntryKind::ConfigureMatchLogs, 0, MatchLogDirectory);
+}
+
+void FlushLog()
+{
+    GetLogWriter().Flush();
+}
+
+const LogContext &CurrentLogContext()
+{
+    return ThreadContext;
+}
+
+void SetLogPhase(const std::string &Phase)
+{
+    ThreadContext.Phase = Phase;
+}
+
+LogScope::LogScope(const LogContext &Context)
+    : Previous(ThreadContext)
+{
+    ThreadContext = Context;
+}
+
+LogScope::~LogScope()
+{
+    ThreadContext = Previous;
+}
+
+MatchLogFile::MatchLogFile(uint64_t InMatchId, const std::string &FileName)
+    : MatchId(InMatchId)
+{
+    PushControl(EntryKind::BeginMatch, MatchId, FileName);
+}
+
+MatchLogFile::~MatchLogFile()
+{
+    PushControl(EntryKind::EndMatch, MatchId, std::string());
+}
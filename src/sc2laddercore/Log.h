@@ -0,0 +1,66 @@
+#pragma once
+
+#include <cstdint>
+#include <sstream>
+#include <string>
+
+// Fields attached to every message a thread logs, see LogScope.
+struct LogContext
+{
+    uint64_t MatchId{0};
+    std::string Bot;
+    std::string Phase;
+};
+
+enum class LogTarget : uint8_t
+{
+    Console,
+    // Appended to ErrorListFile as it is.
+    ErrorList,
+    // Appended to ErrorListFile after the time it was logged.
+    ErrorListTimestamped,
+};
+
+// Messages go into a fixed size lock free ring buffer and are written by a background thread,
+// so logging never waits for the console or a disk. Console messages are dropped and counted
+// when the buffer is full, error list entries wait for space.
+void LogWrite(LogTarget Target, std::string &&Text);
+// An empty ErrorListFile drops error list entries, an empty MatchLogDirectory disables the per match log files.
+void ConfigureLog(const std::string &ErrorListFile, const std::string &MatchLogDirectory);
+// Waits until everything logged so far has been written.
+void FlushLog();
+const LogContext &CurrentLogContext();
+void SetLogPhase(const std::string &Phase);
+
+// Sets the fields attached to the messages of the current thread until it goes out of scope.
+class LogScope
+{
+public:
+    explicit LogScope(const LogContext &Context);
+    ~LogScope();
+
+private:
+    LogContext Previous;
+};
+
+// Also writes the messages of one match to FileName inside MatchLogDirectory while it is in scope.
+class MatchLogFile
+{
+public:
+    MatchLogFile(uint64_t InMatchId, const std::string &FileName);
+    ~MatchLogFile();
+
+private:
+    const uint64_t MatchId;
+};
+
+class PrintThread : public std::ostringstream
+{
+public:
+    PrintThread() = default;
+
+    ~PrintThread()
+    {
+        LogWrite(LogTarget::Console, str());
+    }
+};
@@ -0,0 +1,144 @@
+#include "MapCatalog.h"
+
+#include <chrono>
+#include <climits>
+#include <cstdlib>
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#if defined(__unix__) || defined(__APPLE__)
+#include <unistd.h>
+#endif
+
+#include "Log.h"
+#include "Tools.h"
+
+namespace {
+
+bool IsLocalMap(const std::string &Map)
+{
+    static const std::string Extension = ".SC2Map";
+    return Map.size() >= Extension.size() && Map.compare(Map.size() - Extension.size(), Extension.size(), Extension) == 0;
+}
+
+bool GetFileSize(const std::string &Path, uint64_t &Size)
+{
+    struct stat Info;
+    if (stat(Path.c_str(), &Info) != 0 || (Info.st_mode & S_IFMT) != S_IFREG)
+    {
+        return false;
+    }
+    Size = static_cast<uint64_t>(Info.st_size);
+    return true;
+}
+
+std::string GetAbsolutePath(const std::string &Path)
+{
+#ifdef _WIN32
+    char Absolute[_MAX_PATH];
+    if (_fullpath(Absolute, Path.c_str(), _MAX_PATH) != nullptr)
+    {
+        return Absolute;
+    }
+#else
+    char Absolute[PATH_MAX];
+    if (realpath(Path.c_str(), Absolute) != nullptr)
+    {
+        return Absolute;
+    }
+#endif
+    return Path;
+}
+
+} // namespace
+
+MapCatalog::MapCatalog(const std::vector<std::string> &InMaps, const std::string &InGameMapsDirectory, const std::string &InLibraryMapsDirectory, bool InPrewarm)
+    : GameMapsDirectory(InGameMapsDirectory)
+    , LibraryMapsDirectory(InLibraryMapsDirectory)
+    , PrewarmFiles(InPrewarm)
+{
+    const auto Start = std::chrono::steady_clock::now();
+    uint64_t Bytes = 0;
+    for (const std::string &Map : InMaps)
+    {
+        MapInfo Info;
+        if (Maps.count(Map) == 0 && Resolve(Map, Info))
+        {
+            Bytes += Info.Size;
+            Maps.emplace(Map, Info);
+        }
+    }
+    const auto Elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - Start);
+    PrintThread{} << "Indexed " << Maps.size() << " of " << InMaps.size() << " maps, " << Bytes << " bytes, in " << Elapsed.count() << "ms" << std::endl;
+}
+
+bool MapCatalog::Resolve(const std::string &Map, MapInfo &Info) const
+{
+    Info.Name = Map;
+    if (!IsLocalMap(Map))
+    {
+        return true;
+    }
+    for (const std::string &Candidate : { Map, GameMapsDirectory + Map, LibraryMapsDirectory + Map })
+    {
+        if (GetFileSize(Candidate, Info.Size))
+        {
+            Info.Path = GetAbsolutePath(Candidate);
+            return true;
+        }
+    }
+    return false;
+}
+
+bool MapCatalog::Find(const std::string &Map, MapInfo &Info)
+{
+    {
+        std::lock_guard<std::mutex> Lock(CatalogMutex);
+        const auto Known = Maps.find(Map);
+        if (Known != Maps.end())
+        {
+            Info = Known->second;
+            return true;
+        }
+    }
+    // Missing maps are looked up again next time, they may have been copied in since.
+    if (!Resolve(Map, Info))
+    {
+        return false;
+    }
+    std::lock_guard<std::mutex> Lock(CatalogMutex);
+    Maps.emplace(Map, Info);
+    return true;
+}
+
+bool MapCatalog::IsAvailable(const std::string &Map)
+{
+    MapInfo Info;
+    return Find(Map, Info);
+}
+
+void MapCatalog::Prewarm(const std::string &Map)
+{
+    MapInfo Info;
+    if (!PrewarmFiles || !Find(Map, Info) || Info.Path.empty())
+    {
+        return;
+    }
+#ifdef __linux__
+    const int File = open(Info.Path.c_str(), O_RDONLY);
+    if (File >= 0)
+    {
+        posix_fadvise(File, 0, 0, POSIX_FADV_WILLNEED);
+        close(File);
+    }
+#endif
+}
+
+void MapCatalog::ReportLoadTime(const std::string &Map, double Seconds)
+{
+    std::lock_guard<std::mutex> Lock(CatalogMutex);
+    LoadTimes &Times = Loads[Map];
+    ++Times.Loads;
+    Times.TotalSeconds += Seconds;
+    PrintThread{} << "Loaded " << Map << " in " << Seconds << " seconds, " << Times.TotalSeconds / Times.Loads << " on average over " << Times.Loads << " loads." << std::endl;
+}
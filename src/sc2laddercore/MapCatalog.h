@@ -0,0 +1,50 @@
+#pragma once
+
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+struct MapInfo
+{
+    // The name as it is configured or sent by the server.
+    std::string Name;
+    // Absolute path of the map file, empty for a Battle.net map.
+    std::string Path;
+    uint64_t Size{0};
+};
+
+// Looks up every map once instead of searching the map directories for each matchup and game.
+// A local map (*.SC2Map) is searched as given, in the game's Maps directory and in the library maps
+// directory, in that order, and kept with its absolute path. Battle.net maps are always available.
+// Maps that are not in the list given on construction are looked up on first use and kept.
+class MapCatalog
+{
+public:
+    MapCatalog(const std::vector<std::string> &InMaps, const std::string &InGameMapsDirectory, const std::string &InLibraryMapsDirectory, bool InPrewarm);
+
+    // False if Map is a local map that does not exist.
+    bool Find(const std::string &Map, MapInfo &Info);
+    bool IsAvailable(const std::string &Map);
+    // Asks the kernel to read the file of Map into the page cache in the background, so creating
+    // the game does not wait for the disk. Only on Linux and if enabled, returns immediately.
+    void Prewarm(const std::string &Map);
+    // Keeps the time the game took to load Map and logs it with the earlier loads.
+    void ReportLoadTime(const std::string &Map, double Seconds);
+
+private:
+    bool Resolve(const std::string &Map, MapInfo &Info) const;
+
+    const std::string GameMapsDirectory;
+    const std::string LibraryMapsDirectory;
+    const bool PrewarmFiles;
+    std::mutex CatalogMutex;
+    std::unordered_map<std::string, MapInfo> Maps;
+    struct LoadTimes
+    {
+        uint32_t Loads{0};
+        double TotalSeconds{0.0};
+    };
+    std::unordered_map<std::string, LoadTimes> Loads;
+};
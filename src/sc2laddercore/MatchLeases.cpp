@@ -0,0 +1,145 @@
+#include "MatchLeases.h"
+
+MatchLeases::MatchLeases(int InTimeoutSeconds, int InMaxAttempts)
+    : Timeout(std::chrono::seconds(InTimeoutSeconds > 0 ? InTimeoutSeconds : 1))
+    , MaxAttempts(InMaxAttempts)
+{
+}
+
+std::string MatchLeases::Add(const Matchup &Match, const std::string &Worker, Clock::time_point Now)
+{
+    std::lock_guard<std::mutex> Lock(LeaseMutex);
+    // The time keeps ids unique across restarts of the coordinator.
+    const std::string LeaseId = std::to_string(std::chrono::duration_cast<std::chrono::seconds>(std::chrono::system_clock::now().time_since_epoch()).count()) + "-" + std::to_string(++NextLease);
+    Lease &Added = Active[LeaseId];
+    Added.Match = Match;
+    Added.Match.LeaseId = LeaseId;
+    Added.Worker = Worker;
+    Added.Expires = Now + Timeout;
+    ++Attempts[Match.SchedulePosition];
+    return LeaseId;
+}
+
+bool MatchLeases::Renew(const std::string &LeaseId, Clock::time_point Now)
+{
+    std::lock_guard<std::mutex> Lock(LeaseMutex);
+    const auto Found = Active.find(LeaseId);
+    if (Found == Active.end())
+    {
+        return false;
+    }
+    Found->second.Expires = Now + Timeout;
+    return true;
+}
+
+bool MatchLeases::Complete(const std::string &LeaseId, Matchup &Match)
+{
+    std::lock_guard<std::mutex> Lock(LeaseMutex);
+    const auto Found = Active.find(LeaseId);
+    if (Found == Active.end())
+    {
+        return false;
+    }
+    Match = Found->second.Match;
+    Attempts.erase(Match.SchedulePosition);
+    Active.erase(Found);
+    return true;
+}
+
+bool MatchLeases::Release(const std::string &LeaseId)
+{
+    std::lock_guard<std::mutex> Lock(LeaseMutex);
+    const auto Found = Active.find(LeaseId);
+    if (Found == Active.end())
+    {
+        return false;
+    }
+    Return(Found->second.Match);
+    Active.erase(Found);
+    return true;
+}
+
+size_t MatchLeases::Expire(Clock::time_point Now)
+{
+    std::lock_guard<std::mutex> Lock(LeaseMutex);
+    size_t Expired = 0;
+    for (auto Current = Active.begin(); Current != Active.end();)
+    {
+        if (Current->second.Expires > Now)
+        {
+            ++Current;
+            continue;
+        }
+        PrintThread{} << "Lease " << Current->first << " of " << Current->second.Worker << " for " << Current->second.Match.Agent1.BotName << " vs " << Current->second.Match.Agent2.BotName << " ran out." << std::endl;
+        Return(Current->second.Match);
+        Current = Active.erase(Current);
+        ++Expired;
+    }
+    return Expired;
+}
+
+void MatchLeases::Return(const Matchup &Match)
+{
+    if (MaxAttempts > 0 && Attempts[Match.SchedulePosition] >= MaxAttempts)
+    {
+        Attempts.erase(Match.SchedulePosition);
+        Abandoned.push_back(Match);
+        return;
+    }
+    Returned.push_back(Match);
+}
+
+bool MatchLeases::TakeReturned(Matchup &Match)
+{
+    std::lock_guard<std::mutex> Lock(LeaseMutex);
+    if (Returned.empty())
+    {
+        return false;
+    }
+    Match = Returned.front();
+    Returned.pop_front();
+    return true;
+}
+
+bool MatchLeases::TakeAbandoned(Matchup &Match)
+{
+    std::lock_guard<std::mutex> Lock(LeaseMutex);
+    if (Abandoned.empty())
+    {
+        return false;
+    }
+    Match = Abandoned.front();
+    Abandoned.pop_front();
+    return true;
+}
+
+bool MatchLeases::IsPlaying(const std::string &BotName) const
+{
+    std::lock_guard<std::mutex> Lock(LeaseMutex);
+    for (const auto &Current : Active)
+    {
+        if (Current.second.Match.Agent1.BotName == BotName || Current.second.Match.Agent2.BotName == BotName)
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+size_t MatchLeases::GetActiveCount() const
+{
+    std::lock_guard<std::mutex> Lock(LeaseMutex);
+    return Active.size();
+}
+
+size_t MatchLeases::GetReturnedCount() const
+{
+    std::lock_guard<std::mutex> Lock(LeaseMutex);
+    return Returned.size();
+}
+
+size_t MatchLeases::GetAbandonedCount() const
+{
+    std::lock_guard<std::mutex> Lock(LeaseMutex);
+    return Abandoned.size();
+}
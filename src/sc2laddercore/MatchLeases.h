@@ -0,0 +1,67 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <map>
+#include <mutex>
+#include <string>
+
+#include "Types.h"
+
+// Matches the coordinator has handed out to workers. A lease runs out unless its worker
+// renews it with a heartbeat, the match is then handed to the next worker that asks.
+// A result is only accepted from the worker that holds the current lease of its match.
+// A match whose leases ran out or were released InMaxAttempts times is abandoned instead of
+// handed out again, so a match no worker can play does not keep the schedule from finishing.
+class MatchLeases
+{
+public:
+    typedef std::chrono::steady_clock Clock;
+
+    // InMaxAttempts 0 hands a match out until it is played.
+    MatchLeases(int InTimeoutSeconds, int InMaxAttempts = 0);
+
+    // Returns the id of the new lease.
+    std::string Add(const Matchup &Match, const std::string &Worker, Clock::time_point Now = Clock::now());
+    bool Renew(const std::string &LeaseId, Clock::time_point Now = Clock::now());
+    // Fills Match and ends the lease. Returns false if the lease is unknown or ran out.
+    bool Complete(const std::string &LeaseId, Matchup &Match);
+    // The worker gives the match back without playing it.
+    bool Release(const std::string &LeaseId);
+    // Moves the matches of leases that ran out to the queue of matches to hand out again.
+    // Returns the number of leases that ran out.
+    size_t Expire(Clock::time_point Now = Clock::now());
+    // Takes a match that has to be played again, false if there is none.
+    bool TakeReturned(Matchup &Match);
+    // Takes a match that ran out of attempts, false if there is none.
+    bool TakeAbandoned(Matchup &Match);
+
+    // True if a match of the bot is leased, a bot plays one match at a time.
+    bool IsPlaying(const std::string &BotName) const;
+
+    size_t GetActiveCount() const;
+    size_t GetReturnedCount() const;
+    size_t GetAbandonedCount() const;
+
+private:
+    struct Lease
+    {
+        Matchup Match;
+        std::string Worker;
+        Clock::time_point Expires;
+    };
+
+    // Called with LeaseMutex held.
+    void Return(const Matchup &Match);
+
+    const Clock::duration Timeout;
+    const int MaxAttempts;
+    uint64_t NextLease{0};
+    std::map<std::string, Lease> Active;
+    std::deque<Matchup> Returned;
+    std::deque<Matchup> Abandoned;
+    // Leases handed out for each match of the schedule that has no result yet, by schedule position.
+    std::map<uint64_t, int> Attempts;
+    mutable std::mutex LeaseMutex;
+};
@@ -10,24 +10,36 @@
 #include <vector>
 #include <string>
 #include <algorithm>
+#include <chrono>
 #include <random>
 #include <regex>
+#include <set>
+#include <unordered_map>
 #define RAPIDJSON_HAS_STDSTRING 1
 
 #include "rapidjson.h"
+#include "document.h"
+#include "ostreamwrapper.h"
+#include "writer.h"
 
 #include "Types.h"
 #include "LadderManager.h"
 #include "MatchupList.h"
 #include "Tools.h"
 #include "AgentsConfig.h"
+#include "HttpClient.h"
+#include "MapCatalog.h"
+#include "PairingIndex.h"
 
 #define URL_REGEX 
 
-MatchupList::MatchupList(const std::string &inMatchupListFile, AgentsConfig *InAgentConfig, std::vector<std::string> &&MapList, const std::string& sc2Path, const std::string &GeneratorType, const std::string &InServerUsername, const std::string &InServerPassword)
+MatchupList::MatchupList(const std::string &inMatchupListFile, AgentsConfig *InAgentConfig, HttpClient *InHttp, std::vector<std::string> &&MapList, const std::string& sc2Path, MapCatalog *InCatalog, const std::string &GeneratorType, const std::string &InServerUsername, const std::string &InServerPassword)
 	: MatchupListFile(inMatchupListFile)
 	, AgentConfig(InAgentConfig)
+	, Http(InHttp)
+	, Cursor(inMatchupListFile + ".cursor")
 	, sc2Path(sc2Path)
+	, Catalog(InCatalog)
 	, ServerUsername(InServerUsername)
 	, ServerPassword(InServerPassword)
 {
@@ -48,13 +60,12 @@ MatchupList::MatchupList(const std::string &inMatchupListFile, AgentsConfig *InA
 
 bool MatchupList::GenerateMatches(std::vector<std::string> &&maps)
 {
-	Matchups.clear();
 	PrintThread{} << "Found agents: " << std::endl;
-	for (const auto &Agent : AgentConfig->BotConfigs)
+	for (const BotConfig &Agent : AgentConfig->GetBots())
 	{
-        PrintThread{} << "* " << Agent.second.BotName << std::endl;
+        PrintThread{} << "* " << Agent.BotName << std::endl;
 	}
-	const auto firstInvalidMapIt = std::remove_if(maps.begin(),maps.end(),[&](const auto& map)->bool { return !isMapAvailable(map, sc2Path);});
+	const auto firstInvalidMapIt = std::remove_if(maps.begin(),maps.end(),[&](const auto& map)->bool { return !Catalog->IsAvailable(map);});
 	if (firstInvalidMapIt != maps.cbegin())
 	{
 		PrintThread{} << "Found the following maps: " << std::endl;
@@ -80,49 +91,147 @@ bool MatchupList::GenerateMatches(std::vector<std::string> &&maps)
 	if (!LoadMatchupList())
 	{
 		PrintThread{} << "Could not load MatchupList from file. Generating new one.." << std::endl;
-		for (const auto &Agent1 : AgentConfig->BotConfigs)
-		{
-			for (const auto &Agent2 : AgentConfig->BotConfigs)
-			{
-				if (Agent1.first == Agent2.first)
-				{
-					continue;
-				}
-				for (std::string map : maps)
-				{
-					Matchup NextMatchup(Agent1.second, Agent2.second, map);
-					Matchups.push_back(NextMatchup);
-				}
-			}
-		}
-		srand(time(0));
-		std::random_shuffle(std::begin(Matchups), std::end(Matchups));
+		GenerateSchedule(maps);
 		return true;
 	}
 	else
 	{
-		PrintThread{} << "MatchupList loaded from file with " << Matchups.size() << " matches to go." << std::endl;
+		PrintThread{} << "MatchupList loaded from file with " << RemainingMatches() << " matches to go." << std::endl;
 	}
 	return true;
 }
 
+void MatchupList::GenerateSchedule(const std::vector<std::string> &Maps)
+{
+	BotNames.clear();
+	for (const BotConfig &Agent : AgentConfig->GetBots())
+	{
+		BotNames.push_back(Agent.BotName);
+	}
+	MapNames = Maps;
+	MapAvailable.assign(MapNames.size(), true);
+	ListedMatches.clear();
+	Generated = true;
+	Seed = (static_cast<uint64_t>(std::random_device{}()) << 32) ^ static_cast<uint64_t>(time(0));
+	ScheduleId = Seed;
+	SetGeneratedSize();
+	PrintThread{} << "Generated schedule of " << TotalMatches << " matches." << std::endl;
+	SaveSchedule();
+	Cursor.Start(ScheduleId);
+	ResumeFromCursor();
+}
+
+void MatchupList::SetGeneratedSize()
+{
+	const uint64_t Bots = BotNames.size();
+	TotalMatches = Bots > 1 ? Bots * (Bots - 1) * MapNames.size() : 0;
+	Order = SchedulePermutation(TotalMatches, Seed);
+}
+
+ScheduledMatch MatchupList::GetScheduledMatch(uint64_t Index) const
+{
+	if (!Generated)
+	{
+		return ListedMatches[Index];
+	}
+	const uint64_t Position = Order.Map(Index);
+	const uint64_t Opponents = BotNames.size() - 1;
+	const uint64_t Pair = Position / MapNames.size();
+	ScheduledMatch Match;
+	Match.Map = static_cast<uint32_t>(Position % MapNames.size());
+	Match.Bot1 = static_cast<uint32_t>(Pair / Opponents);
+	const uint32_t Opponent = static_cast<uint32_t>(Pair % Opponents);
+	Match.Bot2 = Opponent < Match.Bot1 ? Opponent : Opponent + 1;
+	return Match;
+}
+
+bool MatchupList::NextSchedulePosition(uint64_t &Position)
+{
+	while (!ResumeQueue.empty())
+	{
+		Position = ResumeQueue.front();
+		ResumeQueue.pop_front();
+		if (Position < TotalMatches)
+		{
+			return true;
+		}
+		// Only a damaged cursor names a position past the end, there is no match to resume.
+		PrintThread{} << "Ignoring resumed match " << Position << " outside a schedule of " << TotalMatches << " matches." << std::endl;
+		ResumedOpponents.erase(Position);
+	}
+	if (NextIndex >= TotalMatches)
+	{
+		return false;
+	}
+	Position = NextIndex++;
+	return true;
+}
+
+size_t MatchupList::RemainingMatches() const
+{
+	return static_cast<size_t>(TotalMatches - NextIndex) + ResumeQueue.size();
+}
+
 bool MatchupList::GetNextMatchup(Matchup &NextMatch)
 {
 	switch (MatchUpProcess)
 	{
 		case MatchupListType::File:
 		{
-			if (MatchUpProcess == MatchupListType::File)
+			uint64_t Position;
+			while (NextSchedulePosition(Position))
 			{
-				if (Matchups.empty())
+				const ScheduledMatch Next = GetScheduledMatch(Position);
+				uint32_t OpponentIndex = Next.Bot2;
+				// A match that was started before a restart keeps its opponent, even if the ratings moved since.
+				const auto Resumed = ResumedOpponents.find(Position);
+				const bool KeepOpponent = Resumed != ResumedOpponents.end() && Resumed->second < BotNames.size();
+				if (Resumed != ResumedOpponents.end())
+				{
+					if (KeepOpponent)
+					{
+						OpponentIndex = Resumed->second;
+					}
+					ResumedOpponents.erase(Resumed);
+				}
+				std::string Opponent = BotNames[OpponentIndex];
+				if (!KeepOpponent && Pairing != nullptr && !Pairing->IsEligible(BotNames[Next.Bot1], Opponent, MaxEloDiff)
+					&& !Pairing->PickOpponent(BotNames[Next.Bot1], MaxEloDiff, SchedulePermutation::Mix(ScheduleId ^ Position), Opponent))
+				{
+					PrintThread{} << "No opponent within " << MaxEloDiff << " ELO of " << BotNames[Next.Bot1] << std::endl;
+					Cursor.Append('D', Position);
+					continue;
+				}
+				const BotConfig *Agent1 = AgentConfig->FindBot(BotNames[Next.Bot1]);
+				const BotConfig *Agent2 = AgentConfig->FindBot(Opponent);
+				if (Agent1 == nullptr || Agent2 == nullptr || !Agent1->Enabled || !Agent2->Enabled)
+				{
+					PrintThread{} << "Skipping match of removed agent: " << BotNames[Next.Bot1] << " vs " << Opponent << std::endl;
+					Cursor.Append('D', Position);
+					continue;
+				}
+				if (Agent1->Type == Computer && Agent2->Type == Computer)
+				{
+					// The built-in AI playing itself rates no bot, the coordinator draws from here as well.
+					Cursor.Append('D', Position);
+					continue;
+				}
+				if (!MapAvailable[Next.Map])
+				{
+					Cursor.Append('D', Position);
+					continue;
+				}
+				if (Opponent != BotNames[OpponentIndex])
 				{
-					return false;
+					// A bot loaded after the schedule was made has no index and is picked again on a resume.
+					OpponentIndex = static_cast<uint32_t>(std::find(BotNames.begin(), BotNames.end(), Opponent) - BotNames.begin());
 				}
-				NextMatch = Matchups.back();
-				Matchups.pop_back();
+				Cursor.Append('S', Position, OpponentIndex < BotNames.size() ? OpponentIndex : UINT32_MAX);
+				NextMatch = Matchup(*Agent1, *Agent2, MapNames[Next.Map]);
+				NextMatch.SchedulePosition = Position;
 				return true;
 			}
-			break;
+			return false;
 		}
 		case MatchupListType::URL:
 		{
@@ -137,20 +246,47 @@ bool MatchupList::GetNextMatchup(Matchup &NextMatch)
 	return false;
 }
 
-bool MatchupList::SaveMatchList()
+bool MatchupList::CompleteMatch(const Matchup &Match)
 {
-	std::ofstream ofs(MatchupListFile, std::ofstream::binary);
-	if (!ofs)
+	if (MatchUpProcess != MatchupListType::File)
 	{
-		return false;
+		std::lock_guard<std::mutex> Lock(HeartbeatMutex);
+		ActiveLeases.erase(Match.LeaseId);
+		LostLeases.erase(Match.LeaseId);
+		return true;
 	}
-	for (Matchup &NextMatch : Matchups)
+	return Cursor.Append('D', Match.SchedulePosition);
+}
+
+bool MatchupList::SkipMatch(const Matchup &Match)
+{
+	if (MatchUpProcess != MatchupListType::File)
 	{
-		ofs << "\"" + NextMatch.Agent1.BotName + "\"vs\"" + NextMatch.Agent2.BotName + "\" " + NextMatch.Map << std::endl;
+		{
+			std::lock_guard<std::mutex> Lock(HeartbeatMutex);
+			ActiveLeases.erase(Match.LeaseId);
+			LostLeases.erase(Match.LeaseId);
+		}
+		// Without the release the server would wait for the lease to run out.
+		if (!Match.LeaseId.empty())
+		{
+			ReleaseLeaseId(Match.LeaseId);
+		}
+		return true;
 	}
-	ofs.close();
-	return true;
+	return Cursor.Append('D', Match.SchedulePosition);
+}
 
+void MatchupList::SetRatingWindow(const PairingIndex *InPairing, int InMaxEloDiff)
+{
+	Pairing = InMaxEloDiff > 0 ? InPairing : nullptr;
+	MaxEloDiff = InMaxEloDiff;
+}
+
+MatchupList::~MatchupList()
+{
+	StopHeartbeat();
+	StopPrefetch();
 }
 
 bool MatchupList::LoadMatchupList()
@@ -160,7 +296,48 @@ bool MatchupList::LoadMatchupList()
 	{
 		return false;
 	}
-	Matchups.clear();
+	std::stringstream buffer;
+	buffer << ifs.rdbuf();
+	const std::string Content = buffer.str();
+	const size_t FirstCharacter = Content.find_first_not_of(" \t\r\n");
+	if (FirstCharacter != std::string::npos && Content[FirstCharacter] == '{')
+	{
+		if (!LoadSchedule(Content))
+		{
+			return false;
+		}
+		Cursor.Open(ScheduleId, TotalMatches);
+		ResumeFromCursor();
+		return true;
+	}
+	// A plain list of matches as written by older versions (or by hand) is converted once.
+	LoadLegacyMatchupList(buffer);
+	ScheduleId = (static_cast<uint64_t>(std::random_device{}()) << 32) ^ static_cast<uint64_t>(time(0));
+	SaveSchedule();
+	Cursor.Start(ScheduleId);
+	ResumeFromCursor();
+	return true;
+}
+
+void MatchupList::LoadLegacyMatchupList(std::istream &ifs)
+{
+	ifs.clear();
+	ifs.seekg(0);
+	BotNames.clear();
+	MapNames.clear();
+	ListedMatches.clear();
+	Generated = false;
+	std::unordered_map<std::string, uint32_t> BotIds;
+	std::unordered_map<std::string, uint32_t> MapIds;
+	const auto GetBotId = [&](const std::string &Name)
+	{
+		auto Inserted = BotIds.emplace(Name, static_cast<uint32_t>(BotNames.size()));
+		if (Inserted.second)
+		{
+			BotNames.push_back(Name);
+		}
+		return Inserted.first->second;
+	};
 	std::string line;
 	while (std::getline(ifs, line))
 	{
@@ -178,38 +355,279 @@ bool MatchupList::LoadMatchupList()
 		line.erase(0, p);
 		p = line.find_last_not_of(" \t\r\n");
 		std::string Map = line.substr(0, p + 1);
-		PrintThread{} << "Creating match: " + FirstAgent + " vs " + SecondAgent + " on " + Map << std::endl;
-		BotConfig Agent2, Agent1;
-		if (!AgentConfig->FindBot(FirstAgent, Agent1))
+		if (AgentConfig->GetBotHandle(FirstAgent) == InvalidBotHandle)
 		{
 			PrintThread{} << "Unable to find agent: " + FirstAgent << std::endl;
 			continue;
 		}
-		if (!AgentConfig->FindBot(SecondAgent, Agent2))
+		if (AgentConfig->GetBotHandle(SecondAgent) == InvalidBotHandle)
 		{
 			PrintThread{} << "Unable to find agent: " + SecondAgent << std::endl;
 			continue;
 		}
-		if (!isMapAvailable(Map,sc2Path))
+		auto KnownMap = MapIds.find(Map);
+		if (KnownMap == MapIds.end())
 		{
-			PrintThread{} << "Unable to find map: " + Map << std::endl;
-			continue;
+			if (!Catalog->IsAvailable(Map))
+			{
+				PrintThread{} << "Unable to find map: " + Map << std::endl;
+				continue;
+			}
+			KnownMap = MapIds.emplace(Map, static_cast<uint32_t>(MapNames.size())).first;
+			MapNames.push_back(Map);
 		}
-		Matchup NextMatchup(Agent1, Agent2, Map);
-		Matchups.push_back(NextMatchup);
+		ScheduledMatch NextMatchup;
+		NextMatchup.Bot1 = GetBotId(FirstAgent);
+		NextMatchup.Bot2 = GetBotId(SecondAgent);
+		NextMatchup.Map = KnownMap->second;
+		ListedMatches.push_back(NextMatchup);
+	}
+	// Old lists were played from the last line up.
+	std::reverse(ListedMatches.begin(), ListedMatches.end());
+	MapAvailable.assign(MapNames.size(), true);
+	TotalMatches = ListedMatches.size();
+	NextIndex = 0;
+	ResumeQueue.clear();
+	ResumedOpponents.clear();
+}
 
+bool MatchupList::LoadSchedule(const std::string &Content)
+{
+	rapidjson::Document doc;
+	if (doc.Parse(Content).HasParseError() || !doc.IsObject() || !doc.HasMember("Schedule") || !doc["Schedule"].IsUint64()
+		|| !doc.HasMember("Bots") || !doc["Bots"].IsArray() || !doc.HasMember("Maps") || !doc["Maps"].IsArray())
+	{
+		PrintThread{} << "Unable to parse schedule: " << MatchupListFile << std::endl;
+		return false;
+	}
+	ScheduleId = doc["Schedule"].GetUint64();
+	BotNames.clear();
+	for (const auto &Bot : doc["Bots"].GetArray())
+	{
+		BotNames.push_back(Bot.IsString() ? Bot.GetString() : "");
+	}
+	MapNames.clear();
+	MapAvailable.clear();
+	for (const auto &Map : doc["Maps"].GetArray())
+	{
+		MapNames.push_back(Map.IsString() ? Map.GetString() : "");
+		MapAvailable.push_back(Catalog->IsAvailable(MapNames.back()));
+		if (!MapAvailable.back())
+		{
+			PrintThread{} << "Unable to find map: " + MapNames.back() << std::endl;
+		}
+	}
+	ListedMatches.clear();
+	if (doc.HasMember("Seed") && doc["Seed"].IsUint64())
+	{
+		Generated = true;
+		Seed = doc["Seed"].GetUint64();
+		SetGeneratedSize();
+	}
+	else if (doc.HasMember("Matches") && doc["Matches"].IsArray())
+	{
+		Generated = false;
+		const uint32_t Bots = static_cast<uint32_t>(BotNames.size());
+		const uint32_t Maps = static_cast<uint32_t>(MapNames.size());
+		for (const auto &Match : doc["Matches"].GetArray())
+		{
+			if (!Match.IsArray() || Match.Size() != 3 || !Match[0].IsUint() || !Match[1].IsUint() || !Match[2].IsUint()
+				|| Match[0].GetUint() >= Bots || Match[1].GetUint() >= Bots || Match[2].GetUint() >= Maps)
+			{
+				PrintThread{} << "Unable to parse schedule: " << MatchupListFile << std::endl;
+				return false;
+			}
+			ListedMatches.push_back(ScheduledMatch{ Match[0].GetUint(), Match[1].GetUint(), Match[2].GetUint() });
+		}
+		TotalMatches = ListedMatches.size();
+	}
+	else
+	{
+		PrintThread{} << "Unable to parse schedule: " << MatchupListFile << std::endl;
+		return false;
 	}
+	NextIndex = 0;
+	ResumeQueue.clear();
+	ResumedOpponents.clear();
 	return true;
 }
 
+bool MatchupList::SaveSchedule() const
+{
+	const std::string TempFile = MatchupListFile + ".tmp";
+	{
+		std::ofstream ofs(TempFile.c_str(), std::ofstream::trunc);
+		if (!ofs)
+		{
+			return false;
+		}
+		rapidjson::OStreamWrapper osw(ofs);
+		rapidjson::Writer<rapidjson::OStreamWrapper> writer(osw);
+		writer.StartObject();
+		writer.Key("Schedule");
+		writer.Uint64(ScheduleId);
+		writer.Key("Bots");
+		writer.StartArray();
+		for (const std::string &Bot : BotNames)
+		{
+			writer.String(Bot);
+		}
+		writer.EndArray();
+		writer.Key("Maps");
+		writer.StartArray();
+		for (const std::string &Map : MapNames)
+		{
+			writer.String(Map);
+		}
+		writer.EndArray();
+		if (Generated)
+		{
+			writer.Key("Seed");
+			writer.Uint64(Seed);
+		}
+		else
+		{
+			writer.Key("Matches");
+			writer.StartArray();
+			for (const ScheduledMatch &Match : ListedMatches)
+			{
+				writer.StartArray();
+				writer.Uint(Match.Bot1);
+				writer.Uint(Match.Bot2);
+				writer.Uint(Match.Map);
+				writer.EndArray();
+			}
+			writer.EndArray();
+		}
+		writer.EndObject();
+	}
+	return ReplaceFileAtomically(TempFile, MatchupListFile);
+}
+
+void MatchupList::ResumeFromCursor()
+{
+	NextIndex = Cursor.GetPosition();
+	ResumeQueue.clear();
+	for (const auto &Started : Cursor.GetInFlight())
+	{
+		ResumeQueue.push_back(Started.first);
+	}
+	ResumedOpponents = Cursor.GetInFlight();
+}
+
+void MatchupList::StartPrefetch(size_t Depth)
+{
+	if (MatchUpProcess != MatchupListType::URL || Depth == 0 || PrefetchThread.joinable())
+	{
+		return;
+	}
+	PrefetchDepth = Depth;
+	PrefetchThread = std::thread(&MatchupList::PrefetchLoop, this);
+}
+
+void MatchupList::PrefetchLoop()
+{
+	std::unique_lock<std::mutex> Lock(PrefetchMutex);
+	while (!PrefetchStopping)
+	{
+		PrefetchCondition.wait(Lock, [this] { return PrefetchStopping || Prefetched.size() < PrefetchDepth; });
+		if (PrefetchStopping)
+		{
+			break;
+		}
+		Lock.unlock();
+		std::string Response = RequestMatchup();
+		Lock.lock();
+		if (Response.empty())
+		{
+			PrefetchFailed = true;
+			PrefetchCondition.notify_all();
+			break;
+		}
+		// Queued even when stopping, so its lease is released below.
+		Prefetched.push_back(std::move(Response));
+		PrefetchCondition.notify_all();
+	}
+}
+
+void MatchupList::StopPrefetch()
+{
+	if (!PrefetchThread.joinable())
+	{
+		return;
+	}
+	{
+		std::lock_guard<std::mutex> Lock(PrefetchMutex);
+		PrefetchStopping = true;
+	}
+	PrefetchCondition.notify_all();
+	PrefetchThread.join();
+	for (const std::string &Response : Prefetched)
+	{
+		ReleaseLease(Response);
+	}
+	Prefetched.clear();
+}
+
+void MatchupList::ReleaseLease(const std::string &Response)
+{
+	rapidjson::Document doc;
+	if (doc.Parse(Response.c_str()).HasParseError() || !doc.IsObject() || !doc.HasMember("LeaseId") || !doc["LeaseId"].IsString())
+	{
+		return;
+	}
+	ReleaseLeaseId(doc["LeaseId"].GetString());
+}
+
+void MatchupList::ReleaseLeaseId(const std::string &LeaseId)
+{
+	std::vector<HttpFormField> Fields;
+	Fields.emplace_back("Username", ServerUsername);
+	Fields.emplace_back("Password", ServerPassword);
+	Fields.emplace_back("Action", "release");
+	Fields.emplace_back("LeaseId", LeaseId);
+	HttpResponse Released;
+	if (!Http->PostForm(MatchupListFile, Fields, Released) || Released.StatusCode != 200)
+	{
+		PrintThread{} << "Unable to release matchup lease " << LeaseId << std::endl;
+	}
+}
+
+std::string MatchupList::RequestMatchup()
+{
+	std::vector<HttpFormField> Fields;
+	Fields.emplace_back("Username", ServerUsername);
+	Fields.emplace_back("Password", ServerPassword);
+	return Http->PostForm(MatchupListFile, Fields);
+}
+
+std::string MatchupList::TakeMatchup()
+{
+	if (!PrefetchThread.joinable())
+	{
+		return RequestMatchup();
+	}
+	std::unique_lock<std::mutex> Lock(PrefetchMutex);
+	PrefetchCondition.wait(Lock, [this] { return !Prefetched.empty() || PrefetchFailed; });
+	if (Prefetched.empty())
+	{
+		return std::string();
+	}
+	std::string ReturnString = std::move(Prefetched.front());
+	Prefetched.pop_front();
+	PrefetchCondition.notify_all();
+	return ReturnString;
+}
+
 bool MatchupList::GetNextMatchFromURL(Matchup &NextMatch)
 {
-	std::vector<std::string> arguments;
-	std::string argument = " -F Username=" + ServerUsername;
-	arguments.push_back(argument);
-	argument = " -F Password=" + ServerPassword;
-	arguments.push_back(argument);
-    std::string ReturnString = PerformRestRequest(MatchupListFile, arguments);
+	std::string ReturnString = TakeMatchup();
+	// A coordinator asks us to wait while matches handed to other workers may still come back.
+	for (int RetryAfter = GetRetryAfter(ReturnString); RetryAfter > 0; RetryAfter = GetRetryAfter(ReturnString))
+	{
+		SleepFor(RetryAfter);
+		ReturnString = TakeMatchup();
+	}
 //    ReturnString = "{\"Bot1\":{\"name\":\"Lambdanaut\", \"race\" : \"Zerg\", \"elo\" : \"1270\", \"playerid\" : \"ioa874jd\", \"checksum\" : \"8f10769e137259b23a73e0f1aea2c503\"}, \"Bot2\" : {\"name\":\"VeTerran\", \"race\" : \"Terran\", \"elo\" : \"1120\", \"playerid\" : \"sd9836f\", \"checksum\" : \"0a748c62d21fa8d2d412489d651a63d1\"}, \"Map\" : \"ParaSiteLE.SC2Map\"}";
 
 	rapidjson::Document doc;
@@ -224,7 +642,11 @@ bool MatchupList::GetNextMatchFromURL(Matchup &NextMatch)
 		const rapidjson::Value &Bot1Value = doc["Bot1"];
 		if (Bot1Value.HasMember("name") && Bot1Value["name"].IsString())
 		{
-			if(!AgentConfig->FindBot(Bot1Value["name"].GetString(), NextMatch.Agent1))
+			if (const BotConfig *KnownAgent = AgentConfig->FindBot(Bot1Value["name"].GetString()))
+			{
+				NextMatch.Agent1 = *KnownAgent;
+			}
+			else
 			{
                 BotConfig Agent1;
                 Agent1.BotName = Bot1Value["name"].GetString();
@@ -256,7 +678,11 @@ bool MatchupList::GetNextMatchFromURL(Matchup &NextMatch)
 		const rapidjson::Value &Bot2Value = doc["Bot2"];
 		if (Bot2Value.HasMember("name") && Bot2Value["name"].IsString())
 		{
-			if (!AgentConfig->FindBot(Bot2Value["name"].GetString(), NextMatch.Agent2))
+			if (const BotConfig *KnownAgent = AgentConfig->FindBot(Bot2Value["name"].GetString()))
+			{
+				NextMatch.Agent2 = *KnownAgent;
+			}
+			else
 			{
                 BotConfig Agent2;
                 Agent2.BotName = Bot2Value["name"].GetString();
@@ -280,11 +706,93 @@ bool MatchupList::GetNextMatchFromURL(Matchup &NextMatch)
 	if (doc.HasMember("Map") && doc["Map"].IsString())
 	{
 		NextMatch.Map = doc["Map"].GetString();
-		if (!isMapAvailable(NextMatch.Map,sc2Path))
+		if (!Catalog->IsAvailable(NextMatch.Map))
 		{
 			PrintThread{} << "Unable to find map: " + NextMatch.Map << std::endl;
 			return false;
 		}
 	}
+	NextMatch.LeaseId.clear();
+	if (doc.HasMember("LeaseId") && doc["LeaseId"].IsString())
+	{
+		NextMatch.LeaseId = doc["LeaseId"].GetString();
+		std::lock_guard<std::mutex> Lock(HeartbeatMutex);
+		ActiveLeases.insert(NextMatch.LeaseId);
+	}
 	return true;
 }
+
+int MatchupList::GetRetryAfter(const std::string &Response)
+{
+	rapidjson::Document doc;
+	if (doc.Parse(Response.c_str()).HasParseError() || !doc.IsObject() || !doc.HasMember("RetryAfter") || !doc["RetryAfter"].IsInt())
+	{
+		return 0;
+	}
+	return std::max(doc["RetryAfter"].GetInt(), 1);
+}
+
+void MatchupList::StartHeartbeat(int IntervalSeconds)
+{
+	if (MatchUpProcess != MatchupListType::URL || IntervalSeconds <= 0 || HeartbeatThread.joinable())
+	{
+		return;
+	}
+	HeartbeatInterval = IntervalSeconds;
+	HeartbeatThread = std::thread(&MatchupList::HeartbeatLoop, this);
+}
+
+void MatchupList::HeartbeatLoop()
+{
+	std::unique_lock<std::mutex> Lock(HeartbeatMutex);
+	while (!HeartbeatStopping)
+	{
+		HeartbeatCondition.wait_for(Lock, std::chrono::seconds(HeartbeatInterval), [this] { return HeartbeatStopping; });
+		if (HeartbeatStopping)
+		{
+			break;
+		}
+		const std::vector<std::string> Leases(ActiveLeases.begin(), ActiveLeases.end());
+		Lock.unlock();
+		for (const std::string &LeaseId : Leases)
+		{
+			std::vector<HttpFormField> Fields;
+			Fields.emplace_back("Username", ServerUsername);
+			Fields.emplace_back("Password", ServerPassword);
+			Fields.emplace_back("Action", "heartbeat");
+			Fields.emplace_back("LeaseId", LeaseId);
+			HttpResponse Renewed;
+			if (!Http->PostForm(MatchupListFile, Fields, Renewed) && Renewed.StatusCode == 410)
+			{
+				PrintThread{} << "Lease " << LeaseId << " ran out, its match may be played by another worker." << std::endl;
+				// Renewing it again is pointless, and its slot must not report for it any more.
+				std::lock_guard<std::mutex> Lost(HeartbeatMutex);
+				if (ActiveLeases.erase(LeaseId) > 0)
+				{
+					LostLeases.insert(LeaseId);
+				}
+			}
+		}
+		Lock.lock();
+	}
+}
+
+bool MatchupList::IsLeaseLost(const std::string &LeaseId)
+{
+	std::lock_guard<std::mutex> Lock(HeartbeatMutex);
+	return LostLeases.count(LeaseId) > 0;
+}
+
+void MatchupList::StopHeartbeat()
+{
+	if (!HeartbeatThread.joinable())
+	{
+		return;
+	}
+	{
+		std::lock_guard<std::mutex> Lock(HeartbeatMutex);
+		HeartbeatStopping = true;
+	}
+	HeartbeatCondition.notify_all();
+	HeartbeatThread.join();
+}
@@ -1,25 +1,124 @@
 #pragma once
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <map>
+#include <mutex>
+#include <set>
 #include <string>
+#include <thread>
 #include <vector>
 
+#include "ScheduleCursor.h"
+#include "SchedulePermutation.h"
+
 class AgentsConfig;
+class HttpClient;
+class MapCatalog;
+class PairingIndex;
+
+struct ScheduledMatch
+{
+    uint32_t Bot1;
+    uint32_t Bot2;
+    uint32_t Map;
+};
 
+// The file generator plays every ordered pair of bots on every map in random order.
+// Generated schedules are never materialised: match number i of the round robin is
+// found by a seeded bijective permutation of [0, bots * (bots - 1) * maps), so memory
+// use is O(bots + maps) regardless of the size of the ladder. A schedule imported from
+// a legacy matchup list is kept as a list of (bot, bot, map) indices.
+//
+// MatchupListFile holds the schedule definition and is only written when a schedule is
+// created. Progress is appended to MatchupListFile.cursor, one fsynced record when a
+// match starts and one when it is completed, so a restart continues with the matches
+// that were in flight, against the opponents they were started with, and then with the
+// next unplayed one.
 class MatchupList
 {
 public:
-	MatchupList(const std::string &inMatchupListFile, AgentsConfig *InAgentConfig, std::vector<std::string> &&MapList, const std::string& sc2Path, const std::string &GeneratorType, const std::string &InServerUsername, const std::string &InServerPassword);
+	MatchupList(const std::string &inMatchupListFile, AgentsConfig *InAgentConfig, HttpClient *InHttp, std::vector<std::string> &&MapList, const std::string& sc2Path, MapCatalog *InCatalog, const std::string &GeneratorType, const std::string &InServerUsername, const std::string &InServerPassword);
 	bool GenerateMatches(std::vector<std::string> &&Maps);
     bool GetNextMatchup(Matchup &NextMatch);
-    bool SaveMatchList();
+    bool CompleteMatch(const Matchup &Match);
+    // A match that was not played: a file schedule counts it as done, a server gets its lease back.
+    bool SkipMatch(const Matchup &Match);
+    // With a window set, a scheduled opponent outside the rating window is replaced by one inside it.
+    void SetRatingWindow(const PairingIndex *InPairing, int InMaxEloDiff);
+    // Keeps up to Depth server assigned matchups ready in the background (url generator only).
+    // A server may hand out a "LeaseId" with each matchup; unplayed leases are released on shutdown.
+    void StartPrefetch(size_t Depth);
+    // Renews the leases of handed out matches until they are completed (url generator only).
+    void StartHeartbeat(int IntervalSeconds);
+    // True once the server answered a heartbeat for the lease with 410: the match was handed to
+    // another worker, whose data and result the server keeps instead.
+    bool IsLeaseLost(const std::string &LeaseId);
+    ~MatchupList();
 
 private:
     const std::string MatchupListFile;
-    std::vector<Matchup> Matchups;
     AgentsConfig *AgentConfig;
+    HttpClient *Http;
     bool LoadMatchupList();
+    void LoadLegacyMatchupList(std::istream &ifs);
+    bool LoadSchedule(const std::string &Content);
+    bool SaveSchedule() const;
+    void GenerateSchedule(const std::vector<std::string> &Maps);
+    void SetGeneratedSize();
+    // Continues with the matches in flight and the next position of the cursor.
+    void ResumeFromCursor();
+    bool NextSchedulePosition(uint64_t &Position);
+    ScheduledMatch GetScheduledMatch(uint64_t Position) const;
+    size_t RemainingMatches() const;
+
+    std::vector<std::string> BotNames;
+    std::vector<std::string> MapNames;
+    std::vector<bool> MapAvailable;
+    // Matches of an imported list, in the order they are played.
+    std::vector<ScheduledMatch> ListedMatches;
+    bool Generated{false};
+    uint64_t ScheduleId{0};
+    uint64_t Seed{0};
+    uint64_t TotalMatches{0};
+    uint64_t NextIndex{0};
+    SchedulePermutation Order;
+    // Matches started before a restart but never completed.
+    std::deque<uint64_t> ResumeQueue;
+    // Opponents the resumed matches were started with, they are played against them again.
+    std::map<uint64_t, uint32_t> ResumedOpponents;
+    ScheduleCursor Cursor;
+    const PairingIndex *Pairing{nullptr};
+    int MaxEloDiff{0};
 	bool GetNextMatchFromURL(Matchup &NextMatch);
+    std::string TakeMatchup();
+    std::string RequestMatchup();
+    static int GetRetryAfter(const std::string &Response);
+    void HeartbeatLoop();
+    void StopHeartbeat();
+    void PrefetchLoop();
+    void StopPrefetch();
+    void ReleaseLease(const std::string &Response);
+    void ReleaseLeaseId(const std::string &LeaseId);
+
+    size_t PrefetchDepth{0};
+    std::deque<std::string> Prefetched;
+    std::mutex PrefetchMutex;
+    std::condition_variable PrefetchCondition;
+    std::thread PrefetchThread;
+    bool PrefetchStopping{false};
+    bool PrefetchFailed{false};
+
+    int HeartbeatInterval{0};
+    std::set<std::string> ActiveLeases;
+    std::set<std::string> LostLeases;
+    std::mutex HeartbeatMutex;
+    std::condition_variable HeartbeatCondition;
+    std::thread HeartbeatThread;
+    bool HeartbeatStopping{false};
 
 	const std::string sc2Path{""};
+    MapCatalog *Catalog;
     MatchupListType MatchUpProcess;
     std::string ServerUsername;
     std::string ServerPassword;
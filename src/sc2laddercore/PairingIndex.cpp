@@ -0,0 +1,102 @@
+#include "PairingIndex.h"
+
+#include <algorithm>
+#include <cstdlib>
+
+void PairingIndex::Update(const std::string &Bot, int Rating)
+{
+    const auto Known = Ratings.find(Bot);
+    if (Known != Ratings.end())
+    {
+        if (Known->second == Rating)
+        {
+            return;
+        }
+        Sorted.erase(std::lower_bound(Sorted.begin(), Sorted.end(), RatedBot(Known->second, Bot)));
+        Ratings.erase(Known);
+    }
+    if (Rating <= 0)
+    {
+        return;
+    }
+    const RatedBot Entry(Rating, Bot);
+    Sorted.insert(std::upper_bound(Sorted.begin(), Sorted.end(), Entry), Entry);
+    Ratings[Bot] = Rating;
+}
+
+void PairingIndex::Remove(const std::string &Bot)
+{
+    Update(Bot, 0);
+}
+
+bool PairingIndex::IsEligible(const std::string &Bot1, const std::string &Bot2, int MaxDiff) const
+{
+    if (MaxDiff <= 0)
+    {
+        return true;
+    }
+    const auto Rating1 = Ratings.find(Bot1);
+    const auto Rating2 = Ratings.find(Bot2);
+    if (Rating1 == Ratings.end() || Rating2 == Ratings.end())
+    {
+        return true;
+    }
+    return std::abs(Rating1->second - Rating2->second) <= MaxDiff;
+}
+
+bool PairingIndex::GetWindow(const std::string &Bot, int MaxDiff, std::vector<RatedBot>::const_iterator &First, std::vector<RatedBot>::const_iterator &Last) const
+{
+    const auto Known = Ratings.find(Bot);
+    if (Known == Ratings.end())
+    {
+        return false;
+    }
+    // Names compare greater than the empty string, so these bracket every bot of the boundary ratings.
+    First = std::lower_bound(Sorted.begin(), Sorted.end(), RatedBot(Known->second - MaxDiff, std::string()));
+    Last = std::lower_bound(First, Sorted.end(), RatedBot(Known->second + MaxDiff + 1, std::string()));
+    return true;
+}
+
+size_t PairingIndex::CountOpponents(const std::string &Bot, int MaxDiff) const
+{
+    std::vector<RatedBot>::const_iterator First, Last;
+    if (!GetWindow(Bot, MaxDiff, First, Last))
+    {
+        return 0;
+    }
+    // The window always contains the bot itself.
+    return static_cast<size_t>(Last - First) - 1;
+}
+
+bool PairingIndex::PickOpponent(const std::string &Bot, int MaxDiff, uint64_t Choice, std::string &Opponent) const
+{
+    std::vector<RatedBot>::const_iterator First, Last;
+    if (!GetWindow(Bot, MaxDiff, First, Last) || Last - First < 2)
+    {
+        return false;
+    }
+    const auto Self = std::lower_bound(First, Last, RatedBot(Ratings.at(Bot), Bot));
+    const size_t Candidates = static_cast<size_t>(Last - First) - 1;
+    auto Picked = First + static_cast<std::ptrdiff_t>(Choice % Candidates);
+    if (Picked >= Self)
+    {
+        ++Picked;
+    }
+    Opponent = Picked->second;
+    return true;
+}
+
+uint64_t PairingIndex::CountEligiblePairs(int MaxDiff) const
+{
+    uint64_t Pairs = 0;
+    size_t Last = 0;
+    for (size_t First = 0; First < Sorted.size(); ++First)
+    {
+        while (Last < Sorted.size() && Sorted[Last].first - Sorted[First].first <= MaxDiff)
+        {
+            ++Last;
+        }
+        Pairs += Last - First - 1;
+    }
+    return Pairs;
+}
@@ -0,0 +1,31 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+// Bots ordered by rating, so the opponents within a rating window of a bot
+// are a contiguous range found with two binary searches.
+// Bots without a rating (0 or less) are not indexed and may play anyone.
+class PairingIndex
+{
+public:
+    void Update(const std::string &Bot, int Rating);
+    void Remove(const std::string &Bot);
+
+    bool IsEligible(const std::string &Bot1, const std::string &Bot2, int MaxDiff) const;
+    size_t CountOpponents(const std::string &Bot, int MaxDiff) const;
+    // Picks opponent number Choice % CountOpponents() from the window of Bot.
+    bool PickOpponent(const std::string &Bot, int MaxDiff, uint64_t Choice, std::string &Opponent) const;
+    // Number of unordered pairs of rated bots within MaxDiff of each other.
+    uint64_t CountEligiblePairs(int MaxDiff) const;
+
+private:
+    typedef std::pair<int, std::string> RatedBot;
+    bool GetWindow(const std::string &Bot, int MaxDiff, std::vector<RatedBot>::const_iterator &First, std::vector<RatedBot>::const_iterator &Last) const;
+
+    std::vector<RatedBot> Sorted;
+    std::unordered_map<std::string, int> Ratings;
+};
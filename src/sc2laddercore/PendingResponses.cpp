@@ -0,0 +1,58 @@
+#include "PendingResponses.h"
+
+PendingResponses::PendingResponses(size_t maxPending)
+    : m_maxPending(maxPending)
+{
+}
+
+bool PendingResponses::canForward() const
+{
+    if (m_pending.empty())
+    {
+        return true;
+    }
+    if (m_pending.size() >= m_maxPending)
+    {
+        return false;
+    }
+    // Only the last request in flight may be one whose response the proxy acts on:
+    // an observation can make it surrender for the bot with a request of its own,
+    // a step or a game setup request changes the status and step time it checks.
+    switch (m_pending.back())
+    {
+    case SC2APIProtocol::Response::ResponseCase::kAction:
+    case SC2APIProtocol::Response::ResponseCase::kObsAction:
+    case SC2APIProtocol::Response::ResponseCase::kQuery:
+    case SC2APIProtocol::Response::ResponseCase::kDebug:
+    case SC2APIProtocol::Response::ResponseCase::kGameInfo:
+    case SC2APIProtocol::Response::ResponseCase::kData:
+    case SC2APIProtocol::Response::ResponseCase::kPing:
+        return true;
+    default:
+        return false;
+    }
+}
+
+void PendingResponses::push(ResponseCase expected)
+{
+    m_pending.push_back(expected);
+}
+
+PendingResponses::ResponseCase PendingResponses::pop()
+{
+    const ResponseCase oldest = m_pending.front();
+    m_pending.pop_front();
+    return oldest;
+}
+
+void PendingResponses::drain(const std::function<bool(ResponseCase)>& receive)
+{
+    while (!m_pending.empty())
+    {
+        if (!receive(pop()))
+        {
+            m_pending.clear();
+            return;
+        }
+    }
+}
@@ -0,0 +1,33 @@
+#pragma once
+
+#include <cstddef>
+#include <deque>
+#include <functional>
+
+#include "s2clientprotocol/sc2api.pb.h"
+
+// Responses the client still owes for the requests a proxy forwarded to it, oldest first,
+// and the policy which requests of a bot may be written behind ones that are still unanswered.
+class PendingResponses
+{
+ public:
+    using ResponseCase = SC2APIProtocol::Response::ResponseCase;
+
+    explicit PendingResponses(size_t maxPending);
+
+    // True if the next request of the bot may be written to the client now.
+    bool canForward() const;
+    void push(ResponseCase expected);
+    // The response case of the oldest request, which is no longer pending afterwards.
+    ResponseCase pop();
+    // Hands every pending response case to receive, oldest first. Stops and forgets the rest
+    // once receive returns false. Afterwards the proxy may send requests of its own.
+    void drain(const std::function<bool(ResponseCase)>& receive);
+
+    bool empty() const { return m_pending.empty(); }
+    size_t size() const { return m_pending.size(); }
+
+ private:
+    std::deque<ResponseCase> m_pending{};
+    const size_t m_maxPending;
+};
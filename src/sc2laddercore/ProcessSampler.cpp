@@ -0,0 +1,104 @@
+#include "ProcessSampler.h"
+
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+#include <string>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <unistd.h>
+#endif
+
+namespace {
+
+#ifdef __linux__
+// Reads utime + stime (in clock ticks) and the resident set (in pages) from /proc/<pid>/stat.
+bool ReadProcessStat(unsigned long ProcessId, uint64_t &CpuTicks, uint64_t &RssPages)
+{
+    std::ifstream StatFile("/proc/" + std::to_string(ProcessId) + "/stat");
+    std::string Stat;
+    if (!std::getline(StatFile, Stat))
+    {
+        return false;
+    }
+    // The command name may contain spaces, the fields after it start behind the last ')'.
+    const size_t NameEnd = Stat.rfind(')');
+    if (NameEnd == std::string::npos)
+    {
+        return false;
+    }
+    std::istringstream Fields(Stat.substr(NameEnd + 2));
+    std::string Field;
+    uint64_t UserTicks = 0;
+    uint64_t SystemTicks = 0;
+    // Field 3 (state) is the first one here, utime and stime are fields 14 and 15, rss is field 24.
+    for (int Index = 3; Index <= 24 && Fields >> Field; ++Index)
+    {
+        if (Index == 14)
+        {
+            UserTicks = std::stoull(Field);
+        }
+        else if (Index == 15)
+        {
+            SystemTicks = std::stoull(Field);
+        }
+        else if (Index == 24)
+        {
+            CpuTicks = UserTicks + SystemTicks;
+            RssPages = std::stoull(Field);
+            return true;
+        }
+    }
+    return false;
+}
+#endif
+
+} // namespace
+
+ProcessSampler::ProcessSampler()
+    : SampledProcess(0)
+    , LastCpuTicks(0)
+    , PeakCpuPercent(0.0f)
+    , RssSum(0)
+    , Samples(0)
+{
+}
+
+void ProcessSampler::Sample(unsigned long ProcessId)
+{
+#ifdef __linux__
+    uint64_t CpuTicks = 0;
+    uint64_t RssPages = 0;
+    if (ProcessId == 0 || !ReadProcessStat(ProcessId, CpuTicks, RssPages))
+    {
+        return;
+    }
+    static const long TicksPerSecond = sysconf(_SC_CLK_TCK);
+    static const long PageSize = sysconf(_SC_PAGESIZE);
+    const auto Now = std::chrono::steady_clock::now();
+    // The cpu use is the difference to the previous sample of the same process.
+    if (SampledProcess == ProcessId && CpuTicks >= LastCpuTicks)
+    {
+        const double Seconds = std::chrono::duration<double>(Now - LastSampleTime).count();
+        if (Seconds > 0.0)
+        {
+            const float CpuPercent = static_cast<float>((CpuTicks - LastCpuTicks) * 100.0 / TicksPerSecond / Seconds);
+            PeakCpuPercent = std::max(PeakCpuPercent, CpuPercent);
+        }
+    }
+    SampledProcess = ProcessId;
+    LastCpuTicks = CpuTicks;
+    LastSampleTime = Now;
+    RssSum += RssPages * static_cast<uint64_t>(PageSize);
+    ++Samples;
+#else
+    (void)ProcessId;
+#endif
+}
+
+void ProcessSampler::AddTo(ResourceUsage &Usage) const
+{
+    Usage.PeakCpuPercent = PeakCpuPercent;
+    Usage.AverageRssBytes = Samples > 0 ? RssSum / Samples : 0;
+    Usage.Samples = Samples;
+}
@@ -0,0 +1,28 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+
+#include "Types.h"
+
+// Samples the cpu time and resident memory of a running process from /proc,
+// to see how a bot's load develops over a game and not only its totals.
+// Does nothing on platforms without /proc.
+class ProcessSampler
+{
+public:
+    ProcessSampler();
+
+    // Called periodically while the game runs, ProcessId 0 is skipped.
+    void Sample(unsigned long ProcessId);
+    // Fills the sampled fields of Usage.
+    void AddTo(ResourceUsage &Usage) const;
+
+private:
+    unsigned long SampledProcess;
+    uint64_t LastCpuTicks;
+    std::chrono::steady_clock::time_point LastSampleTime;
+    float PeakCpuPercent;
+    uint64_t RssSum;
+    uint32_t Samples;
+};
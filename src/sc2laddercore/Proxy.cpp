@@ -1,5 +1,6 @@
 #include "Proxy.h"
 
+#include <algorithm>
 #include <fstream>
 
 #include "Tools.h"
@@ -7,29 +8,54 @@
 #include "sc2utils/sc2_manage_process.h"
 
 
-bool Proxy::m_mapAlreadyLoaded{false};
-
-
 
 Proxy::Proxy(const uint32_t maxGameLoops, const uint32_t maxRealGameTime, const BotConfig& botConfig):
     m_maxGameLoops(maxGameLoops)
   , m_maxRealGameTime(maxRealGameTime)
   , m_botConfig(botConfig)
+  , m_logContext(CurrentLogContext())
 {
+    // The game update thread logs with the match of the thread that created the proxy.
+    m_logContext.Bot = m_botConfig.BotName;
 }
 
 Proxy::~Proxy()
 {
-    // Set it back to false for the match after this one.
-    m_mapAlreadyLoaded = false;
+    stopBot();
+    if (m_gameClientPid)
+    {
+        if (!sc2::TerminateProcess(m_gameClientPid))
+        {
+            PrintThread{} << m_botConfig.BotName << " : Terminating SC2 failed!" << std::endl;
+        }
+        sc2::SleepFor(5000);
+    }
+}
+void Proxy::startSC2Instance(const sc2::ProcessSettings& processSettings, const int portServer, const int portClient)
+{
+    // magic numbers
+    m_server.Listen(std::to_string(portServer).c_str(), "100000", "100000", "5");
 
+    m_gameClientPid = sc2::StartProcess(processSettings.process_path,
+        { "-listen", m_localHost,
+          "-port", std::to_string(portClient),
+          "-displayMode", "0",
+          "-dataVersion", processSettings.data_version });
+    if (m_clientGroup != nullptr && !m_clientGroup->AddProcess(m_gameClientPid) && m_clientGroup->IsActive())
+    {
+        PrintThread{} << m_botConfig.BotName << " : Unable to move the StarCraft II client into " << m_clientGroup->GetPath() << std::endl;
+    }
+}
+
+void Proxy::stopBot()
+{
     // Check if the bot is still running.
     const auto start = clock::now();
     std::chrono::duration<double> elapsedSeconds{0};
     std::future_status botProgStatus{std::future_status::deferred};
     // toDo: add to config?
     constexpr auto maxWaitTime{20};
-    if (m_botProgramThread.valid())
+    if (m_botProgramThread.valid() && !m_botStopped)
     {
         while (elapsedSeconds.count() < maxWaitTime)
         {
@@ -46,27 +72,51 @@ Proxy::~Proxy()
             PrintThread{} << m_botConfig.BotName << " : Bot is still running after " << maxWaitTime << " seconds. Sending kill signal." << std::endl;
             KillBotProcess(m_botThreadId);
         }
+        m_botStopped = true;
         sc2::SleepFor(5000);
     }
-    if (m_gameClientPid)
+}
+
+unsigned long Proxy::botProcessId() const
+{
+    return m_botThreadId;
+}
+
+ResourceUsage Proxy::botUsage() const
+{
+    // The bot thread writes the usage when the bot exits.
+    if (m_botProgramThread.valid() && m_botProgramThread.wait_for(std::chrono::seconds(0)) == std::future_status::ready)
     {
-        if (!sc2::TerminateProcess(m_gameClientPid))
-        {
-            PrintThread{} << m_botConfig.BotName << " : Terminating SC2 failed!" << std::endl;
-        }
-        sc2::SleepFor(5000);
+        return m_botUsage;
     }
+    return ResourceUsage();
 }
-void Proxy::startSC2Instance(const sc2::ProcessSettings& processSettings, const int portServer, const int portClient)
+
+void Proxy::setComputerOpponent(const sc2::Difficulty difficulty)
 {
-    // magic numbers
-    m_server.Listen(std::to_string(portServer).c_str(), "100000", "100000", "5");
+    m_vsComputer = true;
+    m_computerDifficulty = difficulty;
+}
 
-    m_gameClientPid = sc2::StartProcess(processSettings.process_path,
-        { "-listen", m_localHost,
-          "-port", std::to_string(portClient),
-          "-displayMode", "0",
-          "-dataVersion", processSettings.data_version });
+void Proxy::setRandomSeed(const uint32_t randomSeed)
+{
+    m_randomSeed = randomSeed;
+}
+
+void Proxy::setKeepStepTimes(const bool keepStepTimes)
+{
+    m_keepStepTimes = keepStepTimes;
+}
+
+void Proxy::setJoinsGame()
+{
+    m_joinsGame = true;
+}
+
+void Proxy::setResourceGroups(const ResourceGroup* botGroup, const ResourceGroup* clientGroup)
+{
+    m_botGroup = botGroup;
+    m_clientGroup = clientGroup;
 }
 
 bool Proxy::ConnectToSC2Instance(const sc2::ProcessSettings& processSettings, const int portServer, const int portClient)
@@ -96,11 +146,11 @@ bool Proxy::ConnectToSC2Instance(const sc2::ProcessSettings& processSettings, co
 }
 
 // Technically, we only need opponents race. But I think it looks clearer on the caller side with both races.
-bool Proxy::setupGame(const sc2::ProcessSettings& processSettings, const std::string& map, const bool realTimeMode, const sc2::Race bot1Race, const sc2::Race bot2Race)
+bool Proxy::setupGame(const std::string& map, const bool realTimeMode, const sc2::Race bot1Race, const sc2::Race bot2Race)
 {
     m_realTimeMode = realTimeMode;
     // Only one client needs to / is allowed to send the create game request.
-    if (m_mapAlreadyLoaded)
+    if (m_joinsGame)
     {
         return true;
     }
@@ -117,9 +167,17 @@ bool Proxy::setupGame(const sc2::ProcessSettings& processSettings, const std::st
 
     // Player 2
     playerSetup = requestCreateGame->add_player_setup();
-    playerSetup->set_type(SC2APIProtocol::PlayerType::Participant);
     playerSetup->set_race(SC2APIProtocol::Race(static_cast<int>(bot2Race) + 1));
-    playerSetup->set_difficulty(SC2APIProtocol::Difficulty::VeryEasy);
+    if (m_vsComputer)
+    {
+        playerSetup->set_type(SC2APIProtocol::PlayerType::Computer);
+        playerSetup->set_difficulty(SC2APIProtocol::Difficulty(static_cast<int>(m_computerDifficulty)));
+    }
+    else
+    {
+        playerSetup->set_type(SC2APIProtocol::PlayerType::Participant);
+        playerSetup->set_difficulty(SC2APIProtocol::Difficulty::VeryEasy);
+    }
 
     // Map
     // BattleNet map
@@ -129,39 +187,16 @@ bool Proxy::setupGame(const sc2::ProcessSettings& processSettings, const std::st
     }
     else
     {
-        // Local map file
-        SC2APIProtocol::LocalMap* const localMap = requestCreateGame->mutable_local_map();
-        // Absolute path
-        if (sc2::DoesFileExist(map))
-        {
-            localMap->set_map_path(map);
-        }
-        else
-        {
-            // Relative path - Game maps directory
-            const std::string gameRelative = sc2::GetGameMapsDirectory(processSettings.process_path) + map;
-            if (sc2::DoesFileExist(gameRelative))
-            {
-                localMap->set_map_path(map);
-            }
-            else
-            {
-                // Relative path - Library maps directory
-                const std::string libraryRelative = sc2::GetLibraryMapsDirectory() + map;
-                if (sc2::DoesFileExist(libraryRelative))
-                {
-                    localMap->set_map_path(libraryRelative);
-                }
-                else
-                {
-                    return false;
-                }
-            }
-        }
+        // Local map file, already looked up by the caller.
+        requestCreateGame->mutable_local_map()->set_map_path(map);
     }
 
     // Real time mode
     requestCreateGame->set_realtime(realTimeMode);
+    if (m_randomSeed != 0U)
+    {
+        requestCreateGame->set_random_seed(m_randomSeed);
+    }
 
     // Send the request
     m_client.Send(request.get());
@@ -172,7 +207,6 @@ bool Proxy::setupGame(const sc2::ProcessSettings& processSettings, const std::st
     {
         return false;
     }
-    m_mapAlreadyLoaded = true;
     return true;
 }
 
@@ -183,7 +217,7 @@ bool Proxy::startBot(const int portServer, const int portStart, const std::strin
     {
         return false;
     }
-    m_botProgramThread = std::async(std::launch::async, &StartBotProcess, m_botConfig, botStartCommand, &m_botThreadId);
+    m_botProgramThread = std::async(std::launch::async, &StartBotProcess, m_botConfig, botStartCommand, &m_botThreadId, m_botGroup, &m_botUsage);
     if (m_botProgramThread.wait_for(std::chrono::seconds(2)) == std::future_status::ready)
     {
         return false;
@@ -210,6 +244,11 @@ bool Proxy::gameFinished() const
     return std::future_status::ready == m_gameUpdateThread.wait_for(std::chrono::seconds(0));
 }
 
+uint32_t Proxy::currentGameLoop() const
+{
+    return m_currentGameLoop;
+}
+
 ExitCase Proxy::getResult() const
 {
     return m_result;
@@ -285,6 +324,11 @@ std::string Proxy::getBotCommandLine(const int gamePort, const int startPort, co
 
 void Proxy::gameUpdate()
 {
+    LogScope logScope(m_logContext);
+    if (m_clientGroup != nullptr)
+    {
+        m_clientGroup->PinCurrentThread();
+    }
     PrintThread{} << "Starting proxy for " << m_botConfig.BotName << std::endl;
     // toDo: somehow check if the other functions were already used.
 
@@ -314,7 +358,7 @@ void Proxy::gameUpdate()
             }
         }
 
-        if (m_server.HasRequest())
+        if (m_server.HasRequest() && m_pendingResponses.canForward())
         {
             const sc2::RequestData& request = m_server.PeekRequest();
             // Analyse request
@@ -331,48 +375,20 @@ void Proxy::gameUpdate()
             // Forward the valid request
             // The cast puts a lot of trust in Blizzard
             const auto expectedResponseCase = static_cast<SC2APIProtocol::Response::ResponseCase>(request.second->request_case());
-            m_server.SendRequest(m_client.connection_);
-
-            // Block for sc2's response then queue it.
-            SC2APIProtocol::Response* response = receiveResponse(expectedResponseCase);
-            const bool validResponse = processResponse(response);
-
-            if (!validResponse)
+            if (!m_pendingResponses.empty())
             {
-                m_result = ExitCase::Error;
-                break;
-            }
-            // Send the response back to the client.
-            if (!m_server.connections_.empty() && m_client.connection_ != nullptr)
-            {
-                m_server.QueueResponse(m_client.connection_, response);
-                m_server.SendResponse();
+                ++m_stats.pipelinedRequests;
             }
-            else
+            m_server.SendRequest(m_client.connection_);
+            // The client answers in order. Requests the bot has already sent are written
+            // right behind this one before its response is read.
+            m_pendingResponses.push(expectedResponseCase);
+        }
+        else if (!m_pendingResponses.empty())
+        {
+            // Block for sc2's response to the oldest request then queue it.
+            if (!forwardResponse())
             {
-                // This usually happens if the bot crashed.
-                // Check if the bot thread has send the crashed signal aka ready signal.
-                if (isBotCrashed(1000))
-                {
-                    PrintThread{} << m_botConfig.BotName << " : crashed." << std::endl;
-                    m_result = ExitCase::BotCrashed;
-                    continue;
-                }
-                // Maybe it is the client ?
-                if (isClientCrashed(1000))
-                {
-                    PrintThread{} << m_botConfig.BotName << " : crashed." << std::endl;
-                }
-                // toDo: Are there other cases when this happens?
-                if (m_server.connections_.empty())
-                {
-                    PrintThread{} << m_botConfig.BotName << " : Response: m_server.connections_.empty()" << std::endl;
-                }
-                else
-                {
-                    PrintThread{} << m_botConfig.BotName << " : Response: m_client.connection_ == nullptr" << std::endl;
-                }
-                m_result = ExitCase::Error;
                 break;
             }
         }
@@ -433,6 +449,8 @@ void Proxy::gameUpdate()
         }
     }
 
+    // The bot gets the responses that were still on their way, the proxy then asks for the result.
+    drainResponses();
     if (m_result == ExitCase::Unknown)
     {
         // The game ended normally for this bot. Get the result from the observation.
@@ -464,7 +482,7 @@ void Proxy::gameUpdate()
     }
     m_stats.avgLoopDuration = std::chrono::duration_cast<std::chrono::milliseconds>(m_totalTime).count()/static_cast<float>(m_currentGameLoop);
     m_stats.gameLoops = m_currentGameLoop;
-    PrintThread{} << m_botConfig.BotName << " : Exiting with " << GetExitCaseString(m_result) << " Average step time " << m_stats.avgLoopDuration << " microseconds, total time: " << std::chrono::duration_cast<std::chrono::seconds>(m_totalTime).count() << " seconds, game loops: " << m_currentGameLoop << std::endl;
+    PrintThread{} << m_botConfig.BotName << " : Exiting with " << GetExitCaseString(m_result) << " Average step time " << m_stats.avgLoopDuration << " microseconds, total time: " << std::chrono::duration_cast<std::chrono::seconds>(m_totalTime).count() << " seconds, game loops: " << m_currentGameLoop << ", step time deviation " << m_stats.stepTimeDeviation() << " microseconds, " << m_stats.pipelinedRequests << " requests pipelined" << std::endl;
 }
 
 bool Proxy::isBotCrashed(const int milliseconds) const
@@ -484,6 +502,14 @@ bool Proxy::processRequest(const sc2::RequestData& request)
 {
     if (request.second)
     {
+        if (request.second->has_join_game() && m_vsComputer)
+        {
+            // There is no second client to connect to, the bot joins a single player game.
+            SC2APIProtocol::RequestJoinGame* joinGame = request.second->mutable_join_game();
+            joinGame->clear_shared_port();
+            joinGame->clear_server_ports();
+            joinGame->clear_client_ports();
+        }
         if (request.second->has_quit())
         {
             // Intercept quit requests, we want to keep game alive to save replays.
@@ -512,12 +538,85 @@ bool Proxy::processRequest(const sc2::RequestData& request)
         }
         else if (request.second->has_step() && m_currentGameLoop)
         {
-            m_totalTime += clock::now() - m_lastResponseSendTime;
+            const auto stepTime = clock::now() - m_lastResponseSendTime;
+            m_totalTime += stepTime;
+            const double stepMicroseconds = static_cast<double>(std::chrono::duration_cast<std::chrono::microseconds>(stepTime).count());
+            ++m_stats.steps;
+            const double delta = stepMicroseconds - m_stats.stepTimeMean;
+            m_stats.stepTimeMean += delta / m_stats.steps;
+            m_stats.stepTimeM2 += delta * (stepMicroseconds - m_stats.stepTimeMean);
+            if (m_keepStepTimes)
+            {
+                m_stats.stepTimes.push_back(static_cast<uint32_t>(std::min(stepMicroseconds, 4294967295.0)));
+            }
         }
     }
     return true;
 }
 
+bool Proxy::forwardResponse()
+{
+    const auto expectedResponseCase = m_pendingResponses.pop();
+    SC2APIProtocol::Response* response = receiveResponse(expectedResponseCase);
+    const bool validResponse = processResponse(response);
+
+    if (!validResponse)
+    {
+        m_result = ExitCase::Error;
+        return false;
+    }
+    // Send the response back to the client.
+    if (!m_server.connections_.empty() && m_client.connection_ != nullptr)
+    {
+        m_server.QueueResponse(m_client.connection_, response);
+        m_server.SendResponse();
+        return true;
+    }
+    // This usually happens if the bot crashed.
+    // Check if the bot thread has send the crashed signal aka ready signal.
+    if (isBotCrashed(1000))
+    {
+        PrintThread{} << m_botConfig.BotName << " : crashed." << std::endl;
+        m_result = ExitCase::BotCrashed;
+        return true;
+    }
+    // Maybe it is the client ?
+    if (isClientCrashed(1000))
+    {
+        PrintThread{} << m_botConfig.BotName << " : crashed." << std::endl;
+    }
+    // toDo: Are there other cases when this happens?
+    if (m_server.connections_.empty())
+    {
+        PrintThread{} << m_botConfig.BotName << " : Response: m_server.connections_.empty()" << std::endl;
+    }
+    else
+    {
+        PrintThread{} << m_botConfig.BotName << " : Response: m_client.connection_ == nullptr" << std::endl;
+    }
+    m_result = ExitCase::Error;
+    return false;
+}
+
+void Proxy::drainResponses()
+{
+    // The outcome for the bot is already decided, so the responses are only passed on.
+    m_pendingResponses.drain([this](SC2APIProtocol::Response::ResponseCase responseCase)
+    {
+        SC2APIProtocol::Response* response = receiveResponse(responseCase);
+        if (response == nullptr)
+        {
+            return false;
+        }
+        if (!m_server.connections_.empty() && m_client.connection_ != nullptr)
+        {
+            m_server.QueueResponse(m_client.connection_, response);
+            m_server.SendResponse();
+        }
+        return true;
+    });
+}
+
 bool Proxy::processResponse(SC2APIProtocol::Response* const response)
 {
     if (response == nullptr)
@@ -578,6 +677,8 @@ bool Proxy::processResponse(SC2APIProtocol::Response* const response)
 void Proxy::terminateGame()
 {
     PrintThread{} << m_botConfig.BotName << " : surrender." << std::endl;
+    // The client answers in order, so the surrender must not overtake the bot's requests.
+    drainResponses();
     sc2::ProtoInterface proto;
     sc2::GameRequestPtr request = proto.MakeRequest();
 
@@ -725,6 +826,7 @@ const Stats& Proxy::stats() const
 
 SC2APIProtocol::Result Proxy::getGameResult()
 {
+    drainResponses();
     sc2::ProtoInterface proto;
     sc2::GameRequestPtr request = proto.MakeRequest();
 
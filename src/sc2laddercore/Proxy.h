@@ -1,8 +1,13 @@
 #pragma once
 
 #include "AgentsConfig.h"
+#include "PendingResponses.h"
+#include "ResourceGroup.h"
 
+#include <atomic>
+#include <cmath>
 #include <string>
+#include <vector>
 #include <future>
 
 #include "sc2api/sc2_game_settings.h"
@@ -14,6 +19,17 @@ struct Stats
 {
     float avgLoopDuration{0.0f};
     size_t gameLoops{0U};
+    // Time the bot takes per step in microseconds, mean and sum of squared deviations (Welford).
+    size_t steps{0U};
+    double stepTimeMean{0.0};
+    double stepTimeM2{0.0};
+    std::vector<uint32_t> stepTimes;
+    // Requests written to the client while it had not answered an earlier one yet.
+    size_t pipelinedRequests{0U};
+    double stepTimeDeviation() const
+    {
+        return steps > 1 ? std::sqrt(stepTimeM2 / (steps - 1)) : 0.0;
+    }
     // Fill this with more stats
     // time for first Loop
     // number of actions
@@ -27,21 +43,33 @@ class Proxy
     uint64_t m_gameClientPid{0UL};
 
     // Game
-    static bool m_mapAlreadyLoaded;
+    // The other player's client creates the game, this one only joins it.
+    bool m_joinsGame{false};
     const uint32_t m_maxGameLoops{0U};
     const uint32_t m_maxRealGameTime{0U};  // sec
-    uint32_t m_currentGameLoop{0U};
+    // Written by the game update thread, read by whoever watches the match.
+    std::atomic<uint32_t> m_currentGameLoop{0U};
     uint32_t m_surrenderLoop{0U};
     SC2APIProtocol::Status m_gameStatus{SC2APIProtocol::Status::unknown};
     std::future<void> m_gameUpdateThread{};
+    PendingResponses m_pendingResponses{m_maxPendingResponses};
     ExitCase m_result{ExitCase::Unknown};
     bool m_realTimeMode{false};
+    bool m_vsComputer{false};
+    uint32_t m_randomSeed{0U};
+    bool m_keepStepTimes{false};
+    sc2::Difficulty m_computerDifficulty{sc2::Difficulty::Easy};
 
     // Bot
     const BotConfig m_botConfig{};
     std::future<void> m_botProgramThread{};
     unsigned long m_botThreadId{0};
+    ResourceUsage m_botUsage{};
+    bool m_botStopped{false};
     bool m_usedDebugInterface{false};
+    LogContext m_logContext{};
+    const ResourceGroup* m_botGroup{nullptr};
+    const ResourceGroup* m_clientGroup{nullptr};
 
     // stats
     Stats m_stats{};
@@ -53,6 +81,7 @@ class Proxy
     // constants
     static constexpr auto m_localHost{"127.0.0.1"};  // is there a way to get this without hardcoding?
     static constexpr int m_responseTimeOutMS{100000};
+    static constexpr size_t m_maxPendingResponses{32U};
 
 
     bool createGameHasErrors(const SC2APIProtocol::ResponseCreateGame& createGameResponse) const;
@@ -61,6 +90,11 @@ class Proxy
     bool isClientCrashed(const int milliseconds) const;
     bool processRequest(const sc2::RequestData& request);
     bool processResponse(SC2APIProtocol::Response* const response);
+    // Reads the response to the oldest forwarded request and sends it to the bot.
+    // Returns false if the game can not go on, m_result says why.
+    bool forwardResponse();
+    // Waits for all outstanding responses, the proxy may then send requests of its own.
+    void drainResponses();
     void gameUpdate();
     void terminateGame();
     void doAStep();
@@ -75,12 +109,30 @@ class Proxy
     Proxy(const uint32_t maxGameLoops, const uint32_t maxRealGameTime, const BotConfig& botConfig);
 
     bool ConnectToSC2Instance(const sc2::ProcessSettings & processSettings, const int portServer, const int portClient);
+    // Set before the client and the bot are started, the groups have to outlive the proxy.
+    void setResourceGroups(const ResourceGroup* botGroup, const ResourceGroup* clientGroup);
+    // Makes the second player of the game the built-in AI, set before setupGame.
+    void setComputerOpponent(const sc2::Difficulty difficulty);
+    // Games with the same seed play out the same way if the bots do, 0 for a random game.
+    void setRandomSeed(const uint32_t randomSeed);
+    // Keeps every step time in stats().stepTimes, which grows with the game, for the benchmark report.
+    void setKeepStepTimes(const bool keepStepTimes);
+    // Only one client of a game sends the create game request, setupGame of the other does nothing.
+    void setJoinsGame();
     void startSC2Instance(const sc2::ProcessSettings& processSettings, const int portServer, const int portClient);
-    bool setupGame(const sc2::ProcessSettings& processSettings, const std::string& map, const bool realTimeMode, const sc2::Race bot1Race, const sc2::Race bot2Race);
+    // map is the name of a Battle.net map or the path of a local map file.
+    bool setupGame(const std::string& map, const bool realTimeMode, const sc2::Race bot1Race, const sc2::Race bot2Race);
     bool startBot(const int portServer, const int portStart, const std::string & opponentPlayerId);
     void startGame();
 
     bool gameFinished() const;
+    // Game loop of the last observation, while the game is running.
+    uint32_t currentGameLoop() const;
+    // Waits for the bot to exit after the game and kills it if it does not.
+    void stopBot();
+    unsigned long botProcessId() const;
+    // Usage of the bot process, measured once it has exited.
+    ResourceUsage botUsage() const;
     bool saveReplay(const std::string& replayFile);
     ExitCase getResult() const;
     const Stats& stats() const;
@@ -0,0 +1,181 @@
+#include "RatingEngine.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <fstream>
+#include <sstream>
+
+#define RAPIDJSON_HAS_STDSTRING 1
+#include "rapidjson.h"
+#include "document.h"
+#include "ostreamwrapper.h"
+#include "prettywriter.h"
+
+#include "AgentsConfig.h"
+#include "Tools.h"
+
+RatingEngine::RatingEngine(const std::string &InRatingsFile, int InKFactor, int InInitialRating)
+    : RatingsFile(InRatingsFile)
+    , KFactor(InKFactor > 0 ? InKFactor : 32)
+    , InitialRating(InInitialRating > 0 ? InInitialRating : 1200)
+    , ResultCount(0)
+{
+}
+
+void RatingEngine::Initialize(const ResultStore &Results)
+{
+    if (Load() && ResultCount == Results.Size())
+    {
+        PrintThread{} << "Loaded ratings of " << Names.size() << " bots from " << RatingsFile << std::endl;
+        return;
+    }
+    Recompute(Results);
+    Save();
+}
+
+void RatingEngine::Recompute(const ResultStore &Results)
+{
+    const auto Start = std::chrono::steady_clock::now();
+    // Flatten the history into plain arrays first, so the rating pass itself
+    // is a tight loop over integers without any string handling.
+    std::vector<uint32_t> Bot1Ids, Bot2Ids;
+    std::vector<float> Scores;
+    std::lock_guard<std::mutex> Lock(RatingsMutex);
+    Results.ForEach([&](const std::string &Bot1, const std::string &Bot2, ResultStore::Outcome Outcome)
+    {
+        if (Outcome == ResultStore::Errored)
+        {
+            return;
+        }
+        Bot1Ids.push_back(GetId(Bot1));
+        Bot2Ids.push_back(GetId(Bot2));
+        Scores.push_back(Outcome == ResultStore::Bot1Won ? 1.0f : Outcome == ResultStore::Bot2Won ? 0.0f : 0.5f);
+    });
+    ResultCount = Results.Size();
+    std::fill(Ratings.begin(), Ratings.end(), InitialRating);
+    std::fill(Games.begin(), Games.end(), 0);
+    for (size_t i = 0; i < Scores.size(); ++i)
+    {
+        Rate(Bot1Ids[i], Bot2Ids[i], Scores[i]);
+    }
+    const auto Elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - Start);
+    PrintThread{} << "Computed ratings of " << Names.size() << " bots from " << Scores.size() << " games in " << Elapsed.count() << "ms" << std::endl;
+}
+
+void RatingEngine::Update(const std::string &Bot1, const std::string &Bot2, ResultStore::Outcome Outcome)
+{
+    std::lock_guard<std::mutex> Lock(RatingsMutex);
+    ++ResultCount;
+    if (Outcome == ResultStore::Errored)
+    {
+        return;
+    }
+    const uint32_t Bot1Id = GetId(Bot1);
+    const uint32_t Bot2Id = GetId(Bot2);
+    Rate(Bot1Id, Bot2Id, Outcome == ResultStore::Bot1Won ? 1.0 : Outcome == ResultStore::Bot2Won ? 0.0 : 0.5);
+}
+
+void RatingEngine::Rate(uint32_t Bot1, uint32_t Bot2, double Score)
+{
+    if (Bot1 == Bot2)
+    {
+        return;
+    }
+    const double Expected = 1.0 / (1.0 + std::pow(10.0, (Ratings[Bot2] - Ratings[Bot1]) / 400.0));
+    const double Change = KFactor * (Score - Expected);
+    Ratings[Bot1] += Change;
+    Ratings[Bot2] -= Change;
+    ++Games[Bot1];
+    ++Games[Bot2];
+}
+
+uint32_t RatingEngine::GetId(const std::string &Bot)
+{
+    auto Inserted = Ids.emplace(Bot, static_cast<uint32_t>(Names.size()));
+    if (Inserted.second)
+    {
+        Names.push_back(Bot);
+        Ratings.push_back(InitialRating);
+        Games.push_back(0);
+    }
+    return Inserted.first->second;
+}
+
+int RatingEngine::GetRating(const std::string &Bot) const
+{
+    std::lock_guard<std::mutex> Lock(RatingsMutex);
+    const auto Found = Ids.find(Bot);
+    return static_cast<int>(std::lround(Found != Ids.end() ? Ratings[Found->second] : InitialRating));
+}
+
+void RatingEngine::Apply(AgentsConfig &Agents) const
+{
+    for (BotHandle Handle = 0; Handle < Agents.GetBots().size(); ++Handle)
+    {
+        Agents.SetELO(Handle, GetRating(Agents.GetBot(Handle).BotName));
+    }
+}
+
+bool RatingEngine::Load()
+{
+    std::ifstream ifs(RatingsFile.c_str());
+    if (!ifs)
+    {
+        return false;
+    }
+    std::stringstream buffer;
+    buffer << ifs.rdbuf();
+    rapidjson::Document doc;
+    if (doc.Parse(buffer.str()).HasParseError() || !doc.IsObject() || !doc.HasMember("Ratings") || !doc["Ratings"].IsArray())
+    {
+        return false;
+    }
+    std::lock_guard<std::mutex> Lock(RatingsMutex);
+    ResultCount = doc.HasMember("Results") && doc["Results"].IsUint64() ? static_cast<size_t>(doc["Results"].GetUint64()) : 0;
+    for (const auto &val : doc["Ratings"].GetArray())
+    {
+        if (!val.HasMember("Bot") || !val["Bot"].IsString() || !val.HasMember("Rating") || !val["Rating"].IsNumber())
+        {
+            continue;
+        }
+        const uint32_t Id = GetId(val["Bot"].GetString());
+        Ratings[Id] = val["Rating"].GetDouble();
+        Games[Id] = val.HasMember("Games") && val["Games"].IsUint() ? val["Games"].GetUint() : 0;
+    }
+    return true;
+}
+
+bool RatingEngine::Save() const
+{
+    const std::string TempFile = RatingsFile + ".tmp";
+    {
+        std::ofstream ofs(TempFile.c_str(), std::ofstream::trunc);
+        if (!ofs)
+        {
+            return false;
+        }
+        rapidjson::OStreamWrapper osw(ofs);
+        rapidjson::PrettyWriter<rapidjson::OStreamWrapper> writer(osw);
+        std::lock_guard<std::mutex> Lock(RatingsMutex);
+        writer.StartObject();
+        writer.Key("Results");
+        writer.Uint64(ResultCount);
+        writer.Key("Ratings");
+        writer.StartArray();
+        for (size_t i = 0; i < Names.size(); ++i)
+        {
+            writer.StartObject();
+            writer.Key("Bot");
+            writer.String(Names[i]);
+            writer.Key("Rating");
+            writer.Double(Ratings[i]);
+            writer.Key("Games");
+            writer.Uint(Games[i]);
+            writer.EndObject();
+        }
+        writer.EndArray();
+        writer.EndObject();
+    }
+    return ReplaceFileAtomically(TempFile, RatingsFile);
+}
@@ -0,0 +1,49 @@
+#pragma once
+
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "ResultStore.h"
+#include "Types.h"
+
+class AgentsConfig;
+
+// Elo ratings computed by the ladder itself from its own results.
+// Ratings are updated as each game finishes and saved to RatingsFile together with the
+// number of results they were computed from. If that number does not match the result
+// store at startup the whole history is replayed with Recompute().
+class RatingEngine
+{
+public:
+    RatingEngine(const std::string &InRatingsFile, int InKFactor = 32, int InInitialRating = 1200);
+
+    // Loads the saved ratings, or recomputes them if they are missing or out of date.
+    void Initialize(const ResultStore &Results);
+    void Recompute(const ResultStore &Results);
+    void Update(const std::string &Bot1, const std::string &Bot2, ResultStore::Outcome Outcome);
+    bool Save() const;
+
+    int GetRating(const std::string &Bot) const;
+    // Copies the ratings into BotConfig::ELO.
+    void Apply(AgentsConfig &Agents) const;
+
+private:
+    bool Load();
+    uint32_t GetId(const std::string &Bot);
+    void Rate(uint32_t Bot1, uint32_t Bot2, double Score);
+
+    const std::string RatingsFile;
+    const double KFactor;
+    const double InitialRating;
+
+    mutable std::mutex RatingsMutex;
+    std::unordered_map<std::string, uint32_t> Ids;
+    std::vector<std::string> Names;
+    std::vector<double> Ratings;
+    std::vector<uint32_t> Games;
+    size_t ResultCount;
+};
@@ -0,0 +1,525 @@
+#include "ReplayArchive.h"
+
+#include <chrono>
+#include <ctime>
+#include <fstream>
+#include <sstream>
+#include <vector>
+
+#ifdef SC2LADDER_HAVE_ZLIB
+#include <zlib.h>
+#endif
+
+#define RAPIDJSON_HAS_STDSTRING 1
+#include "rapidjson.h"
+#include "document.h"
+#include "stringbuffer.h"
+#include "writer.h"
+
+#include "Tools.h"
+#include "sc2utils/sc2_scan_directory.h"
+
+namespace {
+
+uint64_t GetFileSize(const std::string &File)
+{
+    std::ifstream ifs(File, std::ifstream::binary | std::ifstream::ate);
+    return ifs ? static_cast<uint64_t>(ifs.tellg()) : 0;
+}
+
+bool CopyReplay(const std::string &From, const std::string &To)
+{
+    std::ifstream ifs(From, std::ifstream::binary);
+    std::ofstream ofs(To, std::ofstream::binary | std::ofstream::trunc);
+    if (!ifs || !ofs)
+    {
+        return false;
+    }
+    ofs << ifs.rdbuf();
+    return static_cast<bool>(ofs);
+}
+
+// The archive may be on another file system than the replay directory, rename only works within one.
+bool MoveReplay(const std::string &From, const std::string &To)
+{
+    if (std::rename(From.c_str(), To.c_str()) == 0)
+    {
+        return true;
+    }
+    if (!CopyReplay(From, To))
+    {
+        remove(To.c_str());
+        return false;
+    }
+    remove(From.c_str());
+    return true;
+}
+
+#ifdef SC2LADDER_HAVE_ZLIB
+bool GzipFile(const std::string &From, const std::string &To)
+{
+    FILE *In = fopen(From.c_str(), "rb");
+    if (In == nullptr)
+    {
+        return false;
+    }
+    gzFile Out = gzopen(To.c_str(), "wb9");
+    if (Out == nullptr)
+    {
+        fclose(In);
+        return false;
+    }
+    bool Written = true;
+    char Buffer[64 * 1024];
+    size_t Read = 0;
+    while (Written && (Read = fread(Buffer, 1, sizeof(Buffer), In)) > 0)
+    {
+        Written = gzwrite(Out, Buffer, static_cast<unsigned>(Read)) == static_cast<int>(Read);
+    }
+    fclose(In);
+    return gzclose(Out) == Z_OK && Written;
+}
+
+bool GunzipFile(const std::string &From, const std::string &To)
+{
+    gzFile In = gzopen(From.c_str(), "rb");
+    if (In == nullptr)
+    {
+        return false;
+    }
+    FILE *Out = fopen(To.c_str(), "wb");
+    if (Out == nullptr)
+    {
+        gzclose(In);
+        return false;
+    }
+    bool Written = true;
+    char Buffer[64 * 1024];
+    int Read = 0;
+    while (Written && (Read = gzread(In, Buffer, sizeof(Buffer))) > 0)
+    {
+        Written = fwrite(Buffer, 1, static_cast<size_t>(Read), Out) == static_cast<size_t>(Read);
+    }
+    fclose(Out);
+    return gzclose(In) == Z_OK && Written && Read == 0;
+}
+#endif
+
+bool CanCompress(bool Compress)
+{
+#ifdef SC2LADDER_HAVE_ZLIB
+    return Compress;
+#else
+    if (Compress)
+    {
+        PrintThread{} << "Built without zlib, replays are archived uncompressed." << std::endl;
+    }
+    return false;
+#endif
+}
+
+std::string GetStagedName(std::string MatchId)
+{
+    for (char &Character : MatchId)
+    {
+        if (Character == '/' || Character == '\\' || Character == ':')
+        {
+            Character = '_';
+        }
+    }
+    return MatchId + ".SC2Replay";
+}
+
+std::string GetStagedMetadataFile(const std::string &StagedFile)
+{
+    return StagedFile + ".json";
+}
+
+std::string GetStringMember(const rapidjson::Value &Value, const char *Name)
+{
+    return Value.HasMember(Name) && Value[Name].IsString() ? Value[Name].GetString() : "";
+}
+
+uint64_t GetUint64Member(const rapidjson::Value &Value, const char *Name)
+{
+    return Value.HasMember(Name) && Value[Name].IsUint64() ? Value[Name].GetUint64() : 0;
+}
+
+std::string GetEntryJson(const ArchivedReplay &Entry)
+{
+    rapidjson::StringBuffer Buffer;
+    rapidjson::Writer<rapidjson::StringBuffer> writer(Buffer);
+    writer.StartObject();
+    writer.Key("MatchId");
+    writer.String(Entry.MatchId);
+    writer.Key("Bot1");
+    writer.String(Entry.Bot1);
+    writer.Key("Bot2");
+    writer.String(Entry.Bot2);
+    writer.Key("Map");
+    writer.String(Entry.Map);
+    writer.Key("TimeStamp");
+    writer.String(Entry.TimeStamp);
+    writer.Key("UnixTime");
+    writer.Int64(Entry.UnixTime);
+    writer.Key("Hash");
+    writer.String(Entry.Hash);
+    writer.Key("Size");
+    writer.Uint64(Entry.Size);
+    writer.Key("StoredSize");
+    writer.Uint64(Entry.StoredSize);
+    writer.Key("Compressed");
+    writer.Bool(Entry.Compressed);
+    writer.EndObject();
+    return std::string(Buffer.GetString(), Buffer.GetSize());
+}
+
+bool ParseEntryJson(const std::string &Json, ArchivedReplay &Entry)
+{
+    rapidjson::Document doc;
+    if (Json.empty() || doc.Parse(Json.c_str()).HasParseError() || !doc.IsObject())
+    {
+        return false;
+    }
+    Entry.MatchId = GetStringMember(doc, "MatchId");
+    Entry.Bot1 = GetStringMember(doc, "Bot1");
+    Entry.Bot2 = GetStringMember(doc, "Bot2");
+    Entry.Map = GetStringMember(doc, "Map");
+    Entry.TimeStamp = GetStringMember(doc, "TimeStamp");
+    Entry.UnixTime = doc.HasMember("UnixTime") && doc["UnixTime"].IsInt64() ? doc["UnixTime"].GetInt64() : 0;
+    Entry.Hash = GetStringMember(doc, "Hash");
+    Entry.Size = GetUint64Member(doc, "Size");
+    Entry.StoredSize = GetUint64Member(doc, "StoredSize");
+    Entry.Compressed = doc.HasMember("Compressed") && doc["Compressed"].IsBool() && doc["Compressed"].GetBool();
+    return !Entry.MatchId.empty();
+}
+
+} // namespace
+
+ReplayArchive::ReplayArchive(const std::string &InDirectory, bool InCompress)
+    : Directory(!InDirectory.empty() && InDirectory.back() != '/' ? InDirectory + "/" : InDirectory)
+    , Compress(CanCompress(InCompress))
+    , Index(nullptr)
+    , Storing(false)
+    , Stopping(false)
+    , NextMatch(0)
+    , ReplayBytes(0)
+    , StoredBytes(0)
+{
+    MakeDirectory(Directory);
+    MakeDirectory(Directory + "objects");
+    MakeDirectory(Directory + "staging");
+    LoadIndex();
+    Index = fopen((Directory + "index.jsonl").c_str(), "ab");
+    if (Index == nullptr)
+    {
+        PrintThread{} << "Unable to open the replay archive index in " << Directory << std::endl;
+        return;
+    }
+    RecoverStaged();
+    PrintThread{} << "Replay archive " << Directory << ": " << Matches.size() << " replays, " << StoredBytes << " of " << ReplayBytes << " bytes on disk." << std::endl;
+    ArchiveThread = std::thread(&ReplayArchive::ArchiveLoop, this);
+}
+
+ReplayArchive::~ReplayArchive()
+{
+    {
+        std::lock_guard<std::mutex> Lock(ArchiveMutex);
+        Stopping = true;
+    }
+    ArchiveCondition.notify_all();
+    // The queue is worked off before the thread ends, only replays that failed to store stay in staging.
+    if (ArchiveThread.joinable())
+    {
+        ArchiveThread.join();
+    }
+    if (Index != nullptr)
+    {
+        fclose(Index);
+    }
+}
+
+std::string ReplayArchive::Add(const std::string &ReplayFile, const ArchivedReplay &Entry)
+{
+    if (Index == nullptr)
+    {
+        return std::string();
+    }
+    Pending Replay;
+    Replay.Entry = Entry;
+    Replay.Entry.Hash.clear();
+    if (Replay.Entry.UnixTime == 0)
+    {
+        Replay.Entry.UnixTime = static_cast<int64_t>(std::time(nullptr));
+    }
+    {
+        // The id is reserved right away, the entry is only found once its replay is stored.
+        std::lock_guard<std::mutex> Lock(ArchiveMutex);
+        const std::string BaseId = Entry.MatchId.empty() ? std::to_string(Replay.Entry.UnixTime) : Entry.MatchId;
+        std::string MatchId = Entry.MatchId.empty() ? BaseId + "-" + std::to_string(++NextMatch) : BaseId;
+        while (Matches.count(MatchId) > 0)
+        {
+            MatchId = BaseId + "-" + std::to_string(++NextMatch);
+        }
+        Replay.Entry.MatchId = MatchId;
+        Matches[MatchId] = Replay.Entry;
+    }
+    // The next game of the same bots on the same map writes a replay with the same name,
+    // so it is moved out of the replay directory before Add returns.
+    Replay.StagedFile = Directory + "staging/" + GetStagedName(Replay.Entry.MatchId);
+    if (!MoveReplay(ReplayFile, Replay.StagedFile))
+    {
+        PrintThread{} << "Unable to archive the replay " << ReplayFile << std::endl;
+        std::lock_guard<std::mutex> Lock(ArchiveMutex);
+        Matches.erase(Replay.Entry.MatchId);
+        return std::string();
+    }
+    // Lets RecoverStaged queue the replay again with its bots and map if the ladder stops before it is stored.
+    std::ofstream(GetStagedMetadataFile(Replay.StagedFile), std::ofstream::trunc) << GetEntryJson(Replay.Entry);
+    const std::string MatchId = Replay.Entry.MatchId;
+    {
+        std::lock_guard<std::mutex> Lock(ArchiveMutex);
+        Queue.push_back(std::move(Replay));
+    }
+    ArchiveCondition.notify_all();
+    return MatchId;
+}
+
+bool ReplayArchive::Find(const std::string &MatchId, ArchivedReplay &Entry) const
+{
+    std::lock_guard<std::mutex> Lock(ArchiveMutex);
+    const auto Found = Matches.find(MatchId);
+    if (Found == Matches.end() || Found->second.Hash.empty())
+    {
+        return false;
+    }
+    Entry = Found->second;
+    return true;
+}
+
+bool ReplayArchive::Extract(const std::string &MatchId, const std::string &OutFile) const
+{
+    ArchivedReplay Entry;
+    if (!Find(MatchId, Entry))
+    {
+        return false;
+    }
+    const std::string BlobFile = GetBlobFile(Entry.Hash, Entry.Compressed);
+    if (!Entry.Compressed)
+    {
+        return CopyReplay(BlobFile, OutFile);
+    }
+#ifdef SC2LADDER_HAVE_ZLIB
+    return GunzipFile(BlobFile, OutFile);
+#else
+    PrintThread{} << "Built without zlib, unable to extract " << BlobFile << std::endl;
+    return false;
+#endif
+}
+
+void ReplayArchive::Flush()
+{
+    std::unique_lock<std::mutex> Lock(ArchiveMutex);
+    ArchiveCondition.wait(Lock, [this] { return Queue.empty() && !Storing; });
+}
+
+uint64_t ReplayArchive::GetReplayBytes() const
+{
+    std::lock_guard<std::mutex> Lock(ArchiveMutex);
+    return ReplayBytes;
+}
+
+uint64_t ReplayArchive::GetStoredBytes() const
+{
+    std::lock_guard<std::mutex> Lock(ArchiveMutex);
+    return StoredBytes;
+}
+
+void ReplayArchive::LoadIndex()
+{
+    std::ifstream ifs(Directory + "index.jsonl");
+    std::string Line;
+    while (std::getline(ifs, Line))
+    {
+        ArchivedReplay Entry;
+        // A torn last line after a crash is simply skipped.
+        if (!ParseEntryJson(Line, Entry) || Entry.Hash.empty())
+        {
+            continue;
+        }
+        Matches[Entry.MatchId] = Entry;
+        ReplayBytes += Entry.Size;
+        if (Blobs.count(Entry.Hash) == 0)
+        {
+            Blobs[Entry.Hash] = Blob{ Entry.StoredSize, Entry.Compressed };
+            StoredBytes += Entry.StoredSize;
+        }
+    }
+}
+
+void ReplayArchive::RecoverStaged()
+{
+    const std::string Staging = Directory + "staging/";
+    std::vector<std::string> Files;
+    sc2::scan_directory(Staging.c_str(), Files, false, false);
+    const std::string Extension = ".SC2Replay";
+    size_t Recovered = 0;
+    for (const std::string &File : Files)
+    {
+        if (File.size() <= Extension.size() || File.compare(File.size() - Extension.size(), Extension.size(), Extension) != 0)
+        {
+            continue;
+        }
+        Pending Replay;
+        Replay.StagedFile = Staging + File;
+        const std::string MetadataFile = GetStagedMetadataFile(Replay.StagedFile);
+        std::stringstream Metadata;
+        Metadata << std::ifstream(MetadataFile).rdbuf();
+        if (!ParseEntryJson(Metadata.str(), Replay.Entry))
+        {
+            // Staged before the metadata was written, only the match id is known from the name.
+            Replay.Entry = ArchivedReplay();
+            Replay.Entry.MatchId = File.substr(0, File.size() - Extension.size());
+        }
+        Replay.Entry.Hash.clear();
+        if (Matches.count(Replay.Entry.MatchId) > 0)
+        {
+            // Stored and indexed, the ladder stopped before the staged copy was removed.
+            remove(Replay.StagedFile.c_str());
+            remove(MetadataFile.c_str());
+            continue;
+        }
+        Matches[Replay.Entry.MatchId] = Replay.Entry;
+        Queue.push_back(std::move(Replay));
+        ++Recovered;
+    }
+    if (Recovered > 0)
+    {
+        PrintThread{} << "Queued " << Recovered << " replays left in " << Staging << " for the archive." << std::endl;
+    }
+}
+
+void ReplayArchive::ArchiveLoop()
+{
+    std::unique_lock<std::mutex> Lock(ArchiveMutex);
+    while (true)
+    {
+        ArchiveCondition.wait(Lock, [this] { return Stopping || !Queue.empty(); });
+        if (Queue.empty())
+        {
+            break;
+        }
+        Pending Replay = std::move(Queue.front());
+        Queue.pop_front();
+        Storing = true;
+        Lock.unlock();
+        const bool Stored = Store(Replay);
+        Lock.lock();
+        Storing = false;
+        if (Stored)
+        {
+            Matches[Replay.Entry.MatchId] = Replay.Entry;
+            remove(GetStagedMetadataFile(Replay.StagedFile).c_str());
+        }
+        else
+        {
+            // The replay stays in staging and is queued again when the archive is opened the next time.
+            Matches.erase(Replay.Entry.MatchId);
+            PrintThread{} << "Unable to archive the replay of " << Replay.Entry.MatchId << ", it is kept as " << Replay.StagedFile << std::endl;
+        }
+        ArchiveCondition.notify_all();
+    }
+}
+
+bool ReplayArchive::Store(Pending &Replay)
+{
+    ArchivedReplay &Entry = Replay.Entry;
+    Entry.Hash = GenerateMD5(Replay.StagedFile);
+    if (Entry.Hash.empty())
+    {
+        return false;
+    }
+    Entry.Size = GetFileSize(Replay.StagedFile);
+    Blob Stored{ 0, false };
+    bool Known = false;
+    {
+        std::lock_guard<std::mutex> Lock(ArchiveMutex);
+        const auto Found = Blobs.find(Entry.Hash);
+        if (Found != Blobs.end())
+        {
+            Stored = Found->second;
+            Known = true;
+        }
+    }
+    if (Known)
+    {
+        remove(Replay.StagedFile.c_str());
+    }
+    else if (!StoreBlob(Replay.StagedFile, Entry.Hash, Stored))
+    {
+        return false;
+    }
+    Entry.StoredSize = Stored.StoredSize;
+    Entry.Compressed = Stored.Compressed;
+    if (!AppendIndex(Entry))
+    {
+        return false;
+    }
+    std::lock_guard<std::mutex> Lock(ArchiveMutex);
+    ReplayBytes += Entry.Size;
+    if (!Known)
+    {
+        Blobs[Entry.Hash] = Stored;
+        StoredBytes += Stored.StoredSize;
+    }
+    PrintThread{} << "Archived the replay of " << Entry.MatchId << " as " << Entry.Hash << ": " << Entry.Size << " bytes, " << (Known ? 0 : Stored.StoredSize) << " bytes stored." << std::endl;
+    return true;
+}
+
+bool ReplayArchive::StoreBlob(const std::string &StagedFile, const std::string &Hash, Blob &Stored)
+{
+    const std::string Shard = Directory + "objects/" + Hash.substr(0, 2);
+    MakeDirectory(Shard);
+    MakeDirectory(Shard + "/" + Hash.substr(2, 2));
+#ifdef SC2LADDER_HAVE_ZLIB
+    if (Compress)
+    {
+        const std::string BlobFile = GetBlobFile(Hash, true);
+        const std::string TempFile = BlobFile + ".tmp";
+        const uint64_t Size = GetFileSize(StagedFile);
+        // Replays are partly compressed already, the gzipped copy is only kept if it is smaller.
+        if (GzipFile(StagedFile, TempFile) && GetFileSize(TempFile) < Size)
+        {
+            remove(BlobFile.c_str());
+            if (MoveReplay(TempFile, BlobFile))
+            {
+                remove(StagedFile.c_str());
+                Stored = Blob{ GetFileSize(BlobFile), true };
+                return true;
+            }
+        }
+        remove(TempFile.c_str());
+    }
+#endif
+    const std::string BlobFile = GetBlobFile(Hash, false);
+    remove(BlobFile.c_str());
+    if (!MoveReplay(StagedFile, BlobFile))
+    {
+        return false;
+    }
+    Stored = Blob{ GetFileSize(BlobFile), false };
+    return true;
+}
+
+bool ReplayArchive::AppendIndex(const ArchivedReplay &Entry)
+{
+    std::string Line = GetEntryJson(Entry);
+    Line += '\n';
+    // Only the archive thread writes the index. The replay is on disk before its line is.
+    return fwrite(Line.data(), 1, Line.size(), Index) == Line.size() && fflush(Index) == 0 && SyncFileToDisk(Index);
+}
+
+std::string ReplayArchive::GetBlobFile(const std::string &Hash, bool Compressed) const
+{
+    return Directory + "objects/" + Hash.substr(0, 2) + "/" + Hash.substr(2, 2) + "/" + Hash + (Compressed ? ".SC2Replay.gz" : ".SC2Replay");
+}
@@ -0,0 +1,93 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+
+#include "Types.h"
+
+struct ArchivedReplay
+{
+    std::string MatchId;
+    std::string Bot1;
+    std::string Bot2;
+    std::string Map;
+    std::string TimeStamp;
+    int64_t UnixTime{0};
+    // MD5 of the replay as the game wrote it.
+    std::string Hash;
+    uint64_t Size{0};
+    // Size of the stored replay, shared with every match that has the same hash.
+    uint64_t StoredSize{0};
+    bool Compressed{false};
+};
+
+// Keeps every replay instead of only the last one of each pairing and map.
+// Replays are stored once per content hash under objects/<ab>/<cd>/<hash>.SC2Replay, gzipped
+// when that makes them smaller, so no directory grows past a few hundred files.
+// index.jsonl next to the objects is an append-only list of the archived matches, it is read
+// into memory on construction and maps a match id to its bots, map, time and replay.
+// Add only moves the replay aside, hashing and compression happen on a background thread.
+// Replays still in staging/ when the archive is opened are queued again.
+class ReplayArchive
+{
+public:
+    ReplayArchive(const std::string &InDirectory, bool InCompress);
+    ~ReplayArchive();
+
+    // Takes ReplayFile out of its place and queues it for the archive.
+    // Returns the match id, Entry.MatchId if set, or an empty string if the replay could not be taken.
+    std::string Add(const std::string &ReplayFile, const ArchivedReplay &Entry);
+    // False if MatchId is unknown or its replay is still queued.
+    bool Find(const std::string &MatchId, ArchivedReplay &Entry) const;
+    // Writes the replay of MatchId, uncompressed, to OutFile.
+    bool Extract(const std::string &MatchId, const std::string &OutFile) const;
+    // Waits until every queued replay is archived.
+    void Flush();
+
+    // Bytes of all archived replays as the game wrote them and on disk.
+    uint64_t GetReplayBytes() const;
+    uint64_t GetStoredBytes() const;
+
+private:
+    struct Blob
+    {
+        uint64_t StoredSize;
+        bool Compressed;
+    };
+    struct Pending
+    {
+        ArchivedReplay Entry;
+        std::string StagedFile;
+    };
+
+    void LoadIndex();
+    // Queues the replays that were staged but not stored when the ladder stopped.
+    void RecoverStaged();
+    void ArchiveLoop();
+    bool Store(Pending &Replay);
+    bool StoreBlob(const std::string &StagedFile, const std::string &Hash, Blob &Stored);
+    bool AppendIndex(const ArchivedReplay &Entry);
+    std::string GetBlobFile(const std::string &Hash, bool Compressed) const;
+
+    const std::string Directory;
+    const bool Compress;
+
+    FILE *Index;
+    mutable std::mutex ArchiveMutex;
+    std::condition_variable ArchiveCondition;
+    std::deque<Pending> Queue;
+    bool Storing;
+    bool Stopping;
+    uint64_t NextMatch;
+    std::unordered_map<std::string, ArchivedReplay> Matches;
+    std::unordered_map<std::string, Blob> Blobs;
+    uint64_t ReplayBytes;
+    uint64_t StoredBytes;
+    std::thread ArchiveThread;
+};
@@ -0,0 +1,696 @@
+#include "ReplayRename.h"
+
+#include <array>
+#include <cctype>
+#include <cstdint>
+#include <cstdio>
+#include <vector>
+
+#ifdef SC2LADDER_HAVE_ZLIB
+#include <zlib.h>
+#endif
+#ifdef SC2LADDER_HAVE_BZIP2
+#include <bzlib.h>
+#endif
+
+#include "Tools.h"
+
+namespace {
+
+const uint32_t MPQ_USER_DATA_MAGIC = 0x1B51504D;
+const uint32_t MPQ_HEADER_MAGIC = 0x1A51504D;
+const size_t MPQ_HEADER_SIZE_V1 = 32;
+const size_t MPQ_HEADER_SIZE_V2 = 44;
+const size_t MPQ_HEADER_SIZE_V3 = 68;
+const size_t MPQ_HEADER_SIZE_V4 = 208;
+const size_t MPQ_HEADER_MD5_OFFSET = 192;
+const size_t MPQ_BLOCK_TABLE_MD5_OFFSET = 112;
+
+const uint32_t MPQ_FILE_IMPLODE = 0x00000100;
+const uint32_t MPQ_FILE_COMPRESS = 0x00000200;
+const uint32_t MPQ_FILE_ENCRYPTED = 0x00010000;
+const uint32_t MPQ_FILE_PATCH_FILE = 0x00100000;
+const uint32_t MPQ_FILE_SINGLE_UNIT = 0x01000000;
+const uint32_t MPQ_FILE_EXISTS = 0x80000000;
+
+const unsigned char MPQ_COMPRESSION_ZLIB = 0x02;
+const unsigned char MPQ_COMPRESSION_BZIP2 = 0x10;
+
+const uint32_t HASH_TABLE_OFFSET = 0;
+const uint32_t HASH_NAME_A = 1;
+const uint32_t HASH_NAME_B = 2;
+const uint32_t HASH_FILE_KEY = 3;
+const uint32_t HASH_ENTRY_FREE = 0xFFFFFFFF;
+
+// Deeper values than this are not in any replay, only in a corrupt one.
+const int MAX_DETAILS_DEPTH = 64;
+
+std::array<uint32_t, 0x500> BuildCryptTable()
+{
+    std::array<uint32_t, 0x500> Table;
+    uint32_t Seed = 0x00100001;
+    for (uint32_t Index1 = 0; Index1 < 0x100; ++Index1)
+    {
+        for (uint32_t Index2 = Index1, i = 0; i < 5; ++i, Index2 += 0x100)
+        {
+            Seed = (Seed * 125 + 3) % 0x2AAAAB;
+            const uint32_t Temp1 = (Seed & 0xFFFF) << 0x10;
+            Seed = (Seed * 125 + 3) % 0x2AAAAB;
+            const uint32_t Temp2 = Seed & 0xFFFF;
+            Table[Index2] = Temp1 | Temp2;
+        }
+    }
+    return Table;
+}
+
+// Built on first use, the initialisation of a local static is thread safe.
+const std::array<uint32_t, 0x500> &GetCryptTable()
+{
+    static const std::array<uint32_t, 0x500> Table = BuildCryptTable();
+    return Table;
+}
+
+uint32_t HashString(const std::string &Name, uint32_t HashType)
+{
+    const std::array<uint32_t, 0x500> &Table = GetCryptTable();
+    uint32_t Seed1 = 0x7FED7FED;
+    uint32_t Seed2 = 0xEEEEEEEE;
+    for (char Character : Name)
+    {
+        uint32_t Upper = static_cast<uint32_t>(std::toupper(static_cast<unsigned char>(Character)));
+        if (Upper == '/')
+        {
+            Upper = '\\';
+        }
+        Seed1 = Table[(HashType << 8) + Upper] ^ (Seed1 + Seed2);
+        Seed2 = Upper + Seed1 + Seed2 + (Seed2 << 5) + 3;
+    }
+    return Seed1;
+}
+
+void DecryptTable(std::vector<uint32_t> &Values, uint32_t Key)
+{
+    const std::array<uint32_t, 0x500> &Table = GetCryptTable();
+    uint32_t Seed = 0xEEEEEEEE;
+    for (uint32_t &Value : Values)
+    {
+        Seed += Table[0x400 + (Key & 0xFF)];
+        Value ^= Key + Seed;
+        Key = ((~Key << 0x15) + 0x11111111) | (Key >> 0x0B);
+        Seed = Value + Seed + (Seed << 5) + 3;
+    }
+}
+
+void EncryptTable(std::vector<uint32_t> &Values, uint32_t Key)
+{
+    const std::array<uint32_t, 0x500> &Table = GetCryptTable();
+    uint32_t Seed = 0xEEEEEEEE;
+    for (uint32_t &Value : Values)
+    {
+        Seed += Table[0x400 + (Key & 0xFF)];
+        const uint32_t Plain = Value;
+        Value ^= Key + Seed;
+        Key = ((~Key << 0x15) + 0x11111111) | (Key >> 0x0B);
+        Seed = Plain + Seed + (Seed << 5) + 3;
+    }
+}
+
+uint32_t ReadUint32(const unsigned char *Data)
+{
+    return static_cast<uint32_t>(Data[0]) | (static_cast<uint32_t>(Data[1]) << 8) | (static_cast<uint32_t>(Data[2]) << 16) | (static_cast<uint32_t>(Data[3]) << 24);
+}
+
+uint64_t ReadUint64(const unsigned char *Data)
+{
+    return static_cast<uint64_t>(ReadUint32(Data)) | (static_cast<uint64_t>(ReadUint32(Data + 4)) << 32);
+}
+
+void WriteUint32(unsigned char *Data, uint32_t Value)
+{
+    for (int i = 0; i < 4; ++i)
+    {
+        Data[i] = static_cast<unsigned char>(Value >> (8 * i));
+    }
+}
+
+void WriteUint64(unsigned char *Data, uint64_t Value)
+{
+    WriteUint32(Data, static_cast<uint32_t>(Value));
+    WriteUint32(Data + 4, static_cast<uint32_t>(Value >> 32));
+}
+
+bool IsZero(const unsigned char *Data, size_t Length)
+{
+    for (size_t i = 0; i < Length; ++i)
+    {
+        if (Data[i] != 0)
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+void WriteMD5(unsigned char *Digest, const void *Data, size_t Length)
+{
+    const std::string Hex = GenerateMD5(Data, Length);
+    for (size_t i = 0; i < 16 && Hex.size() == 32; ++i)
+    {
+        Digest[i] = static_cast<unsigned char>(std::stoul(Hex.substr(2 * i, 2), nullptr, 16));
+    }
+}
+
+// A compressed sector starts with a mask of the methods it was compressed with.
+bool Decompress(const std::string &In, size_t Size, std::string &Out)
+{
+    if (In.empty())
+    {
+        return false;
+    }
+    Out.assign(Size, '\0');
+    const unsigned char Method = static_cast<unsigned char>(In[0]);
+#ifdef SC2LADDER_HAVE_ZLIB
+    if (Method == MPQ_COMPRESSION_ZLIB)
+    {
+        uLongf OutSize = static_cast<uLongf>(Size);
+        return uncompress(reinterpret_cast<Bytef *>(&Out[0]), &OutSize, reinterpret_cast<const Bytef *>(In.data() + 1), static_cast<uLong>(In.size() - 1)) == Z_OK && OutSize == Size;
+    }
+#endif
+#ifdef SC2LADDER_HAVE_BZIP2
+    if (Method == MPQ_COMPRESSION_BZIP2)
+    {
+        unsigned int OutSize = static_cast<unsigned int>(Size);
+        std::string Compressed = In.substr(1);
+        return BZ2_bzBuffToBuffDecompress(&Out[0], &OutSize, &Compressed[0], static_cast<unsigned int>(Compressed.size()), 0, 0) == BZ_OK && OutSize == Size;
+    }
+#endif
+    PrintThread{} << "Replay data compressed with method " << static_cast<int>(Method) << " can not be read by this build." << std::endl;
+    return false;
+}
+
+// The tables of an MPQ archive, read from and written to its file in place.
+class MpqArchive
+{
+public:
+    explicit MpqArchive(FILE *InFile)
+        : File(InFile)
+    {
+    }
+
+    bool Open()
+    {
+        unsigned char Magic[16];
+        if (!ReadAt(0, Magic, sizeof(Magic)))
+        {
+            return false;
+        }
+        // Replays start with the user data of the game, the archive follows it.
+        if (ReadUint32(Magic) == MPQ_USER_DATA_MAGIC)
+        {
+            HeaderOffset = ReadUint32(Magic + 8);
+        }
+        Header.resize(MPQ_HEADER_SIZE_V1);
+        if (!ReadAt(HeaderOffset, Header.data(), Header.size()) || ReadUint32(Header.data()) != MPQ_HEADER_MAGIC)
+        {
+            return false;
+        }
+        const uint32_t HeaderSize = ReadUint32(&Header[4]);
+        if (HeaderSize > MPQ_HEADER_SIZE_V1)
+        {
+            Header.resize(HeaderSize < MPQ_HEADER_SIZE_V4 ? HeaderSize : MPQ_HEADER_SIZE_V4);
+            if (!ReadAt(HeaderOffset, Header.data(), Header.size()))
+            {
+                return false;
+            }
+        }
+        const uint32_t SectorSizeShift = Header[14] | (Header[15] << 8);
+        if (SectorSizeShift > 20)
+        {
+            return false;
+        }
+        SectorSize = 512U << SectorSizeShift;
+        HashTableOffset = ReadUint32(&Header[16]);
+        BlockTableOffset = ReadUint32(&Header[20]);
+        const uint32_t HashEntries = ReadUint32(&Header[24]);
+        const uint32_t BlockEntries = ReadUint32(&Header[28]);
+        // Archives over 4 GB and the HET/BET tables of newer versions are never used for replays.
+        if (Header.size() >= MPQ_HEADER_SIZE_V2 && (ReadUint64(&Header[32]) != 0 || !IsZero(&Header[40], 4)))
+        {
+            return false;
+        }
+        if (Header.size() >= MPQ_HEADER_SIZE_V3 && (ReadUint64(&Header[52]) != 0 || ReadUint64(&Header[60]) != 0))
+        {
+            return false;
+        }
+        // Compressed tables are smaller than their entries.
+        if (Header.size() >= MPQ_HEADER_SIZE_V4 && ((ReadUint64(&Header[68]) != 0 && ReadUint64(&Header[68]) != HashEntries * 16ULL) || (ReadUint64(&Header[76]) != 0 && ReadUint64(&Header[76]) != BlockEntries * 16ULL)))
+        {
+            return false;
+        }
+        return HashEntries > 0 && ReadTable(HashTableOffset, HashEntries, HashString("(hash table)", HASH_FILE_KEY), HashTable)
+            && ReadTable(BlockTableOffset, BlockEntries, HashString("(block table)", HASH_FILE_KEY), BlockTable);
+    }
+
+    bool ReadFile(const std::string &FileName, std::string &Contents)
+    {
+        uint32_t Block = 0;
+        if (!FindBlock(FileName, Block))
+        {
+            return false;
+        }
+        const uint32_t FilePosition = BlockTable[Block * 4];
+        const uint32_t StoredSize = BlockTable[Block * 4 + 1];
+        const uint32_t FileSize = BlockTable[Block * 4 + 2];
+        const uint32_t Flags = BlockTable[Block * 4 + 3];
+        if ((Flags & MPQ_FILE_EXISTS) == 0 || (Flags & (MPQ_FILE_IMPLODE | MPQ_FILE_ENCRYPTED | MPQ_FILE_PATCH_FILE)) != 0)
+        {
+            return false;
+        }
+        std::string Stored(StoredSize, '\0');
+        if (StoredSize > 0 && !ReadAt(HeaderOffset + FilePosition, &Stored[0], StoredSize))
+        {
+            return false;
+        }
+        if ((Flags & MPQ_FILE_COMPRESS) == 0)
+        {
+            Contents = Stored.substr(0, FileSize);
+            return Contents.size() == FileSize;
+        }
+        if ((Flags & MPQ_FILE_SINGLE_UNIT) != 0)
+        {
+            if (StoredSize >= FileSize)
+            {
+                Contents = Stored.substr(0, FileSize);
+                return Contents.size() == FileSize;
+            }
+            return Decompress(Stored, FileSize, Contents);
+        }
+        // Compressed files are split into sectors, with the offsets of the sectors in front of them.
+        const size_t Sectors = (FileSize + SectorSize - 1) / SectorSize;
+        if (Stored.size() < (Sectors + 1) * 4)
+        {
+            return false;
+        }
+        Contents.clear();
+        for (size_t Sector = 0; Sector < Sectors; ++Sector)
+        {
+            const uint32_t Start = ReadUint32(reinterpret_cast<const unsigned char *>(Stored.data()) + Sector * 4);
+            const uint32_t End = ReadUint32(reinterpret_cast<const unsigned char *>(Stored.data()) + Sector * 4 + 4);
+            const size_t Size = Sector + 1 < Sectors ? SectorSize : FileSize - Sector * SectorSize;
+            if (End < Start || End > Stored.size())
+            {
+                return false;
+            }
+            const std::string Data = Stored.substr(Start, End - Start);
+            if (Data.size() == Size)
+            {
+                Contents += Data;
+                continue;
+            }
+            std::string Decompressed;
+            if (!Decompress(Data, Size, Decompressed))
+            {
+                return false;
+            }
+            Contents += Decompressed;
+        }
+        return true;
+    }
+
+    // Writes Contents at the end of the archive and points the file's block to it.
+    // The old data stays where it is, unused.
+    bool ReplaceFile(const std::string &FileName, const std::string &Contents)
+    {
+        uint32_t Block = 0;
+        if (!FindBlock(FileName, Block) || fseek(File, 0, SEEK_END) != 0)
+        {
+            return false;
+        }
+        const long End = ftell(File);
+        if (End < 0 || static_cast<uint64_t>(End) < HeaderOffset || static_cast<uint64_t>(End) + Contents.size() - HeaderOffset > 0xFFFFFFFFULL)
+        {
+            return false;
+        }
+        if (!WriteAt(static_cast<uint64_t>(End), Contents.data(), Contents.size()))
+        {
+            return false;
+        }
+        BlockTable[Block * 4] = static_cast<uint32_t>(End - HeaderOffset);
+        BlockTable[Block * 4 + 1] = static_cast<uint32_t>(Contents.size());
+        BlockTable[Block * 4 + 2] = static_cast<uint32_t>(Contents.size());
+        BlockTable[Block * 4 + 3] = MPQ_FILE_EXISTS;
+        std::vector<uint32_t> Encrypted(BlockTable);
+        EncryptTable(Encrypted, HashString("(block table)", HASH_FILE_KEY));
+        std::vector<unsigned char> BlockData(Encrypted.size() * 4);
+        for (size_t i = 0; i < Encrypted.size(); ++i)
+        {
+            WriteUint32(&BlockData[i * 4], Encrypted[i]);
+        }
+        if (!WriteAt(HeaderOffset + BlockTableOffset, BlockData.data(), BlockData.size()))
+        {
+            return false;
+        }
+
+        const uint64_t ArchiveSize = static_cast<uint64_t>(End) + Contents.size() - HeaderOffset;
+        WriteUint32(&Header[8], static_cast<uint32_t>(ArchiveSize));
+        if (Header.size() >= MPQ_HEADER_SIZE_V3)
+        {
+            WriteUint64(&Header[44], ArchiveSize);
+        }
+        // Version 4 headers may carry MD5s of the tables and of themselves, a zero one is not checked.
+        if (Header.size() >= MPQ_HEADER_SIZE_V4)
+        {
+            if (!IsZero(&Header[MPQ_BLOCK_TABLE_MD5_OFFSET], 16))
+            {
+                WriteMD5(&Header[MPQ_BLOCK_TABLE_MD5_OFFSET], BlockData.data(), BlockData.size());
+            }
+            if (!IsZero(&Header[MPQ_HEADER_MD5_OFFSET], 16))
+            {
+                WriteMD5(&Header[MPQ_HEADER_MD5_OFFSET], Header.data(), MPQ_HEADER_MD5_OFFSET);
+            }
+        }
+        return WriteAt(HeaderOffset, Header.data(), Header.size()) && fflush(File) == 0;
+    }
+
+private:
+    bool FindBlock(const std::string &FileName, uint32_t &Block) const
+    {
+        const size_t Entries = HashTable.size() / 4;
+        const uint32_t Start = HashString(FileName, HASH_TABLE_OFFSET);
+        const uint32_t NameA = HashString(FileName, HASH_NAME_A);
+        const uint32_t NameB = HashString(FileName, HASH_NAME_B);
+        for (size_t i = 0; i < Entries; ++i)
+        {
+            const size_t Entry = (Start + i) % Entries;
+            const uint32_t EntryBlock = HashTable[Entry * 4 + 3];
+            if (EntryBlock == HASH_ENTRY_FREE)
+            {
+                return false;
+            }
+            if (HashTable[Entry * 4] == NameA && HashTable[Entry * 4 + 1] == NameB && EntryBlock < BlockTable.size() / 4)
+            {
+                Block = EntryBlock;
+                return true;
+            }
+        }
+        return false;
+    }
+
+    bool ReadTable(uint32_t Offset, uint32_t Entries, uint32_t Key, std::vector<uint32_t> &Table)
+    {
+        std::vector<unsigned char> Data(Entries * 16);
+        if (!ReadAt(HeaderOffset + Offset, Data.data(), Data.size()))
+        {
+            return false;
+        }
+        Table.resize(Entries * 4);
+        for (size_t i = 0; i < Table.size(); ++i)
+        {
+            Table[i] = ReadUint32(&Data[i * 4]);
+        }
+        DecryptTable(Table, Key);
+        return true;
+    }
+
+    bool ReadAt(uint64_t Offset, void *Data, size_t Length)
+    {
+        return fseek(File, static_cast<long>(Offset), SEEK_SET) == 0 && fread(Data, 1, Length, File) == Length;
+    }
+
+    bool WriteAt(uint64_t Offset, const void *Data, size_t Length)
+    {
+        return fseek(File, static_cast<long>(Offset), SEEK_SET) == 0 && fwrite(Data, 1, Length, File) == Length;
+    }
+
+    FILE *File;
+    uint64_t HeaderOffset{0};
+    std::vector<unsigned char> Header;
+    uint32_t SectorSize{0};
+    uint32_t HashTableOffset{0};
+    uint32_t BlockTableOffset{0};
+    std::vector<uint32_t> HashTable;
+    std::vector<uint32_t> BlockTable;
+};
+
+// Copies a value of the versioned format and replaces the blobs that are keys of Names.
+// Every value starts with its type, so values can be copied without knowing the structure of replay.details.
+class DetailsRewriter
+{
+public:
+    DetailsRewriter(const std::string &InDetails, const std::map<std::string, std::string> &InNames)
+        : Details(InDetails)
+        , Names(InNames)
+    {
+    }
+
+    bool Rewrite(std::string &Out)
+    {
+        if (!CopyValue(0) || Position != Details.size())
+        {
+            return false;
+        }
+        Out.swap(Rewritten);
+        return true;
+    }
+
+    size_t GetReplaced() const
+    {
+        return Replaced;
+    }
+
+private:
+    enum ValueType : unsigned char
+    {
+        Array = 0,
+        BitArray = 1,
+        Blob = 2,
+        Choice = 3,
+        Optional = 4,
+        Struct = 5,
+        Uint8 = 6,
+        Uint32 = 7,
+        Uint64 = 8,
+        Int = 9
+    };
+
+    bool CopyValue(int Depth)
+    {
+        if (Depth > MAX_DETAILS_DEPTH || Position >= Details.size())
+        {
+            return false;
+        }
+        const unsigned char Type = static_cast<unsigned char>(Details[Position]);
+        Rewritten += Details[Position++];
+        int64_t Length = 0;
+        switch (Type)
+        {
+        case Array:
+            if (!CopyInt(Length) || Length < 0)
+            {
+                return false;
+            }
+            for (int64_t i = 0; i < Length; ++i)
+            {
+                if (!CopyValue(Depth + 1))
+                {
+                    return false;
+                }
+            }
+            return true;
+        case BitArray:
+            return CopyInt(Length) && Length >= 0 && CopyBytes(static_cast<size_t>((Length + 7) / 8));
+        case Blob:
+            return ReadInt(Length) && Length >= 0 && CopyBlob(static_cast<size_t>(Length));
+        case Choice:
+            return CopyInt(Length) && CopyValue(Depth + 1);
+        case Optional:
+            if (!CopyBytes(1))
+            {
+                return false;
+            }
+            return Rewritten.back() == 0 || CopyValue(Depth + 1);
+        case Struct:
+            if (!CopyInt(Length) || Length < 0)
+            {
+                return false;
+            }
+            for (int64_t i = 0; i < Length; ++i)
+            {
+                int64_t Tag = 0;
+                if (!CopyInt(Tag) || !CopyValue(Depth + 1))
+                {
+                    return false;
+                }
+            }
+            return true;
+        case Uint8:
+            return CopyBytes(1);
+        case Uint32:
+            return CopyBytes(4);
+        case Uint64:
+            return CopyBytes(8);
+        case Int:
+            return CopyInt(Length);
+        default:
+            return false;
+        }
+    }
+
+    // Integers are stored with the sign in the lowest bit and 7 bits per byte after the first.
+    bool ReadInt(int64_t &Value)
+    {
+        if (Position >= Details.size())
+        {
+            return false;
+        }
+        unsigned char Byte = static_cast<unsigned char>(Details[Position++]);
+        const bool Negative = (Byte & 1) != 0;
+        uint64_t Result = (Byte >> 1) & 0x3F;
+        int Bits = 6;
+        while ((Byte & 0x80) != 0)
+        {
+            if (Position >= Details.size() || Bits > 56)
+            {
+                return false;
+            }
+            Byte = static_cast<unsigned char>(Details[Position++]);
+            Result |= static_cast<uint64_t>(Byte & 0x7F) << Bits;
+            Bits += 7;
+        }
+        Value = Negative ? -static_cast<int64_t>(Result) : static_cast<int64_t>(Result);
+        return true;
+    }
+
+    bool CopyInt(int64_t &Value)
+    {
+        const size_t Start = Position;
+        if (!ReadInt(Value))
+        {
+            return false;
+        }
+        Rewritten.append(Details, Start, Position - Start);
+        return true;
+    }
+
+    void WriteInt(uint64_t Value)
+    {
+        unsigned char Byte = static_cast<unsigned char>((Value & 0x3F) << 1);
+        Value >>= 6;
+        while (Value != 0)
+        {
+            Rewritten += static_cast<char>(Byte | 0x80);
+            Byte = static_cast<unsigned char>(Value & 0x7F);
+            Value >>= 7;
+        }
+        Rewritten += static_cast<char>(Byte);
+    }
+
+    bool CopyBytes(size_t Length)
+    {
+        if (Details.size() - Position < Length)
+        {
+            return false;
+        }
+        Rewritten.append(Details, Position, Length);
+        Position += Length;
+        return true;
+    }
+
+    bool CopyBlob(size_t Length)
+    {
+        if (Details.size() - Position < Length)
+        {
+            return false;
+        }
+        std::string Value = Details.substr(Position, Length);
+        Position += Length;
+        const auto Name = Names.find(Value);
+        if (Name != Names.end())
+        {
+            Value = Name->second;
+            ++Replaced;
+        }
+        WriteInt(Value.size());
+        Rewritten += Value;
+        return true;
+    }
+
+    const std::string &Details;
+    const std::map<std::string, std::string> &Names;
+    size_t Position{0};
+    size_t Replaced{0};
+    std::string Rewritten;
+};
+
+bool CopyReplay(const std::string &From, const std::string &To)
+{
+    FILE *In = fopen(From.c_str(), "rb");
+    if (In == nullptr)
+    {
+        return false;
+    }
+    FILE *Out = fopen(To.c_str(), "wb");
+    if (Out == nullptr)
+    {
+        fclose(In);
+        return false;
+    }
+    bool Written = true;
+    std::array<char, 64 * 1024> Buffer;
+    size_t Read = 0;
+    while (Written && (Read = fread(Buffer.data(), 1, Buffer.size(), In)) > 0)
+    {
+        Written = fwrite(Buffer.data(), 1, Read, Out) == Read;
+    }
+    fclose(In);
+    return fclose(Out) == 0 && Written;
+}
+
+} // namespace
+
+bool ReadReplayFile(const std::string &ReplayFile, const std::string &FileName, std::string &Contents)
+{
+    FILE *File = fopen(ReplayFile.c_str(), "rb");
+    if (File == nullptr)
+    {
+        return false;
+    }
+    MpqArchive Archive(File);
+    const bool Read = Archive.Open() && Archive.ReadFile(FileName, Contents);
+    fclose(File);
+    return Read;
+}
+
+bool RenameReplayPlayers(const std::string &ReplayFile, const std::map<std::string, std::string> &Names)
+{
+    const std::string TempFile = ReplayFile + ".rename";
+    if (!CopyReplay(ReplayFile, TempFile))
+    {
+        remove(TempFile.c_str());
+        return false;
+    }
+    FILE *File = fopen(TempFile.c_str(), "r+b");
+    if (File == nullptr)
+    {
+        remove(TempFile.c_str());
+        return false;
+    }
+    MpqArchive Archive(File);
+    std::string Details;
+    std::string Renamed;
+    DetailsRewriter Rewriter(Details, Names);
+    bool Rewritten = Archive.Open() && Archive.ReadFile("replay.details", Details) && Rewriter.Rewrite(Renamed);
+    const bool Changed = Rewritten && Rewriter.GetReplaced() > 0;
+    if (Changed)
+    {
+        Rewritten = Archive.ReplaceFile("replay.details", Renamed);
+    }
+    fclose(File);
+    if (!Changed || !Rewritten)
+    {
+        // A replay without any of the names is left alone, the caller reports it.
+        remove(TempFile.c_str());
+        return false;
+    }
+    return ReplaceFileAtomically(TempFile, ReplayFile);
+}
@@ -0,0 +1,18 @@
+#pragma once
+
+#include <map>
+#include <string>
+
+// A replay is an MPQ archive. The player names are in its replay.details file, encoded with
+// the versioned format of s2protocol.
+
+// Reads FileName from the archive into Contents. Fails for files that are encrypted or compressed
+// with a method this build has no library for, zlib and bzip2 are supported when available.
+bool ReadReplayFile(const std::string &ReplayFile, const std::string &FileName, std::string &Contents);
+
+// Replaces every player name of replay.details that is a key of Names with its value.
+// The replay is rewritten through a copy next to it that replaces it once it is complete,
+// the new replay.details is stored uncompressed at the end of the archive.
+// Nothing but the replay is shared, so several matches can rename their replays at the same time.
+// Returns false if the replay could not be rewritten or none of its players is in Names.
+bool RenameReplayPlayers(const std::string &ReplayFile, const std::map<std::string, std::string> &Names);
@@ -0,0 +1,237 @@
+#include "ResourceGroup.h"
+
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <thread>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <errno.h>
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/resource.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#ifdef __linux__
+#include <sched.h>
+#endif
+
+namespace {
+
+#ifdef __linux__
+bool WriteControl(const std::string &File, const std::string &Value)
+{
+    const int FileHandle = open(File.c_str(), O_WRONLY | O_CLOEXEC);
+    if (FileHandle < 0)
+    {
+        return false;
+    }
+    const ssize_t Written = write(FileHandle, Value.c_str(), Value.size());
+    close(FileHandle);
+    return Written == static_cast<ssize_t>(Value.size());
+}
+
+// Reads a single number, or the value of Key from a flat keyed file like cpu.stat.
+bool ReadControl(const std::string &File, const std::string &Key, uint64_t &Value)
+{
+    std::ifstream ifs(File.c_str());
+    if (Key.empty())
+    {
+        return static_cast<bool>(ifs >> Value);
+    }
+    std::string Name;
+    uint64_t Number;
+    while (ifs >> Name >> Number)
+    {
+        if (Name == Key)
+        {
+            Value = Number;
+            return true;
+        }
+    }
+    return false;
+}
+
+// Pid 0 is the calling thread. Only async signal safe calls, it is used between fork and exec.
+bool SetAffinity(pid_t ThreadId, const std::vector<int> &Cores)
+{
+    cpu_set_t CpuSet;
+    CPU_ZERO(&CpuSet);
+    for (size_t i = 0; i < Cores.size(); ++i)
+    {
+        if (Cores[i] >= 0 && Cores[i] < CPU_SETSIZE)
+        {
+            CPU_SET(Cores[i], &CpuSet);
+        }
+    }
+    return sched_setaffinity(ThreadId, sizeof(CpuSet), &CpuSet) == 0;
+}
+#endif
+
+} // namespace
+
+ResourceGroup::ResourceGroup(const std::string &ParentPath, const std::string &Name, const ResourceLimits &InLimits)
+    : Limits(InLimits)
+    , Active(false)
+{
+#ifdef __linux__
+    if (ParentPath.empty())
+    {
+        return;
+    }
+    // A group can only use the controllers its parent enables for its children.
+    // Enabled one at a time, so a missing controller does not disable the others.
+    WriteControl(ParentPath + "/cgroup.subtree_control", "+cpu");
+    WriteControl(ParentPath + "/cgroup.subtree_control", "+memory");
+    WriteControl(ParentPath + "/cgroup.subtree_control", "+pids");
+    const std::string GroupPath = ParentPath + "/" + Name;
+    if (mkdir(GroupPath.c_str(), 0755) != 0 && errno != EEXIST)
+    {
+        PrintThread{} << "Unable to create cgroup " << GroupPath << ": " << strerror(errno) << std::endl;
+        return;
+    }
+    bool LimitsSet = true;
+    if (Limits.CpuPercent > 0)
+    {
+        LimitsSet &= WriteControl(GroupPath + "/cpu.max", std::to_string(Limits.CpuPercent * 1000) + " 100000");
+    }
+    if (Limits.MemoryBytes > 0)
+    {
+        LimitsSet &= WriteControl(GroupPath + "/memory.max", std::to_string(Limits.MemoryBytes));
+        // Otherwise a bot over its limit is swapped out instead of stopped.
+        WriteControl(GroupPath + "/memory.swap.max", "0");
+    }
+    if (Limits.MaxProcesses > 0)
+    {
+        LimitsSet &= WriteControl(GroupPath + "/pids.max", std::to_string(Limits.MaxProcesses));
+    }
+    if (!LimitsSet)
+    {
+        PrintThread{} << "Unable to set the limits of cgroup " << GroupPath << std::endl;
+        rmdir(GroupPath.c_str());
+        return;
+    }
+    Path = GroupPath;
+    ProcsFile = Path + "/cgroup.procs";
+    Active = true;
+#else
+    (void)ParentPath;
+    (void)Name;
+#endif
+}
+
+ResourceGroup::~ResourceGroup()
+{
+#ifdef __linux__
+    if (!Active)
+    {
+        return;
+    }
+    // cgroup.kill needs Linux 5.14, on older kernels the proxies have already killed the processes.
+    WriteControl(Path + "/cgroup.kill", "1");
+    for (int Attempt = 0; Attempt < 50; ++Attempt)
+    {
+        if (rmdir(Path.c_str()) == 0 || errno == ENOENT)
+        {
+            return;
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    }
+    PrintThread{} << "Unable to remove cgroup " << Path << ": " << strerror(errno) << std::endl;
+#endif
+}
+
+bool ResourceGroup::AddProcess(unsigned long ProcessId) const
+{
+#ifdef __linux__
+    if (!Limits.Cores.empty())
+    {
+        // The affinity is per thread, threads created later inherit it from their creator.
+        const std::string TaskDirectory = "/proc/" + std::to_string(ProcessId) + "/task";
+        if (DIR *Tasks = opendir(TaskDirectory.c_str()))
+        {
+            while (const dirent *Task = readdir(Tasks))
+            {
+                if (Task->d_name[0] != '.')
+                {
+                    SetAffinity(static_cast<pid_t>(std::atoi(Task->d_name)), Limits.Cores);
+                }
+            }
+            closedir(Tasks);
+        }
+    }
+    return Active && WriteControl(ProcsFile, std::to_string(ProcessId));
+#else
+    (void)ProcessId;
+    return false;
+#endif
+}
+
+void ResourceGroup::EnterFromChild() const
+{
+#if defined(__unix__) || defined(__APPLE__)
+#ifdef __linux__
+    if (!Limits.Cores.empty())
+    {
+        SetAffinity(0, Limits.Cores);
+    }
+    if (Active)
+    {
+        // Writing 0 moves the writing process.
+        const int FileHandle = open(ProcsFile.c_str(), O_WRONLY | O_CLOEXEC);
+        if (FileHandle >= 0)
+        {
+            const bool Moved = write(FileHandle, "0", 1) == 1;
+            close(FileHandle);
+            if (Moved)
+            {
+                return;
+            }
+        }
+    }
+#endif
+    struct rlimit Limit;
+    if (Limits.MemoryBytes > 0 && Limits.LimitAddressSpace)
+    {
+        Limit.rlim_cur = Limit.rlim_max = static_cast<rlim_t>(Limits.MemoryBytes);
+        setrlimit(RLIMIT_AS, &Limit);
+    }
+    // RLIMIT_NPROC counts every process of the user, so it would starve the ladder and the other matches.
+#endif
+}
+
+void ResourceGroup::PinCurrentThread() const
+{
+#ifdef __linux__
+    if (!Limits.Cores.empty() && !SetAffinity(0, Limits.Cores))
+    {
+        PrintThread{} << "Unable to pin thread to the cores of " << (Path.empty() ? "its match" : Path) << ": " << strerror(errno) << std::endl;
+    }
+#endif
+}
+
+void ResourceGroup::ReadUsage(ResourceUsage &Usage) const
+{
+#ifdef __linux__
+    if (!Active)
+    {
+        return;
+    }
+    uint64_t Value = 0;
+    if (ReadControl(Path + "/cpu.stat", "usage_usec", Value))
+    {
+        Usage.CpuMicroseconds = Value;
+        Usage.Measured = true;
+    }
+    // memory.peak needs Linux 5.19.
+    if (ReadControl(Path + "/memory.peak", "", Value))
+    {
+        Usage.PeakMemoryBytes = Value;
+    }
+#else
+    (void)Usage;
+#endif
+}
@@ -0,0 +1,55 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "Types.h"
+
+struct ResourceLimits
+{
+    // Percent of one core, 0 for no limit.
+    uint32_t CpuPercent{0};
+    uint64_t MemoryBytes{0};
+    uint32_t MaxProcesses{0};
+    // Without a cgroup MemoryBytes is only applied if this is set, as an address space limit.
+    // Runtimes that reserve a large heap up front (JVM, .NET, mono, wine) fail to start under it.
+    bool LimitAddressSpace{false};
+    // Cores the processes of the group run on, empty to let the scheduler decide.
+    std::vector<int> Cores;
+
+    bool IsLimited() const
+    {
+        return CpuPercent > 0 || MemoryBytes > 0 || MaxProcesses > 0;
+    }
+};
+
+// A cgroup v2 group for the processes of one part of a match, e.g. a bot or its StarCraft II client.
+// The group is created below ParentPath, which has to be a cgroup the ladder may create groups in.
+// If that is not possible the group is inactive: started bots then get the limits as rlimits
+// (memory only as address space if asked for, no cpu quota or process limit) and no usage is measured.
+class ResourceGroup
+{
+public:
+    ResourceGroup(const std::string &ParentPath, const std::string &Name, const ResourceLimits &InLimits);
+    // Kills what is left in the group and removes it.
+    ~ResourceGroup();
+
+    bool IsActive() const { return Active; }
+    const std::string &GetPath() const { return Path; }
+    const std::vector<int> &GetCores() const { return Limits.Cores; }
+    // Pins all threads of the process to the cores of the group and moves it into the group if active.
+    bool AddProcess(unsigned long ProcessId) const;
+    // Called by a forked child before exec, so it only makes async signal safe calls.
+    void EnterFromChild() const;
+    // Pins the calling thread, used for the proxy threads serving the group.
+    void PinCurrentThread() const;
+    // Replaces the totals in Usage by those of the group, if they could be read.
+    void ReadUsage(ResourceUsage &Usage) const;
+
+private:
+    const ResourceLimits Limits;
+    std::string Path;
+    std::string ProcsFile;
+    bool Active;
+};
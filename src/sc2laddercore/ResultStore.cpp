@@ -0,0 +1,247 @@
+#include "ResultStore.h"
+
+#include <algorithm>
+#include <chrono>
+
+ResultStore::ResultStore(ResultsJournal *InJournal)
+    : Journal(InJournal)
+{
+    if (Journal == nullptr)
+    {
+        return;
+    }
+    const auto Start = std::chrono::steady_clock::now();
+    Journal->ForEach([this](const ResultRecord &Record)
+    {
+        Index(Record);
+    });
+    const auto Elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - Start);
+    PrintThread{} << "Indexed " << Results.size() << " results of " << Names.size() << " bots on " << Maps.size() << " maps in " << Elapsed.count() << "ms" << std::endl;
+}
+
+bool ResultStore::Add(const ResultRecord &Record)
+{
+    // The journal write and the index update happen under one lock, so concurrent
+    // matches can never leave the two disagreeing about the order of results.
+    std::unique_lock<std::shared_timed_mutex> Lock(StoreMutex);
+    bool Written = true;
+    if (Journal != nullptr)
+    {
+        Written = Journal->Append(Record);
+    }
+    Index(Record);
+    return Written;
+}
+
+ResultStore::Outcome ResultStore::GetOutcome(const ResultRecord &Record)
+{
+    if (Record.Winner == Record.Bot1)
+    {
+        return Bot1Won;
+    }
+    if (Record.Winner == Record.Bot2)
+    {
+        return Bot2Won;
+    }
+    if (Record.Winner == "Tie")
+    {
+        return Tied;
+    }
+    return Errored;
+}
+
+void ResultStore::Index(const ResultRecord &Record)
+{
+    StoredResult Result;
+    Result.Bot1 = Intern(Record.Bot1, NameIds, Names);
+    Result.Bot2 = Intern(Record.Bot2, NameIds, Names);
+    Result.Map = Intern(Record.Map, MapIds, Maps);
+    Result.ResultName = Intern(Record.Result, ResultNameIds, ResultNames);
+    Result.GameTime = Record.GameTime;
+    Result.UnixTime = Record.UnixTime;
+    Result.Result = GetOutcome(Record);
+
+    const uint32_t Position = static_cast<uint32_t>(Results.size());
+    Results.push_back(Result);
+
+    ByBot[Result.Bot1].push_back(Position);
+    ByBotMap[Key(Result.Bot1, Result.Map)].push_back(Position);
+    Count(Result, Result.Bot1, HeadToHead[Key(Result.Bot1, Result.Bot2)]);
+    Count(Result, Result.Bot1, BotMapSummary[Key(Result.Bot1, Result.Map)]);
+    Count(Result, Result.Bot1, BotSummary[Result.Bot1]);
+    if (Result.Bot2 != Result.Bot1)
+    {
+        ByBot[Result.Bot2].push_back(Position);
+        ByBotMap[Key(Result.Bot2, Result.Map)].push_back(Position);
+        Count(Result, Result.Bot2, HeadToHead[Key(Result.Bot2, Result.Bot1)]);
+        Count(Result, Result.Bot2, BotMapSummary[Key(Result.Bot2, Result.Map)]);
+        Count(Result, Result.Bot2, BotSummary[Result.Bot2]);
+    }
+
+    // Results nearly always arrive in time order, so this is an append in practice.
+    const auto TimeEntry = std::make_pair(Result.UnixTime, Position);
+    if (ByTime.empty() || ByTime.back() <= TimeEntry)
+    {
+        ByTime.push_back(TimeEntry);
+    }
+    else
+    {
+        ByTime.insert(std::upper_bound(ByTime.begin(), ByTime.end(), TimeEntry), TimeEntry);
+    }
+}
+
+uint32_t ResultStore::Intern(const std::string &Name, std::unordered_map<std::string, uint32_t> &Ids, std::vector<std::string> &Values)
+{
+    auto Inserted = Ids.emplace(Name, static_cast<uint32_t>(Values.size()));
+    if (Inserted.second)
+    {
+        Values.push_back(Name);
+    }
+    return Inserted.first->second;
+}
+
+bool ResultStore::FindId(const std::string &Name, const std::unordered_map<std::string, uint32_t> &Ids, uint32_t &Id) const
+{
+    const auto Found = Ids.find(Name);
+    if (Found == Ids.end())
+    {
+        return false;
+    }
+    Id = Found->second;
+    return true;
+}
+
+void ResultStore::Count(const StoredResult &Result, uint32_t Bot, ResultSummary &Summary)
+{
+    ++Summary.Games;
+    switch (Result.Result)
+    {
+    case Bot1Won:
+        ++(Bot == Result.Bot1 ? Summary.Wins : Summary.Losses);
+        break;
+    case Bot2Won:
+        ++(Bot == Result.Bot2 ? Summary.Wins : Summary.Losses);
+        break;
+    case Tied:
+        ++Summary.Ties;
+        break;
+    case Errored:
+        ++Summary.Errors;
+        break;
+    }
+}
+
+ResultRecord ResultStore::ToRecord(const StoredResult &Result) const
+{
+    ResultRecord Record;
+    Record.Bot1 = Names[Result.Bot1];
+    Record.Bot2 = Names[Result.Bot2];
+    Record.Map = Maps[Result.Map];
+    Record.Result = ResultNames[Result.ResultName];
+    Record.GameTime = Result.GameTime;
+    Record.UnixTime = Result.UnixTime;
+    switch (Result.Result)
+    {
+    case Bot1Won:
+        Record.Winner = Record.Bot1;
+        break;
+    case Bot2Won:
+        Record.Winner = Record.Bot2;
+        break;
+    case Tied:
+        Record.Winner = "Tie";
+        break;
+    case Errored:
+        Record.Winner = "Error";
+        break;
+    }
+    return Record;
+}
+
+ResultSummary ResultStore::GetHeadToHead(const std::string &Bot, const std::string &Opponent) const
+{
+    std::shared_lock<std::shared_timed_mutex> Lock(StoreMutex);
+    uint32_t BotId, OpponentId;
+    if (!FindId(Bot, NameIds, BotId) || !FindId(Opponent, NameIds, OpponentId))
+    {
+        return ResultSummary();
+    }
+    const auto Found = HeadToHead.find(Key(BotId, OpponentId));
+    return Found != HeadToHead.end() ? Found->second : ResultSummary();
+}
+
+ResultSummary ResultStore::GetBotSummary(const std::string &Bot, const std::string &Map) const
+{
+    std::shared_lock<std::shared_timed_mutex> Lock(StoreMutex);
+    uint32_t BotId;
+    if (!FindId(Bot, NameIds, BotId))
+    {
+        return ResultSummary();
+    }
+    if (Map.empty())
+    {
+        const auto Found = BotSummary.find(BotId);
+        return Found != BotSummary.end() ? Found->second : ResultSummary();
+    }
+    uint32_t MapId;
+    if (!FindId(Map, MapIds, MapId))
+    {
+        return ResultSummary();
+    }
+    const auto Found = BotMapSummary.find(Key(BotId, MapId));
+    return Found != BotMapSummary.end() ? Found->second : ResultSummary();
+}
+
+ResultSummary ResultStore::GetRecentSummary(const std::string &Bot, const std::string &Map, size_t LastGames) const
+{
+    std::shared_lock<std::shared_timed_mutex> Lock(StoreMutex);
+    ResultSummary Summary;
+    uint32_t BotId;
+    if (!FindId(Bot, NameIds, BotId))
+    {
+        return Summary;
+    }
+    const std::vector<uint32_t> *Positions = nullptr;
+    if (Map.empty())
+    {
+        const auto Found = ByBot.find(BotId);
+        Positions = Found != ByBot.end() ? &Found->second : nullptr;
+    }
+    else
+    {
+        uint32_t MapId;
+        if (FindId(Map, MapIds, MapId))
+        {
+            const auto Found = ByBotMap.find(Key(BotId, MapId));
+            Positions = Found != ByBotMap.end() ? &Found->second : nullptr;
+        }
+    }
+    if (Positions == nullptr)
+    {
+        return Summary;
+    }
+    const size_t First = Positions->size() > LastGames ? Positions->size() - LastGames : 0;
+    for (size_t i = First; i < Positions->size(); ++i)
+    {
+        Count(Results[(*Positions)[i]], BotId, Summary);
+    }
+    return Summary;
+}
+
+std::vector<ResultRecord> ResultStore::GetResultsBetween(int64_t FromUnixTime, int64_t ToUnixTime) const
+{
+    std::shared_lock<std::shared_timed_mutex> Lock(StoreMutex);
+    std::vector<ResultRecord> Found;
+    auto It = std::lower_bound(ByTime.begin(), ByTime.end(), std::make_pair(FromUnixTime, static_cast<uint32_t>(0)));
+    for (; It != ByTime.end() && It->first <= ToUnixTime; ++It)
+    {
+        Found.push_back(ToRecord(Results[It->second]));
+    }
+    return Found;
+}
+
+size_t ResultStore::Size() const
+{
+    std::shared_lock<std::shared_timed_mutex> Lock(StoreMutex);
+    return Results.size();
+}
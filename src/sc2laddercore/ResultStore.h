@@ -0,0 +1,109 @@
+#pragma once
+
+#include <cstdint>
+#include <shared_mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "ResultsJournal.h"
+
+struct ResultSummary
+{
+    uint32_t Games{0};
+    uint32_t Wins{0};
+    uint32_t Losses{0};
+    uint32_t Ties{0};
+    uint32_t Errors{0};
+
+    float WinRate() const
+    {
+        const uint32_t Decided = Wins + Losses + Ties;
+        return Decided > 0 ? static_cast<float>(Wins) / Decided : 0.0f;
+    }
+};
+
+// In-memory result store with secondary indexes by bot, opponent, map and time.
+// Records are kept in compact form with interned bot and map names and the
+// head-to-head and per map aggregates are updated as results come in.
+// The journal, if given, is the persistent copy: the store is rebuilt from it
+// on construction and every Add is written to it under the same lock.
+class ResultStore
+{
+public:
+    enum Outcome : uint8_t
+    {
+        Bot1Won,
+        Bot2Won,
+        Tied,
+        Errored
+    };
+
+    explicit ResultStore(ResultsJournal *InJournal = nullptr);
+
+    bool Add(const ResultRecord &Record);
+    static Outcome GetOutcome(const ResultRecord &Record);
+
+    // All games of Bot against Opponent, from Bot's point of view.
+    ResultSummary GetHeadToHead(const std::string &Bot, const std::string &Opponent) const;
+    // All games of Bot on Map. An empty map means all maps.
+    ResultSummary GetBotSummary(const std::string &Bot, const std::string &Map = "") const;
+    // The last LastGames games of Bot (on Map if given), counted from the newest.
+    ResultSummary GetRecentSummary(const std::string &Bot, const std::string &Map, size_t LastGames) const;
+    std::vector<ResultRecord> GetResultsBetween(int64_t FromUnixTime, int64_t ToUnixTime) const;
+    size_t Size() const;
+
+    // Calls Visit(Bot1, Bot2, Outcome) for every stored result in the order they were added.
+    template <typename Visitor>
+    void ForEach(Visitor &&Visit) const
+    {
+        std::shared_lock<std::shared_timed_mutex> Lock(StoreMutex);
+        for (const StoredResult &Result : Results)
+        {
+            Visit(Names[Result.Bot1], Names[Result.Bot2], Result.Result);
+        }
+    }
+
+private:
+    struct StoredResult
+    {
+        uint32_t Bot1;
+        uint32_t Bot2;
+        uint32_t Map;
+        uint32_t GameTime;
+        int64_t UnixTime;
+        uint32_t ResultName;
+        Outcome Result;
+    };
+
+    void Index(const ResultRecord &Record);
+    uint32_t Intern(const std::string &Name, std::unordered_map<std::string, uint32_t> &Ids, std::vector<std::string> &Values);
+    bool FindId(const std::string &Name, const std::unordered_map<std::string, uint32_t> &Ids, uint32_t &Id) const;
+    ResultRecord ToRecord(const StoredResult &Result) const;
+    static void Count(const StoredResult &Result, uint32_t Bot, ResultSummary &Summary);
+    static uint64_t Key(uint32_t First, uint32_t Second)
+    {
+        return (static_cast<uint64_t>(First) << 32) | Second;
+    }
+
+    ResultsJournal *Journal;
+    mutable std::shared_timed_mutex StoreMutex;
+
+    std::vector<StoredResult> Results;
+    std::vector<std::string> Names;
+    std::unordered_map<std::string, uint32_t> NameIds;
+    std::vector<std::string> Maps;
+    std::unordered_map<std::string, uint32_t> MapIds;
+    std::vector<std::string> ResultNames;
+    std::unordered_map<std::string, uint32_t> ResultNameIds;
+
+    // Secondary indexes, each a list of positions in Results in insertion order.
+    std::unordered_map<uint32_t, std::vector<uint32_t>> ByBot;
+    std::unordered_map<uint64_t, std::vector<uint32_t>> ByBotMap;
+    std::vector<std::pair<int64_t, uint32_t>> ByTime;
+
+    // Aggregates keyed by (bot, opponent) and (bot, map).
+    std::unordered_map<uint64_t, ResultSummary> HeadToHead;
+    std::unordered_map<uint64_t, ResultSummary> BotMapSummary;
+    std::unordered_map<uint32_t, ResultSummary> BotSummary;
+};
@@ -0,0 +1,362 @@
+#include "ResultsJournal.h"
+
+#include <chrono>
+#include <fstream>
+#include <sstream>
+
+#define RAPIDJSON_HAS_STDSTRING 1
+#include "rapidjson.h"
+#include "document.h"
+#include "ostreamwrapper.h"
+#include "prettywriter.h"
+#include "stringbuffer.h"
+#include "writer.h"
+
+#include "Tools.h"
+
+namespace {
+
+// Only written for bots whose usage was measured, older results have none.
+template <typename Writer>
+void WriteUsage(Writer &writer, const char *Name, const ResourceUsage &Usage)
+{
+    if (!Usage.Measured && !Usage.ProcessMeasured && Usage.Samples == 0)
+    {
+        return;
+    }
+    writer.Key(Name);
+    writer.StartObject();
+    writer.Key("CpuMicroseconds");
+    writer.Uint64(Usage.CpuMicroseconds);
+    writer.Key("PeakMemoryBytes");
+    writer.Uint64(Usage.PeakMemoryBytes);
+    if (Usage.ProcessMeasured)
+    {
+        writer.Key("UserCpuMicroseconds");
+        writer.Uint64(Usage.UserCpuMicroseconds);
+        writer.Key("SystemCpuMicroseconds");
+        writer.Uint64(Usage.SystemCpuMicroseconds);
+        writer.Key("PeakRssBytes");
+        writer.Uint64(Usage.PeakRssBytes);
+        writer.Key("VoluntarySwitches");
+        writer.Uint64(Usage.VoluntarySwitches);
+        writer.Key("InvoluntarySwitches");
+        writer.Uint64(Usage.InvoluntarySwitches);
+    }
+    if (Usage.Samples > 0)
+    {
+        writer.Key("PeakCpuPercent");
+        writer.Double(Usage.PeakCpuPercent);
+        writer.Key("AverageRssBytes");
+        writer.Uint64(Usage.AverageRssBytes);
+        writer.Key("Samples");
+        writer.Uint(Usage.Samples);
+    }
+    writer.EndObject();
+}
+
+template <typename Writer>
+void WriteRecord(Writer &writer, const ResultRecord &Record)
+{
+    writer.StartObject();
+    writer.Key("Bot1");
+    writer.String(Record.Bot1);
+    writer.Key("Bot2");
+    writer.String(Record.Bot2);
+    writer.Key("Winner");
+    writer.String(Record.Winner);
+    writer.Key("Map");
+    writer.String(Record.Map);
+    writer.Key("Result");
+    writer.String(Record.Result);
+    writer.Key("GameTime");
+    writer.Uint(Record.GameTime);
+    writer.Key("TimeStamp");
+    writer.String(Record.TimeStamp);
+    writer.Key("UnixTime");
+    writer.Int64(Record.UnixTime);
+    WriteUsage(writer, "Bot1Usage", Record.Bot1Usage);
+    WriteUsage(writer, "Bot2Usage", Record.Bot2Usage);
+    writer.EndObject();
+}
+
+std::string GetStringMember(const rapidjson::Value &Value, const char *Name)
+{
+    return Value.HasMember(Name) && Value[Name].IsString() ? Value[Name].GetString() : "";
+}
+
+uint64_t GetUint64Member(const rapidjson::Value &Value, const char *Name)
+{
+    return Value.HasMember(Name) && Value[Name].IsUint64() ? Value[Name].GetUint64() : 0;
+}
+
+void ReadUsage(const rapidjson::Value &Value, const char *Name, ResourceUsage &Usage)
+{
+    if (!Value.HasMember(Name) || !Value[Name].IsObject())
+    {
+        return;
+    }
+    const rapidjson::Value &UsageValue = Value[Name];
+    Usage.CpuMicroseconds = GetUint64Member(UsageValue, "CpuMicroseconds");
+    Usage.PeakMemoryBytes = GetUint64Member(UsageValue, "PeakMemoryBytes");
+    Usage.Measured = true;
+    Usage.ProcessMeasured = UsageValue.HasMember("UserCpuMicroseconds");
+    Usage.UserCpuMicroseconds = GetUint64Member(UsageValue, "UserCpuMicroseconds");
+    Usage.SystemCpuMicroseconds = GetUint64Member(UsageValue, "SystemCpuMicroseconds");
+    Usage.PeakRssBytes = GetUint64Member(UsageValue, "PeakRssBytes");
+    Usage.VoluntarySwitches = GetUint64Member(UsageValue, "VoluntarySwitches");
+    Usage.InvoluntarySwitches = GetUint64Member(UsageValue, "InvoluntarySwitches");
+    Usage.PeakCpuPercent = UsageValue.HasMember("PeakCpuPercent") && UsageValue["PeakCpuPercent"].IsNumber() ? UsageValue["PeakCpuPercent"].GetFloat() : 0.0f;
+    Usage.AverageRssBytes = GetUint64Member(UsageValue, "AverageRssBytes");
+    Usage.Samples = static_cast<uint32_t>(GetUint64Member(UsageValue, "Samples"));
+}
+
+bool ReadRecord(const rapidjson::Value &Value, ResultRecord &Record)
+{
+    if (!Value.IsObject())
+    {
+        return false;
+    }
+    Record.Bot1 = GetStringMember(Value, "Bot1");
+    Record.Bot2 = GetStringMember(Value, "Bot2");
+    Record.Winner = GetStringMember(Value, "Winner");
+    Record.Map = GetStringMember(Value, "Map");
+    Record.Result = GetStringMember(Value, "Result");
+    Record.TimeStamp = GetStringMember(Value, "TimeStamp");
+    Record.GameTime = Value.HasMember("GameTime") && Value["GameTime"].IsUint() ? Value["GameTime"].GetUint() : 0;
+    Record.UnixTime = Value.HasMember("UnixTime") && Value["UnixTime"].IsInt64() ? Value["UnixTime"].GetInt64() : 0;
+    ReadUsage(Value, "Bot1Usage", Record.Bot1Usage);
+    ReadUsage(Value, "Bot2Usage", Record.Bot2Usage);
+    return true;
+}
+
+// A crash while a line is written leaves it without its newline.
+bool EndsWithTornLine(const std::string &File)
+{
+    std::ifstream ifs(File, std::ifstream::binary | std::ifstream::ate);
+    if (!ifs || ifs.tellg() <= 0)
+    {
+        return false;
+    }
+    ifs.seekg(-1, std::ifstream::end);
+    char Last = 0;
+    return ifs.get(Last) && Last != '\n';
+}
+
+} // namespace
+
+ResultRecord::ResultRecord(const std::string &InBot1, const std::string &InBot2, const std::string &InMap, const GameResult &InResult)
+    : Bot1(InBot1)
+    , Bot2(InBot2)
+    , Map(InMap)
+    , Result(GetResultType(InResult.Result))
+    , GameTime(InResult.GameLoop)
+    , TimeStamp(InResult.TimeStamp)
+    , UnixTime(static_cast<int64_t>(std::time(nullptr)))
+    , Bot1Usage(InResult.Bot1Usage)
+    , Bot2Usage(InResult.Bot2Usage)
+{
+    switch (InResult.Result)
+    {
+    case ResultType::Player1Win:
+    case ResultType::Player2Crash:
+    case ResultType::Player2TimeOut:
+        Winner = Bot1;
+        break;
+    case ResultType::Player2Win:
+    case ResultType::Player1Crash:
+    case ResultType::Player1TimeOut:
+        Winner = Bot2;
+        break;
+    case ResultType::Tie:
+    case ResultType::Timeout:
+        Winner = "Tie";
+        break;
+    case ResultType::InitializationError:
+    case ResultType::Error:
+    case ResultType::ProcessingReplay:
+        Winner = "Error";
+        break;
+    }
+}
+
+ResultsJournal::ResultsJournal(const std::string &InJournalFile, const std::string &InExportFile, int InSyncIntervalMS)
+    : JournalFile(InJournalFile)
+    , ExportFile(InExportFile)
+    , SyncIntervalMS(InSyncIntervalMS > 0 ? InSyncIntervalMS : 1000)
+    , Journal(nullptr)
+    , PendingSync(0)
+    , Stopping(false)
+{
+    std::ifstream Existing(JournalFile);
+    const bool NewJournal = !Existing.good();
+    Existing.close();
+    const bool TornLine = !NewJournal && EndsWithTornLine(JournalFile);
+    Journal = fopen(JournalFile.c_str(), "ab");
+    if (Journal == nullptr)
+    {
+        PrintThread{} << "Unable to open results journal: " << JournalFile << std::endl;
+        return;
+    }
+    if (TornLine)
+    {
+        // Ends the torn line, so it is skipped on reading and the next result starts a line of its own.
+        PrintThread{} << "The last line of " << JournalFile << " is incomplete, it is ignored." << std::endl;
+        fputc('\n', Journal);
+        SyncFileToDisk(Journal);
+    }
+    if (NewJournal)
+    {
+        ImportExportFile();
+    }
+    SyncThread = std::thread(&ResultsJournal::SyncLoop, this);
+}
+
+ResultsJournal::~ResultsJournal()
+{
+    {
+        std::lock_guard<std::mutex> Lock(JournalMutex);
+        Stopping = true;
+    }
+    SyncCondition.notify_all();
+    if (SyncThread.joinable())
+    {
+        SyncThread.join();
+    }
+    if (Journal != nullptr)
+    {
+        Sync();
+        fclose(Journal);
+    }
+}
+
+bool ResultsJournal::Append(const ResultRecord &Record)
+{
+    rapidjson::StringBuffer Buffer;
+    rapidjson::Writer<rapidjson::StringBuffer> writer(Buffer);
+    WriteRecord(writer, Record);
+    std::string Line(Buffer.GetString(), Buffer.GetSize());
+    Line += '\n';
+
+    std::lock_guard<std::mutex> Lock(JournalMutex);
+    if (Journal == nullptr)
+    {
+        return false;
+    }
+    // One write per line, flushed to the OS right away so a crash of the ladder itself loses nothing.
+    const bool Written = fwrite(Line.data(), 1, Line.size(), Journal) == Line.size() && fflush(Journal) == 0;
+    ++PendingSync;
+    SyncCondition.notify_all();
+    return Written;
+}
+
+void ResultsJournal::Sync()
+{
+    int FileDescriptor = -1;
+    {
+        std::lock_guard<std::mutex> Lock(JournalMutex);
+        if (Journal == nullptr || PendingSync == 0)
+        {
+            return;
+        }
+        // Append has flushed every line to the OS already. The file stays open until the
+        // destructor, which syncs on its own thread, so the descriptor can be synced unlocked.
+        FileDescriptor = fileno(Journal);
+        PendingSync = 0;
+    }
+    // Appends go on while the disk catches up, they are picked up by the next sync.
+    SyncDescriptorToDisk(FileDescriptor);
+}
+
+void ResultsJournal::SyncLoop()
+{
+    std::unique_lock<std::mutex> Lock(JournalMutex);
+    while (!Stopping)
+    {
+        SyncCondition.wait(Lock, [this] { return Stopping || PendingSync > 0; });
+        if (Stopping)
+        {
+            break;
+        }
+        // Give other appends the chance to join this sync.
+        SyncCondition.wait_for(Lock, std::chrono::milliseconds(SyncIntervalMS), [this] { return Stopping; });
+        Lock.unlock();
+        Sync();
+        Lock.lock();
+    }
+}
+
+bool ResultsJournal::ForEach(const std::function<void(const ResultRecord &)> &Visitor) const
+{
+    std::ifstream ifs(JournalFile);
+    if (!ifs)
+    {
+        return false;
+    }
+    std::string Line;
+    while (std::getline(ifs, Line))
+    {
+        rapidjson::Document doc;
+        ResultRecord Record;
+        // A torn last line after a crash is simply skipped.
+        if (Line.empty() || doc.Parse(Line.c_str()).HasParseError() || !ReadRecord(doc, Record))
+        {
+            continue;
+        }
+        Visitor(Record);
+    }
+    return true;
+}
+
+bool ResultsJournal::Export()
+{
+    Sync();
+    const std::string TempFile = ExportFile + ".tmp";
+    {
+        std::ofstream ofs(TempFile.c_str(), std::ofstream::trunc);
+        if (!ofs)
+        {
+            return false;
+        }
+        rapidjson::OStreamWrapper osw(ofs);
+        rapidjson::PrettyWriter<rapidjson::OStreamWrapper> writer(osw);
+        writer.StartObject();
+        writer.Key("Results");
+        writer.StartArray();
+        ForEach([&writer](const ResultRecord &Record)
+        {
+            WriteRecord(writer, Record);
+        });
+        writer.EndArray();
+        writer.EndObject();
+    }
+    return ReplaceFileAtomically(TempFile, ExportFile);
+}
+
+void ResultsJournal::ImportExportFile()
+{
+    // Seed a fresh journal with the results of an existing Results.json so no history is lost.
+    std::ifstream ifs(ExportFile.c_str());
+    if (!ifs)
+    {
+        return;
+    }
+    std::stringstream buffer;
+    buffer << ifs.rdbuf();
+    rapidjson::Document OriginalResults;
+    if (OriginalResults.Parse(buffer.str()).HasParseError() || !OriginalResults.IsObject() || !OriginalResults.HasMember("Results") || !OriginalResults["Results"].IsArray())
+    {
+        return;
+    }
+    size_t Imported = 0;
+    for (const auto &val : OriginalResults["Results"].GetArray())
+    {
+        ResultRecord Record;
+        if (ReadRecord(val, Record) && Append(Record))
+        {
+            ++Imported;
+        }
+    }
+    Sync();
+    PrintThread{} << "Imported " << Imported << " results from " << ExportFile << " into " << JournalFile << std::endl;
+}
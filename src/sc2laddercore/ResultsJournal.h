@@ -0,0 +1,65 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <ctime>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+
+#include "Types.h"
+
+struct ResultRecord
+{
+    std::string Bot1;
+    std::string Bot2;
+    std::string Winner;
+    std::string Map;
+    std::string Result;
+    uint32_t GameTime{0};
+    std::string TimeStamp;
+    int64_t UnixTime{0};
+    ResourceUsage Bot1Usage;
+    ResourceUsage Bot2Usage;
+
+    ResultRecord() {}
+    ResultRecord(const std::string &InBot1, const std::string &InBot2, const std::string &InMap, const GameResult &InResult);
+};
+
+// Append-only, newline delimited log of match results.
+// Every result is a single write at the end of the file, so appending takes the
+// same time no matter how long the history is and a crash can at most lose the
+// line being written: a torn last line is ended when the journal is opened again,
+// so it is skipped and later results are kept. Writes are fsynced in batches by a
+// background thread, without blocking appends.
+// Export() rewrites the journal into the classic Results.json layout.
+class ResultsJournal
+{
+public:
+    ResultsJournal(const std::string &InJournalFile, const std::string &InExportFile, int InSyncIntervalMS = 1000);
+    ~ResultsJournal();
+
+    bool Append(const ResultRecord &Record);
+    void Sync();
+    bool Export();
+
+    // Calls Visitor for every result in the journal, oldest first.
+    bool ForEach(const std::function<void(const ResultRecord &)> &Visitor) const;
+
+private:
+    void ImportExportFile();
+    void SyncLoop();
+
+    const std::string JournalFile;
+    const std::string ExportFile;
+    const int SyncIntervalMS;
+
+    FILE *Journal;
+    std::mutex JournalMutex;
+    size_t PendingSync;
+    bool Stopping;
+    std::condition_variable SyncCondition;
+    std::thread SyncThread;
+};
@@ -0,0 +1,119 @@
+#include "ScheduleCursor.h"
+
+#include <algorithm>
+#include <fstream>
+
+#include "Tools.h"
+#include "Types.h"
+
+ScheduleCursor::ScheduleCursor(const std::string &InFile)
+    : File(InFile)
+{
+}
+
+ScheduleCursor::~ScheduleCursor()
+{
+    if (Handle != nullptr)
+    {
+        fclose(Handle);
+    }
+}
+
+void ScheduleCursor::Open(uint64_t ScheduleId, uint64_t TotalMatches)
+{
+    Position = 0;
+    InFlight.clear();
+    std::ifstream ifs(File);
+    std::string Line;
+    unsigned long long Value = 0;
+    if (!ifs || !std::getline(ifs, Line) || sscanf(Line.c_str(), "Schedule %llu", &Value) != 1 || Value != ScheduleId)
+    {
+        Rewrite(ScheduleId);
+        return;
+    }
+    while (std::getline(ifs, Line))
+    {
+        if (ifs.eof())
+        {
+            // Every record ends with a newline, one without it was torn by a crash.
+            break;
+        }
+        char Type = 0;
+        unsigned int Opponent = UINT32_MAX;
+        if (sscanf(Line.c_str(), "%c %llu %u", &Type, &Value, &Opponent) < 2)
+        {
+            continue;
+        }
+        switch (Type)
+        {
+        case 'C':
+            Position = std::max<uint64_t>(Position, Value);
+            break;
+        case 'S':
+            Position = std::max<uint64_t>(Position, Value + 1);
+            InFlight[Value] = Opponent;
+            break;
+        case 'D':
+            InFlight.erase(Value);
+            break;
+        }
+    }
+    ifs.close();
+    if (Position > TotalMatches)
+    {
+        // The schedule it was written for had more matches, none of its positions can be trusted.
+        PrintThread{} << "Schedule cursor " << File << " is at match " << Position << " of " << TotalMatches << ", starting over." << std::endl;
+        Position = 0;
+        InFlight.clear();
+    }
+    else if (!InFlight.empty())
+    {
+        PrintThread{} << "Resuming " << InFlight.size() << " matches that were in progress." << std::endl;
+    }
+    Rewrite(ScheduleId);
+}
+
+void ScheduleCursor::Start(uint64_t ScheduleId)
+{
+    Position = 0;
+    InFlight.clear();
+    Rewrite(ScheduleId);
+}
+
+void ScheduleCursor::Rewrite(uint64_t ScheduleId)
+{
+    if (Handle != nullptr)
+    {
+        fclose(Handle);
+        Handle = nullptr;
+    }
+    const std::string TempFile = File + ".tmp";
+    FILE *Compacted = fopen(TempFile.c_str(), "wb");
+    if (Compacted == nullptr)
+    {
+        PrintThread{} << "Unable to write schedule cursor: " << TempFile << std::endl;
+        return;
+    }
+    fprintf(Compacted, "Schedule %llu\nC %llu\n", static_cast<unsigned long long>(ScheduleId), static_cast<unsigned long long>(Position));
+    for (const auto &Started : InFlight)
+    {
+        fprintf(Compacted, "S %llu %u\n", static_cast<unsigned long long>(Started.first), static_cast<unsigned int>(Started.second));
+    }
+    SyncFileToDisk(Compacted);
+    fclose(Compacted);
+    ReplaceFileAtomically(TempFile, File);
+    Handle = fopen(File.c_str(), "ab");
+}
+
+bool ScheduleCursor::Append(char Type, uint64_t SchedulePosition, uint32_t Opponent)
+{
+    if (Handle == nullptr)
+    {
+        return false;
+    }
+    if (Type == 'S')
+    {
+        return fprintf(Handle, "S %llu %u\n", static_cast<unsigned long long>(SchedulePosition), static_cast<unsigned int>(Opponent)) > 0 && SyncFileToDisk(Handle);
+    }
+    return fprintf(Handle, "%c %llu\n", Type, static_cast<unsigned long long>(SchedulePosition)) > 0 && SyncFileToDisk(Handle);
+}
@@ -0,0 +1,39 @@
+#pragma once
+
+#include <cstdint>
+#include <cstdio>
+#include <map>
+#include <string>
+
+// Progress through a file schedule, one fsynced record per line:
+// "Schedule <id>" once, then "C <next position>", "S <position> <opponent>" when a match
+// starts and "D <position>" when it is done. The opponent is the index of the bot the match was
+// started with, cursors of older versions leave it out. A torn last line is ignored.
+// The file is rewritten compactly whenever it is opened, so it only grows with the matches of one run.
+class ScheduleCursor
+{
+public:
+    explicit ScheduleCursor(const std::string &InFile);
+    ~ScheduleCursor();
+
+    // Continues where schedule ScheduleId of TotalMatches matches stopped. A cursor of another
+    // schedule, or one that points past the end of this one, starts over at position 0.
+    void Open(uint64_t ScheduleId, uint64_t TotalMatches);
+    // Starts a new schedule at position 0.
+    void Start(uint64_t ScheduleId);
+    // Opponent is only written for a started match, UINT32_MAX if the opponent has no index.
+    bool Append(char Type, uint64_t SchedulePosition, uint32_t Opponent = UINT32_MAX);
+
+    // The first position that was never started.
+    uint64_t GetPosition() const { return Position; }
+    // Position of every match that was started but not completed -> index of its opponent, UINT32_MAX if not known.
+    const std::map<uint64_t, uint32_t> &GetInFlight() const { return InFlight; }
+
+private:
+    void Rewrite(uint64_t ScheduleId);
+
+    const std::string File;
+    FILE *Handle{nullptr};
+    uint64_t Position{0};
+    std::map<uint64_t, uint32_t> InFlight;
+};
@@ -0,0 +1,46 @@
+#include "SchedulePermutation.h"
+
+#include <stdexcept>
+#include <string>
+
+SchedulePermutation::SchedulePermutation(uint64_t InSize, uint64_t InSeed)
+    : Size(InSize)
+    , Seed(InSeed)
+    , HalfBits(1)
+{
+    // The permutation domain is at most 4x larger than the schedule.
+    while (HalfBits < 32 && (uint64_t(1) << (2 * HalfBits)) < Size)
+    {
+        ++HalfBits;
+    }
+}
+
+uint64_t SchedulePermutation::Map(uint64_t Index) const
+{
+    if (Index >= Size)
+    {
+        throw std::out_of_range("Schedule position " + std::to_string(Index) + " is outside a schedule of " + std::to_string(Size) + " matches");
+    }
+    const uint64_t Mask = (uint64_t(1) << HalfBits) - 1;
+    do
+    {
+        uint64_t Left = Index >> HalfBits;
+        uint64_t Right = Index & Mask;
+        for (uint64_t Round = 0; Round < 4; ++Round)
+        {
+            const uint64_t Next = Left ^ (Mix(Right ^ (Seed + Round * 0xD1B54A32D192ED03ULL)) & Mask);
+            Left = Right;
+            Right = Next;
+        }
+        Index = (Left << HalfBits) | Right;
+    } while (Index >= Size);
+    return Index;
+}
+
+uint64_t SchedulePermutation::Mix(uint64_t Value)
+{
+    Value += 0x9E3779B97F4A7C15ULL;
+    Value = (Value ^ (Value >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    Value = (Value ^ (Value >> 27)) * 0x94D049BB133111EBULL;
+    return Value ^ (Value >> 31);
+}
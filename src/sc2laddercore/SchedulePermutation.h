@@ -0,0 +1,24 @@
+#pragma once
+
+#include <cstdint>
+
+// Seeded bijective permutation of [0, Size), the order a generated schedule is played in.
+// A four round Feistel network over the smallest even bit width that covers Size, values
+// outside [0, Size) are permuted again until they land inside it (cycle walking).
+class SchedulePermutation
+{
+public:
+    SchedulePermutation(uint64_t InSize = 0, uint64_t InSeed = 0);
+
+    uint64_t GetSize() const { return Size; }
+    // Index has to be below GetSize(), cycle walking from outside the domain may never end.
+    uint64_t Map(uint64_t Index) const;
+
+    // splitmix64 finaliser, also used to derive choices from schedule positions.
+    static uint64_t Mix(uint64_t Value);
+
+private:
+    uint64_t Size;
+    uint64_t Seed;
+    uint32_t HalfBits;
+};
@@ -1,10 +1,15 @@
 #pragma once
 
+#include <cstdio>
 #include <string>
 #include "Types.h"
 
 
-void StartBotProcess(const BotConfig &Agent, const std::string& CommandLine, unsigned long *ProcessId);
+class ResourceGroup;
+
+// Group may be nullptr. The bot is started inside it, or with its limits as rlimits if it is inactive.
+// Blocks until the bot exits and then fills the process fields of Usage.
+void StartBotProcess(const BotConfig &Agent, const std::string& CommandLine, unsigned long *ProcessId, const ResourceGroup *Group, ResourceUsage *Usage);
 
 void SleepFor(int seconds);
 
@@ -12,10 +17,21 @@ void KillBotProcess(unsigned long pid);
 
 bool MoveReplayFile(const char* lpExistingFileName, const char* lpNewFileName);
 
+// Moves From over To in one step, so To is never missing: it is either the old or the new file.
+bool ReplaceFileAtomically(const std::string &From, const std::string &To);
+
+bool SyncFileToDisk(FILE *File);
+
+// Only waits for the disk, data still buffered in a FILE has to be flushed before.
+bool SyncDescriptorToDisk(int FileDescriptor);
+
 void StartExternalProcess(const std::string &CommandLine);
 
+// The arguments and the location are joined into a shell command, values in them have to be quoted with QuoteShellArgument.
 std::string PerformRestRequest(const std::string &location, const std::vector<std::string> &arguments);
 
+std::string QuoteShellArgument(const std::string &Argument);
+
 bool ZipArchive(const std::string &InDirectory, const std::string &OutArchive);
 
 bool UnzipArchive(const std::string &InArchive, const std::string &OutDirectory);
@@ -26,6 +42,6 @@ void RemoveDirectoryRecursive(std::string Path);
 
 std::string GenerateMD5(std::string& filename);
 
-bool isMapAvailable(const std::string& map_name, const std::string& sc2Path);
+std::string GenerateMD5(const void *Data, size_t Length);
 
 bool MakeDirectory(const std::string& directory_name);
@@ -9,6 +9,7 @@
 #include <fcntl.h>
 #include <signal.h>
 #include <stdio.h>
+#include <sys/resource.h>
 #include <sys/stat.h>
 #include <sys/types.h>
 #include <sys/wait.h>
@@ -16,6 +17,7 @@
 
 #include "Tools.h"
 #include "Types.h"
+#include "ResourceGroup.h"
 
 namespace {
 
@@ -43,7 +45,7 @@ int RedirectOutput(const BotConfig &Agent, int SrcFD, const char *LogFile)
 
 } // namespace
 
-void StartBotProcess(const BotConfig &Agent, const std::string &CommandLine, unsigned long *ProcessId)
+void StartBotProcess(const BotConfig &Agent, const std::string &CommandLine, unsigned long *ProcessId, const ResourceGroup *Group, ResourceUsage *Usage)
 {
     pid_t pID = fork();
 
@@ -58,6 +60,10 @@ void StartBotProcess(const BotConfig &Agent, const std::string &CommandLine, uns
     {
         // Move child to a new process group so that it can not kill the ladderManager
         setpgid(0, 0);
+        if (Group != nullptr)
+        {
+            Group->EnterFromChild();
+        }
         int ret = chdir(Agent.RootPath.c_str());
         if (ret < 0) {
             std::cerr << Agent.BotName +
@@ -115,11 +121,27 @@ void StartBotProcess(const BotConfig &Agent, const std::string &CommandLine, uns
     *ProcessId = pID;
 
     int exit_status = 0;
-    int ret = waitpid(pID, &exit_status, 0);
+    struct rusage BotUsage;
+    int ret = wait4(pID, &exit_status, 0, &BotUsage);
     if (ret < 0) {
         std::cerr << Agent.BotName +
             ": Can't wait for the child process, error:" +
             strerror(errno) << std::endl;
+        return;
+    }
+    if (Usage != nullptr)
+    {
+        Usage->UserCpuMicroseconds = static_cast<uint64_t>(BotUsage.ru_utime.tv_sec) * 1000000 + BotUsage.ru_utime.tv_usec;
+        Usage->SystemCpuMicroseconds = static_cast<uint64_t>(BotUsage.ru_stime.tv_sec) * 1000000 + BotUsage.ru_stime.tv_usec;
+#ifdef __APPLE__
+        Usage->PeakRssBytes = static_cast<uint64_t>(BotUsage.ru_maxrss);
+#else
+        // Linux reports kilobytes.
+        Usage->PeakRssBytes = static_cast<uint64_t>(BotUsage.ru_maxrss) * 1024;
+#endif
+        Usage->VoluntarySwitches = static_cast<uint64_t>(BotUsage.ru_nvcsw);
+        Usage->InvoluntarySwitches = static_cast<uint64_t>(BotUsage.ru_nivcsw);
+        Usage->ProcessMeasured = true;
     }
 }
 
@@ -173,6 +195,27 @@ bool MoveReplayFile(const char* lpExistingFileName, const  char* lpNewFileName)
     return ret == 0;
 }
 
+bool ReplaceFileAtomically(const std::string &From, const std::string &To)
+{
+    // rename() replaces an existing target atomically.
+    if (rename(From.c_str(), To.c_str()) != 0)
+    {
+        std::cerr << "Failed to replace " << To << ", error: " << strerror(errno) << std::endl;
+        return false;
+    }
+    return true;
+}
+
+bool SyncFileToDisk(FILE *File)
+{
+    return fflush(File) == 0 && SyncDescriptorToDisk(fileno(File));
+}
+
+bool SyncDescriptorToDisk(int FileDescriptor)
+{
+    return fsync(FileDescriptor) == 0;
+}
+
 std::string PerformRestRequest(const std::string &location, const std::vector<std::string> &arguments)
 {
 	std::array<char, 10000> buffer;
@@ -192,6 +235,24 @@ std::string PerformRestRequest(const std::string &location, const std::vector<st
 	return result;
 }
 
+std::string QuoteShellArgument(const std::string &Argument)
+{
+	// Nothing is special inside single quotes, a single quote itself has to end the quoting.
+	std::string Quoted = "'";
+	for (const char Character : Argument)
+	{
+		if (Character == '\'')
+		{
+			Quoted += "'\\''";
+		}
+		else
+		{
+			Quoted += Character;
+		}
+	}
+	return Quoted + "'";
+}
+
 bool ZipArchive(const std::string &InDirectory, const std::string &OutArchive)
 {
 	return false;
@@ -202,9 +263,163 @@ bool UnzipArchive(const std::string &InArchive, const std::string &OutDirectory)
 	return false;
 }
 
-std::string GenerateMD5(std::string&)
+namespace {
+
+// Straight implementation of RFC 1321, there is no system crypto library we can rely on.
+class MD5
+{
+public:
+    MD5()
+    {
+        State[0] = 0x67452301;
+        State[1] = 0xefcdab89;
+        State[2] = 0x98badcfe;
+        State[3] = 0x10325476;
+    }
+
+    void Update(const unsigned char *Data, size_t Length)
+    {
+        size_t Index = static_cast<size_t>(TotalLength % 64);
+        TotalLength += Length;
+        for (size_t i = 0; i < Length; ++i)
+        {
+            Buffer[Index++] = Data[i];
+            if (Index == 64)
+            {
+                Transform(Buffer);
+                Index = 0;
+            }
+        }
+    }
+
+    std::string Final()
+    {
+        const uint64_t BitLength = TotalLength * 8;
+        const unsigned char Padding = 0x80;
+        Update(&Padding, 1);
+        const unsigned char Zero = 0;
+        while (TotalLength % 64 != 56)
+        {
+            Update(&Zero, 1);
+        }
+        unsigned char LengthBytes[8];
+        for (int i = 0; i < 8; ++i)
+        {
+            LengthBytes[i] = static_cast<unsigned char>(BitLength >> (8 * i));
+        }
+        Update(LengthBytes, 8);
+
+        static const char hexdigit[] = "0123456789abcdef";
+        std::string Digest;
+        for (int i = 0; i < 4; ++i)
+        {
+            for (int Byte = 0; Byte < 4; ++Byte)
+            {
+                const unsigned char Value = static_cast<unsigned char>(State[i] >> (8 * Byte));
+                Digest += hexdigit[Value >> 4];
+                Digest += hexdigit[Value & 0xf];
+            }
+        }
+        return Digest;
+    }
+
+private:
+    static uint32_t RotateLeft(uint32_t Value, int Bits)
+    {
+        return (Value << Bits) | (Value >> (32 - Bits));
+    }
+
+    void Transform(const unsigned char Block[64])
+    {
+        static const uint32_t K[64] = {
+            0xd76aa478, 0xe8c7b756, 0x242070db, 0xc1bdceee, 0xf57c0faf, 0x4787c62a, 0xa8304613, 0xfd469501,
+            0x698098d8, 0x8b44f7af, 0xffff5bb1, 0x895cd7be, 0x6b901122, 0xfd987193, 0xa679438e, 0x49b40821,
+            0xf61e2562, 0xc040b340, 0x265e5a51, 0xe9b6c7aa, 0xd62f105d, 0x02441453, 0xd8a1e681, 0xe7d3fbc8,
+            0x21e1cde6, 0xc33707d6, 0xf4d50d87, 0x455a14ed, 0xa9e3e905, 0xfcefa3f8, 0x676f02d9, 0x8d2a4c8a,
+            0xfffa3942, 0x8771f681, 0x6d9d6122, 0xfde5380c, 0xa4beea44, 0x4bdecfa9, 0xf6bb4b60, 0xbebfbc70,
+            0x289b7ec6, 0xeaa127fa, 0xd4ef3085, 0x04881d05, 0xd9d4d039, 0xe6db99e5, 0x1fa27cf8, 0xc4ac5665,
+            0xf4292244, 0x432aff97, 0xab9423a7, 0xfc93a039, 0x655b59c3, 0x8f0ccc92, 0xffeff47d, 0x85845dd1,
+            0x6fa87e4f, 0xfe2ce6e0, 0xa3014314, 0x4e0811a1, 0xf7537e82, 0xbd3af235, 0x2ad7d2bb, 0xeb86d391 };
+        static const int Shift[64] = {
+            7, 12, 17, 22, 7, 12, 17, 22, 7, 12, 17, 22, 7, 12, 17, 22,
+            5, 9, 14, 20, 5, 9, 14, 20, 5, 9, 14, 20, 5, 9, 14, 20,
+            4, 11, 16, 23, 4, 11, 16, 23, 4, 11, 16, 23, 4, 11, 16, 23,
+            6, 10, 15, 21, 6, 10, 15, 21, 6, 10, 15, 21, 6, 10, 15, 21 };
+
+        uint32_t M[16];
+        for (int i = 0; i < 16; ++i)
+        {
+            M[i] = static_cast<uint32_t>(Block[i * 4]) | (static_cast<uint32_t>(Block[i * 4 + 1]) << 8)
+                | (static_cast<uint32_t>(Block[i * 4 + 2]) << 16) | (static_cast<uint32_t>(Block[i * 4 + 3]) << 24);
+        }
+        uint32_t A = State[0], B = State[1], C = State[2], D = State[3];
+        for (int i = 0; i < 64; ++i)
+        {
+            uint32_t F;
+            int G;
+            if (i < 16)
+            {
+                F = (B & C) | (~B & D);
+                G = i;
+            }
+            else if (i < 32)
+            {
+                F = (D & B) | (~D & C);
+                G = (5 * i + 1) % 16;
+            }
+            else if (i < 48)
+            {
+                F = B ^ C ^ D;
+                G = (3 * i + 5) % 16;
+            }
+            else
+            {
+                F = C ^ (B | ~D);
+                G = (7 * i) % 16;
+            }
+            const uint32_t Temp = D;
+            D = C;
+            C = B;
+            B = B + RotateLeft(A + F + K[i] + M[G], Shift[i]);
+            A = Temp;
+        }
+        State[0] += A;
+        State[1] += B;
+        State[2] += C;
+        State[3] += D;
+    }
+
+    uint32_t State[4];
+    unsigned char Buffer[64];
+    uint64_t TotalLength{0};
+};
+
+} // namespace
+
+std::string GenerateMD5(std::string& filename)
+{
+    FILE *file = fopen(filename.c_str(), "rb");
+    if (file == nullptr)
+    {
+        std::cerr << "Error opening file " << filename << std::endl;
+        return std::string();
+    }
+    MD5 Hash;
+    std::array<unsigned char, 64 * 1024> buffer;
+    size_t read = 0;
+    while ((read = fread(buffer.data(), 1, buffer.size(), file)) > 0)
+    {
+        Hash.Update(buffer.data(), read);
+    }
+    fclose(file);
+    return Hash.Final();
+}
+
+std::string GenerateMD5(const void *Data, size_t Length)
 {
-    return std::string();
+    MD5 Hash;
+    Hash.Update(static_cast<const unsigned char *>(Data), Length);
+    return Hash.Final();
 }
 
 bool MakeDirectory(const std::string& directory_name)
@@ -4,9 +4,11 @@
 #include "LadderManager.h"
 #include <Windows.h>
 #include <array>
+#include <io.h>
 #include <Wincrypt.h>
+#include <Psapi.h>
 
-void StartBotProcess(const BotConfig &Agent, const std::string &CommandLine, unsigned long *ProcessId)
+void StartBotProcess(const BotConfig &Agent, const std::string &CommandLine, unsigned long *ProcessId, const ResourceGroup *, ResourceUsage *Usage)
 {
 	//////////////////////////////////////////////////////////////////////////////////////////////////
 	// Executes the given command using CreateProcess() and WaitForSingleObject().
@@ -84,6 +86,20 @@ void StartBotProcess(const BotConfig &Agent, const std::string &CommandLine, uns
 		// Get the exit code.
 		result = GetExitCodeProcess(processInformation.hProcess, &exitCode);
 
+		FILETIME creationTime, exitTime, kernelTime, userTime;
+		PROCESS_MEMORY_COUNTERS memoryCounters;
+		if (Usage != nullptr && GetProcessTimes(processInformation.hProcess, &creationTime, &exitTime, &kernelTime, &userTime))
+		{
+			// FILETIME counts 100 nanosecond intervals.
+			Usage->UserCpuMicroseconds = ((static_cast<uint64_t>(userTime.dwHighDateTime) << 32) | userTime.dwLowDateTime) / 10;
+			Usage->SystemCpuMicroseconds = ((static_cast<uint64_t>(kernelTime.dwHighDateTime) << 32) | kernelTime.dwLowDateTime) / 10;
+			if (GetProcessMemoryInfo(processInformation.hProcess, &memoryCounters, sizeof(memoryCounters)))
+			{
+				Usage->PeakRssBytes = memoryCounters.PeakWorkingSetSize;
+			}
+			Usage->ProcessMeasured = true;
+		}
+
 		// Close the handles.
 		CloseHandle(processInformation.hProcess);
 		CloseHandle(processInformation.hThread);
@@ -146,6 +162,21 @@ bool MoveReplayFile(const char* lpExistingFileName, const char* lpNewFileName) {
 	return MoveFile(lpExistingFileName, lpNewFileName);
 }
 
+bool ReplaceFileAtomically(const std::string &From, const std::string &To)
+{
+	return MoveFileEx(From.c_str(), To.c_str(), MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH) != 0;
+}
+
+bool SyncFileToDisk(FILE *File)
+{
+	return fflush(File) == 0 && SyncDescriptorToDisk(_fileno(File));
+}
+
+bool SyncDescriptorToDisk(int FileDescriptor)
+{
+	return _commit(FileDescriptor) == 0;
+}
+
 std::string PerformRestRequest(const std::string &location, const std::vector<std::string> &arguments)
 {
 	std::array<char, 10000> buffer;
@@ -172,6 +203,32 @@ std::string PerformRestRequest(const std::string &location, const std::vector<st
 	return result;
 }
 
+std::string QuoteShellArgument(const std::string &Argument)
+{
+	// Backslashes are only special in front of a quote, where they have to be doubled.
+	std::string Quoted = "\"";
+	size_t Backslashes = 0;
+	for (const char Character : Argument)
+	{
+		if (Character == '\\')
+		{
+			++Backslashes;
+		}
+		else if (Character == '"')
+		{
+			Quoted.append(Backslashes + 1, '\\');
+			Backslashes = 0;
+		}
+		else
+		{
+			Backslashes = 0;
+		}
+		Quoted += Character;
+	}
+	Quoted.append(Backslashes, '\\');
+	return Quoted + "\"";
+}
+
 bool ZipArchive(const std::string &InDirectory, const std::string &OutArchive)
 {
     std::array<char, 10000> buffer;
@@ -294,6 +351,43 @@ std::string GenerateMD5(std::string& filename)
     return ReturnString;
 }
 
+std::string GenerateMD5(const void *Data, size_t Length)
+{
+    constexpr int MD5Len = 16;
+    std::string ReturnString;
+    HCRYPTPROV hProv = 0;
+    HCRYPTHASH hHash = 0;
+    BYTE rgbHash[MD5Len];
+    DWORD cbHash = MD5Len;
+    CHAR rgbDigits[] = "0123456789abcdef";
+    if (!CryptAcquireContext(&hProv, NULL, NULL, PROV_RSA_FULL, CRYPT_VERIFYCONTEXT))
+    {
+        printf("CryptAcquireContext failed: %d\n", GetLastError());
+        return ReturnString;
+    }
+    if (!CryptCreateHash(hProv, CALG_MD5, 0, 0, &hHash))
+    {
+        printf("CryptCreateHash failed: %d\n", GetLastError());
+        CryptReleaseContext(hProv, 0);
+        return ReturnString;
+    }
+    if (CryptHashData(hHash, static_cast<const BYTE *>(Data), static_cast<DWORD>(Length), 0) && CryptGetHashParam(hHash, HP_HASHVAL, rgbHash, &cbHash, 0))
+    {
+        for (DWORD i = 0; i < cbHash; i++)
+        {
+            ReturnString += rgbDigits[rgbHash[i] >> 4];
+            ReturnString += rgbDigits[rgbHash[i] & 0xf];
+        }
+    }
+    else
+    {
+        printf("CryptHashData failed: %d\n", GetLastError());
+    }
+    CryptDestroyHash(hHash);
+    CryptReleaseContext(hProv, 0);
+    return ReturnString;
+}
+
 bool MakeDirectory(const std::string& directory_name)
 {
     return CreateDirectory(directory_name.c_str(), NULL);
@@ -1,28 +1,15 @@
 #pragma once
 
 #include <string>
+#include <vector>
+#include <cstdint>
 #include <sc2api/sc2_api.h>
 #include <ctime>
 #include <sstream>
 #include <iostream>
 #include <iomanip>
 
-class PrintThread : public std::ostringstream
-{
-public:
-    PrintThread() = default;
-
-    ~PrintThread()
-    {
-        std::lock_guard<std::mutex> guard(_mutexPrint);
-        std::time_t t = std::time(nullptr);
-        std::tm tm = *std::localtime(&t);
-        std::cout << std::put_time(&tm, "%d-%m-%Y %H-%M-%S") << ": " << this->str();
-    }
-
-private:
-    static std::mutex _mutexPrint;
-};
+#include "Log.h"
 
 enum BotType
 {
@@ -34,6 +21,8 @@ enum BotType
 	DotNetCore,
     Java,
     NodeJS,
+    // Blizzard's built-in AI, played by the StarCraft II client of its opponent.
+    Computer,
 };
 
 enum class ResultType
@@ -83,6 +72,25 @@ struct GameState
 
 };
 
+struct ResourceUsage
+{
+    // Totals of the bot, from its cgroup if it had one, otherwise from the bot process.
+    uint64_t CpuMicroseconds{0};
+    uint64_t PeakMemoryBytes{0};
+    bool Measured{false};
+    // Of the bot process, from wait4 when it exits.
+    uint64_t UserCpuMicroseconds{0};
+    uint64_t SystemCpuMicroseconds{0};
+    uint64_t PeakRssBytes{0};
+    uint64_t VoluntarySwitches{0};
+    uint64_t InvoluntarySwitches{0};
+    bool ProcessMeasured{false};
+    // Sampled from the bot process while the game runs.
+    float PeakCpuPercent{0.0f};
+    uint64_t AverageRssBytes{0};
+    uint32_t Samples{0};
+};
+
 struct GameResult
 {
     ResultType Result;
@@ -90,12 +98,27 @@ struct GameResult
     float Bot2AvgFrame;
     uint32_t GameLoop;
     std::string TimeStamp;
+    ResourceUsage Bot1Usage;
+    ResourceUsage Bot2Usage;
+    // Standard deviation of the step times in microseconds.
+    float Bot1StepDeviation;
+    float Bot2StepDeviation;
+    // Cores the match was pinned to, empty if it was not.
+    std::vector<int> Cores;
+    // Number of bots that were stopped for taking too long for a step.
+    int StepTimeouts;
+    // Every step time in microseconds, only kept in benchmark mode.
+    std::vector<uint32_t> Bot1StepTimes;
+    std::vector<uint32_t> Bot2StepTimes;
     GameResult()
         : Result(ResultType::InitializationError)
         , Bot1AvgFrame(0)
         , Bot2AvgFrame(0)
         , GameLoop(0)
         , TimeStamp("")
+        , Bot1StepDeviation(0)
+        , Bot2StepDeviation(0)
+        , StepTimeouts(0)
     {}
 
 };
@@ -157,6 +180,10 @@ struct Matchup
     std::string Bot2Checksum;
     std::string Bot2DataChecksum;
     std::string Map;
+    // Position of the match in the file schedule.
+    uint64_t SchedulePosition{0};
+    // Lease of a match handed out by a coordinator, its result has to name it.
+    std::string LeaseId;
 	Matchup() {}
 	Matchup(const BotConfig &InAgent1, const BotConfig &InAgent2, const std::string &InMap)
 		: Agent1(InAgent1),
@@ -290,10 +317,39 @@ static BotType GetTypeFromString(const std::string &TypeIn)
     else if (type == "nodejs")
     {
         return BotType::NodeJS;
+    }
+    else if (type == "computer")
+    {
+        return BotType::Computer;
     }
 	return BotType::BinaryCpp;
 }
 
+static std::string GetTypeString(const BotType TypeIn)
+{
+	switch (TypeIn)
+	{
+	case BotType::CommandCenter:
+		return "CommandCenter";
+	case BotType::Python:
+		return "Python";
+	case BotType::Wine:
+		return "Wine";
+	case BotType::DotNetCore:
+		return "DotNetCore";
+	case BotType::Mono:
+		return "Mono";
+	case BotType::Java:
+		return "Java";
+	case BotType::NodeJS:
+		return "NodeJS";
+	case BotType::Computer:
+		return "Computer";
+	default:
+		return "BinaryCpp";
+	}
+}
+
 static sc2::Difficulty GetDifficultyFromString(const std::string &InDifficulty)
 {
 	if (InDifficulty == "VeryEasy")
@@ -426,6 +482,18 @@ static std::string GetResultType(ResultType InResultType)
 	}
 }
 
+static ResultType GetResultTypeFromString(const std::string &InResultType)
+{
+	for (const ResultType Type : { ResultType::InitializationError, ResultType::Timeout, ResultType::ProcessingReplay, ResultType::Player1Win, ResultType::Player1Crash, ResultType::Player1TimeOut, ResultType::Player2Win, ResultType::Player2Crash, ResultType::Player2TimeOut, ResultType::Tie })
+	{
+		if (GetResultType(Type) == InResultType)
+		{
+			return Type;
+		}
+	}
+	return ResultType::Error;
+}
+
 static std::string RemoveMapExtension(const std::string& filename)
 {
     size_t lastdot = filename.find_last_of(".");
@@ -472,6 +540,28 @@ static ResultType getEndResultFromProxyResults(const ExitCase resultBot1, const
     return ResultType::Error;
 }
 
+// Result of a game against the built-in AI, from the result of the bot's proxy.
+static ResultType getEndResultVsComputer(const ExitCase resultBot, const bool botIsPlayer1)
+{
+    switch (resultBot)
+    {
+    case ExitCase::GameEndVictory:
+        return botIsPlayer1 ? ResultType::Player1Win : ResultType::Player2Win;
+    case ExitCase::GameEndDefeat:
+        return botIsPlayer1 ? ResultType::Player2Win : ResultType::Player1Win;
+    case ExitCase::BotCrashed:
+        return botIsPlayer1 ? ResultType::Player1Crash : ResultType::Player2Crash;
+    case ExitCase::BotStepTimeout:
+        return botIsPlayer1 ? ResultType::Player1TimeOut : ResultType::Player2TimeOut;
+    case ExitCase::GameEndTie:
+        return ResultType::Tie;
+    case ExitCase::GameTimeOver:
+        return ResultType::Timeout;
+    default:
+        return ResultType::Error;
+    }
+}
+
 static std::string statusToString(SC2APIProtocol::Status status)
 {
     switch (status)
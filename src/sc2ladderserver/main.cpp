@@ -12,10 +12,12 @@ int main(int argc, char** argv)
 	PrintThread{} << "LadderManager started." << std::endl;
 
 	LadderManager LadderMan(argc, argv);
+	int ExitCode = 1;
 	if (LadderMan.LoadSetup())
 	{
-		LadderMan.RunLadderManager();
+		ExitCode = LadderMan.RunLadderManager();
 	}
 
 	PrintThread{} << "Finished." << std::endl;
+	return ExitCode;
 }
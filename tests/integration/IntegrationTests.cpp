@@ -21,11 +21,18 @@
 #include <fstream>
 #include <string>
 #include <map>
+#include <sstream>
+#include <cstring>
+
+#define RAPIDJSON_HAS_STDSTRING 1
+#include "document.h"
 
 #include "Types.h"
 #include "LadderConfig.h"
 #include "LadderManager.h"
 #include "MatchupList.h"
+#include "HttpClient.h"
+#include "ResultsJournal.h"
 
 // If we mock the filesystem, we can move this into the unit tests
 bool TestLadderConfig(int argc, char** argv) {
@@ -57,6 +64,45 @@ bool TestLadderConfig(int argc, char** argv) {
 		&& readConfig.GetStringValue("Item3") == item3;
 }
 
+bool TestResultsJournal(int argc, char** argv) {
+	const char *exportFile = "./integration_test_configs/TestResults.json",
+		*journalFile = "./integration_test_configs/TestResults.json.journal";
+	remove(exportFile);
+	remove(journalFile);
+
+	// An existing Results.json is imported into a new journal.
+	{
+		std::ofstream existing(exportFile);
+		existing << "{\"Results\":[{\"Bot1\":\"DebugBot1\",\"Bot2\":\"DebugBot2\",\"Winner\":\"DebugBot1\",\"Map\":\"InterloperLE.SC2Map\",\"Result\":\"Player1Win\",\"GameTime\":100,\"TimeStamp\":\"\"}]}";
+	}
+	size_t results = 0;
+	{
+		ResultsJournal journal(journalFile, exportFile);
+		GameResult result;
+		result.Result = ResultType::Player2Win;
+		for (int i = 0; i < 100; ++i)
+		{
+			journal.Append(ResultRecord("DebugBot1", "DebugBot2", "InterloperLE.SC2Map", result));
+		}
+		journal.Export();
+	}
+
+	std::ifstream exported(exportFile);
+	std::stringstream buffer;
+	buffer << exported.rdbuf();
+	rapidjson::Document doc;
+	if (doc.Parse(buffer.str().c_str()).HasParseError() || !doc.HasMember("Results") || !doc["Results"].IsArray())
+	{
+		return false;
+	}
+	results = doc["Results"].Size();
+	const bool winnerIsBot2 = std::string(doc["Results"][1]["Winner"].GetString()) == "DebugBot2";
+	exported.close();
+	remove(exportFile);
+	remove(journalFile);
+	return results == 101 && winnerIsBot2;
+}
+
 bool TestMatch_Bot1Eliminated(int argc, char** argv) {
 	try
 	{
@@ -82,6 +128,119 @@ bool TestMatch_Bot1Eliminated(int argc, char** argv) {
 	}
 }
 
+// Stand-in for the ladder website, served by civetweb on localhost.
+namespace HttpStandIn {
+
+int LastRemotePort = 0;
+int FlakyCalls = 0;
+
+void Reply(struct mg_connection *conn, int status, const std::string &body, const std::string &extraHeaders = "")
+{
+	mg_printf(conn, "HTTP/1.1 %d X\r\nContent-Length: %d\r\nConnection: keep-alive\r\n%s\r\n", status, static_cast<int>(body.size()), extraHeaders.c_str());
+	mg_write(conn, body.data(), body.size());
+}
+
+size_t ReadBody(struct mg_connection *conn)
+{
+	char buffer[4096];
+	size_t total = 0;
+	int read = 0;
+	while ((read = mg_read(conn, buffer, sizeof(buffer))) > 0)
+	{
+		total += static_cast<size_t>(read);
+	}
+	return total;
+}
+
+int Login(struct mg_connection *conn, void *)
+{
+	ReadBody(conn);
+	LastRemotePort = mg_get_request_info(conn)->remote_port;
+	Reply(conn, 200, "{\"result\":true}", "Set-Cookie: session=ladder; Path=/\r\n");
+	return 200;
+}
+
+int Echo(struct mg_connection *conn, void *)
+{
+	const size_t bodySize = ReadBody(conn);
+	const char *cookie = mg_get_header(conn, "Cookie");
+	const bool sameConnection = mg_get_request_info(conn)->remote_port == LastRemotePort;
+	Reply(conn, 200, std::string(cookie ? cookie : "") + " " + std::to_string(bodySize) + " " + (sameConnection ? "reused" : "new"));
+	return 200;
+}
+
+int Download(struct mg_connection *conn, void *)
+{
+	ReadBody(conn);
+	Reply(conn, 200, std::string(256 * 1024, 'x'));
+	return 200;
+}
+
+int Flaky(struct mg_connection *conn, void *)
+{
+	ReadBody(conn);
+	++FlakyCalls;
+	Reply(conn, FlakyCalls < 2 ? 503 : 200, "flaky");
+	return 200;
+}
+
+} // namespace HttpStandIn
+
+bool TestHttpClient(int argc, char** argv) {
+	const char *options[] = { "listening_ports", "127.0.0.1:18765", "enable_keep_alive", "yes", "num_threads", "2", nullptr };
+	struct mg_callbacks callbacks;
+	memset(&callbacks, 0, sizeof(callbacks));
+	struct mg_context *ctx = mg_start(&callbacks, nullptr, options);
+	if (ctx == nullptr)
+	{
+		std::cerr << "Unable to start the http stand-in server" << std::endl;
+		return false;
+	}
+	mg_set_request_handler(ctx, "/login", HttpStandIn::Login, nullptr);
+	mg_set_request_handler(ctx, "/echo", HttpStandIn::Echo, nullptr);
+	mg_set_request_handler(ctx, "/download", HttpStandIn::Download, nullptr);
+	mg_set_request_handler(ctx, "/flaky", HttpStandIn::Flaky, nullptr);
+
+	const std::string server = "http://127.0.0.1:18765";
+	const char *uploadFile = "./integration_test_configs/HttpUpload.bin";
+	const char *downloadFile = "./integration_test_configs/HttpDownload.bin";
+	{
+		std::ofstream upload(uploadFile, std::ios::binary);
+		upload << std::string(100 * 1024, 'u');
+	}
+
+	bool success = true;
+	HttpClient client(5000, 3);
+
+	// Login sets a cookie that has to be sent with the following requests over the same connection.
+	std::vector<HttpFormField> loginFields{ HttpFormField("Username", "user"), HttpFormField("Password", "pass") };
+	success &= client.PostForm(server + "/login", loginFields) == "{\"result\":true}";
+	const std::string echo = client.PostForm(server + "/echo", { HttpFormField("BotFile", uploadFile, true) });
+	success &= echo.find("session=ladder") == 0;
+	success &= echo.find("reused") != std::string::npos;
+
+	// Multipart upload streams the whole file.
+	const size_t uploadedBytes = std::stoul(echo.substr(echo.find(' ') + 1));
+	success &= uploadedBytes > 100 * 1024;
+
+	// Downloads go straight to disk.
+	HttpResponse response;
+	remove(downloadFile);
+	success &= client.DownloadForm(server + "/download", { HttpFormField("BotName", "DebugBot1") }, downloadFile, response);
+	std::ifstream downloaded(downloadFile, std::ios::binary | std::ios::ate);
+	success &= downloaded && downloaded.tellg() == 256 * 1024;
+	success &= response.Body.empty();
+
+	// Server errors are retried.
+	success &= client.Get(server + "/flaky") == "flaky";
+	success &= HttpStandIn::FlakyCalls == 2;
+
+	mg_stop(ctx);
+	remove(uploadFile);
+	remove(downloadFile);
+	return success;
+}
+
 // Handy macro from: s2client-api/tests/all_tests.cc
 #define TEST(X)                                                     \
     std::cout << "Running integration test: " << #X << std::endl;   \
@@ -98,6 +257,10 @@ int main(int argc, char** argv) {
 
 	TEST(TestLadderConfig);
 
+	TEST(TestHttpClient);
+
+	TEST(TestResultsJournal);
+
 	TEST(TestMatch_Bot1Eliminated);
 	//TEST(TestMatch_Bot2Eliminated);
 	//TEST(sc2ai::TestMatch_Bot1Leave);
@@ -1,4 +1,26 @@
+#include <cstdio>
+#include <fstream>
 #include <iostream>
+#include <set>
+#include <sstream>
+#include <stdexcept>
+
+#include "BotDataSync.h"
+#include "ConcurrencyGovernor.h"
+#include "CorePlanner.h"
+#include "FileWatcher.h"
+#include "MapCatalog.h"
+#include "MatchLeases.h"
+#include "PairingIndex.h"
+#include "PendingResponses.h"
+#include "RatingEngine.h"
+#include "ReplayArchive.h"
+#include "ReplayRename.h"
+#include "ResultStore.h"
+#include "ResultsJournal.h"
+#include "ScheduleCursor.h"
+#include "SchedulePermutation.h"
+#include "Tools.h"
 
 bool UnitTest_Dummy(int argc, char** argv) {
 	try
@@ -14,6 +36,778 @@ bool UnitTest_Dummy(int argc, char** argv) {
 	}
 }
 
+static ResultRecord MakeRecord(const std::string &Bot1, const std::string &Bot2, const std::string &Winner, const std::string &Map, int64_t UnixTime)
+{
+	ResultRecord Record;
+	Record.Bot1 = Bot1;
+	Record.Bot2 = Bot2;
+	Record.Winner = Winner;
+	Record.Map = Map;
+	Record.Result = Winner == Bot1 ? "Player1Win" : Winner == Bot2 ? "Player2Win" : Winner;
+	Record.UnixTime = UnixTime;
+	return Record;
+}
+
+bool UnitTest_ResultStore(int argc, char** argv) {
+	try
+	{
+		ResultStore Store;
+		Store.Add(MakeRecord("A", "B", "A", "Map1", 100));
+		Store.Add(MakeRecord("B", "A", "B", "Map2", 200));
+		Store.Add(MakeRecord("A", "C", "A", "Map1", 300));
+		Store.Add(MakeRecord("C", "A", "Tie", "Map2", 150));
+		Store.Add(MakeRecord("A", "B", "Error", "Map1", 400));
+
+		const ResultSummary HeadToHead = Store.GetHeadToHead("A", "B");
+		if (HeadToHead.Games != 3 || HeadToHead.Wins != 1 || HeadToHead.Losses != 1 || HeadToHead.Errors != 1)
+			return false;
+		if (Store.GetHeadToHead("B", "A").Wins != 1 || Store.GetHeadToHead("A", "Unknown").Games != 0)
+			return false;
+		const ResultSummary OnMap1 = Store.GetBotSummary("A", "Map1");
+		if (OnMap1.Games != 3 || OnMap1.Wins != 2 || Store.GetBotSummary("A").Games != 5)
+			return false;
+		const ResultSummary Recent = Store.GetRecentSummary("A", "", 2);
+		if (Recent.Games != 2 || Recent.Ties != 1 || Recent.Errors != 1)
+			return false;
+		const std::vector<ResultRecord> Between = Store.GetResultsBetween(150, 300);
+		if (Between.size() != 3 || Between[0].UnixTime != 150 || Between[2].Winner != "A")
+			return false;
+		return Store.Size() == 5;
+	}
+	catch (const std::exception& e)
+	{
+		std::cerr << "Exception in UnitTest_ResultStore" << std::endl;
+		std::cerr << e.what() << std::endl;
+		return false;
+	}
+}
+
+bool UnitTest_ResultsJournalUsage(int argc, char** argv) {
+	try
+	{
+		const std::string JournalFile = "UnitTest_ResultsJournalUsage.journal";
+		std::remove(JournalFile.c_str());
+		GameResult Result;
+		Result.Result = ResultType::Player1Win;
+		Result.Bot1Usage.Measured = true;
+		Result.Bot1Usage.ProcessMeasured = true;
+		Result.Bot1Usage.CpuMicroseconds = 3000000;
+		Result.Bot1Usage.UserCpuMicroseconds = 2500000;
+		Result.Bot1Usage.PeakRssBytes = 1 << 30;
+		Result.Bot1Usage.InvoluntarySwitches = 42;
+		Result.Bot1Usage.Samples = 10;
+		std::vector<ResultRecord> Read;
+		{
+			ResultsJournal Journal(JournalFile, "");
+			Journal.Append(ResultRecord("A", "B", "Map1", Result));
+			Journal.Sync();
+			Journal.ForEach([&Read](const ResultRecord &Record) { Read.push_back(Record); });
+		}
+		std::remove(JournalFile.c_str());
+		if (Read.size() != 1 || Read[0].Winner != "A")
+			return false;
+		const ResourceUsage &Usage = Read[0].Bot1Usage;
+		if (!Usage.ProcessMeasured || Usage.CpuMicroseconds != 3000000 || Usage.UserCpuMicroseconds != 2500000 || Usage.PeakRssBytes != (1 << 30) || Usage.InvoluntarySwitches != 42 || Usage.Samples != 10)
+			return false;
+		// Bots without measurements are not written.
+		return !Read[0].Bot2Usage.Measured;
+	}
+	catch (const std::exception& e)
+	{
+		std::cerr << "Exception in UnitTest_ResultsJournalUsage" << std::endl;
+		std::cerr << e.what() << std::endl;
+		return false;
+	}
+}
+
+bool UnitTest_MatchLeases(int argc, char** argv) {
+	try
+	{
+		MatchLeases Leases(60);
+		const MatchLeases::Clock::time_point Start = MatchLeases::Clock::now();
+		BotConfig A;
+		A.BotName = "A";
+		BotConfig B;
+		B.BotName = "B";
+		const std::string First = Leases.Add(Matchup(A, B, "Map1"), "Worker1", Start);
+		const std::string Second = Leases.Add(Matchup(B, A, "Map2"), "Worker2", Start);
+		if (First == Second || Leases.GetActiveCount() != 2)
+			return false;
+		if (!Leases.IsPlaying("A") || Leases.IsPlaying("C"))
+			return false;
+		// Only the lease without heartbeats runs out.
+		if (!Leases.Renew(First, Start + std::chrono::seconds(50)) || Leases.Expire(Start + std::chrono::seconds(70)) != 1)
+			return false;
+		Matchup Returned;
+		if (!Leases.TakeReturned(Returned) || Returned.Map != "Map2" || Leases.TakeReturned(Returned))
+			return false;
+		// A late result of the expired lease is not accepted, the new lease's is.
+		Matchup Completed;
+		const std::string Third = Leases.Add(Returned, "Worker1", Start + std::chrono::seconds(70));
+		if (Leases.Complete(Second, Completed) || !Leases.Complete(Third, Completed) || Completed.Map != "Map2" || Completed.LeaseId != Third)
+			return false;
+		if (!Leases.Release(First) || Leases.GetActiveCount() != 0 || Leases.GetReturnedCount() != 1 || Leases.IsPlaying("A"))
+			return false;
+		if (Leases.Renew(First, Start + std::chrono::seconds(80)))
+			return false;
+		// A match that keeps coming back is given up after two leases.
+		MatchLeases Limited(60, 2);
+		Matchup Failing(A, B, "Map3");
+		Failing.SchedulePosition = 7;
+		Limited.Release(Limited.Add(Failing, "Worker1", Start));
+		Matchup Again;
+		if (!Limited.TakeReturned(Again) || Limited.GetAbandonedCount() != 0)
+			return false;
+		Limited.Add(Again, "Worker2", Start);
+		if (Limited.Expire(Start + std::chrono::seconds(61)) != 1 || Limited.TakeReturned(Again) || !Limited.TakeAbandoned(Again))
+			return false;
+		return Again.SchedulePosition == 7 && Limited.GetAbandonedCount() == 0;
+	}
+	catch (const std::exception& e)
+	{
+		std::cerr << "Exception in UnitTest_MatchLeases" << std::endl;
+		std::cerr << e.what() << std::endl;
+		return false;
+	}
+}
+
+bool UnitTest_ReplayArchive(int argc, char** argv) {
+	try
+	{
+		const std::string Directory = "UnitTest_ReplayArchive";
+		RemoveDirectoryRecursive(Directory);
+		const std::string Replay(64 * 1024, 'r');
+		const auto WriteReplay = [](const std::string &File, const std::string &Content)
+		{
+			std::ofstream(File, std::ofstream::binary) << Content;
+		};
+		WriteReplay("AvB-Map1.SC2Replay", Replay);
+		WriteReplay("BvA-Map1.SC2Replay", Replay);
+		WriteReplay("AvB-Map2.SC2Replay", "other");
+		ArchivedReplay Entry;
+		Entry.Bot1 = "A";
+		Entry.Bot2 = "B";
+		Entry.Map = "Map1";
+		Entry.MatchId = "1-1";
+		std::string First, Second, Third, Duplicate;
+		{
+			ReplayArchive Archive(Directory, true);
+			First = Archive.Add("AvB-Map1.SC2Replay", Entry);
+			Entry.MatchId.clear();
+			Second = Archive.Add("BvA-Map1.SC2Replay", Entry);
+			Entry.Map = "Map2";
+			Third = Archive.Add("AvB-Map2.SC2Replay", Entry);
+			Archive.Flush();
+			// Identical replays are stored once, the ids stay apart.
+			ArchivedReplay Found1, Found2;
+			if (First != "1-1" || Second.empty() || Second == First || !Archive.Find(First, Found1) || !Archive.Find(Second, Found2) || Found1.Hash != Found2.Hash || Found1.Map != "Map1")
+				return false;
+			if (Archive.GetReplayBytes() != 2 * Replay.size() + 5 || Archive.GetStoredBytes() > Replay.size() + 5)
+				return false;
+			if (std::ifstream("AvB-Map1.SC2Replay") || std::ifstream("AvB-Map2.SC2Replay"))
+				return false;
+			WriteReplay("AvB-Map1.SC2Replay", "again");
+			Entry.MatchId = "1-1";
+			Duplicate = Archive.Add("AvB-Map1.SC2Replay", Entry);
+		}
+		// Replays left in staging by a crash are archived when the archive is opened again.
+		WriteReplay(Directory + "/staging/2-1.SC2Replay", "staged");
+		WriteReplay(Directory + "/staging/2-1.SC2Replay.json", "{\"MatchId\":\"2-1\",\"Bot1\":\"C\",\"Bot2\":\"D\",\"Map\":\"Map3\"}");
+		WriteReplay(Directory + "/staging/2-2.SC2Replay", "unnamed");
+		// The index is read back and the replays come out as they went in.
+		ReplayArchive Reopened(Directory, true);
+		Reopened.Flush();
+		ArchivedReplay Found;
+		if (Duplicate.empty() || Duplicate == First || !Reopened.Find(Duplicate, Found) || !Reopened.Find(Third, Found) || Found.Map != "Map2")
+			return false;
+		if (!Reopened.Find("2-1", Found) || Found.Bot1 != "C" || Found.Map != "Map3" || !Reopened.Find("2-2", Found) || std::ifstream(Directory + "/staging/2-1.SC2Replay"))
+			return false;
+		bool Extracted = Reopened.Extract(First, "Extracted.SC2Replay");
+		std::stringstream Content;
+		Content << std::ifstream("Extracted.SC2Replay", std::ifstream::binary).rdbuf();
+		std::remove("Extracted.SC2Replay");
+		RemoveDirectoryRecursive(Directory);
+		return Extracted && Content.str() == Replay && !Reopened.Find("unknown", Found);
+	}
+	catch (const std::exception& e)
+	{
+		std::cerr << "Exception in UnitTest_ReplayArchive" << std::endl;
+		std::cerr << e.what() << std::endl;
+		return false;
+	}
+}
+
+bool UnitTest_ReplayRename(int argc, char** argv) {
+	try
+	{
+		// A replay with the user data and version 4 header of the game and an uncompressed
+		// replay.details whose player list has the players foo5679 and foo5680.
+		const unsigned char Replay[] = {
+			0x4d, 0x50, 0x51, 0x1b, 0x00, 0x00, 0x00, 0x00, 0x10, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+			0x4d, 0x50, 0x51, 0x1a, 0xd0, 0x00, 0x00, 0x00, 0x3f, 0x01, 0x00, 0x00, 0x03, 0x00, 0x03, 0x00,
+			0xef, 0x00, 0x00, 0x00, 0x2f, 0x01, 0x00, 0x00, 0x04, 0x00, 0x00, 0x00, 0x01, 0x00, 0x00, 0x00,
+			0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x3f, 0x01, 0x00, 0x00,
+			0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+			0x00, 0x00, 0x00, 0x00, 0x40, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x10, 0x00, 0x00, 0x00,
+			0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+			0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+			0x7e, 0xad, 0xbd, 0xa3, 0x6a, 0x4c, 0xbf, 0x67, 0xd8, 0x87, 0x84, 0x8a, 0x9a, 0xf2, 0xdc, 0x05,
+			0xc1, 0x79, 0x9e, 0x0a, 0x16, 0x72, 0x02, 0x02, 0xd4, 0x4a, 0x02, 0x3c, 0x0b, 0x8e, 0xdf, 0xd3,
+			0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+			0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+			0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+			0xa6, 0x8e, 0xd5, 0x7f, 0x04, 0xab, 0x48, 0x4d, 0x99, 0x84, 0xf7, 0x82, 0x2b, 0x8f, 0x77, 0xec,
+			0x05, 0x02, 0x00, 0x04, 0x01, 0x00, 0x04, 0x05, 0x02, 0x00, 0x02, 0x0e, 0x66, 0x6f, 0x6f, 0x35,
+			0x36, 0x37, 0x39, 0x05, 0x02, 0x00, 0x02, 0x0e, 0x66, 0x6f, 0x6f, 0x35, 0x36, 0x38, 0x30, 0x33,
+			0x30, 0xc3, 0x79, 0x28, 0xd9, 0x32, 0x98, 0xbc, 0x73, 0x6f, 0x9f, 0xb2, 0x88, 0x4e, 0xe9, 0x17,
+			0xa2, 0x04, 0x84, 0xc4, 0x40, 0xbf, 0xca, 0x63, 0xbf, 0x7b, 0x98, 0x0c, 0xe7, 0x19, 0x7e, 0x4e,
+			0x96, 0xcf, 0x65, 0x0f, 0xb6, 0xa3, 0xc8, 0xcb, 0xd7, 0x39, 0x1b, 0x7f, 0x75, 0x4e, 0xbc, 0x9e,
+			0x40, 0xb7, 0x2f, 0xa7, 0x8f, 0xc5, 0xfc, 0x28, 0x67, 0xd4, 0x9d, 0x5a, 0x65, 0xd8, 0x83, 0x5b,
+			0x67, 0x48, 0x3d, 0x4e, 0xd4, 0x08, 0xca, 0xbd, 0xd1, 0x35, 0xf8, 0x97, 0x62, 0x36, 0xe8,
+		};
+		const std::string ReplayFile = "UnitTest_ReplayRename.SC2Replay";
+		std::ofstream(ReplayFile, std::ofstream::binary).write(reinterpret_cast<const char *>(Replay), sizeof(Replay));
+		const bool Renamed = RenameReplayPlayers(ReplayFile, { { "foo5679", "Bot1" }, { "foo5680", "A bot with a name longer than sixty-three characters, the length takes two bytes" } });
+		std::string Details;
+		const bool Read = ReadReplayFile(ReplayFile, "replay.details", Details);
+		std::remove(ReplayFile.c_str());
+		if (!Renamed || !Read)
+			return false;
+		return Details.find("Bot1") != std::string::npos && Details.find("two bytes") != std::string::npos && Details.find("foo56") == std::string::npos;
+	}
+	catch (const std::exception& e)
+	{
+		std::cerr << "Exception in UnitTest_ReplayRename" << std::endl;
+		std::cerr << e.what() << std::endl;
+		return false;
+	}
+}
+
+bool UnitTest_ReplayRenameCompressed(int argc, char** argv) {
+#ifndef SC2LADDER_HAVE_BZIP2
+	// Without bzip2 these replays are left to ReplayBotRenameProgram.
+	return true;
+#endif
+	try
+	{
+		// A replay whose replay.details is split into three 512 byte sectors compressed with bzip2,
+		// as the game writes them. The players foo5679 and foo5680 are in the second sector,
+		// between a 600 and a 700 byte blob.
+		const unsigned char Replay[] = {
+			0x4d, 0x50, 0x51, 0x1b, 0x00, 0x00, 0x00, 0x00, 0x10, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+			0x4d, 0x50, 0x51, 0x1a, 0x20, 0x00, 0x00, 0x00, 0x30, 0x01, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+			0xe0, 0x00, 0x00, 0x00, 0x20, 0x01, 0x00, 0x00, 0x04, 0x00, 0x00, 0x00, 0x01, 0x00, 0x00, 0x00,
+			0x10, 0x00, 0x00, 0x00, 0x45, 0x00, 0x00, 0x00, 0x92, 0x00, 0x00, 0x00, 0xc0, 0x00, 0x00, 0x00,
+			0x10, 0x42, 0x5a, 0x68, 0x39, 0x31, 0x41, 0x59, 0x26, 0x53, 0x59, 0x1e, 0x37, 0x38, 0x4c, 0x00,
+			0x00, 0x01, 0x41, 0x08, 0xd3, 0x20, 0x20, 0x00, 0x40, 0x00, 0x00, 0x88, 0x20, 0x00, 0x21, 0xa6,
+			0x86, 0x99, 0x08, 0x32, 0x62, 0x30, 0xbd, 0x71, 0xc1, 0x50, 0x8f, 0x17, 0x72, 0x45, 0x38, 0x50,
+			0x90, 0x1e, 0x37, 0x38, 0x4c, 0x10, 0x42, 0x5a, 0x68, 0x39, 0x31, 0x41, 0x59, 0x26, 0x53, 0x59,
+			0x08, 0xe0, 0xa6, 0xda, 0x00, 0x00, 0x0e, 0x4b, 0x40, 0xd6, 0x11, 0x43, 0xe0, 0x00, 0x10, 0x31,
+			0x00, 0xc0, 0x00, 0x00, 0x48, 0x20, 0x00, 0x21, 0x2a, 0x1a, 0x00, 0xd0, 0x34, 0x14, 0xc2, 0x69,
+			0xa0, 0x34, 0xc4, 0x7b, 0x90, 0x54, 0x23, 0x48, 0x41, 0x5a, 0x86, 0x7a, 0x29, 0x93, 0x5b, 0x06,
+			0xf7, 0x18, 0x73, 0x16, 0x3c, 0x22, 0xbf, 0xe2, 0xee, 0x48, 0xa7, 0x0a, 0x12, 0x01, 0x1c, 0x14,
+			0xdb, 0x40, 0x10, 0x42, 0x5a, 0x68, 0x39, 0x31, 0x41, 0x59, 0x26, 0x53, 0x59, 0x75, 0x1f, 0x6c,
+			0x3f, 0x00, 0x00, 0x02, 0x89, 0x00, 0x81, 0x00, 0x10, 0x00, 0x00, 0x08, 0x20, 0x00, 0x20, 0xaa,
+			0x6d, 0x41, 0x98, 0xc5, 0x47, 0x8b, 0xb9, 0x22, 0x9c, 0x28, 0x48, 0x3a, 0x8f, 0xb6, 0x1f, 0x80,
+			0x33, 0x30, 0xc3, 0x79, 0x28, 0xd9, 0x32, 0x98, 0xbc, 0x73, 0x6f, 0x9f, 0xb2, 0x88, 0x4e, 0xe9,
+			0x17, 0xa2, 0x04, 0x84, 0xc4, 0x40, 0xbf, 0xca, 0x63, 0xbf, 0x7b, 0x98, 0x0c, 0xe7, 0x19, 0x7e,
+			0x4e, 0x96, 0xcf, 0x65, 0x0f, 0xb6, 0xa3, 0xc8, 0xcb, 0xd7, 0x39, 0x1b, 0x7f, 0x75, 0x4e, 0xbc,
+			0x9e, 0x40, 0xb7, 0x2f, 0xa7, 0x8f, 0xc5, 0xfc, 0x28, 0x67, 0xd4, 0x9d, 0x5a, 0x65, 0xd8, 0x83,
+			0xab, 0x67, 0x48, 0x3d, 0x61, 0xd3, 0x08, 0xca, 0xaa, 0xbe, 0x35, 0xf8, 0xc2, 0x8d, 0x33, 0xe8,
+		};
+		const std::string ReplayFile = "UnitTest_ReplayRenameCompressed.SC2Replay";
+		std::ofstream(ReplayFile, std::ofstream::binary).write(reinterpret_cast<const char *>(Replay), sizeof(Replay));
+		std::string Original;
+		const bool ReadOriginal = ReadReplayFile(ReplayFile, "replay.details", Original);
+		// A replay without any of the names is reported, not taken as renamed.
+		const bool RenamedUnknown = RenameReplayPlayers(ReplayFile, { { "foo1234", "Bot1" } });
+		const bool Renamed = RenameReplayPlayers(ReplayFile, { { "foo5679", "Bot1" }, { "foo5680", "Bot2" } });
+		std::string Details;
+		const bool Read = ReadReplayFile(ReplayFile, "replay.details", Details);
+		std::remove(ReplayFile.c_str());
+		if (!ReadOriginal || Original.size() != 1337 || Original.find("foo5679") == std::string::npos || RenamedUnknown || !Renamed || !Read)
+			return false;
+		return Details.size() == Original.size() - 6 && Details.find("Bot1") != std::string::npos && Details.find("Bot2") != std::string::npos
+			&& Details.find("foo56") == std::string::npos && Details.find(std::string(600, 'a')) != std::string::npos && Details.find(std::string(700, 'b')) != std::string::npos;
+	}
+	catch (const std::exception& e)
+	{
+		std::cerr << "Exception in UnitTest_ReplayRenameCompressed" << std::endl;
+		std::cerr << e.what() << std::endl;
+		return false;
+	}
+}
+
+// Every one of Slots plays LoopsPerSecond game loops per second for the minute after Start.
+static void PlayMinute(ConcurrencyGovernor &Governor, int Slots, uint32_t LoopsPerSecond, ConcurrencyGovernor::Clock::time_point Start)
+{
+	for (int Slot = 0; Slot < Slots; ++Slot)
+	{
+		Governor.ReportProgress(Slot, 0, Start);
+		Governor.ReportProgress(Slot, LoopsPerSecond * 60, Start + std::chrono::seconds(60));
+	}
+}
+
+bool UnitTest_ConcurrencyGovernor(int argc, char** argv) {
+	try
+	{
+		LadderSettings Settings;
+		Settings.MaxMatchSlots = 4;
+		const ConcurrencyGovernor::Clock::time_point Start;
+		const auto Minute = [&Start](int Minutes) { return Start + std::chrono::minutes(Minutes); };
+		ConcurrencyGovernor Governor(Settings, Start);
+		HostLoad Idle;
+		Idle.CpuPercent = 30.0;
+		HostLoad Busy = Idle;
+		Busy.CpuPercent = 95.0;
+		if (Governor.GetSlots() != 1 || Governor.IsDue(Minute(0) + std::chrono::seconds(30)) || !Governor.IsDue(Minute(1)))
+			return false;
+		// Slots are added while the matches keep their speed.
+		PlayMinute(Governor, 1, 20, Minute(0));
+		if (!Governor.Update(Idle, Minute(1)) || Governor.GetSlots() != 2)
+			return false;
+		PlayMinute(Governor, 2, 20, Minute(1));
+		if (!Governor.Update(Idle, Minute(2)) || Governor.GetSlots() != 3)
+			return false;
+		// Three matches slow each other down, so one is taken away and not tried again for a while.
+		PlayMinute(Governor, 3, 12, Minute(2));
+		if (!Governor.Update(Idle, Minute(3)) || Governor.GetSlots() != 2)
+			return false;
+		PlayMinute(Governor, 2, 20, Minute(3));
+		if (Governor.Update(Idle, Minute(4)) || Governor.GetSlots() != 2)
+			return false;
+		// A busy host or step timeouts take slots away, down to MinMatchSlots.
+		PlayMinute(Governor, 2, 20, Minute(4));
+		if (!Governor.Update(Busy, Minute(5)) || Governor.GetSlots() != 1)
+			return false;
+		GameResult TimedOut;
+		TimedOut.StepTimeouts = 1;
+		Governor.ReportResult(0, TimedOut);
+		if (Governor.Update(Idle, Minute(6)) || Governor.GetSlots() != 1)
+			return false;
+		// Slots are only added again once the hold after the overload has passed.
+		PlayMinute(Governor, 1, 20, Minute(6));
+		if (Governor.Update(Idle, Minute(7)) || Governor.GetSlots() != 1)
+			return false;
+		PlayMinute(Governor, 1, 20, Minute(20));
+		return Governor.Update(Idle, Minute(21)) && Governor.GetSlots() == 2;
+	}
+	catch (const std::exception& e)
+	{
+		std::cerr << "Exception in UnitTest_ConcurrencyGovernor" << std::endl;
+		std::cerr << e.what() << std::endl;
+		return false;
+	}
+}
+
+bool UnitTest_MapCatalog(int argc, char** argv) {
+	try
+	{
+		const std::string GameDirectory = "UnitTest_MapCatalog_Game";
+		const std::string LibraryDirectory = "UnitTest_MapCatalog_Library";
+		const std::string GameMaps = GameDirectory + "/";
+		const std::string LibraryMaps = LibraryDirectory + "/";
+		MakeDirectory(GameDirectory);
+		MakeDirectory(LibraryDirectory);
+		std::ofstream(GameMaps + "Game.SC2Map") << "game map";
+		std::ofstream(LibraryMaps + "Library.SC2Map") << "library map";
+		MapCatalog Catalog({ "Game.SC2Map", "Library.SC2Map", "Missing.SC2Map", "Ladder Map" }, GameMaps, LibraryMaps, true);
+		MapInfo Game;
+		MapInfo Library;
+		const bool Found = Catalog.Find("Game.SC2Map", Game) && Catalog.Find("Library.SC2Map", Library);
+		// A map copied in after startup is found on its first use.
+		const bool Missing = Catalog.IsAvailable("Missing.SC2Map");
+		std::ofstream(GameMaps + "Missing.SC2Map") << "late map";
+		const bool Late = Catalog.IsAvailable("Missing.SC2Map");
+		Catalog.Prewarm("Game.SC2Map");
+		RemoveDirectoryRecursive(GameDirectory);
+		RemoveDirectoryRecursive(LibraryDirectory);
+		if (!Found || Missing || !Late || !Catalog.IsAvailable("Ladder Map"))
+			return false;
+		// Lookups after the first one do not touch the disk.
+		MapInfo Cached;
+		if (!Catalog.Find("Game.SC2Map", Cached) || Cached.Path != Game.Path)
+			return false;
+		return Game.Size == 8 && Game.Path[0] == '/' && Game.Path.find(GameMaps) != std::string::npos
+			&& Library.Path.find(LibraryMaps) != std::string::npos;
+	}
+	catch (const std::exception& e)
+	{
+		std::cerr << "Exception in UnitTest_MapCatalog" << std::endl;
+		std::cerr << e.what() << std::endl;
+		return false;
+	}
+}
+
+bool UnitTest_ResultsJournalTornLine(int argc, char** argv) {
+	try
+	{
+		const std::string JournalFile = "UnitTest_ResultsJournalTornLine.journal";
+		std::remove(JournalFile.c_str());
+		{
+			ResultsJournal Journal(JournalFile, "");
+			Journal.Append(MakeRecord("A", "B", "A", "Map1", 100));
+		}
+		// A crash in the middle of a write leaves a line without its newline.
+		std::ofstream(JournalFile, std::ofstream::app) << "{\"Bot1\":\"Torn";
+		std::vector<ResultRecord> Read;
+		{
+			ResultsJournal Journal(JournalFile, "");
+			Journal.Append(MakeRecord("C", "D", "D", "Map2", 200));
+			Journal.Sync();
+			Journal.ForEach([&Read](const ResultRecord &Record) { Read.push_back(Record); });
+		}
+		std::remove(JournalFile.c_str());
+		return Read.size() == 2 && Read[0].Winner == "A" && Read[1].Winner == "D" && Read[1].UnixTime == 200;
+	}
+	catch (const std::exception& e)
+	{
+		std::cerr << "Exception in UnitTest_ResultsJournalTornLine" << std::endl;
+		std::cerr << e.what() << std::endl;
+		return false;
+	}
+}
+
+bool UnitTest_BotDataSyncManifest(int argc, char** argv) {
+	try
+	{
+		DataManifest Remote;
+		if (!BotDataSync::ParseManifest("{\"Files\":[{\"Path\":\"a.txt\",\"Hash\":\"1\"},{\"Path\":\"dir/b.txt\",\"Hash\":\"2\"},{\"Path\":\"c.txt\",\"Hash\":\"3\"}]}", Remote)
+			|| Remote.size() != 3)
+			return false;
+		// One path outside the data directory spoils the whole manifest.
+		for (const std::string Path : { "../escape", "/etc/passwd", "dir/../../x", "C:\\\\x", "" })
+		{
+			DataManifest Rejected;
+			if (BotDataSync::ParseManifest("{\"Files\":[{\"Path\":\"a.txt\",\"Hash\":\"1\"},{\"Path\":\"" + Path + "\",\"Hash\":\"2\"}]}", Rejected)
+				|| !Rejected.empty())
+				return false;
+		}
+		DataManifest Local;
+		Local["a.txt"].Hash = "1";
+		Local["dir/b.txt"].Hash = "old";
+		Local["stale.txt"].Hash = "4";
+		std::vector<std::string> Changed;
+		std::vector<std::string> Removed;
+		BotDataSync::DiffManifests(Remote, Local, Changed, Removed);
+		return Changed == std::vector<std::string>{ "c.txt", "dir/b.txt" } && Removed == std::vector<std::string>{ "stale.txt" };
+	}
+	catch (const std::exception& e)
+	{
+		std::cerr << "Exception in UnitTest_BotDataSyncManifest" << std::endl;
+		std::cerr << e.what() << std::endl;
+		return false;
+	}
+}
+
+bool UnitTest_FileWatcherRecreate(int argc, char** argv) {
+	try
+	{
+		const std::string BaseDirectory = "UnitTest_FileWatcherRecreate";
+		const std::string BotDirectory = BaseDirectory + "/Bot";
+		const std::string BotFile = BotDirectory + "/ladderbots.json";
+		RemoveDirectoryRecursive(BaseDirectory);
+		MakeDirectory(BaseDirectory);
+		MakeDirectory(BotDirectory);
+		std::ofstream(BotFile) << "first";
+		FileWatcher Watcher;
+		Watcher.WatchSubdirectories(BaseDirectory, "ladderbots.json");
+		const bool Quiet = Watcher.PollChanges().empty();
+		RemoveDirectoryRecursive(BotDirectory);
+		const bool Removed = Watcher.PollChanges().count(BotFile) > 0;
+		// The same directory created again is watched like a new one.
+		MakeDirectory(BotDirectory);
+		std::ofstream(BotFile) << "second";
+		const bool Recreated = Watcher.PollChanges().count(BotFile) > 0;
+		std::ofstream(BotFile) << "third";
+		const bool Rewritten = Watcher.PollChanges().count(BotFile) > 0;
+		RemoveDirectoryRecursive(BaseDirectory);
+		return Quiet && Removed && Recreated && Rewritten;
+	}
+	catch (const std::exception& e)
+	{
+		std::cerr << "Exception in UnitTest_FileWatcherRecreate" << std::endl;
+		std::cerr << e.what() << std::endl;
+		return false;
+	}
+}
+
+bool UnitTest_PairingIndex(int argc, char** argv) {
+	try
+	{
+		PairingIndex Pairing;
+		Pairing.Update("A", 1000);
+		Pairing.Update("B", 1050);
+		Pairing.Update("C", 1100);
+		Pairing.Update("D", 1300);
+		Pairing.Update("Unrated", 0);
+		if (Pairing.CountOpponents("B", 100) != 2 || Pairing.CountOpponents("D", 100) != 0 || Pairing.CountEligiblePairs(100) != 3)
+			return false;
+		if (!Pairing.IsEligible("A", "C", 100) || Pairing.IsEligible("A", "D", 100) || !Pairing.IsEligible("Unrated", "D", 100))
+			return false;
+		// Every choice lands in the window and never on the bot itself.
+		std::set<std::string> Picked;
+		for (uint64_t Choice = 0; Choice < 10; ++Choice)
+		{
+			std::string Opponent;
+			if (!Pairing.PickOpponent("B", 100, Choice, Opponent))
+				return false;
+			Picked.insert(Opponent);
+		}
+		if (Picked != std::set<std::string>{ "A", "C" })
+			return false;
+		std::string Opponent;
+		if (Pairing.PickOpponent("D", 100, 0, Opponent) || Pairing.PickOpponent("Unrated", 100, 0, Opponent))
+			return false;
+		// A disabled bot is taken out of the index and is no longer picked.
+		Pairing.Remove("C");
+		for (uint64_t Choice = 0; Choice < 10; ++Choice)
+		{
+			if (!Pairing.PickOpponent("B", 100, Choice, Opponent) || Opponent != "A")
+				return false;
+		}
+		// Its rating moving later puts it back in a new window.
+		Pairing.Update("C", 1250);
+		return Pairing.CountOpponents("B", 100) == 1 && Pairing.PickOpponent("D", 100, 0, Opponent) && Opponent == "C";
+	}
+	catch (const std::exception& e)
+	{
+		std::cerr << "Exception in UnitTest_PairingIndex" << std::endl;
+		std::cerr << e.what() << std::endl;
+		return false;
+	}
+}
+
+bool UnitTest_SchedulePermutation(int argc, char** argv) {
+	try
+	{
+		// Sizes around the bit widths of the Feistel network, where cycle walking has the most to do.
+		for (const uint64_t Size : { 1, 2, 3, 4, 5, 15, 16, 17, 90, 1000, 4097 })
+		{
+			for (const uint64_t Seed : { 0ULL, 42ULL, 0xFEDCBA9876543210ULL })
+			{
+				const SchedulePermutation Order(Size, Seed);
+				std::vector<bool> Seen(Size, false);
+				for (uint64_t Index = 0; Index < Size; ++Index)
+				{
+					const uint64_t Position = Order.Map(Index);
+					if (Position >= Size || Seen[Position])
+						return false;
+					Seen[Position] = true;
+				}
+			}
+		}
+		// Nothing to permute in an empty schedule, and nothing to map past the end of one.
+		int Rejected = 0;
+		for (const uint64_t Size : { 0, 16 })
+		{
+			try
+			{
+				SchedulePermutation(Size, 1).Map(Size);
+			}
+			catch (const std::out_of_range&)
+			{
+				++Rejected;
+			}
+		}
+		return Rejected == 2;
+	}
+	catch (const std::exception& e)
+	{
+		std::cerr << "Exception in UnitTest_SchedulePermutation" << std::endl;
+		std::cerr << e.what() << std::endl;
+		return false;
+	}
+}
+
+bool UnitTest_ScheduleCursor(int argc, char** argv) {
+	try
+	{
+		const std::string CursorFile = "UnitTest_ScheduleCursor.cursor";
+		{
+			ScheduleCursor Cursor(CursorFile);
+			Cursor.Start(7);
+			Cursor.Append('S', 0, 3);
+			Cursor.Append('S', 1, 2);
+			Cursor.Append('D', 0);
+			Cursor.Append('S', 2);
+		}
+		// A cursor of an older version has no opponents, and a crash may leave a torn line.
+		std::ofstream(CursorFile, std::ofstream::app) << "S 4\nD 2\nS 9";
+		const std::map<uint64_t, uint32_t> Expected{ { 1, 2 }, { 4, UINT32_MAX } };
+		{
+			ScheduleCursor Cursor(CursorFile);
+			Cursor.Open(7, 10);
+			if (Cursor.GetPosition() != 5 || Cursor.GetInFlight() != Expected)
+				return false;
+			Cursor.Append('D', 1);
+		}
+		// The compacted cursor continues where the last run stopped.
+		{
+			ScheduleCursor Cursor(CursorFile);
+			Cursor.Open(7, 10);
+			if (Cursor.GetPosition() != 5 || Cursor.GetInFlight() != std::map<uint64_t, uint32_t>{ { 4, UINT32_MAX } })
+				return false;
+		}
+		// A cursor past the end of the schedule, e.g. of a longer matchup list, starts over.
+		bool Restarted = false;
+		{
+			ScheduleCursor Cursor(CursorFile);
+			Cursor.Open(7, 3);
+			Restarted = Cursor.GetPosition() == 0 && Cursor.GetInFlight().empty();
+		}
+		// So does the cursor of another schedule.
+		bool Replaced = false;
+		{
+			ScheduleCursor Cursor(CursorFile);
+			Cursor.Append('S', 2, 1);
+			Cursor.Open(8, 10);
+			Replaced = Cursor.GetPosition() == 0 && Cursor.GetInFlight().empty();
+		}
+		std::remove(CursorFile.c_str());
+		return Restarted && Replaced;
+	}
+	catch (const std::exception& e)
+	{
+		std::cerr << "Exception in UnitTest_ScheduleCursor" << std::endl;
+		std::cerr << e.what() << std::endl;
+		return false;
+	}
+}
+
+bool UnitTest_RatingEngine(int argc, char** argv) {
+	try
+	{
+		const std::string RatingsFile = "UnitTest_RatingEngine.json";
+		std::remove(RatingsFile.c_str());
+		RatingEngine Ratings(RatingsFile, 32, 1200);
+		// Even ratings expect a draw, so the winner takes half of K.
+		Ratings.Update("A", "B", ResultStore::Bot1Won);
+		if (Ratings.GetRating("A") != 1216 || Ratings.GetRating("B") != 1184)
+			return false;
+		// B was expected to score 0.454, the tie earns it 32 * 0.046.
+		Ratings.Update("B", "A", ResultStore::Tied);
+		Ratings.Update("A", "B", ResultStore::Errored);
+		if (Ratings.GetRating("A") != 1215 || Ratings.GetRating("B") != 1185 || Ratings.GetRating("Unknown") != 1200)
+			return false;
+		if (!Ratings.Save())
+			return false;
+		// Saved ratings are used as long as they cover every result of the store.
+		ResultStore Store;
+		Store.Add(MakeRecord("A", "B", "B", "Map1", 100));
+		Store.Add(MakeRecord("A", "B", "B", "Map1", 200));
+		Store.Add(MakeRecord("A", "B", "B", "Map1", 300));
+		RatingEngine Loaded(RatingsFile, 32, 1200);
+		Loaded.Initialize(Store);
+		if (Loaded.GetRating("A") != 1215 || Loaded.GetRating("B") != 1185 || Loaded.GetRating("Unknown") != 1200)
+			return false;
+		// With more results than they were computed from, the history is replayed.
+		Store.Add(MakeRecord("C", "A", "Error", "Map1", 400));
+		RatingEngine Recomputed(RatingsFile, 32, 1200);
+		Recomputed.Initialize(Store);
+		const bool Replayed = Recomputed.GetRating("B") > 1240 && Recomputed.GetRating("A") + Recomputed.GetRating("B") == 2400
+			&& Recomputed.GetRating("C") == 1200;
+		std::remove(RatingsFile.c_str());
+		return Replayed;
+	}
+	catch (const std::exception& e)
+	{
+		std::cerr << "Exception in UnitTest_RatingEngine" << std::endl;
+		std::cerr << e.what() << std::endl;
+		return false;
+	}
+}
+
+bool UnitTest_CorePlanner(int argc, char** argv) {
+	try
+	{
+		CorePlanner Planner(2, { { 0, 1, 2 }, { 3, 4, 5 } });
+		if (Planner.GetCoreCount() != 6 || Planner.GetNodeCount() != 2)
+			return false;
+		// Each node first, then the cores left over on both are spread over them.
+		const std::vector<int> First = Planner.Acquire();
+		const std::vector<int> Second = Planner.Acquire();
+		const std::vector<int> Spread = Planner.Acquire();
+		if (First != std::vector<int>{ 0, 1 } || Second != std::vector<int>{ 3, 4 } || Spread != std::vector<int>{ 2, 5 })
+			return false;
+		std::set<int> Leased;
+		for (const std::vector<int> &Cores : { First, Second, Spread })
+		{
+			Leased.insert(Cores.begin(), Cores.end());
+		}
+		if (Leased.size() != 6)
+			return false;
+		// Out of cores, the match runs unpinned.
+		if (!Planner.Acquire().empty())
+			return false;
+		Planner.Release(Second);
+		if (Planner.Acquire() != Second)
+			return false;
+		Planner.Release(First);
+		{
+			CoreLease Lease(&Planner);
+			if (Lease.GetCores() != First || !Planner.Acquire().empty())
+				return false;
+		}
+		// The lease gave its cores back when it went out of scope.
+		return Planner.Acquire() == First && Planner.Acquire().empty();
+	}
+	catch (const std::exception& e)
+	{
+		std::cerr << "Exception in UnitTest_CorePlanner" << std::endl;
+		std::cerr << e.what() << std::endl;
+		return false;
+	}
+}
+
+bool UnitTest_PendingResponses(int argc, char** argv) {
+	try
+	{
+		typedef SC2APIProtocol::Response Response;
+		PendingResponses Pending(3);
+		// Nothing in flight, anything may be sent.
+		if (!Pending.canForward())
+			return false;
+		// Actions and queries are pipelined, the proxy does not act on their responses.
+		Pending.push(Response::ResponseCase::kAction);
+		Pending.push(Response::ResponseCase::kQuery);
+		if (!Pending.canForward())
+			return false;
+		// The limit holds even for requests that could be pipelined.
+		Pending.push(Response::ResponseCase::kPing);
+		if (Pending.canForward() || Pending.size() != 3)
+			return false;
+		if (Pending.pop() != Response::ResponseCase::kAction || !Pending.canForward())
+			return false;
+		// Nothing is written behind a step or an observation until they are answered.
+		for (const Response::ResponseCase Acted : { Response::ResponseCase::kStep, Response::ResponseCase::kObservation, Response::ResponseCase::kJoinGame })
+		{
+			PendingResponses Single(32);
+			Single.push(Acted);
+			if (Single.canForward())
+				return false;
+		}
+		// Before a surrender or the result request every response is passed on, oldest first.
+		Pending.push(Response::ResponseCase::kObservation);
+		std::vector<Response::ResponseCase> Drained;
+		Pending.drain([&Drained](Response::ResponseCase Expected) { Drained.push_back(Expected); return true; });
+		if (!Pending.empty() || Drained != std::vector<Response::ResponseCase>{ Response::ResponseCase::kQuery, Response::ResponseCase::kPing, Response::ResponseCase::kObservation })
+			return false;
+		// A lost response leaves nothing to wait for.
+		Pending.push(Response::ResponseCase::kAction);
+		Pending.push(Response::ResponseCase::kAction);
+		size_t Received = 0;
+		Pending.drain([&Received](Response::ResponseCase) { ++Received; return false; });
+		return Received == 1 && Pending.empty() && Pending.canForward();
+	}
+	catch (const std::exception& e)
+	{
+		std::cerr << "Exception in UnitTest_PendingResponses" << std::endl;
+		std::cerr << e.what() << std::endl;
+		return false;
+	}
+}
+
 // Handy macro from: s2client-api/tests/all_tests.cc
 #define TEST(X)                                                     \
     std::cout << "Running unit test: " << #X << std::endl;          \
@@ -29,6 +823,23 @@ int main(int argc, char** argv) {
 	bool success = true;
 
 	TEST(UnitTest_Dummy);
+	TEST(UnitTest_ResultStore);
+	TEST(UnitTest_ResultsJournalUsage);
+	TEST(UnitTest_ResultsJournalTornLine);
+	TEST(UnitTest_MatchLeases);
+	TEST(UnitTest_ReplayArchive);
+	TEST(UnitTest_ReplayRename);
+	TEST(UnitTest_ReplayRenameCompressed);
+	TEST(UnitTest_ConcurrencyGovernor);
+	TEST(UnitTest_MapCatalog);
+	TEST(UnitTest_BotDataSyncManifest);
+	TEST(UnitTest_FileWatcherRecreate);
+	TEST(UnitTest_PairingIndex);
+	TEST(UnitTest_SchedulePermutation);
+	TEST(UnitTest_ScheduleCursor);
+	TEST(UnitTest_RatingEngine);
+	TEST(UnitTest_CorePlanner);
+	TEST(UnitTest_PendingResponses);
 	// Add more tests here...
 
 	if (success)